@@ -3,7 +3,14 @@ use strict;
 use warnings;
 
 use Exporter qw(import);
-our @EXPORT = qw(readEncLog readDecLog);
+our @EXPORT = qw(readEncLog readDecLog readStageTimes readTraceSummary);
+
+# names of the per-attribute stages in the log
+my %stage_map = (
+	positions => 'geometry',
+	colors => 'colour',
+	reflectances => 'reflectance',
+);
 
 ##
 # parse output of encoder log
@@ -17,12 +24,7 @@ sub readEncLog {
 	while (<$fh>) {
 		chomp;
 		if (m{^(positions|colors|reflectances|\w+) bitstream size (\d+) B \((\d+(\.\d+(e[+-]\d+)?)?) bpp\)}) {
-			my %map = (
-				positions => 'geometry',
-				colors => 'colour',
-				reflectances => 'reflectance',
-			);
-			my $key = $map{$1} || $1;
+			my $key = $stage_map{$1} || $1;
 
 			no warnings;
 			$result{"enc.bits.$key"} += $2 * 8;
@@ -74,4 +76,45 @@ sub readDecLog {
 	return \%result;
 }
 
+##
+# parse the per-stage processing times of an encoder or decoder log.
+# returns the user time in seconds of each stage, keyed by $prefix.stage
+sub readStageTimes {
+	my ($file, $prefix) = @_;
+
+	open my $fh, '<', $file
+		or return {};
+
+	my %result;
+	while (<$fh>) {
+		chomp;
+		if (m{^(\w+) processing time \(user\): (\d+(\.\d+)?) s}) {
+			my $key = $stage_map{$1} || $1;
+			$result{"$prefix.$key"} += $2;
+		}
+	}
+
+	return \%result;
+}
+
+##
+# parse a trace summary (--traceSummaryFile) written by a tracing build.
+# returns the total time in seconds of each zone, keyed by $prefix.zone
+sub readTraceSummary {
+	my ($file, $prefix) = @_;
+
+	open my $fh, '<', $file
+		or return {};
+
+	my %result;
+	while (<$fh>) {
+		chomp;
+		my ($kind, $name, $count, $total_ms) = split /,/;
+		next unless $kind eq 'zone';
+		$result{"$prefix.$name"} = $total_ms / 1000;
+	}
+
+	return \%result;
+}
+
 1;
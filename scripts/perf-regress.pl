@@ -0,0 +1,825 @@
+#!/usr/bin/env perl
+
+use 5.022;
+use Cwd qw(abs_path);
+use Digest::MD5;
+use File::Basename qw(dirname);
+use File::Find;
+use File::Path qw(make_path);
+use FindBin;
+use Getopt::Long;
+use JSON::PP;
+use List::Util qw(max);
+use POSIX qw(strftime);
+use Pod::Usage;
+use Sys::Hostname;
+use Time::HiRes;
+use strict;
+
+use lib "$FindBin::Bin";
+use MPEG::PCC::Parse::Tmc3;
+
+=head1 NAME
+
+perf-regress.pl - Run codec performance jobs and compare against a baseline
+
+=head1 SYNOPSIS
+
+perf-regress.pl [options] --tmc3=path --ply-synth=path [--baseline=file]
+
+perf-regress.pl [options] --compare=results.json --baseline=file
+
+=head1 DESCRIPTION
+
+A fixed set of encode and decode jobs is run over synthetic (or locally
+cached) sequences using the test conditions in cfg/*.yaml.  The encoder
+and decoder configurations are generated by gen-cfg.pl exactly as by
+gen-cfg.sh.  No network access and no distortion metric tool is needed.
+
+Each job is repeated, recording for the encoder and the decoder:
+
+ - the wall and cpu (user + system) time,
+ - the peak resident set size,
+ - the per-stage user times reported in the log, and any trace zone
+   times (when tmc3 is built with ENABLE_TRACING),
+
+along with the size and md5 of the bitstream and of the reconstruction.
+A job fails if the decoder reconstruction differs from the encoder's, or
+if repetitions are not bit-exact.
+
+The results are written as JSON.  When a baseline is given, the results
+are compared against it and a report is written to stdout.  A timing or
+memory metric regresses if its median increases by more than the
+relative threshold and by more than the measurement noise (--sigma
+times the combined standard error, estimated from the median absolute
+deviation of the repetitions).  Any change to a bitstream is also
+treated as a regression.  Per-stage times are reported but do not
+affect the exit status.
+
+The exit status is 0 if there are no regressions, 1 if there are and
+2 on error.
+
+=head1 OPTIONS
+
+=over 4
+
+=item B<--tmc3>=path
+
+The codec under test.
+
+=item B<--ply-synth>=path
+
+The synthetic sequence generator.  Only required if the synthetic
+sources are not already cached.
+
+=item B<--workdir>=dir (default perf-regress)
+
+Location of the generated configurations, sources, and job outputs.
+
+=item B<--src-cache>=dir (default $workdir/src)
+
+Location of the generated synthetic sources.  Sources are regenerated
+only if absent or if their generation parameters change.
+
+=item B<--src-base-dir>=dir
+
+Base directory of locally cached CTC sequences, ie, the
+sequence-base-dir of cfg/sequences-*.yaml.
+
+=item B<--sequences>=seq1[,seq2,...] (default synth_dense_vox10)
+
+The sequences to test.  Synthetic sequences are named synth_*, others
+are taken from cfg/sequences-cat2.yaml and cfg/sequences-cat3.yaml.
+
+=item B<--cfg-sets>=set1[,set2,...] (default all)
+
+The configuration sets to test, as generated by gen-cfg.sh: octree-raht,
+trisoup-raht, octree-raht-inter, and trisoup-raht-inter.
+
+=item B<--jobs>=regex
+
+Only run jobs with an identifier ($set/$category/$sequence/$variant)
+matching regex.
+
+=item B<--frames>=n (default 2)
+
+The number of frames of each sequence to code.
+
+=item B<--points>=n (default 100000)
+
+The approximate number of points in each frame of a synthetic sequence.
+
+=item B<--repeats>=n (default 3)
+
+The number of times each job is run.
+
+=item B<--output>=file (default $workdir/results.json)
+
+Where to write the results.
+
+=item B<--compare>=file
+
+Compare an existing results file against the baseline without running
+any jobs.
+
+=item B<--baseline>=file
+
+The baseline to compare against.
+
+=item B<--update-baseline>
+
+Replace the baseline with the results, after any comparison.
+
+=item B<--time-threshold>=percent (default 5)
+
+=item B<--rss-threshold>=percent (default 10)
+
+The relative increase in a timing or memory metric above which it may
+be considered a regression.
+
+=item B<--min-time>=seconds (default 0.05)
+
+Time differences below this are never considered significant.
+
+=item B<--sigma>=k (default 3)
+
+The number of standard errors by which a difference must exceed the
+measurement noise to be significant.
+
+=item B<--allow-bitstream-change>
+
+Report bitstream changes without treating them as regressions.
+
+=back
+
+=head1 BASELINE FORMAT
+
+The baseline is a results file.  Results are versioned by the
+I<format_version> key, which is incremented for incompatible changes.
+The codec version, host, and job parameters are recorded so that
+incomparable results may be detected: results produced with different
+job parameters are not compared, while a different host produces a
+warning.
+
+=cut
+
+
+my $format_version = 1;
+
+##
+# Command line processing
+my $do_help = '';
+my $tmc3 = '';
+my $synth = '';
+my $workdir = 'perf-regress';
+my $src_cache = '';
+my $src_base_dir = '';
+my $sequences = 'synth_dense_vox10';
+my $cfg_sets = 'octree-raht,trisoup-raht,octree-raht-inter,trisoup-raht-inter';
+my $job_filter = '';
+my $frames = 2;
+my $points = 100000;
+my $repeats = 3;
+my $output = '';
+my $compare = '';
+my $baseline = '';
+my $update_baseline = 0;
+my $time_threshold = 5;
+my $rss_threshold = 10;
+my $min_time = 0.05;
+my $sigma = 3;
+my $allow_bitstream_change = 0;
+GetOptions(
+	'help' => \$do_help,
+	'tmc3=s' => \$tmc3,
+	'ply-synth=s' => \$synth,
+	'workdir=s' => \$workdir,
+	'src-cache=s' => \$src_cache,
+	'src-base-dir=s' => \$src_base_dir,
+	'sequences=s' => \$sequences,
+	'cfg-sets=s' => \$cfg_sets,
+	'jobs=s' => \$job_filter,
+	'frames=i' => \$frames,
+	'points=i' => \$points,
+	'repeats=i' => \$repeats,
+	'output=s' => \$output,
+	'compare=s' => \$compare,
+	'baseline=s' => \$baseline,
+	'update-baseline!' => \$update_baseline,
+	'time-threshold=f' => \$time_threshold,
+	'rss-threshold=f' => \$rss_threshold,
+	'min-time=f' => \$min_time,
+	'sigma=f' => \$sigma,
+	'allow-bitstream-change!' => \$allow_bitstream_change,
+) or pod2usage(2);
+
+pod2usage(0) if $do_help;
+pod2usage(2) unless $tmc3 || $compare;
+pod2usage(2) if $compare && !$baseline;
+
+# any failure to run is reported with exit status 2
+$SIG{__DIE__} = sub { die @_ if $^S; print STDERR @_; exit 2; };
+
+my $cfg_dir = abs_path("$FindBin::Bin/../cfg");
+
+##
+# The configuration sets, as per gen-cfg.sh
+my %cfg_set_yaml = (
+	'octree-raht' => [qw(
+		octree-raht-ctc-lossless-geom-lossy-attrs.yaml
+		octree-raht-ctc-lossy-geom-lossy-attrs.yaml
+		octree-raht-ctc-lossless-geom-lossless-attrs.yaml
+	)],
+	'trisoup-raht' => [qw(
+		trisoup-raht-ctc-lossy-geom-lossy-attrs.yaml
+	)],
+);
+$cfg_set_yaml{"$_-inter"} = [map {"inter/$_"} @{$cfg_set_yaml{$_}}]
+	foreach (keys %cfg_set_yaml);
+
+##
+# Synthetic sequences: ply-synth arguments and sequence properties in
+# the form of cfg/sequences-*.yaml.  The per-category properties (only
+# used by trisoup) are those of similar CTC sequences.
+my %synth_sequences = (
+	synth_dense_vox10 => {
+		args => "--profile=dense --precisionBits=10 --rotationPerFrame=2",
+		props => {
+			'group' => 'cat2-synthetic',
+			'src-geometry-precision' => 10,
+			'has_colour' => 1,
+			'bitdepth_colour' => 8,
+		},
+		cat_props => { 'test-depth' => 10, 'thickness' => 24 },
+	},
+	synth_dense_vox11 => {
+		args => "--profile=dense --precisionBits=11 --rotationPerFrame=1",
+		props => {
+			'group' => 'cat2-synthetic',
+			'src-geometry-precision' => 11,
+			'has_colour' => 1,
+			'bitdepth_colour' => 8,
+		},
+		cat_props => { 'test-depth' => 11, 'thickness' => 36 },
+	},
+);
+
+my $results;
+if ($compare) {
+	$results = read_json($compare);
+}
+else {
+	$results = run_all();
+	write_json($output, $results);
+	print "results written to $output\n";
+}
+
+my $status = 0;
+if ($baseline && -f $baseline) {
+	$status = compare_results(read_json($baseline), $results);
+}
+elsif ($baseline && !$update_baseline) {
+	die "$baseline: no such baseline\n";
+}
+
+if ($baseline && $update_baseline) {
+	write_json($baseline, $results);
+	print "baseline $baseline updated\n";
+}
+
+exit $status;
+
+
+#############################################################################
+# running jobs
+
+sub run_all {
+	$tmc3 = abs_path($tmc3) // die "$tmc3: not found\n";
+	die "$tmc3: not executable\n" unless -x $tmc3;
+
+	make_path($workdir);
+	$workdir = abs_path($workdir);
+	$src_cache = abs_path($src_cache || "$workdir/src");
+	$output ||= "$workdir/results.json";
+
+	my @seqs = split /,/, $sequences;
+	prepare_synth_source($_) foreach grep {exists $synth_sequences{$_}} @seqs;
+
+	my @jobs;
+	foreach my $set (split /,/, $cfg_sets) {
+		die "unknown configuration set: $set\n" unless $cfg_set_yaml{$set};
+		push @jobs, generate_cfg($set, @seqs);
+	}
+	@jobs = grep {$_->{id} =~ m{$job_filter}} @jobs if $job_filter;
+	die "no jobs selected\n" unless @jobs;
+
+	my %results = (
+		format_version => $format_version,
+		created => strftime("%Y-%m-%dT%H:%M:%SZ", gmtime),
+		host => host_info(),
+		tmc3 => { path => $tmc3, md5 => md5_files($tmc3) },
+		params => {
+			frames => $frames,
+			points => $points,
+			repeats => $repeats,
+			sequences => join(',', sort @seqs),
+		},
+		jobs => {},
+	);
+
+	my $idx = 0;
+	foreach my $job (@jobs) {
+		printf "[%d/%d] %s\n", ++$idx, scalar @jobs, $job->{id};
+		my $result = run_job($job);
+		$results{tmc3}{version} //= delete $result->{version};
+		delete $result->{version};
+		$results{jobs}{$job->{id}} = $result;
+		print "  error: $result->{error}\n" if $result->{error};
+	}
+
+	return \%results;
+}
+
+##
+# Generate the synthetic source sequence $name (if not cached)
+sub prepare_synth_source {
+	my ($name) = @_;
+	my $dir = "$src_cache/$name";
+	my $args = "$synth_sequences{$name}{args} --numPoints=$points";
+	$args .= " --seed=1 --outputBinaryPly=1 --frameCount=$frames";
+
+	my $stamp = "$dir/ply-synth.args";
+	if (-f $stamp && read_file($stamp) eq "$args\n") {
+		return unless grep {!-f sprintf "$dir/${name}_%04d.ply", $_}
+			0 .. $frames - 1;
+	}
+
+	die "--ply-synth is required to generate $name\n" unless $synth;
+	print "generating $name\n";
+	make_path($dir);
+	unlink $stamp;
+	my @cmd = ($synth, split(/ /, $args), "--outPath=$dir/${name}_%04d.ply");
+	system_quiet("$dir/ply-synth.log", @cmd) == 0
+		or die "$name: ply-synth failed, see $dir/ply-synth.log\n";
+	write_file($stamp, "$args\n");
+}
+
+##
+# Generate the configuration tree for $set with gen-cfg.pl, returning
+# the list of jobs
+sub generate_cfg {
+	my ($set, @seqs) = @_;
+	my $prefix = "$workdir/cfg/$set";
+	make_path($prefix);
+
+	my @yaml = map {"$cfg_dir/$_"} @{$cfg_set_yaml{$set}};
+	my @categories = map {yaml_categories($_)} @yaml;
+	my $seq_yaml = "$prefix/sequences-perf.yaml";
+	write_file($seq_yaml, sequences_yaml(\@categories, @seqs));
+
+	my @cmd = (
+		"$FindBin::Bin/gen-cfg.pl", "--prefix=$prefix",
+		"--output-src-glob-sh", "--only-seqs=" . join(':', @seqs),
+		@yaml,
+		"$cfg_dir/sequences-cat2.yaml", "$cfg_dir/sequences-cat3.yaml",
+		$seq_yaml,
+	);
+	system_quiet("$prefix/gen-cfg.log", @cmd) == 0
+		or die "$set: gen-cfg.pl failed, see $prefix/gen-cfg.log\n";
+
+	my @jobs;
+	find({ no_chdir => 1, wanted => sub {
+		return unless m{/encoder\.cfg$};
+		my $dir = dirname($_);
+		(my $id = $dir) =~ s{^\Q$workdir/cfg/\E}{};
+		push @jobs, { id => $id, cfgdir => $dir };
+	}}, $prefix);
+
+	return sort {$a->{id} cmp $b->{id}} @jobs;
+}
+
+##
+# The names of the categories defined in a cfg yaml file
+sub yaml_categories {
+	my ($file) = @_;
+	my $in_categories = 0;
+	my @categories;
+	foreach (split /\n/, read_file($file)) {
+		if (m{^(\S+):}) { $in_categories = $1 eq 'categories'; next }
+		push @categories, $1 if $in_categories && m{^  ([\w-]+):\s*$};
+	}
+	return @categories;
+}
+
+##
+# A sequence specification to be merged with the cfg yaml files that
+# describes the synthetic sequences and adds them to each category.
+sub sequences_yaml {
+	my ($categories, @seqs) = @_;
+	my @synth = grep {exists $synth_sequences{$_}} @seqs;
+
+	my $yaml = "# Generated by perf-regress.pl\n---\n";
+	$yaml .= "sequence-base-dir: '$src_base_dir'\n" if $src_base_dir;
+	return $yaml unless @synth;
+
+	$yaml .= "sequences:\n";
+	foreach my $name (@synth) {
+		my $props = $synth_sequences{$name}{props};
+		$yaml .= "  $name:\n";
+		$yaml .= "    base-dir: '$src_cache'\n";
+		$yaml .= "    src-dir: $name\n";
+		$yaml .= "    src: ${name}_%04d.ply\n";
+		$yaml .= "    first-frame: 0\n";
+		$yaml .= "    num-frames: $frames\n";
+		$yaml .= "    $_: $props->{$_}\n" foreach sort keys %$props;
+	}
+
+	$yaml .= "categories:\n";
+	foreach my $cat (@$categories) {
+		$yaml .= "  $cat:\n    sequences:\n";
+		foreach my $name (@synth) {
+			my $props = $synth_sequences{$name}{cat_props};
+			$yaml .= "      $name: { "
+				. join(', ', map {"$_: $props->{$_}"} sort keys %$props)
+				. " }\n";
+		}
+	}
+
+	return $yaml;
+}
+
+##
+# The source of a job as (printf pattern, first frame number)
+sub job_source {
+	my ($job) = @_;
+	my $glob = "$job->{cfgdir}/src-glob.sh";
+	-f $glob or die "$job->{id}: no source location\n";
+	chomp(my $src = read_file($glob));
+
+	# convert a brace expansion of frame numbers to a pattern
+	if ($src =~ m/^(.*)\{(\d+)\.\.(\d+)\}(.*)$/) {
+		my ($pre, $first, $post) = ($1, $2, $4);
+		return ("$pre%0" . length($first) . "d$post", $first);
+	}
+
+	return ($src, 0);
+}
+
+##
+# Run the encoder and decoder of $job $repeats times
+sub run_job {
+	my ($job) = @_;
+	my $dir = "$workdir/jobs/$job->{id}";
+	make_path($dir);
+	unlink glob "$dir/*";
+
+	my ($src, $first) = job_source($job);
+	my $num_frames = $frames;
+	$num_frames = 1 unless $src =~ m/%/;
+
+	my @enc_cmd = (
+		$tmc3, "--config=$job->{cfgdir}/encoder.cfg",
+		"--uncompressedDataPath=$src",
+		"--firstFrameNum=$first", "--frameCount=$num_frames",
+		"--compressedStreamPath=$dir/out.bin",
+		"--reconstructedDataPath=$dir/enc%04d.ply",
+		"--traceSummaryFile=$dir/enc.trace.csv",
+	);
+
+	my @dec_cmd = (
+		$tmc3, "--config=$job->{cfgdir}/decoder.cfg",
+		"--compressedStreamPath=$dir/out.bin",
+		"--reconstructedDataPath=$dir/dec%04d.ply",
+		"--firstFrameNum=$first",
+		"--traceSummaryFile=$dir/dec.trace.csv",
+	);
+
+	my %result = (encode => {}, decode => {});
+	for (my $r = 0; $r < $repeats; $r++) {
+		my $enc = run_measured("$dir/enc.log", @enc_cmd);
+		return { error => "encoder failed, see $dir/enc.log" }
+			if $enc->{status};
+		my $enc_stages = readStageTimes("$dir/enc.log", 'enc.utime');
+		my $enc_trace = readTraceSummary("$dir/enc.trace.csv", 'enc.zone');
+
+		my $dec = run_measured("$dir/dec.log", @dec_cmd);
+		return { error => "decoder failed, see $dir/dec.log" }
+			if $dec->{status};
+		my $dec_stages = readStageTimes("$dir/dec.log", 'dec.utime');
+		my $dec_trace = readTraceSummary("$dir/dec.trace.csv", 'dec.zone');
+
+		add_samples($result{encode}, $enc, $enc_stages, $enc_trace);
+		add_samples($result{decode}, $dec, $dec_stages, $dec_trace);
+
+		my $bin_md5 = md5_files("$dir/out.bin");
+		my $enc_md5 = md5_files(sort glob "$dir/enc*.ply");
+		my $dec_md5 = md5_files(sort glob "$dir/dec*.ply");
+
+		return { error => "decoder reconstruction differs from encoder" }
+			if $enc_md5 ne $dec_md5;
+
+		if ($r) {
+			return { error => "bitstream differs between repetitions" }
+				if $bin_md5 ne $result{bitstream}{md5};
+			next;
+		}
+
+		($result{version}) =
+			read_file("$dir/enc.log") =~ m{^MPEG PCC tmc3 version (\S+)}m;
+		$result{bitstream} = { bytes => -s "$dir/out.bin", md5 => $bin_md5 };
+		$result{reconstruction} = { md5 => $dec_md5 };
+	}
+
+	return \%result;
+}
+
+##
+# Append a sample of each measured metric to $stats
+sub add_samples {
+	my ($stats, $run, @logs) = @_;
+
+	my %sample = (
+		wall => $run->{wall},
+		cpu => $run->{cpu},
+		peak_rss_kib => $run->{maxrss},
+	);
+
+	# per-stage times: the enc.utime.$stage / dec.zone.$zone entries
+	foreach my $log (@logs) {
+		while (my ($key, $value) = each %$log) {
+			next unless $key =~ m{^\w+\.(utime|zone)\.(.+)$};
+			$sample{"stage.$1.$2"} = $value;
+		}
+	}
+
+	while (my ($key, $value) = each %sample) {
+		push @{$stats->{$key}}, $value if defined $value;
+	}
+}
+
+##
+# Run a command with output redirected to $log, measuring the wall time
+# and the cpu time and peak rss of the child process
+sub run_measured {
+	my ($log, @cmd) = @_;
+
+	my $t0 = Time::HiRes::time;
+	my $pid = fork // die "fork: $!\n";
+	unless ($pid) {
+		open STDOUT, '>', $log or die "$log: $!\n";
+		open STDERR, '>&', \*STDOUT;
+		exec @cmd or POSIX::_exit(127);
+	}
+
+	my ($status, $cpu, $maxrss) = wait_rusage($pid);
+	my $wall = Time::HiRes::time - $t0;
+
+	return { status => $status, wall => $wall, cpu => $cpu, maxrss => $maxrss };
+}
+
+##
+# Wait for $pid returning the exit status and, if available, the cpu time
+# and peak rss (KiB) of the child.  Uses wait4(2) for the resource usage
+# of the child (not available through perl's waitpid).
+sub wait_rusage {
+	my ($pid) = @_;
+
+	my $have_wait4 = eval { require 'syscall.ph'; defined &SYS_wait4 };
+	if ($have_wait4) {
+		# struct rusage: two timevals followed by fourteen longs
+		my $status = pack 'i', 0;
+		my $rusage = "\0" x (18 * length pack 'l!', 0);
+		my $ret;
+		do {
+			$ret = syscall(&SYS_wait4, $pid + 0, $status, 0, $rusage);
+		} while ($ret == -1 && $!{EINTR});
+		die "wait4: $!\n" if $ret == -1;
+
+		my @ru = unpack 'l!18', $rusage;
+		my $cpu = $ru[0] + $ru[1] / 1e6 + $ru[2] + $ru[3] / 1e6;
+		return (unpack('i', $status), $cpu, $ru[4]);
+	}
+
+	# fallback: cpu time by difference, peak rss is unavailable
+	my (undef, undef, $cu0, $cs0) = times;
+	waitpid $pid, 0;
+	my $status = $?;
+	my (undef, undef, $cu1, $cs1) = times;
+	return ($status, $cu1 - $cu0 + $cs1 - $cs0, undef);
+}
+
+sub system_quiet {
+	my ($log, @cmd) = @_;
+	return run_measured($log, @cmd)->{status};
+}
+
+sub host_info {
+	my ($cpu) = read_file('/proc/cpuinfo') =~ m{^model name\s*:\s*(.*)$}m;
+	my $ncpu = () = read_file('/proc/cpuinfo') =~ m{^processor\s*:}mg;
+	return { name => hostname(), cpu => $cpu // '', ncpu => $ncpu };
+}
+
+
+#############################################################################
+# comparison
+
+##
+# Compare $cur against $base, printing a report.  Returns the number of
+# regressions (saturated to 1).
+sub compare_results {
+	my ($base, $cur) = @_;
+
+	foreach ($base, $cur) {
+		die "unsupported results format_version $_->{format_version}\n"
+			if $_->{format_version} != $format_version;
+	}
+
+	my $params = sub { join ' ', map {"$_=$_[0]{params}{$_}"} sort keys %{$_[0]{params}} };
+	die "incomparable results: baseline has " . $params->($base)
+		. ", results have " . $params->($cur) . "\n"
+		if $params->($base) ne $params->($cur);
+
+	print "\n";
+	print "baseline: tmc3 $base->{tmc3}{version}, $base->{created}\n";
+	print "results:  tmc3 $cur->{tmc3}{version}, $cur->{created}\n";
+	foreach my $key (qw(name cpu ncpu)) {
+		next if $base->{host}{$key} eq $cur->{host}{$key};
+		print "warning: host $key differs: '$base->{host}{$key}'"
+			. " vs '$cur->{host}{$key}', timings may not be comparable\n";
+	}
+	print "\n";
+
+	my @metrics = (
+		['encode', 'cpu', 'enc cpu', $time_threshold, $min_time],
+		['encode', 'wall', 'enc wall', $time_threshold, $min_time],
+		['decode', 'cpu', 'dec cpu', $time_threshold, $min_time],
+		['decode', 'wall', 'dec wall', $time_threshold, $min_time],
+		['encode', 'peak_rss_kib', 'enc rss', $rss_threshold, 0],
+		['decode', 'peak_rss_kib', 'dec rss', $rss_threshold, 0],
+	);
+
+	my @ids = sort keys %{{%{$base->{jobs}}, %{$cur->{jobs}}}};
+	my $w = max(map {length} 'job', @ids);
+	my $fmt = "%-${w}s %10s %8s %8s %8s %8s %s\n";
+	printf $fmt,
+		'job', 'bytes', 'enc cpu', 'dec cpu', 'enc rss', 'dec rss', 'status';
+
+	my (@details, %count);
+	foreach my $id (@ids) {
+		my $b = $base->{jobs}{$id};
+		my $c = $cur->{jobs}{$id};
+
+		# jobs excluded from the results (eg, by --jobs) are not compared
+		if (!$c) {
+			printf "%-${w}s %10s %s\n", $id, '', 'not run';
+			$count{skipped}++;
+			next;
+		}
+		if ($c->{error}) {
+			printf "%-${w}s %10s %s\n", $id, '', 'ERROR';
+			push @details, "$id: $c->{error}";
+			$count{failed}++;
+			next;
+		}
+		if (!$b || $b->{error}) {
+			printf "%-${w}s %10d %s\n", $id, $c->{bitstream}{bytes}, 'new';
+			$count{new}++;
+			next;
+		}
+
+		# bitstream stability
+		my %status;
+		if ($b->{bitstream}{md5} ne $c->{bitstream}{md5}) {
+			$status{BITSTREAM} = 1;
+			push @details, sprintf "%s: bitstream changed, %d -> %d bytes"
+				. " (%+.3f%%)", $id, $b->{bitstream}{bytes},
+				$c->{bitstream}{bytes},
+				pct($b->{bitstream}{bytes}, $c->{bitstream}{bytes});
+		}
+		elsif ($b->{reconstruction}{md5} ne $c->{reconstruction}{md5}) {
+			$status{BITSTREAM} = 1;
+			push @details, "$id: reconstruction changed";
+		}
+
+		# timing and memory
+		my %cells;
+		foreach my $m (@metrics) {
+			my ($stage, $key, $name, $threshold, $floor) = @$m;
+			my $cmp = compare_metric(
+				$b->{$stage}{$key}, $c->{$stage}{$key}, $threshold, $floor);
+			$cells{$name} = $cmp->{text};
+			next unless $cmp->{verdict};
+
+			$status{$cmp->{verdict} > 0 ? 'SLOWER' : 'faster'} = 1;
+			push @details, "$id: $name $cmp->{detail}";
+
+			# attribute a regression to individual stages
+			next unless $cmp->{verdict} > 0 && $key eq 'cpu';
+			foreach my $s (sort grep {m{^stage\.}} keys %{$c->{$stage}}) {
+				my $sc = compare_metric(
+					$b->{$stage}{$s}, $c->{$stage}{$s}, $threshold, $floor);
+				push @details, "    $s $sc->{detail}" if $sc->{verdict} > 0;
+			}
+		}
+
+		$count{bitstream}++ if $status{BITSTREAM};
+		$count{slower}++ if $status{SLOWER};
+		$count{faster}++ if $status{faster};
+
+		printf $fmt, $id, $c->{bitstream}{bytes},
+			@cells{'enc cpu', 'dec cpu', 'enc rss', 'dec rss'},
+			join(',', sort keys %status) || 'ok';
+	}
+
+	print "\n", map {"$_\n"} @details if @details;
+
+	my $regressed = ($count{failed} // 0) + ($count{slower} // 0);
+	$regressed += $count{bitstream} // 0 unless $allow_bitstream_change;
+
+	printf "\n%d jobs: %d failed, %d slower, %d faster, %d bitstream"
+		. " changes, %d new, %d not run\n",
+		scalar @ids, map {$count{$_} // 0}
+			qw(failed slower faster bitstream new skipped);
+	print $regressed ? "REGRESSION\n" : "no regressions\n";
+
+	return $regressed ? 1 : 0;
+}
+
+##
+# Compare the samples of a metric.  verdict is 1 for a significant
+# increase, -1 for a significant decrease, otherwise 0.
+sub compare_metric {
+	my ($b, $c, $threshold, $floor) = @_;
+	return { text => '-', verdict => 0 } unless $b && $c && @$b && @$c;
+
+	my ($mb, $mc) = (median(@$b), median(@$c));
+	my $se = sqrt(noise(@$b) ** 2 / @$b + noise(@$c) ** 2 / @$c);
+	my $delta = $mc - $mb;
+	my $rel = $mb ? 100 * $delta / $mb : 0;
+
+	my $verdict = 0;
+	if (abs($rel) > $threshold && abs($delta) > $sigma * $se
+		&& abs($delta) > $floor)
+	{
+		$verdict = $delta > 0 ? 1 : -1;
+	}
+
+	return {
+		verdict => $verdict,
+		text => sprintf('%+.1f%%', $rel),
+		detail => sprintf('%.4g -> %.4g (%+.1f%%, noise %.2g)',
+			$mb, $mc, $rel, $sigma * $se),
+	};
+}
+
+# standard deviation estimated from the median absolute deviation
+sub noise {
+	my $m = median(@_);
+	return 1.4826 * median(map {abs($_ - $m)} @_);
+}
+
+sub median {
+	my @v = sort {$a <=> $b} @_;
+	return @v % 2 ? $v[$#v / 2] : ($v[@v / 2 - 1] + $v[@v / 2]) / 2;
+}
+
+sub pct {
+	my ($a, $b) = @_;
+	return $a ? 100 * ($b - $a) / $a : 0;
+}
+
+
+#############################################################################
+# utilities
+
+sub read_file {
+	my ($file) = @_;
+	open my $fh, '<', $file or die "$file: $!\n";
+	local $/;
+	return scalar <$fh>;
+}
+
+sub write_file {
+	my ($file, $data) = @_;
+	open my $fh, '>', $file or die "$file: $!\n";
+	print $fh $data;
+}
+
+sub read_json {
+	return JSON::PP->new->decode(read_file($_[0]));
+}
+
+sub write_json {
+	my ($file, $data) = @_;
+	write_file($file, JSON::PP->new->pretty->canonical->encode($data));
+}
+
+# md5 of the concatenation of files
+sub md5_files {
+	my $md5 = Digest::MD5->new;
+	foreach my $file (@_) {
+		open my $fh, '<:raw', $file or die "$file: $!\n";
+		$md5->addfile($fh);
+	}
+	return $md5->hexdigest;
+}
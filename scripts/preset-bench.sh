@@ -0,0 +1,117 @@
+#!/bin/bash
+#
+# Measure encoding time against bitrate for each encoder speed preset
+# using synthetic sequences generated by ply-synth.
+#
+# usage: preset-bench.sh <tmc3> <ply-synth> [<workdir>] [<frameCount>]
+#                        [<repeats>]
+#
+# The reported time is the minimum encoder user time over the repeated
+# runs.  Every bitstream is decoded and the decoder reconstruction
+# compared against that of the encoder.
+
+set -e
+
+tmc3="$1"
+synth="$2"
+work="${3:-preset-bench}"
+frames="${4:-4}"
+repeats="${5:-1}"
+
+if [[ ! -x "$tmc3" || ! -x "$synth" ]]; then
+	echo "usage: $0 <tmc3> <ply-synth> [<workdir>] [<frameCount>]" \
+		"[<repeats>]"
+	exit 1
+fi
+
+presets=(placebo slow medium fast faster veryfast)
+
+mkdir -p "$work/seq"
+
+##
+# Synthetic sequences
+"$synth" --profile=dense --seed=1 --rotationPerFrame=2 --outputBinaryPly=1 \
+	--frameCount=$frames --outPath="$work/seq/dense%04d.ply" > /dev/null
+"$synth" --profile=lidar --seed=1 --translationPerFrame="200 0 0" \
+	--outputBinaryPly=1 \
+	--frameCount=$frames --outPath="$work/seq/lidar%04d.ply" > /dev/null
+
+col="--convertPlyColourspace=1 --transformType=0 --qp=28 --bitdepth=8"
+col="$col --attribute=color"
+ref="--transformType=0 --qp=34 --bitdepth=8 --attrOffset=0 --attrScale=1"
+ref="$ref --attribute=reflectance"
+oct="--qtbtEnabled=0 --inferredDirectCodingMode=0"
+oct="$oct --neighbourAvailBoundaryLog2=8"
+
+##
+# Test conditions: name, source, encoder arguments
+conds=(
+	dense-intra dense "$oct $col"
+	dense-inter dense "$oct --positionQuantizationScale=0.5
+		--interPredictionEnabled=1 --motionParamPreset=2
+		--randomAccessPeriod=32 --rahtInterPredictionEnabled=1 $col"
+	dense-trisoup dense "$oct --trisoupNodeSizeLog2=4
+		--trisoupQuantizationBits=2 $col"
+	trisoup-inter dense "$oct --trisoupNodeSizeLog2=5
+		--trisoupQuantizationBits=2 --interPredictionEnabled=1
+		--motionParamPreset=2 $col"
+	lidar-inter lidar "--qtbtEnabled=0 --positionQuantizationScale=0.25
+		--interPredictionEnabled=1 --motionParamPreset=1
+		--randomAccessPeriod=8 --inferredDirectCodingMode=1
+		--neighbourAvailBoundaryLog2=8 --rahtInterPredictionEnabled=1 $ref"
+)
+
+# sum of the source point counts
+countPoints() {
+	local n=0 f
+	for f in "$work/seq/$1"*.ply; do
+		n=$((n + $(grep -a -m1 "^element vertex" "$f" | cut -d' ' -f3)))
+	done
+	echo $n
+}
+
+printf "%-14s %-9s %10s %8s %8s %7s\n" \
+	condition preset bytes bpp "time(s)" speedup
+
+status=0
+for ((i = 0; i < ${#conds[@]}; i += 3)); do
+	name=${conds[i]}
+	src=${conds[i+1]}
+	args=${conds[i+2]}
+	points=$(countPoints $src)
+	base=""
+
+	for preset in "${presets[@]}"; do
+		out="$work/$name.$preset"
+		time=""
+		for ((r = 0; r < repeats; r++)); do
+			"$tmc3" --mode=0 $args --frameCount=$frames \
+				--uncompressedDataPath="$work/seq/$src%04d.ply" \
+				--encoderPreset=$preset \
+				--compressedStreamPath="$out.bin" \
+				--reconstructedDataPath="$out.enc%04d.ply" \
+				> "$out.enc.log" 2>&1
+			t=$(awk '/Processing time \(user\)/ {print $4}' "$out.enc.log")
+			time=$(awk -v a=${time:-$t} -v b=$t 'BEGIN {print a < b ? a : b}')
+		done
+		"$tmc3" --mode=1 \
+			--compressedStreamPath="$out.bin" \
+			--reconstructedDataPath="$out.dec%04d.ply" > "$out.dec.log" 2>&1
+
+		for f in "$out".enc*.ply; do
+			if ! cmp -s "$f" "${f/.enc/.dec}"; then
+				echo "$name/$preset: decoder mismatch in $f" >&2
+				status=1
+			fi
+		done
+
+		bytes=$(stat -c %s "$out.bin")
+		base=${base:-$time}
+		awk -v n=$name -v p=$preset -v b=$bytes -v pts=$points \
+			-v t=$time -v t0=$base 'BEGIN {
+				printf "%-14s %-9s %10d %8.4f %8.2f %7.2f\n",
+					n, p, b, 8 * b / pts, t, t0 / t }'
+	done
+done
+
+exit $status
@@ -36,6 +36,7 @@
 #include "AttributeDecoder.h"
 
 #include "AttributeCommon.h"
+#include "AttributeResiduals.h"
 #include "attribute_raw.h"
 #include "constants.h"
 #include "entropy.h"
@@ -43,134 +44,10 @@
 #include "io_hls.h"
 #include "RAHT.h"
 #include "FixedPoint.h"
+#include "pcc_trace.h"
 
 namespace pcc {
 
-//============================================================================
-// An encapsulation of the entropy decoding methods used in attribute coding
-
-class PCCResidualsDecoder : protected AttributeContexts {
-public:
-  PCCResidualsDecoder(
-    const AttributeBrickHeader& abh, const AttributeContexts& ctxtMem);
-
-  EntropyDecoder arithmeticDecoder;
-
-  const AttributeContexts& getCtx() const { return *this; }
-
-  void start(const SequenceParameterSet& sps, const char* buf, int buf_len);
-  void stop();
-
-  int decodeRunLength();
-  int decodeSymbol(int k1, int k2, int k3);
-  void decode(int32_t values[3]);
-  int32_t decode();
-};
-
-//----------------------------------------------------------------------------
-
-PCCResidualsDecoder::PCCResidualsDecoder(
-  const AttributeBrickHeader& abh, const AttributeContexts& ctxtMem)
-  : AttributeContexts(ctxtMem)
-{}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsDecoder::start(
-  const SequenceParameterSet& sps, const char* buf, int buf_len)
-{
-  arithmeticDecoder.setBuffer(buf_len, buf);
-  arithmeticDecoder.enableBypassStream(sps.cabac_bypass_stream_enabled_flag);
-  arithmeticDecoder.setBypassBinCodingWithoutProbUpdate(sps.bypass_bin_coding_without_prob_update);
-  arithmeticDecoder.start();
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsDecoder::stop()
-{
-  arithmeticDecoder.stop();
-}
-
-//----------------------------------------------------------------------------
-
-int
-PCCResidualsDecoder::decodeRunLength()
-{
-  int runLength = 0;
-  auto* ctx = ctxRunLen;
-  for (; runLength < 3; runLength++, ctx++) {
-    int bin = arithmeticDecoder.decode(*ctx);
-    if (!bin)
-      return runLength;
-  }
-
-  for (int i = 0; i < 4; i++) {
-    int bin = arithmeticDecoder.decode(*ctx);
-    if (!bin) {
-      runLength += arithmeticDecoder.decode();
-      return runLength;
-    }
-    runLength += 2;
-  }
-
-  runLength += arithmeticDecoder.decodeExpGolomb(2, *++ctx);
-  return runLength;
-}
-
-//----------------------------------------------------------------------------
-
-int
-PCCResidualsDecoder::decodeSymbol(int k1, int k2, int k3)
-{
-  if (!arithmeticDecoder.decode(ctxCoeffGtN[0][k1]))
-    return 0;
-
-  if (!arithmeticDecoder.decode(ctxCoeffGtN[1][k2]))
-    return 1;
-
-  int coeff_abs_minus2 = arithmeticDecoder.decodeExpGolomb(
-    1, ctxCoeffRemPrefix[k3], ctxCoeffRemSuffix[k3]);
-
-  return coeff_abs_minus2 + 2;
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsDecoder::decode(int32_t value[3])
-{
-  value[1] = decodeSymbol(0, 0, 1);
-  int b0 = value[1] == 0;
-  int b1 = value[1] <= 1;
-  value[2] = decodeSymbol(1 + b0, 1 + b1, 1);
-  int b2 = value[2] == 0;
-  int b3 = value[2] <= 1;
-  value[0] = decodeSymbol(3 + (b0 << 1) + b2, 3 + (b1 << 1) + b3, 0);
-
-  if (b0 && b2)
-    value[0] += 1;
-
-  if (value[0] && arithmeticDecoder.decode())
-    value[0] = -value[0];
-  if (value[1] && arithmeticDecoder.decode())
-    value[1] = -value[1];
-  if (value[2] && arithmeticDecoder.decode())
-    value[2] = -value[2];
-}
-
-//----------------------------------------------------------------------------
-
-int32_t
-PCCResidualsDecoder::decode()
-{
-  auto mag = decodeSymbol(0, 0, 0) + 1;
-  bool sign = arithmeticDecoder.decode();
-  return sign ? -mag : mag;
-}
-
 //============================================================================
 // AttributeDecoderIntf
 
@@ -259,8 +136,10 @@ decodeRaht(
   PCCResidualsDecoder& decoder,
   PCCPointSet3& pointCloud,
   attr::ModeDecoder& predDecoder,
-  const AttributeInterPredParams& attrInterPredParams)
+  const AttributeInterPredParams& attrInterPredParams,
+  RahtWorkspace& rahtWorkspace)
 {
+  PCC_TRACE_ZONE("raht");
   const int voxelCount = pointCloud.getPointCount();
 
   // Morton codes
@@ -273,38 +152,13 @@ decodeRaht(
   // Entropy decode
   std::vector<int> coefficients(attribCount * voxelCount, 0);
   std::vector<Qps> pointQpOffsets;
-  pointQpOffsets.reserve(voxelCount);
-
-  for (auto index : indexOrd) {
-    pointQpOffsets.push_back(qpSet.regionQpOffset(pointCloud[index]));
-  }
+  qpSet.regionQpOffsets(pointCloud, indexOrd, pointQpOffsets);
 
   // Decode coefficients
-  if (attribCount == 3) {
-    int32_t values[3];
-
-    for (int n = 0; n < voxelCount; n++) {
-      int zeroRun = decoder.decodeRunLength();
-      if (zeroRun) {
-        n += zeroRun;
-        if (n >= voxelCount)
-          break;
-      }
-
-      decoder.decode(values);
-      for (int d = 0; d < 3; d++)
-        coefficients[n + voxelCount * d] = values[d];
-    }
-  } else if (attribCount == 1) {
-    for (int n = 0; n < voxelCount; n++) {
-      int zeroRun = decoder.decodeRunLength();
-      if (zeroRun) {
-        n += zeroRun;
-        if (n >= voxelCount)
-          break;
-      }
-      coefficients[n] = decoder.decode();
-    }
+  {
+    PCC_TRACE_ZONE("rahtEntropy");
+    decodeRahtCoefficients(
+      decoder, attribCount, coefficients.data(), voxelCount);
   }
 
   if (attrInterPredParams.hasLocalMotion()) {
@@ -323,7 +177,7 @@ decodeRaht(
       aps.rahtPredParams, qpSet, pointQpOffsets.data(), attribCount,
       voxelCount, mortonCode.data(), attributes.data(), voxelCount_mc,
       mortonCode_mc.data(), attributes_mc.data(), coefficients.data(),
-      predDecoder);
+      predDecoder, rahtWorkspace);
   } else {
     predDecoder.reset();
     predDecoder.set(&decoder.arithmeticDecoder);
@@ -331,7 +185,7 @@ decodeRaht(
     regionAdaptiveHierarchicalInverseTransform(
       aps.rahtPredParams, qpSet, pointQpOffsets.data(), attribCount,
       voxelCount, mortonCode.data(), attributes.data(), 0, nullptr, nullptr,
-      coefficients.data(), predDecoder);
+      coefficients.data(), predDecoder, rahtWorkspace);
   }
 
   int clipMax = (1 << desc.bitdepth) - 1;
@@ -362,7 +216,8 @@ AttributeDecoder::decodeReflectancesRaht(
   const AttributeInterPredParams& attrInterPredParams)
 {
   decodeRaht<1>(
-    desc, aps, qpSet, decoder, pointCloud, predDecoder, attrInterPredParams);
+    desc, aps, qpSet, decoder, pointCloud, predDecoder, attrInterPredParams,
+    _rahtWorkspace);
 }
 
 void
@@ -376,7 +231,8 @@ AttributeDecoder::decodeColorsRaht(
   const AttributeInterPredParams& attrInterPredParams)
 {
   decodeRaht<3>(
-    desc, aps, qpSet, decoder, pointCloud, predDecoder, attrInterPredParams);
+    desc, aps, qpSet, decoder, pointCloud, predDecoder, attrInterPredParams,
+    _rahtWorkspace);
 }
 
 //============================================================================
@@ -43,6 +43,7 @@
 #include "PCCTMC3Common.h"
 #include "quantization.h"
 #include "attr_tools.h"
+#include "RAHT.h"
 
 namespace pcc {
 
@@ -90,6 +91,10 @@ protected:
     PCCPointSet3& pointCloud,
     attr::ModeDecoder& predDecoder,
     const AttributeInterPredParams& attrInterPredParams);
+
+private:
+  // RAHT working buffers, retained across slices
+  RahtWorkspace _rahtWorkspace;
 };
 
 //============================================================================
@@ -35,6 +35,7 @@
 
 #include "AttributeEncoder.h"
 
+#include "AttributeResiduals.h"
 #include "attribute_raw.h"
 #include "constants.h"
 #include "entropy.h"
@@ -42,6 +43,7 @@
 #include "quantization.h"
 #include "RAHT.h"
 #include "FixedPoint.h"
+#include "pcc_trace.h"
 
 #include <algorithm>
 
@@ -53,190 +55,6 @@ namespace pcc {
 //============================================================================
 // An encapsulation of the entropy coding methods used in attribute coding
 
-class PCCResidualsEncoder : protected AttributeContexts {
-public:
-  PCCResidualsEncoder(
-    const AttributeParameterSet& aps,
-    const AttributeBrickHeader& abh,
-    const AttributeContexts& ctxtMem);
-
-  EntropyEncoder arithmeticEncoder;
-
-  const AttributeContexts& getCtx() const { return *this; }
-
-  void start(const SequenceParameterSet& sps, int numPoints);
-  int stop();
-
-  void encodeRunLength(int runLength);
-  void encodeSymbol(uint32_t value, int k1, int k2, int k3);
-  void encode(int32_t value0, int32_t value1, int32_t value2);
-  void encode(int32_t value);
-
-  // Encoder side residual cost calculation
-  const int scaleRes = 1 << 20;
-  const int windowLog2 = 6;
-  int probResGt0[3];  //prob of residuals larger than 0: 1 for each component
-  int probResGt1[3];  //prob of residuals larger than 1: 1 for each component
-  void resStatUpdateColor(Vec3<int32_t> values);
-  void resStatUpdateRefl(int32_t values);
-  void resStatReset();
-};
-
-//----------------------------------------------------------------------------
-
-PCCResidualsEncoder::PCCResidualsEncoder(
-  const AttributeParameterSet& aps,
-  const AttributeBrickHeader& abh,
-  const AttributeContexts& ctxtMem)
-  : AttributeContexts(ctxtMem)
-{
-  resStatReset();
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::start(const SequenceParameterSet& sps, int pointCount)
-{
-  // todo(df): remove estimate when arithmetic codec is replaced
-  int maxAcBufLen = pointCount * 3 * 2 + 1024;
-  arithmeticEncoder.setBuffer(maxAcBufLen, nullptr);
-  arithmeticEncoder.enableBypassStream(sps.cabac_bypass_stream_enabled_flag);
-  arithmeticEncoder.setBypassBinCodingWithoutProbUpdate(sps.bypass_bin_coding_without_prob_update);
-  arithmeticEncoder.start();
-}
-
-//----------------------------------------------------------------------------
-
-int
-PCCResidualsEncoder::stop()
-{
-  return arithmeticEncoder.stop();
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::resStatReset()
-{
-  for (int k = 0; k < 3; k++)
-    probResGt0[k] = probResGt1[k] = (scaleRes >> 1);
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::resStatUpdateColor(Vec3<int32_t> value)
-{
-  for (int k = 0; k < 3; k++) {
-    probResGt0[k] += value[k] ? (scaleRes - probResGt0[k]) >> windowLog2
-                              : -((probResGt0[k]) >> windowLog2);
-    if (value[k])
-      probResGt1[k] += abs(value[k]) > 1
-        ? (scaleRes - probResGt1[k]) >> windowLog2
-        : -((probResGt1[k]) >> windowLog2);
-  }
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::resStatUpdateRefl(int32_t value)
-{
-  probResGt0[0] += value ? (scaleRes - probResGt0[0]) >> windowLog2
-                         : -(probResGt0[0] >> windowLog2);
-  if (value)
-    probResGt1[0] += abs(value) > 1 ? (scaleRes - probResGt1[0]) >> windowLog2
-                                    : -(probResGt1[0] >> windowLog2);
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::encodeRunLength(int runLength)
-{
-  auto* ctx = ctxRunLen;
-  for (int i = 0; i < std::min(3, runLength); i++, ctx++)
-    arithmeticEncoder.encode(1, *ctx);
-
-  if (runLength < 3) {
-    arithmeticEncoder.encode(0, *ctx);
-    return;
-  }
-  runLength -= 3;
-
-  auto prefix = runLength >> 1;
-  for (int i = 0; i < std::min(4, prefix); i++)
-    arithmeticEncoder.encode(1, *ctx);
-
-  if (runLength < 8) {
-    arithmeticEncoder.encode(0, *ctx);
-    arithmeticEncoder.encode(runLength & 1);
-    return;
-  }
-  runLength -= 8;
-
-  arithmeticEncoder.encodeExpGolomb(runLength, 2, *++ctx);
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::encodeSymbol(uint32_t value, int k1, int k2, int k3)
-{
-  arithmeticEncoder.encode(value > 0, ctxCoeffGtN[0][k1]);
-  if (!value)
-    return;
-
-  arithmeticEncoder.encode(--value > 0, ctxCoeffGtN[1][k2]);
-  if (!value)
-    return;
-
-  arithmeticEncoder.encodeExpGolomb(
-    --value, 1, ctxCoeffRemPrefix[k3], ctxCoeffRemSuffix[k3]);
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::encode(int32_t value0, int32_t value1, int32_t value2)
-{
-  int mag0 = abs(value0);
-  int mag1 = abs(value1);
-  int mag2 = abs(value2);
-
-  int b0 = (mag1 == 0);
-  int b1 = (mag1 <= 1);
-  int b2 = (mag2 == 0);
-  int b3 = (mag2 <= 1);
-  encodeSymbol(mag1, 0, 0, 1);
-  encodeSymbol(mag2, 1 + b0, 1 + b1, 1);
-
-  auto mag0minusX = b0 && b2 ? mag0 - 1 : mag0;
-  assert(mag0minusX >= 0);
-  encodeSymbol(mag0minusX, 3 + (b0 << 1) + b2, 3 + (b1 << 1) + b3, 0);
-
-  if (mag0)
-    arithmeticEncoder.encode(value0 < 0);
-  if (mag1)
-    arithmeticEncoder.encode(value1 < 0);
-  if (mag2)
-    arithmeticEncoder.encode(value2 < 0);
-}
-
-//----------------------------------------------------------------------------
-
-void
-PCCResidualsEncoder::encode(int32_t value)
-{
-  int mag = abs(value) - 1;
-  encodeSymbol(mag, 0, 0, 0);
-  arithmeticEncoder.encode(value < 0);
-}
-
-//============================================================================
-// An encapsulation of the entropy coding methods used in attribute coding
-
 struct PCCResidualsEntropyEstimator {
   size_t freq0[kAttributeResidualAlphabetSize + 1];
   size_t freq1[kAttributeResidualAlphabetSize + 1];
@@ -473,8 +291,10 @@ encodeRaht(
   PCCPointSet3& pointCloud,
   PCCResidualsEncoder& encoder,
   attr::ModeEncoder& predEncoder,
-  const AttributeInterPredParams& attrInterPredParams)
+  const AttributeInterPredParams& attrInterPredParams,
+  RahtWorkspace& rahtWorkspace)
 {
+  PCC_TRACE_ZONE("raht");
   const int voxelCount = pointCloud.getPointCount();
 
   // Allocate arrays.
@@ -486,10 +306,7 @@ encodeRaht(
   // Populate input arrays.
   auto indexOrd =
     sortedPointCloud(attribCount, pointCloud, mortonCode, attributes);
-  pointQpOffsets.reserve(voxelCount);
-  for (auto index : indexOrd) {
-    pointQpOffsets.push_back(qpSet.regionQpOffset(pointCloud[index]));
-  }
+  qpSet.regionQpOffsets(pointCloud, indexOrd, pointQpOffsets);
 
   if (attrInterPredParams.hasLocalMotion()) {
     predEncoder.set(&encoder.arithmeticEncoder);
@@ -510,7 +327,7 @@ encodeRaht(
       aps.rahtPredParams, qpSet, pointQpOffsets.data(), attribCount,
       voxelCount, mortonCode.data(), attributes.data(), voxelCount_mc,
       mortonCode_mc.data(), attributes_mc.data(), coefficients.data(),
-      predEncoder);
+      predEncoder, rahtWorkspace);
   } else {
     predEncoder.reset();
     predEncoder.set(&encoder.arithmeticEncoder);
@@ -519,39 +336,15 @@ encodeRaht(
     regionAdaptiveHierarchicalTransform(
       aps.rahtPredParams, qpSet, pointQpOffsets.data(), attribCount,
       voxelCount, mortonCode.data(), attributes.data(), 0, nullptr, nullptr,
-      coefficients.data(), predEncoder);
+      coefficients.data(), predEncoder, rahtWorkspace);
   }
 
   // Entropy encode.
-  int zeroRun = 0;
-  if (attribCount == 3) {
-    int values[attribCount];
-    for (int n = 0; n < voxelCount; ++n) {
-      for (int d = 0; d < attribCount; ++d) {
-        values[d] = coefficients[voxelCount * d + n];
-      }
-      if (!values[0] && !values[1] && !values[2])
-        ++zeroRun;
-      else {
-        encoder.encodeRunLength(zeroRun);
-        encoder.encode(values[0], values[1], values[2]);
-        zeroRun = 0;
-      }
-    }
-  } else if (attribCount == 1) {
-    for (int n = 0; n < voxelCount; ++n) {
-      auto value = coefficients[n];
-      if (!value)
-        ++zeroRun;
-      else {
-        encoder.encodeRunLength(zeroRun);
-        encoder.encode(value);
-        zeroRun = 0;
-      }
-    }
+  {
+    PCC_TRACE_ZONE("rahtEntropy");
+    encodeRahtCoefficients(
+      encoder, attribCount, coefficients.data(), voxelCount);
   }
-  if (zeroRun)
-    encoder.encodeRunLength(zeroRun);
   predEncoder.flush();
 
   int clipMax = (1 << desc.bitdepth) - 1;
@@ -582,7 +375,8 @@ AttributeEncoder::encodeReflectancesTransformRaht(
   const AttributeInterPredParams& attrInterPredParams)
 {
   encodeRaht<1>(
-    desc, aps, qpSet, pointCloud, encoder, predEncoder, attrInterPredParams);
+    desc, aps, qpSet, pointCloud, encoder, predEncoder, attrInterPredParams,
+    _rahtWorkspace);
 }
 
 void
@@ -596,7 +390,8 @@ AttributeEncoder::encodeColorsTransformRaht(
   const AttributeInterPredParams& attrInterPredParams)
 {
   encodeRaht<3>(
-    desc, aps, qpSet, pointCloud, encoder, predEncoder, attrInterPredParams);
+    desc, aps, qpSet, pointCloud, encoder, predEncoder, attrInterPredParams,
+    _rahtWorkspace);
 }
 
 //============================================================================
@@ -45,6 +45,7 @@
 #include "hls.h"
 #include "quantization.h"
 #include "attr_tools.h"
+#include "RAHT.h"
 
 namespace pcc {
 
@@ -94,6 +95,9 @@ protected:
 private:
   // The current attribute slice header
   AttributeBrickHeader* _abh;
+
+  // RAHT working buffers, retained across slices
+  RahtWorkspace _rahtWorkspace;
 };
 
 //============================================================================
@@ -0,0 +1,164 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "AttributeResiduals.h"
+
+#include <algorithm>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#  define PCC_RESIDUALS_SSE2 1
+#  include <emmintrin.h>
+#else
+#  define PCC_RESIDUALS_SSE2 0
+#endif
+
+namespace pcc {
+
+//============================================================================
+// Returns the first position n in [start, count) at which any of the
+// attribCount planes of count coefficients is non-zero, or count.
+
+template<const int attribCount>
+static inline int
+findNonZeroCoeff(const int* coeffs, int count, int start)
+{
+  int n = start;
+
+#if PCC_RESIDUALS_SSE2
+  // test eight positions at a time, locating the first non-zero position
+  // from the byte mask of the comparison
+  const __m128i zero = _mm_setzero_si128();
+  for (; n + 8 <= count; n += 8) {
+    __m128i lo = zero, hi = zero;
+    for (int d = 0; d < attribCount; d++) {
+      auto ptr = reinterpret_cast<const __m128i*>(coeffs + count * d + n);
+      lo = _mm_or_si128(lo, _mm_loadu_si128(ptr));
+      hi = _mm_or_si128(hi, _mm_loadu_si128(ptr + 1));
+    }
+    unsigned zeroLo = _mm_movemask_epi8(_mm_cmpeq_epi32(lo, zero));
+    unsigned zeroHi = _mm_movemask_epi8(_mm_cmpeq_epi32(hi, zero));
+    unsigned nonZero = ~(zeroLo | (zeroHi << 16));
+    if (nonZero)
+      return n + (__builtin_ctz(nonZero) >> 2);
+  }
+#endif
+
+  for (; n < count; n++) {
+    int any = 0;
+    for (int d = 0; d < attribCount; d++)
+      any |= coeffs[count * d + n];
+    if (any)
+      return n;
+  }
+
+  return count;
+}
+
+//============================================================================
+
+template<const int attribCount>
+static void
+encodeCoefficients(PCCResidualsEncoder& encoder, const int* coeffs, int count)
+{
+  for (int n = 0; n < count; n++) {
+    int next = findNonZeroCoeff<attribCount>(coeffs, count, n);
+    int zeroRun = next - n;
+    if (next == count) {
+      if (zeroRun)
+        encoder.encodeRunLength(zeroRun);
+      break;
+    }
+
+    encoder.encodeRunLength(zeroRun);
+    n = next;
+
+    if (attribCount == 3)
+      encoder.encode(coeffs[n], coeffs[count + n], coeffs[2 * count + n]);
+    else if (attribCount == 1)
+      encoder.encode(coeffs[n]);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+void
+encodeRahtCoefficients(
+  PCCResidualsEncoder& encoder, int attribCount, const int* coeffs, int count)
+{
+  if (attribCount == 3)
+    encodeCoefficients<3>(encoder, coeffs, count);
+  else if (attribCount == 1)
+    encodeCoefficients<1>(encoder, coeffs, count);
+}
+
+//============================================================================
+
+template<const int attribCount>
+static void
+decodeCoefficients(PCCResidualsDecoder& decoder, int* coeffs, int count)
+{
+  std::fill_n(coeffs, attribCount * count, 0);
+
+  int32_t values[3];
+  for (int n = 0; n < count; n++) {
+    n += decoder.decodeRunLength();
+    if (n >= count)
+      break;
+
+    if (attribCount == 3) {
+      decoder.decode(values);
+      for (int d = 0; d < 3; d++)
+        coeffs[count * d + n] = values[d];
+    } else if (attribCount == 1)
+      coeffs[n] = decoder.decode();
+  }
+}
+
+//----------------------------------------------------------------------------
+
+void
+decodeRahtCoefficients(
+  PCCResidualsDecoder& decoder, int attribCount, int* coeffs, int count)
+{
+  if (attribCount == 3)
+    decodeCoefficients<3>(decoder, coeffs, count);
+  else if (attribCount == 1)
+    decodeCoefficients<1>(decoder, coeffs, count);
+}
+
+//============================================================================
+
+}  // namespace pcc
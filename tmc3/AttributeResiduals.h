@@ -0,0 +1,377 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "AttributeCommon.h"
+#include "entropy.h"
+#include "hls.h"
+#include "pcc_trace.h"
+
+namespace pcc {
+
+//============================================================================
+// An encapsulation of the entropy coding methods used in attribute coding
+
+class PCCResidualsEncoder : protected AttributeContexts {
+public:
+  PCCResidualsEncoder(
+    const AttributeParameterSet& aps,
+    const AttributeBrickHeader& abh,
+    const AttributeContexts& ctxtMem);
+
+  EntropyEncoder arithmeticEncoder;
+
+  const AttributeContexts& getCtx() const { return *this; }
+
+  void start(const SequenceParameterSet& sps, int numPoints);
+  int stop();
+
+  void encodeRunLength(int runLength);
+  void encodeSymbol(uint32_t value, int k1, int k2, int k3);
+  void encode(int32_t value0, int32_t value1, int32_t value2);
+  void encode(int32_t value);
+
+  // Encoder side residual cost calculation
+  const int scaleRes = 1 << 20;
+  const int windowLog2 = 6;
+  int probResGt0[3];  //prob of residuals larger than 0: 1 for each component
+  int probResGt1[3];  //prob of residuals larger than 1: 1 for each component
+  void resStatUpdateColor(Vec3<int32_t> values);
+  void resStatUpdateRefl(int32_t values);
+  void resStatReset();
+};
+
+//----------------------------------------------------------------------------
+
+inline
+PCCResidualsEncoder::PCCResidualsEncoder(
+  const AttributeParameterSet& aps,
+  const AttributeBrickHeader& abh,
+  const AttributeContexts& ctxtMem)
+  : AttributeContexts(ctxtMem)
+{
+  resStatReset();
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::start(const SequenceParameterSet& sps, int pointCount)
+{
+  // todo(df): remove estimate when arithmetic codec is replaced
+  int maxAcBufLen = pointCount * 3 * 2 + 1024;
+  arithmeticEncoder.setBuffer(maxAcBufLen, nullptr);
+  PCC_TRACE_COUNTER("attrAecBufferBytes", maxAcBufLen);
+  arithmeticEncoder.enableBypassStream(sps.cabac_bypass_stream_enabled_flag);
+  arithmeticEncoder.setBypassBinCodingWithoutProbUpdate(sps.bypass_bin_coding_without_prob_update);
+  arithmeticEncoder.start();
+}
+
+//----------------------------------------------------------------------------
+
+inline int
+PCCResidualsEncoder::stop()
+{
+  return arithmeticEncoder.stop();
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::resStatReset()
+{
+  for (int k = 0; k < 3; k++)
+    probResGt0[k] = probResGt1[k] = (scaleRes >> 1);
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::resStatUpdateColor(Vec3<int32_t> value)
+{
+  for (int k = 0; k < 3; k++) {
+    probResGt0[k] += value[k] ? (scaleRes - probResGt0[k]) >> windowLog2
+                              : -((probResGt0[k]) >> windowLog2);
+    if (value[k])
+      probResGt1[k] += abs(value[k]) > 1
+        ? (scaleRes - probResGt1[k]) >> windowLog2
+        : -((probResGt1[k]) >> windowLog2);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::resStatUpdateRefl(int32_t value)
+{
+  probResGt0[0] += value ? (scaleRes - probResGt0[0]) >> windowLog2
+                         : -(probResGt0[0] >> windowLog2);
+  if (value)
+    probResGt1[0] += abs(value) > 1 ? (scaleRes - probResGt1[0]) >> windowLog2
+                                    : -(probResGt1[0] >> windowLog2);
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::encodeRunLength(int runLength)
+{
+  auto* ctx = ctxRunLen;
+  for (int i = 0; i < std::min(3, runLength); i++, ctx++)
+    arithmeticEncoder.encode(1, *ctx);
+
+  if (runLength < 3) {
+    arithmeticEncoder.encode(0, *ctx);
+    return;
+  }
+  runLength -= 3;
+
+  auto prefix = runLength >> 1;
+  for (int i = 0; i < std::min(4, prefix); i++)
+    arithmeticEncoder.encode(1, *ctx);
+
+  if (runLength < 8) {
+    arithmeticEncoder.encode(0, *ctx);
+    arithmeticEncoder.encode(runLength & 1);
+    return;
+  }
+  runLength -= 8;
+
+  arithmeticEncoder.encodeExpGolomb(runLength, 2, *++ctx);
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::encodeSymbol(uint32_t value, int k1, int k2, int k3)
+{
+  arithmeticEncoder.encode(value > 0, ctxCoeffGtN[0][k1]);
+  if (!value)
+    return;
+
+  arithmeticEncoder.encode(--value > 0, ctxCoeffGtN[1][k2]);
+  if (!value)
+    return;
+
+  arithmeticEncoder.encodeExpGolomb(
+    --value, 1, ctxCoeffRemPrefix[k3], ctxCoeffRemSuffix[k3]);
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::encode(int32_t value0, int32_t value1, int32_t value2)
+{
+  int mag0 = abs(value0);
+  int mag1 = abs(value1);
+  int mag2 = abs(value2);
+
+  int b0 = (mag1 == 0);
+  int b1 = (mag1 <= 1);
+  int b2 = (mag2 == 0);
+  int b3 = (mag2 <= 1);
+  encodeSymbol(mag1, 0, 0, 1);
+  encodeSymbol(mag2, 1 + b0, 1 + b1, 1);
+
+  auto mag0minusX = b0 && b2 ? mag0 - 1 : mag0;
+  assert(mag0minusX >= 0);
+  encodeSymbol(mag0minusX, 3 + (b0 << 1) + b2, 3 + (b1 << 1) + b3, 0);
+
+  if (mag0)
+    arithmeticEncoder.encode(value0 < 0);
+  if (mag1)
+    arithmeticEncoder.encode(value1 < 0);
+  if (mag2)
+    arithmeticEncoder.encode(value2 < 0);
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsEncoder::encode(int32_t value)
+{
+  int mag = abs(value) - 1;
+  encodeSymbol(mag, 0, 0, 0);
+  arithmeticEncoder.encode(value < 0);
+}
+
+//============================================================================
+// An encapsulation of the entropy decoding methods used in attribute coding
+
+class PCCResidualsDecoder : protected AttributeContexts {
+public:
+  PCCResidualsDecoder(
+    const AttributeBrickHeader& abh, const AttributeContexts& ctxtMem);
+
+  EntropyDecoder arithmeticDecoder;
+
+  const AttributeContexts& getCtx() const { return *this; }
+
+  void start(const SequenceParameterSet& sps, const char* buf, int buf_len);
+  void stop();
+
+  int decodeRunLength();
+  int decodeSymbol(int k1, int k2, int k3);
+  void decode(int32_t values[3]);
+  int32_t decode();
+};
+
+//----------------------------------------------------------------------------
+
+inline
+PCCResidualsDecoder::PCCResidualsDecoder(
+  const AttributeBrickHeader& abh, const AttributeContexts& ctxtMem)
+  : AttributeContexts(ctxtMem)
+{}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsDecoder::start(
+  const SequenceParameterSet& sps, const char* buf, int buf_len)
+{
+  arithmeticDecoder.setBuffer(buf_len, buf);
+  arithmeticDecoder.enableBypassStream(sps.cabac_bypass_stream_enabled_flag);
+  arithmeticDecoder.setBypassBinCodingWithoutProbUpdate(sps.bypass_bin_coding_without_prob_update);
+  arithmeticDecoder.start();
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsDecoder::stop()
+{
+  arithmeticDecoder.stop();
+}
+
+//----------------------------------------------------------------------------
+
+inline int
+PCCResidualsDecoder::decodeRunLength()
+{
+  int runLength = 0;
+  auto* ctx = ctxRunLen;
+  for (; runLength < 3; runLength++, ctx++) {
+    int bin = arithmeticDecoder.decode(*ctx);
+    if (!bin)
+      return runLength;
+  }
+
+  for (int i = 0; i < 4; i++) {
+    int bin = arithmeticDecoder.decode(*ctx);
+    if (!bin) {
+      runLength += arithmeticDecoder.decode();
+      return runLength;
+    }
+    runLength += 2;
+  }
+
+  runLength += arithmeticDecoder.decodeExpGolomb(2, *++ctx);
+  return runLength;
+}
+
+//----------------------------------------------------------------------------
+
+inline int
+PCCResidualsDecoder::decodeSymbol(int k1, int k2, int k3)
+{
+  if (!arithmeticDecoder.decode(ctxCoeffGtN[0][k1]))
+    return 0;
+
+  if (!arithmeticDecoder.decode(ctxCoeffGtN[1][k2]))
+    return 1;
+
+  int coeff_abs_minus2 = arithmeticDecoder.decodeExpGolomb(
+    1, ctxCoeffRemPrefix[k3], ctxCoeffRemSuffix[k3]);
+
+  return coeff_abs_minus2 + 2;
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+PCCResidualsDecoder::decode(int32_t value[3])
+{
+  value[1] = decodeSymbol(0, 0, 1);
+  int b0 = value[1] == 0;
+  int b1 = value[1] <= 1;
+  value[2] = decodeSymbol(1 + b0, 1 + b1, 1);
+  int b2 = value[2] == 0;
+  int b3 = value[2] <= 1;
+  value[0] = decodeSymbol(3 + (b0 << 1) + b2, 3 + (b1 << 1) + b3, 0);
+
+  if (b0 && b2)
+    value[0] += 1;
+
+  if (value[0] && arithmeticDecoder.decode())
+    value[0] = -value[0];
+  if (value[1] && arithmeticDecoder.decode())
+    value[1] = -value[1];
+  if (value[2] && arithmeticDecoder.decode())
+    value[2] = -value[2];
+}
+
+//----------------------------------------------------------------------------
+
+inline int32_t
+PCCResidualsDecoder::decode()
+{
+  auto mag = decodeSymbol(0, 0, 0) + 1;
+  bool sign = arithmeticDecoder.decode();
+  return sign ? -mag : mag;
+}
+
+//============================================================================
+// Entropy coding of the attribCount planes of count transform coefficients
+// (each plane stored contiguously, as produced by the RAHT).  Runs of
+// positions at which every plane is zero are coded as run lengths, each
+// followed by the coefficients of the next non-zero position.
+
+void encodeRahtCoefficients(
+  PCCResidualsEncoder& encoder, int attribCount, const int* coeffs, int count);
+
+// All attribCount * count coefficients are written.
+void decodeRahtCoefficients(
+  PCCResidualsDecoder& decoder, int attribCount, int* coeffs, int count);
+
+//============================================================================
+
+}  // namespace pcc
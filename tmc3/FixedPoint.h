@@ -78,9 +78,10 @@ public:
 inline int64_t
 FixedPoint::round()
 {
-  if (this->val > 0)
-    return (kOneHalf + this->val) >> kFracBits;
-  return -((kOneHalf - this->val) >> kFracBits);
+  // NB: branchless form of sign(val) * ((|val| + 1/2) >> kFracBits)
+  int64_t sign = this->val >> 63;
+  int64_t mag = (((this->val ^ sign) - sign) + kOneHalf) >> kFracBits;
+  return (mag ^ sign) - sign;
 }
 
 //----------------------------------------------------------------------------
@@ -122,10 +123,7 @@ FixedPoint::operator*=(const FixedPoint& that)
 inline void
 FixedPoint::fixAfterMultiplication()
 {
-  if (this->val < 0)
-    this->val = -((kOneHalf - this->val) >> kFracBits);
-  else
-    this->val = +((kOneHalf + this->val) >> kFracBits);
+  this->val = round();
 }
 
 //============================================================================
@@ -40,7 +40,6 @@
 #include "quantization.h"
 #include "hls.h"
 #include <vector>
-#include <deque>
 #include "TMC3.h"
 #include "PCCPointSet.h"
 #include "entropy.h"
@@ -61,6 +60,17 @@ enum Mode
   size
 };
 
+// Extent of the encoder's prediction mode decision
+enum class ModeSearch
+{
+  // Rate-distortion decision between all permitted modes
+  kFull,
+  // Intra is not tested below a node coded using inter prediction
+  kReduced,
+  // The preferred permitted mode is chosen without testing
+  kNone,
+};
+
 inline bool isNull(Mode mode) { return mode == Mode::Null; }
 inline bool isIntra(Mode mode) { return mode == Mode::Intra; }
 inline bool isInter(Mode mode) { return mode == Mode::Inter; }
@@ -87,13 +97,22 @@ public:
 
 class ModeEncoder : public ModeCoder {
   EntropyEncoder* arith;
-  std::deque<uint16_t> buffer;
+  // Deferred mode decisions, written out by flush().
+  // NB: the storage is retained between slices.
+  std::vector<uint16_t> buffer;
   std::array<decltype(AdaptiveBitModel::probability), NUMBER_OF_CONTEXT_MODE> rdoModeIsNull;
   std::array<decltype(AdaptiveBitModel::probability), NUMBER_OF_CONTEXT_MODE> rdoModeIsIntra;
   std::array<uint16_t, 512> lut;
   double meanDist;
   double meanRate;
   double learnRate;
+  ModeSearch search;
+
+  // Entropies last computed for each context, and the probability state
+  // (including enableInter) they were computed from.
+  std::array<std::array<double, Mode::size>, NUMBER_OF_CONTEXT_MODE>
+    entropyCache;
+  std::array<uint64_t, NUMBER_OF_CONTEXT_MODE> entropyCacheKey;
 
 public:
   std::array<double, Mode::size> entropy;
@@ -104,11 +123,13 @@ public:
     , meanDist(0)
     , meanRate(1)
     , learnRate(1)
+    , search(ModeSearch::kFull)
   {
     for (int i = 0; i < NUMBER_OF_CONTEXT_MODE; i++) {
       rdoModeIsNull[i] = modeIsNull[i].probability;
       rdoModeIsIntra[i] = modeIsIntra[i].probability;
     }
+    entropyCacheKey.fill(~uint64_t(0));
   }
   void reset()
   {
@@ -117,6 +138,7 @@ public:
       rdoModeIsNull[i] = modeIsNull[i].probability;
       rdoModeIsIntra[i] = modeIsIntra[i].probability;
     }
+    entropyCacheKey.fill(~uint64_t(0));
   }
   void set(EntropyEncoder* coder) {
     arith = coder;
@@ -127,6 +149,9 @@ public:
   }
   ~ModeEncoder() { if (arith) flush(); }
 
+  void setModeSearch(ModeSearch value) { search = value; }
+  ModeSearch getModeSearch() const { return search; }
+
   void encode(int ctxMode, int ctxLevel, Mode real)
   {
     _encode<false>(ctxMode, ctxLevel, real);
@@ -148,29 +173,16 @@ public:
   {
     assert(ctxMode >= 0 && ctxMode < NUMBER_OF_CONTEXT_MODE);
     assert(ctxLevel >= 0 && ctxLevel < NUMBER_OF_LEVELS_MODE);
-    std::fill(
-      entropy.begin(), entropy.end(), std::numeric_limits<double>::infinity());
 
-    bool enableIntra = (ctxMode % 3) > 0;
-    if (!enableInter && !enableIntra) {
-      entropy[Mode::Null] = 0;
-      return entropy;
+    // the entropies only change with the context probabilities
+    uint64_t key = uint64_t(rdoModeIsNull[ctxMode])
+      | uint64_t(rdoModeIsIntra[ctxMode]) << 16 | uint64_t(enableInter) << 32;
+    if (entropyCacheKey[ctxMode] != key) {
+      entropyCacheKey[ctxMode] = key;
+      computeEntropy(ctxMode, entropyCache[ctxMode]);
     }
 
-    double PnotNull = static_cast<double>(rdoModeIsNull[ctxMode]) / 65536.0;
-    entropy[Mode::Null] = -std::log2(1.0 - PnotNull);
-    if (!enableInter || !enableIntra) {
-      if (enableInter) {
-        entropy[Mode::Inter] = -std::log2(PnotNull);
-      } else {
-        entropy[Mode::Intra] = -std::log2(PnotNull);
-      }
-      return entropy;
-    }
-
-    double PnotIntra = static_cast<double>(rdoModeIsIntra[ctxMode]) / 65536.0;
-    entropy[Mode::Intra] = -std::log2(PnotNull * (1.0 - PnotIntra));
-    entropy[Mode::Inter] = -std::log2(PnotNull * PnotIntra);
+    entropy = entropyCache[ctxMode];
     return entropy;
   }
 
@@ -202,6 +214,34 @@ public:
   }
 
 private:
+  // Computes the entropy of each mode given the state of context ctxMode
+  void computeEntropy(int ctxMode, std::array<double, Mode::size>& entropy)
+  {
+    std::fill(
+      entropy.begin(), entropy.end(), std::numeric_limits<double>::infinity());
+
+    bool enableIntra = (ctxMode % 3) > 0;
+    if (!enableInter && !enableIntra) {
+      entropy[Mode::Null] = 0;
+      return;
+    }
+
+    double PnotNull = static_cast<double>(rdoModeIsNull[ctxMode]) / 65536.0;
+    entropy[Mode::Null] = -std::log2(1.0 - PnotNull);
+    if (!enableInter || !enableIntra) {
+      if (enableInter) {
+        entropy[Mode::Inter] = -std::log2(PnotNull);
+      } else {
+        entropy[Mode::Intra] = -std::log2(PnotNull);
+      }
+      return;
+    }
+
+    double PnotIntra = static_cast<double>(rdoModeIsIntra[ctxMode]) / 65536.0;
+    entropy[Mode::Intra] = -std::log2(PnotNull * (1.0 - PnotIntra));
+    entropy[Mode::Inter] = -std::log2(PnotNull * PnotIntra);
+  }
+
   template<bool writeOut>
   void _encode(int ctxMode, int ctxLevel, Mode real)
   {
@@ -538,20 +538,21 @@ public:
     int srcSize = indices.size();
     resize(dstEnd + srcSize);
 
-    for (int i = 0; i < srcSize; i++) {
-      int inputIdx = indices[i];
-      int outputIdx = dstEnd + i;
-      positions[outputIdx] = src.positions[inputIdx];
+    // Gather each attribute in turn
+    for (int i = 0; i < srcSize; i++)
+      positions[dstEnd + i] = src.positions[indices[i]];
 
-      if (hasColors() && src.hasColors())
-        setColor(outputIdx, src.getColor(inputIdx));
+    if (hasColors() && src.hasColors())
+      for (int i = 0; i < srcSize; i++)
+        colors[dstEnd + i] = src.colors[indices[i]];
 
-      if (hasReflectances() && src.hasReflectances())
-        setReflectance(outputIdx, src.getReflectance(inputIdx));
+    if (hasReflectances() && src.hasReflectances())
+      for (int i = 0; i < srcSize; i++)
+        reflectances[dstEnd + i] = src.reflectances[indices[i]];
 
-      if (hasLaserAngles() && src.hasLaserAngles())
-        setLaserAngle(outputIdx, src.getLaserAngle(inputIdx));
-    }
+    if (hasLaserAngles() && src.hasLaserAngles())
+      for (int i = 0; i < srcSize; i++)
+        laserAngles[dstEnd + i] = src.laserAngles[indices[i]];
   }
 
   void appendPartition(const PCCPointSet3& src, uint32_t begin, uint32_t end, bool keepAttributes=true)
@@ -63,6 +63,14 @@ struct DecoderParams {
 
   // Number of fractional bits used in output position representation.
   int outputFpBits;
+
+  // Region of interest.  When not empty, slices that cannot intersect any
+  // of the boxes are not decoded.  The boxes are inclusive and in the
+  // coordinate system of the output cloud (CloudFrame::cloud).
+  std::vector<Box3<int32_t>> roiBoxes;
+
+  // Remove output points that are outside of the region of interest.
+  bool roiClip;
 };
 
 //============================================================================
@@ -82,6 +90,20 @@ public:
 
   int decompress(const PayloadBuffer* buf, Callbacks* callback);
 
+  // Receives the geometry of each octree coded slice after every decoded
+  // octree level, allowing a coarse preview before the slice is complete.
+  // Arguments: the slice id, the number of octree levels still to be
+  // decoded, and the positions in the co-ordinate system of the output
+  // cloud.  Nothing is formed when no callback is set.
+  //
+  // Each level matches the output of a decode with minGeomNodeSizeLog2
+  // set to the number of levels remaining, except in multi-slice frames
+  // once that exceeds the octree depth of some slice: such a decode emits
+  // the root node of the slice, whereas no level is reported for it.
+  typedef std::function<void(int, int, const PCCPointSet3&)> GeometryLevelFn;
+
+  void setGeometryLevelCallback(GeometryLevelFn fn);
+
   //==========================================================================
 
   void storeSps(SequenceParameterSet&& sps);
@@ -98,6 +120,8 @@ private:
   void decodeAttributeBrick(const PayloadBuffer& buf);
   void decodeConstantAttribute(const PayloadBuffer& buf);
   bool dectectFrameBoundary(const PayloadBuffer* buf);
+  bool sliceIntersectsRoi() const;
+  void clipToRoi(PCCPointSet3& cloud) const;
   void outputCurrentCloud(Callbacks* callback);
   void storeCurrentCloudAsRef();
 
@@ -112,6 +136,9 @@ private:
   // Decoder specific parameters
   DecoderParams _params;
 
+  // Optional observer of partially decoded geometry
+  GeometryLevelFn _onGeometryLevel;
+
   // Indicates that pointcloud output should be suppressed at a frame boundary
   bool _suppressOutput;
 
@@ -122,6 +149,9 @@ private:
   // Indicates whether the output has been initialised
   bool _outputInitialized;
 
+  // Indicates that the current slice is outside of the region of interest
+  bool _skipSlice;
+
   // Current identifier of payloads with the same geometry
   int _sliceId;
 
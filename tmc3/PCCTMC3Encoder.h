@@ -57,6 +57,20 @@
 namespace pcc {
 
 //============================================================================
+// Encoder speed presets, trading encoder complexity for coding efficiency.
+// Presets only alter encoder decisions: all bitstreams remain conformant.
+
+enum class EncoderPreset
+{
+  kPlacebo = 0,
+  kSlow,
+  kMedium,
+  kFast,
+  kFaster,
+  kVeryFast,
+};
+
+//----------------------------------------------------------------------------
 
 struct EncoderAttributeParams {
   // NB: this only makes sense for setting configurable parameters
@@ -130,6 +144,16 @@ struct EncoderParams {
 
   // local motion
   int motionPreset;
+
+  // Encoder speed preset
+  EncoderPreset preset;
+
+  // Extent of the RAHT prediction mode search (derived from the preset)
+  attr::ModeSearch attrModeSearch;
+
+  // Skip recolouring when geometry coding is lossless (derived from the
+  // preset)
+  bool skipLosslessRecolour;
 };
 
 //============================================================================
@@ -162,6 +186,7 @@ public:
   static void fixupParameterSets(EncoderParams* params);
   void setInterForCurrPic(bool x) { _codeCurrFrameAsInter = x; }
   static void deriveMotionParams(EncoderParams* params);
+  static void applyEncoderPreset(EncoderParams* params);
 
 private:
   void appendSlice(PCCPointSet3& cloud);
@@ -174,6 +199,9 @@ private:
   attr::ModeEncoder predCoder;
   PCCPointSet3 pointCloud;
 
+  // Attribute encoder, retained across slices to reuse its buffers
+  std::unique_ptr<AttributeEncoderIntf> _attrEncoder;
+
   // Point positions in spherical coordinates of the current slice
   std::vector<point_t> _posSph;
 
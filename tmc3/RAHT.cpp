@@ -35,6 +35,7 @@
 
 #include "RAHT.h"
 
+#include <array>
 #include <cassert>
 #include <cinttypes>
 #include <climits>
@@ -213,68 +214,197 @@ expandLevel(
 }
 
 //============================================================================
-// Search for neighbour with @value in the ordered list [first, last).
+// Morton offsets of the parent neighbours relative to the position of the
+// parent offset by (-1,-1,-1).  The first entry (the parent itself) is not
+// used as an offset.
+
+static const uint8_t kNeighOffset[19] = {0, 35, 21, 14, 49, 42, 28, 1,  2, 3,
+                                         4, 5,  6,  10, 12, 17, 20, 33, 34};
+
+//============================================================================
+// For a child node with index childIdx in its parent, the neighbour i of
+// the child is the child table[childIdx][i].childIdx of the parent's
+// neighbour table[childIdx][i].parentNeigh.
 //
-// If distance is positive, search [from, from+distance].
-// If distance is negative, search [from-distance, from].
+// NB: the neighbours are at most displaced along two axes, the parent of each
+// neighbour is therefore itself a member of the parent neighbourhood.
+
+struct NeighParentEntry {
+  uint8_t parentNeigh;
+  uint8_t childIdx;
+};
 
-template<typename It, typename T, typename T2, typename Cmp>
-It
-findNeighbour(It first, It last, It from, T value, T2 distance, Cmp compare)
+static const std::array<std::array<NeighParentEntry, 19>, 8>&
+neighParentTable()
 {
-  It start = first;
-  It end = last;
-
-  if (distance >= 0) {
-    start = from;
-    if ((distance + 1) < std::distance(from, last))
-      end = std::next(from, distance + 1);
-  } else {
-    end = from;
-    if ((-distance) < std::distance(first, from))
-      start = std::prev(from, -distance);
+  static const std::array<std::array<NeighParentEntry, 19>, 8> table = [] {
+    std::array<std::array<NeighParentEntry, 19>, 8> table;
+
+    // an arbitrary parent position, (2,2,2), away from any boundary
+    const int64_t parentPos = 56;
+    const int64_t parentBasePos = morton3dAdd(parentPos, -1ll);
+
+    for (int childIdx = 0; childIdx < 8; childIdx++) {
+      int64_t childPos = (parentPos << 3) + childIdx;
+      int64_t childBasePos = morton3dAdd(childPos, -1ll);
+      table[childIdx][0] = {0, uint8_t(childIdx)};
+
+      for (int i = 1; i < 19; i++) {
+        int64_t neighPos = morton3dAdd(childBasePos, kNeighOffset[i]);
+        int64_t neighParentPos = neighPos >> 3;
+
+        int j = 0;
+        while (j < 19) {
+          int64_t pos = j ? morton3dAdd(parentBasePos, kNeighOffset[j])
+                          : parentPos;
+          if (pos == neighParentPos)
+            break;
+          j++;
+        }
+
+        assert(j < 19);
+        table[childIdx][i] = {uint8_t(j), uint8_t(neighPos & 7)};
+      }
+    }
+
+    return table;
+  }();
+
+  return table;
+}
+
+//============================================================================
+
+void
+RahtNeighbourIndex::update(const int64_t* positions, int numPoints)
+{
+  // the index is shared by all attributes of a slice
+  if (
+    _positions.size() == size_t(numPoints)
+    && std::equal(positions, positions + numPoints, _positions.begin()))
+    return;
+
+  _positions.assign(positions, positions + numPoints);
+  _levels.clear();
+
+  if (numPoints < 2)
+    return;
+
+  // The uraht tree has a single node at level rootLevel.  The first
+  // transform is at the largest multiple of three less than rootLevel,
+  // the parent nodes of each transform being three levels higher.
+  int rootLevel = ilog2(uint64_t(positions[0] ^ positions[numPoints - 1])) + 1;
+  if (rootLevel < 1)
+    return;
+
+  int numLevels = (rootLevel - 1) / 3 + 2;
+
+  // unique node positions at each level 3 * lvl, for lvl > 0.
+  std::vector<std::vector<int64_t>> nodePos(numLevels);
+  for (int lvl = 1; lvl < numLevels; lvl++) {
+    const int64_t* first = lvl == 1 ? positions : nodePos[lvl - 1].data();
+    const int64_t* last =
+      lvl == 1 ? positions + numPoints : first + nodePos[lvl - 1].size();
+
+    auto& out = nodePos[lvl];
+    for (auto it = first; it != last; it++) {
+      int64_t pos = *it >> 3;
+      if (out.empty() || out.back() != pos)
+        out.push_back(pos);
+    }
   }
 
-  auto found = std::lower_bound(start, end, value, compare);
-  if (found == end)
-    return last;
-  return found;
+  assert(nodePos[numLevels - 1].size() == 1);
+
+  _levels.resize(numLevels);
+  _levels[numLevels - 1].mask.assign(1, 0);
+  _levels[numLevels - 1].start.assign(1, 0);
+
+  const auto& neighParent = neighParentTable();
+
+  // descend the tree deriving the neighbours of each child from those of
+  // the parent
+  std::vector<int> firstChild;
+  std::vector<uint8_t> childOccupancy;
+  for (int lvl = numLevels - 2; lvl > 0; lvl--) {
+    const auto& parentLevel = _levels[lvl + 1];
+    const auto& childPos = nodePos[lvl];
+    const int numChildren = childPos.size();
+
+    // the children of each parent are contiguous
+    firstChild.clear();
+    childOccupancy.clear();
+    for (int i = 0; i < numChildren; i++) {
+      if (!i || (childPos[i] >> 3) != (childPos[i - 1] >> 3)) {
+        firstChild.push_back(i);
+        childOccupancy.push_back(0);
+      }
+      childOccupancy.back() |= 1 << (childPos[i] & 7);
+    }
+
+    auto& level = _levels[lvl];
+    level.mask.resize(numChildren);
+    level.start.resize(numChildren);
+    level.idx.clear();
+
+    for (int i = 0, parent = -1; i < numChildren; i++) {
+      if (parent + 1 < int(firstChild.size()) && firstChild[parent + 1] == i)
+        parent++;
+
+      const auto& entries = neighParent[childPos[i] & 7];
+      uint32_t mask = 0;
+      level.start[i] = level.idx.size();
+
+      for (int n = 1; n < 19; n++) {
+        int neighParentIdx = entries[n].parentNeigh
+          ? parentLevel.neighbour(parent, entries[n].parentNeigh)
+          : parent;
+
+        if (neighParentIdx < 0)
+          continue;
+
+        int childIdx = entries[n].childIdx;
+        uint8_t occupancy = childOccupancy[neighParentIdx];
+        if (!((occupancy >> childIdx) & 1))
+          continue;
+
+        mask |= 1 << n;
+        level.idx.push_back(
+          firstChild[neighParentIdx]
+          + popcnt(uint8_t(occupancy & ((1 << childIdx) - 1))));
+      }
+
+      level.mask[i] = mask;
+    }
+  }
 }
 
 //============================================================================
-// Find the neighbours of the node indicated by @t between @first and @last.
+// Find the neighbours of the node indicated by @it, where @first is the
+// start of its level.  The neighbour ranges are supplied by @neighLevel.
 // The position weight of each found neighbour is stored in two arrays.
 
 template<typename It>
 void
 findNeighbours(
   It first,
-  It last,
   It it,
   It firstChild,
-  It lastChild,
   int level,
   uint8_t occupancy,
   int parentNeighIdx[19],
   int childNeighIdx[12][8],
-  const bool rahtSubnodePredictionEnabled)
+  const bool rahtSubnodePredictionEnabled,
+  const RahtNeighbourIndex::Level& neighLevel)
 {
   static const uint8_t neighMasks[19] = {255, 240, 204, 170, 192, 160, 136,
                                          3,   5,   15,  17,  51,  85,  10,
                                          34,  12,  68,  48,  80};
 
-  // current position (discard extra precision)
-  int64_t cur_pos = it->pos >> level;
-
-  // the position of the parent, offset by (-1,-1,-1)
-  int64_t base_pos = morton3dAdd(cur_pos, -1ll);
-
-  // these neighbour offsets are relative to base_pos
-  static const uint8_t neighOffset[19] = {0, 35, 21, 14, 49, 42, 28, 1,  2, 3,
-                                          4, 5,  6,  10, 12, 17, 20, 33, 34};
+  int nodeIdx = std::distance(first, it);
 
   // special case for the direct parent (no need to search);
-  parentNeighIdx[0] = std::distance(first, it);
+  parentNeighIdx[0] = nodeIdx;
 
   for (int i = 1; i < 19; i++) {
     // Only look for neighbours that have an effect
@@ -283,29 +413,7 @@ findNeighbours(
       continue;
     }
 
-    // compute neighbour address to look for
-    // the delta between it and the current position is
-    int64_t neigh_pos = morton3dAdd(base_pos, neighOffset[i]);
-    int64_t delta = neigh_pos - cur_pos;
-
-    // find neighbour
-    auto found = findNeighbour(
-      first, last, it, neigh_pos, delta,
-      [=](decltype(*it)& candidate, int64_t neigh_pos) {
-        return (candidate.pos >> level) < neigh_pos;
-      });
-
-    if (found == last) {
-      parentNeighIdx[i] = -1;
-      continue;
-    }
-
-    if ((found->pos >> level) != neigh_pos) {
-      parentNeighIdx[i] = -1;
-      continue;
-    }
-
-    parentNeighIdx[i] = std::distance(first, found);
+    parentNeighIdx[i] = neighLevel.neighbour(nodeIdx, i);
   }
 
   if (rahtSubnodePredictionEnabled) {
@@ -581,6 +689,7 @@ uraht_process(
   int* attributes_mc,
   int32_t* coeffBufIt,
   ModeCoder& coder,
+  RahtWorkspace& workspace,
   GetMode getMode)
 {
   // coefficients are stored in three planar arrays.  coeffBufItK is a set
@@ -612,15 +721,22 @@ uraht_process(
     return;
   }
 
-  std::vector<UrahtNode> weightsLf, weightsHf;
-  std::vector<int64_t> attrsLf, attrsHf;
+  auto& weightsLf = workspace.weightsLf;
+  auto& weightsHf = workspace.weightsHf;
+  auto& attrsLf = workspace.attrsLf;
+  auto& attrsHf = workspace.attrsHf;
+  weightsLf.clear();
+  weightsHf.clear();
+  attrsLf.clear();
+  attrsHf.clear();
 
   coder.setInterEnabled(
     rahtPredParams.prediction_enabled_flag
     && rahtPredParams.enable_inter_prediction && (numPoints_mc > 0));
 
-  std::vector<int64_t> interTree;
-  std::vector<int64_t> mortonTranslated;
+  auto& interTree = workspace.interTree;
+  auto& mortonTranslated = workspace.mortonTranslated;
+  interTree.clear();
   if (coder.isInterEnabled()) {
     mortonTranslated.resize(numPoints);
     std::copy(&positions[0], &positions[numPoints], mortonTranslated.begin());
@@ -647,8 +763,13 @@ uraht_process(
   weightsHf.reserve(numPoints);
   attrsHf.reserve(numPoints * numAttrs);
 
+  // neighbours are only required for transform-domain prediction
+  if (rahtPredParams.prediction_enabled_flag)
+    workspace.neighIndex.update(positions, numPoints);
+
   // ascend tree
-  std::vector<int> levelHfPos;
+  auto& levelHfPos = workspace.levelHfPos;
+  levelHfPos.clear();
 
   for (int level = 0, numNodes = weightsLf.size(); numNodes > 1; level++) {
     levelHfPos.push_back(weightsHf.size());
@@ -668,34 +789,37 @@ uraht_process(
   weightsLf[0].offset = 0;
 
   // reconstruction buffers
-  std::vector<int64_t> attrRec, attrRecParent;
-  attrRec.resize(numPoints * numAttrs);
-  attrRecParent.resize(numPoints * numAttrs);
+  auto& attrRec = workspace.attrRec;
+  auto& attrRecParent = workspace.attrRecParent;
+  attrRec.assign(numPoints * numAttrs, 0);
+  attrRecParent.assign(numPoints * numAttrs, 0);
 
-  std::vector<int64_t> attrRecUs, attrRecParentUs;
-  attrRecUs.resize(numPoints * numAttrs);
-  attrRecParentUs.resize(numPoints * numAttrs);
+  auto& attrRecUs = workspace.attrRecUs;
+  auto& attrRecParentUs = workspace.attrRecParentUs;
+  attrRecUs.assign(numPoints * numAttrs, 0);
+  attrRecParentUs.assign(numPoints * numAttrs, 0);
 
-  std::vector<UrahtNode> weightsParent;
-  weightsParent.resize(1, weightsLf[0]);
+  auto& weightsParent = workspace.weightsParent;
+  weightsParent.assign(1, weightsLf[0]);
 
-  std::vector<int> numParentNeigh, numGrandParentNeigh;
-  numParentNeigh.resize(numPoints);
-  numGrandParentNeigh.resize(numPoints);
+  auto& numParentNeigh = workspace.numParentNeigh;
+  auto& numGrandParentNeigh = workspace.numGrandParentNeigh;
+  numParentNeigh.assign(numPoints, 0);
+  numGrandParentNeigh.assign(numPoints, 0);
 
   // indexes of the neighbouring parents
   int parentNeighIdx[19];
   int childNeighIdx[12][8];
 
   // Prediction buffers
-  VecAttr transformBuf;
-  VecAttr attrRecIntra;
+  auto& transformBuf = workspace.transformBuf;
   VecAttr::iterator attrPred;
   VecAttr::iterator attrReal;
   VecAttr::iterator attrPredIntra;
   VecAttr::iterator attrPredInter;
-  std::vector<Mode> modes;
-  std::vector<FixedPoint> parentDc(numAttrs);
+  auto& modes = workspace.modes;
+  auto& parentDc = workspace.parentDc;
+  parentDc.assign(numAttrs, FixedPoint(0));
 
   if (coder.isInterEnabled())
     transformBuf.resize(3 * numAttrs);
@@ -704,6 +828,7 @@ uraht_process(
 
   attrReal = transformBuf.begin();
   attrPred = std::next(attrReal, numAttrs);
+  modes.clear();
   modes.push_back(Mode::Null);
 
   if (coder.isInterEnabled()) {
@@ -764,7 +889,7 @@ uraht_process(
       translateLayer(
         interTree, level / 3, numAttrs, numPoints, numPoints_mc, positions,
         mortonTranslated.data(), positions_mc, attributes_mc,
-        rahtPredParams.integer_haar_enable_flag);
+        rahtPredParams.integer_haar_enable_flag, workspace.interPacked);
     }
 
     // initial scan position of the coefficient buffer
@@ -915,10 +1040,11 @@ uraht_process(
             || (!(rahtPredParams.prediction_skip1_flag && nodeCnt == 1)
               && !(*numGrandParentNeighIt < rahtPredParams.prediction_threshold0))) {
           findNeighbours(
-            weightsParent.begin(), weightsParent.end(), weightsParentIt,
-            weightsLf.begin(), weightsLf.begin() + i, level + 3, occupancy,
+            weightsParent.begin(), weightsParentIt, weightsLf.begin(),
+            level + 3, occupancy,
             parentNeighIdx, childNeighIdx,
-            rahtPredParams.subnode_prediction_enabled_flag);
+            rahtPredParams.subnode_prediction_enabled_flag,
+            workspace.neighIndex.parentLevel(level));
           parentNeighCount = std::count_if(
             parentNeighIdx, parentNeighIdx+19,
             [](const int idx) { return idx >= 0; });
@@ -1356,19 +1482,20 @@ regionAdaptiveHierarchicalTransform(
   int64_t* mortonCode_mc,
   int* attributes_mc,
   int* coefficients,
-  attr::ModeEncoder& encoder)
+  attr::ModeEncoder& encoder,
+  RahtWorkspace& workspace)
 {
   uraht_process(
     rahtPredParams, qpset, pointQpOffsets, attribCount, voxelCount, mortonCode,
     attributes, voxelCount_mc, mortonCode_mc, attributes_mc, coefficients,
-    encoder,
+    encoder, workspace,
     [&qpset, &rahtPredParams](
       attr::ModeEncoder& encoder,
       int nodeCnt, int predCtxLevel,
       bool enableIntraPrediction, bool enableInterPrediction, Mode parentMode,
       Mode neighborsMode, int numAttrs, int64_t weights[],
       std::vector<int64_t>::const_iterator attrRecParent,
-      VecAttr& transformBuf, std::vector<Mode> modes, const int qpLayer,
+      VecAttr& transformBuf, const std::vector<Mode>& modes, const int qpLayer,
       const Qps* nodeQp, bool upperInferMode) {
       if (nodeCnt > 1) {
         if (upperInferMode) {
@@ -1388,9 +1515,10 @@ regionAdaptiveHierarchicalTransform(
         if (predCtxLevel < 0)
           return inferredPredMode;
 
+        int numModes = modes.size();
         if (encoder.isInterEnabled()) {
           if (!enableIntraPrediction && enableInterPrediction) {
-            modes.resize(2);
+            numModes = 2;
           }
 		  else if (!enableIntraPrediction && !enableInterPrediction)
             return Mode::Null;
@@ -1399,16 +1527,31 @@ regionAdaptiveHierarchicalTransform(
             return Mode::Null;
         }
 
+        // without a search, prefer inter prediction when available
+        auto modeSearch = encoder.getModeSearch();
+        if (modeSearch == attr::ModeSearch::kNone) {
+          Mode predMode = Mode::Intra;
+          if (encoder.isInterEnabled() && enableInterPrediction)
+            predMode = Mode::Inter;
+          encoder.encode(predCtxMode, predCtxLevel, predMode);
+          return predMode;
+        }
+
+        // intra is not tested below an inter predicted node
+        if (modeSearch == attr::ModeSearch::kReduced && numModes == 3
+            && attr::isInter(parentMode))
+          numModes = 2;
+
         encoder.getEntropy(predCtxMode, predCtxLevel);
         Mode predMode;
         if(rahtPredParams.integer_haar_enable_flag) {
           predMode = attr::choseMode<HaarKernel>(
-            encoder, transformBuf, modes, weights, numAttrs, qpset, qpLayer,
-            nodeQp);
+            encoder, transformBuf, modes.data(), numModes, weights, numAttrs,
+            qpset, qpLayer, nodeQp);
         } else {
           predMode = attr::choseMode<RahtKernel>(
-            encoder, transformBuf, modes, weights, numAttrs, qpset, qpLayer,
-            nodeQp);
+            encoder, transformBuf, modes.data(), numModes, weights, numAttrs,
+            qpset, qpLayer, nodeQp);
         }
         encoder.encode(predCtxMode, predCtxLevel, predMode);
         return predMode;
@@ -1447,18 +1590,19 @@ regionAdaptiveHierarchicalInverseTransform(
   int64_t* mortonCode_mc,
   int* attributes_mc,
   int* coefficients,
-  attr::ModeDecoder& decoder)
+  attr::ModeDecoder& decoder,
+  RahtWorkspace& workspace)
 {
   uraht_process(
     rahtPredParams, qpset, pointQpOffsets, attribCount, voxelCount, mortonCode,
     attributes, voxelCount_mc, mortonCode_mc, attributes_mc, coefficients,
-    decoder,
+    decoder, workspace,
     [&qpset, &rahtPredParams](
       attr::ModeDecoder& decoder, int nodeCnt, int predCtxLevel,
       bool enableIntraPrediction, bool enableInterPrediction, Mode parentMode,
       Mode neighborsMode, int numAttrs, int64_t weights[],
       std::vector<int64_t>::const_iterator attrRecParent,
-      VecAttr& transformBuf, std::vector<Mode>& modes, const int qpLayer,
+      VecAttr& transformBuf, const std::vector<Mode>& modes, const int qpLayer,
       const Qps* nodeQp, bool upperInferMode) {
       if (nodeCnt > 1) {
         if (upperInferMode) {
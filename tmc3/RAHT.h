@@ -43,9 +43,93 @@
 #include "ply.h"
 #include <vector>
 #include "pointset_processing.h"
+#include "PCCMisc.h"
+#include "PCCTMC3Common.h"
 
 namespace pcc {
 
+//============================================================================
+// The parent neighbourhood (self, 6 faces and 12 edges) of every node at
+// each transform level of the uraht tree.
+//
+// The index depends only upon the (sorted) positions and may therefore be
+// shared by all attributes of a slice.  It is built top-down, each level
+// being derived from the neighbours of the parent level without searching.
+
+class RahtNeighbourIndex {
+public:
+  // Prepares the index for the sorted list of @positions, reusing the
+  // existing index if the positions are unchanged.
+  void update(const int64_t* positions, int numPoints);
+
+  // The neighbours of a single tree level
+  struct Level {
+    // per node: bit i is set when neighbour i (1..18) is present
+    std::vector<uint32_t> mask;
+
+    // per node: position of the first neighbour index in idx
+    std::vector<uint32_t> start;
+
+    // the indexes of the present neighbours, in order of neighbour number
+    std::vector<int> idx;
+
+    // Returns the index of neighbour @i of @node, or -1 if absent.
+    int neighbour(int node, int i) const;
+  };
+
+  // The neighbours of the nodes at tree level @level + 3, ie, the parents
+  // of the nodes transformed at @level.
+  const Level& parentLevel(int level) const { return _levels[level / 3 + 1]; }
+
+private:
+  std::vector<int64_t> _positions;
+  std::vector<Level> _levels;
+};
+
+//----------------------------------------------------------------------------
+
+inline int
+RahtNeighbourIndex::Level::neighbour(int node, int i) const
+{
+  uint32_t nodeMask = mask[node];
+  if (!((nodeMask >> i) & 1))
+    return -1;
+
+  return idx[start[node] + popcnt(nodeMask & ((1u << i) - 1))];
+}
+
+//============================================================================
+// Working buffers of the uraht transform.
+//
+// The buffers are retained between invocations so that, once sized for the
+// largest slice, the transform does not allocate.
+
+struct RahtWorkspace {
+  // the tree nodes and their attributes
+  std::vector<UrahtNode> weightsLf, weightsHf, weightsParent;
+  std::vector<int64_t> attrsLf, attrsHf;
+  std::vector<int> levelHfPos;
+
+  // reconstruction buffers
+  std::vector<int64_t> attrRec, attrRecParent;
+  std::vector<int64_t> attrRecUs, attrRecParentUs;
+  std::vector<int> numParentNeigh, numGrandParentNeigh;
+
+  // motion compensated prediction
+  std::vector<int64_t> interTree;
+  std::vector<int64_t> mortonTranslated;
+  std::vector<MortonCodeWithIndex> interPacked;
+
+  // per-node prediction buffers
+  VecAttr transformBuf;
+  std::vector<FixedPoint> parentDc;
+  std::vector<attr::Mode> modes;
+
+  RahtNeighbourIndex neighIndex;
+};
+
+//============================================================================
+
 void regionAdaptiveHierarchicalTransform(
   const RahtPredictionParams& rahtPredParams,
   const QpSet& qpset,
@@ -58,7 +142,8 @@ void regionAdaptiveHierarchicalTransform(
   int64_t* mortonCode_mc,
   int* attributes_mc,
   int* coefficients,
-  attr::ModeEncoder& encoder);
+  attr::ModeEncoder& encoder,
+  RahtWorkspace& workspace);
 
 void regionAdaptiveHierarchicalInverseTransform(
   const RahtPredictionParams& rahtPredParams,
@@ -72,6 +157,7 @@ void regionAdaptiveHierarchicalInverseTransform(
   int64_t* mortonCode_mc,
   int* attributes_mc,
   int* coefficients,
-  attr::ModeDecoder& decoder);
+  attr::ModeDecoder& decoder,
+  RahtWorkspace& workspace);
 
 } /* namespace pcc */
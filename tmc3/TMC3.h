@@ -43,12 +43,9 @@
 
 #define MAX_PU_DEPTH 0
 
-struct Parameters;
-
 typedef pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock>
   Stopwatch;
 
-bool ParseParameters(int argc, char* argv[], Parameters& params);
 //int Compress(Parameters& params, Stopwatch&);
 //int Decompress(Parameters& params, Stopwatch&);
 
@@ -0,0 +1,120 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PCCTMC3Decoder.h"
+#include "PCCTMC3Encoder.h"
+
+//============================================================================
+
+enum class OutputSystem
+{
+  // Output after global scaling, don't convert to external system
+  kConformance = 0,
+
+  // Scale output to external coordinate system
+  kExternal = 1,
+};
+
+//----------------------------------------------------------------------------
+
+struct Parameters {
+  bool isDecoder;
+
+  // Scale factor to apply when loading the ply before integer conversion.
+  // Eg, If source point positions are in fractional metres converting to
+  // millimetres will allow some fidelity to be preserved.
+  double inputScale;
+
+  // Length of the output point clouds unit vectors.
+  double outputUnitLength;
+
+  // output mode for ply writing (binary or ascii)
+  bool outputBinaryPly;
+
+  // Fractional fixed-point bits retained in conformance output
+  int outputFpBits;
+
+  // Output coordinate system to use
+  OutputSystem outputSystem;
+
+  // when true, configure the encoder as if no attributes are specified
+  bool disableAttributeCoding;
+
+  // Frame number of first file in input sequence.
+  int firstFrameNum;
+
+  // Number of frames to process.
+  int frameCount;
+
+  std::string uncompressedDataPath;
+  std::string compressedStreamPath;
+  std::string reconstructedDataPath;
+
+  // Filename for saving recoloured point cloud (encoder).
+  std::string postRecolorPath;
+
+  // Filename for saving pre inverse scaled point cloud (decoder).
+  std::string preInvScalePath;
+
+  // Sidecar file for the bitstream index (decoder).
+  std::string bitstreamIndexPath;
+
+  // Index of the first frame to output (decoder).
+  int decodeStartFrame;
+
+  // Output files for per-stage tracing: Chrome trace JSON and CSV summary.
+  std::string traceFile;
+  std::string traceSummaryFile;
+
+  // Region of interest boxes as a list of xmin,ymin,zmin,xmax,ymax,zmax
+  std::vector<int> roiBoxes;
+
+  pcc::EncoderParams encoder;
+  pcc::DecoderParams decoder;
+
+  // perform attribute colourspace conversion on ply input/output.
+  bool convertColourspace;
+};
+
+//============================================================================
+
+// Parse the tmc3 command line and configuration files into params.
+// Returns false if the options are invalid or help was requested.
+bool ParseParameters(int argc, char* argv[], Parameters& params);
@@ -89,10 +89,11 @@ translateLayer(
   int64_t* morton_mc,
   int* attr_mc,
   bool integer_haar_enable_flag,
+  std::vector<MortonCodeWithIndex>& packed,
   size_t layerSize)
 {
   size_t shift = layerDepth * 3;
-  std::vector<MortonCodeWithIndex> packed;
+  packed.clear();
   if (layerSize)
     packed.reserve(layerSize / attrCount);
   else
@@ -281,7 +282,8 @@ namespace attr {
   Mode choseMode(
     ModeEncoder& rdo,
     const VecAttr& transformBuf,
-    const std::vector<Mode>& modes,
+    const Mode modes[],
+    const int numModes,
     const int64_t weights[],
     const int numAttrs,
     const QpSet& qpset,
@@ -291,17 +293,18 @@ namespace attr {
     auto coefReal = transformBuf.begin();
     auto coefPred = coefReal + numAttrs;
 
-    VecAttr reconsBuf(numAttrs * (modes.size() + 1));
+    assert(numAttrs <= 3 && numModes <= Mode::size);
+    std::array<std::array<FixedPoint, 8>, 3 * (Mode::size + 1)> reconsBuf{};
+    const int numReconsBufs = numAttrs * (numModes + 1);
     auto recReal = reconsBuf.begin();
     auto recPred = recReal + numAttrs;
 
     // Estimate rate
-    std::vector<int> rate;
-    rate.resize(modes.size(), 0);
+    std::array<int, Mode::size> rate{};
 
     for (int k = 0; k < numAttrs; k++) {
       std::copy(coefReal[k].begin(), coefReal[k].end(), recReal[k].begin());
-      for (int mode = 0; mode < modes.size(); mode++)
+      for (int mode = 0; mode < numModes; mode++)
         recPred[numAttrs * mode + k][0] = coefReal[k][0];
     }
 
@@ -316,7 +319,7 @@ namespace attr {
         auto& q = quantizers[std::min(k, int(quantizers.size()) - 1)];
 
         auto real = coefReal[k][i];
-        for (int mode = 0; mode < modes.size(); mode++) {
+        for (int mode = 0; mode < numModes; mode++) {
           auto attr = real;
           auto& rec = recPred[numAttrs * mode + k][i];
           if (mode) {
@@ -329,10 +332,9 @@ namespace attr {
     }
 
     // Estimate distortion
-    std::vector<double> error;
-    error.resize(modes.size(), 0.0);
+    std::array<double, Mode::size> error{};
 
-    invTransformBlock222<Kernel>(reconsBuf.size(), reconsBuf.begin(), weights);
+    invTransformBlock222<Kernel>(numReconsBufs, reconsBuf.begin(), weights);
 
     w = weights;
     int64_t sum_weight = 0;
@@ -346,7 +348,7 @@ namespace attr {
 
       for (int k = 0; k < numAttrs; k++) {
         auto real = reconsBuf[k][i].round();
-        for (int mode = 0; mode < modes.size(); mode++) {
+        for (int mode = 0; mode < numModes; mode++) {
           double diff = static_cast<double>(
             recPred[numAttrs * mode + k][i].round() - real);
           error[mode] += diff * diff;
@@ -360,9 +362,8 @@ namespace attr {
     /* A value in the interval [3,5] seens good */
     double lambda = rdo.getLambda(4);
 
-    std::vector<double> costFun;
-    costFun.resize(modes.size());
-    for (int mode = 0; mode < modes.size(); mode++) {
+    std::array<double, Mode::size> costFun;
+    for (int mode = 0; mode < numModes; mode++) {
       error[mode] /= sum_weight;
       costFun[mode] = error[mode]
         + lambda * (double(rate[mode]) + rdo.entropy[modes[mode]])
@@ -372,7 +373,7 @@ namespace attr {
       error[Mode::Null],
       (double(rate[Mode::Null]) + rdo.entropy[Mode::Null]) / childCount);
 
-    for (int i = modes.size() - 1; i > 0; i--) {
+    for (int i = numModes - 1; i > 0; i--) {
       bool selected = true;
       int j = 0;
       while (selected && j < i)
@@ -389,7 +390,8 @@ namespace attr {
 template Mode choseMode<HaarKernel>(
     ModeEncoder& rdo,
     const VecAttr& transformBuf,
-    const std::vector<Mode>& modes,
+    const Mode modes[],
+    const int numModes,
     const int64_t weights[],
     const int numAttrs,
     const QpSet& qpset,
@@ -399,7 +401,8 @@ template Mode choseMode<HaarKernel>(
 template Mode choseMode<RahtKernel>(
     ModeEncoder& rdo,
     const VecAttr& transformBuf,
-    const std::vector<Mode>& modes,
+    const Mode modes[],
+    const int numModes,
     const int64_t weights[],
     const int numAttrs,
     const QpSet& qpset,
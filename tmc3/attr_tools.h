@@ -50,6 +50,8 @@ using VecAttr = std::vector<std::array<pcc::FixedPoint, 8>>;
 
 namespace pcc {
 
+struct MortonCodeWithIndex;
+
 struct MotionVector {
   Vec3<int32_t> position;
   int nodeSize;
@@ -73,6 +75,7 @@ void translateLayer(
   int64_t* morton_mc,
   int* attr_mc,
   bool integer_haar_enable_flag,
+  std::vector<MortonCodeWithIndex>& packed,
   size_t layerSize = 0);
 
 //============================================================================
@@ -201,7 +204,8 @@ namespace attr {
   Mode choseMode(
     ModeEncoder& rdo,
     const VecAttr& transformBuf,
-    const std::vector<Mode>& modes,
+    const Mode modes[],
+    const int numModes,
     const int64_t weights[],
     const int numAttrs,
     const QpSet& qpset,
@@ -297,11 +301,14 @@ public:
 
 //============================================================================
 // In-place transform a set of sparse 2x2x2 blocks each using the same weights
+//
+// NB: the butterflies are scalar.  Their 64-bit fixed-point products and
+//     arithmetic shifts have no AVX2 lane equivalent, and so no vector
+//     variants are dispatched.
 
-template<class Kernel>
+template<class Kernel, class It>
 void
-fwdTransformBlock222(
-  const int numBufs, VecAttr::iterator buf, const int64_t weights[])
+fwdTransformBlock222(const int numBufs, It buf, const int64_t weights[])
 {
   static const int a[4 + 4 + 4] = {0, 2, 4, 6, 0, 4, 1, 5, 0, 1, 2, 3};
   static const int b[4 + 4 + 4] = {1, 3, 5, 7, 2, 6, 3, 7, 4, 5, 6, 7};
@@ -331,10 +338,9 @@ fwdTransformBlock222(
   }
 }
 
-template<class Kernel>
+template<class Kernel, class It>
 void
-invTransformBlock222(
-  const int numBufs, VecAttr::iterator buf, const int64_t weights[])
+invTransformBlock222(const int numBufs, It buf, const int64_t weights[])
 {
   static const int a[4 + 4 + 4] = {0, 2, 4, 6, 0, 4, 1, 5, 0, 1, 2, 3};
   static const int b[4 + 4 + 4] = {1, 3, 5, 7, 2, 6, 3, 7, 4, 5, 6, 7};
@@ -0,0 +1,436 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "attribute_conversion.h"
+
+#include "colourspace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+  && (defined(__x86_64__) || defined(__i386__))
+#  define PCC_ATTR_CONV_X86 1
+#  define PCC_TARGET(isa) __attribute__((target(isa), flatten))
+#else
+#  define PCC_ATTR_CONV_X86 0
+#endif
+
+namespace pcc {
+
+//============================================================================
+// Number of points converted per block.  The working set of a block fits
+// comfortably in the L1 cache.
+
+static const int kBlockSize = 64;
+
+//----------------------------------------------------------------------------
+// Rounded division of a fixed-point value with a denominator of D,
+// clipped to [0, 255].  The numerator t includes the rounding offset D/2.
+//
+// The quotient is computed by a multiply-shift that is exact for all
+// t in [0, 256 * D).  *tie is set if the unrounded value lies exactly half
+// way between two integers, where floating-point evaluation may round
+// either way.
+
+template<int D, int K>
+static inline int
+fixedRoundClip8(int t, int* tie)
+{
+  const uint64_t kRecip = (uint64_t(1) << K) / D + 1;
+
+  t = std::min(std::max(t, 0), 256 * D - 1);
+  int q = int((uint64_t(uint32_t(t)) * kRecip) >> K);
+  *tie |= (t == q * D) & (t != 0);
+  return q;
+}
+
+//============================================================================
+
+static inline void
+gbrToYCbCrBt709(Vec3<attr_t>* colours, size_t count)
+{
+  Vec3<attr_t> out[kBlockSize];
+  int tie[kBlockSize];
+
+  for (size_t start = 0; start < count; start += kBlockSize) {
+    Vec3<attr_t>* blk = colours + start;
+    int len = int(std::min(count - start, size_t(kBlockSize)));
+
+    int maxVal = 0;
+    for (int i = 0; i < len; i++)
+      maxVal |= blk[i][0] | blk[i][1] | blk[i][2];
+
+    if (maxVal > 255) {
+      for (int i = 0; i < len; i++)
+        blk[i] = transformGbrToYCbCrBt709(blk[i]);
+      continue;
+    }
+
+    int anyTie = 0;
+    for (int i = 0; i < len; i++) {
+      int g = blk[i][0];
+      int b = blk[i][1];
+      int r = blk[i][2];
+
+      int y = 2126 * r + 7152 * g + 722 * b + 5000;
+      int u = -114572 * r - 385428 * g + 500000 * b + 128500000;
+      int v = 500000 * r - 454153 * g - 45847 * b + 128500000;
+
+      int t = 0;
+      out[i][0] = fixedRoundClip8<10000, 36>(y, &t);
+      out[i][1] = fixedRoundClip8<1000000, 48>(u, &t);
+      out[i][2] = fixedRoundClip8<1000000, 48>(v, &t);
+      tie[i] = t;
+      anyTie |= t;
+    }
+
+    if (anyTie) {
+      for (int i = 0; i < len; i++)
+        if (tie[i])
+          out[i] = transformGbrToYCbCrBt709(blk[i]);
+    }
+
+    std::copy_n(out, len, blk);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+static inline void
+yCbCrBt709ToGbr(Vec3<attr_t>* colours, size_t count)
+{
+  Vec3<attr_t> out[kBlockSize];
+  int tie[kBlockSize];
+
+  for (size_t start = 0; start < count; start += kBlockSize) {
+    Vec3<attr_t>* blk = colours + start;
+    int len = int(std::min(count - start, size_t(kBlockSize)));
+
+    int maxVal = 0;
+    for (int i = 0; i < len; i++)
+      maxVal |= blk[i][0] | blk[i][1] | blk[i][2];
+
+    if (maxVal > 255) {
+      for (int i = 0; i < len; i++)
+        blk[i] = transformYCbCrBt709ToGbr(blk[i]);
+      continue;
+    }
+
+    int anyTie = 0;
+    for (int i = 0; i < len; i++) {
+      int y = 100000 * blk[i][0] + 50000;
+      int u = blk[i][1] - 128;
+      int v = blk[i][2] - 128;
+
+      int r = y + 157480 * v;
+      int g = y - 18733 * u - 46813 * v;
+      int b = y + 185563 * u;
+
+      int t = 0;
+      out[i][0] = fixedRoundClip8<100000, 42>(g, &t);
+      out[i][1] = fixedRoundClip8<100000, 42>(b, &t);
+      out[i][2] = fixedRoundClip8<100000, 42>(r, &t);
+      tie[i] = t;
+      anyTie |= t;
+    }
+
+    if (anyTie) {
+      for (int i = 0; i < len; i++)
+        if (tie[i])
+          out[i] = transformYCbCrBt709ToGbr(blk[i]);
+    }
+
+    std::copy_n(out, len, blk);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+// NB: the following are equivalent to the colourspace.h definitions,
+// written so as to be vectorisable.
+
+static inline void
+gbrToYCgCoR(int bitDepth, Vec3<attr_t>* colours, size_t count)
+{
+  const int offset = 1 << bitDepth;
+
+  for (size_t i = 0; i < count; i++) {
+    int g = colours[i][0];
+    int b = colours[i][1];
+    int r = colours[i][2];
+
+    int co = r - b;
+    int t = b + (co >> 1);
+    int cg = g - t;
+    int y = t + (cg >> 1);
+
+    colours[i][0] = attr_t(y);
+    colours[i][1] = attr_t(cg + offset);
+    colours[i][2] = attr_t(co + offset);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+static inline void
+yCgCoRToGbr(int bitDepth, Vec3<attr_t>* colours, size_t count)
+{
+  const int offset = 1 << bitDepth;
+  const int maxVal = (1 << bitDepth) - 1;
+
+  for (size_t i = 0; i < count; i++) {
+    int y0 = colours[i][0];
+    int cg = colours[i][1] - offset;
+    int co = colours[i][2] - offset;
+
+    int t = y0 - (cg >> 1);
+
+    int g = cg + t;
+    int b = t - (co >> 1);
+    int r = co + b;
+
+    colours[i][0] = attr_t(std::min(std::max(g, 0), maxVal));
+    colours[i][1] = attr_t(std::min(std::max(b, 0), maxVal));
+    colours[i][2] = attr_t(std::min(std::max(r, 0), maxVal));
+  }
+}
+
+//----------------------------------------------------------------------------
+
+static inline void
+scaleFwd(const AttributeParameters& params, attr_t* values, size_t count)
+{
+  const int offset = params.attr_offset;
+  const int fracBits = params.attr_frac_bits;
+  const int scale = params.attr_scale_minus1 + 1;
+
+  // Avoid the division when possible; it prevents vectorisation.
+  if (scale == 1) {
+    for (size_t i = 0; i < count; i++)
+      values[i] = attr_t((values[i] - offset) << fracBits);
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++)
+    values[i] = attr_t(((values[i] - offset) << fracBits) / scale);
+}
+
+//----------------------------------------------------------------------------
+
+static inline void
+scaleInv(const AttributeParameters& params, attr_t* values, size_t count)
+{
+  const int offset = params.attr_offset;
+  const int fracBits = params.attr_frac_bits;
+  const int scale = params.attr_scale_minus1 + 1;
+
+  for (size_t i = 0; i < count; i++)
+    values[i] = attr_t(((values[i] * scale) >> fracBits) + offset);
+}
+
+//============================================================================
+// Per instruction set instantiations of the kernels.
+
+namespace {
+  struct ConversionKernels {
+    AttributeConversionIsa isa;
+    void (*gbrToYCbCrBt709)(Vec3<attr_t>*, size_t);
+    void (*yCbCrBt709ToGbr)(Vec3<attr_t>*, size_t);
+    void (*gbrToYCgCoR)(int, Vec3<attr_t>*, size_t);
+    void (*yCgCoRToGbr)(int, Vec3<attr_t>*, size_t);
+    void (*scaleFwd)(const AttributeParameters&, attr_t*, size_t);
+    void (*scaleInv)(const AttributeParameters&, attr_t*, size_t);
+  };
+}  // namespace
+
+#define PCC_DEFINE_KERNELS(name, attrs, isa)                                 \
+  namespace name {                                                           \
+    attrs static void                                                        \
+    gbrToYCbCrBt709(Vec3<attr_t>* colours, size_t count)                     \
+    {                                                                        \
+      pcc::gbrToYCbCrBt709(colours, count);                                  \
+    }                                                                        \
+    attrs static void                                                        \
+    yCbCrBt709ToGbr(Vec3<attr_t>* colours, size_t count)                     \
+    {                                                                        \
+      pcc::yCbCrBt709ToGbr(colours, count);                                  \
+    }                                                                        \
+    attrs static void                                                        \
+    gbrToYCgCoR(int bitDepth, Vec3<attr_t>* colours, size_t count)           \
+    {                                                                        \
+      pcc::gbrToYCgCoR(bitDepth, colours, count);                            \
+    }                                                                        \
+    attrs static void                                                        \
+    yCgCoRToGbr(int bitDepth, Vec3<attr_t>* colours, size_t count)           \
+    {                                                                        \
+      pcc::yCgCoRToGbr(bitDepth, colours, count);                            \
+    }                                                                        \
+    attrs static void                                                        \
+    scaleFwd(const AttributeParameters& params, attr_t* values, size_t count) \
+    {                                                                        \
+      pcc::scaleFwd(params, values, count);                                  \
+    }                                                                        \
+    attrs static void                                                        \
+    scaleInv(const AttributeParameters& params, attr_t* values, size_t count) \
+    {                                                                        \
+      pcc::scaleInv(params, values, count);                                  \
+    }                                                                        \
+    static const ConversionKernels kKernels = {                              \
+      isa,         gbrToYCbCrBt709, yCbCrBt709ToGbr, gbrToYCgCoR,            \
+      yCgCoRToGbr, scaleFwd,        scaleInv};                               \
+  }
+
+PCC_DEFINE_KERNELS(scalar, , AttributeConversionIsa::kScalar)
+
+#if PCC_ATTR_CONV_X86
+PCC_DEFINE_KERNELS(sse4, PCC_TARGET("sse4.2"), AttributeConversionIsa::kSse4)
+PCC_DEFINE_KERNELS(avx2, PCC_TARGET("avx2"), AttributeConversionIsa::kAvx2)
+#endif
+
+#undef PCC_DEFINE_KERNELS
+
+//============================================================================
+
+AttributeConversionIsa
+detectAttributeConversionIsa()
+{
+#if PCC_ATTR_CONV_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return AttributeConversionIsa::kAvx2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return AttributeConversionIsa::kSse4;
+#endif
+  return AttributeConversionIsa::kScalar;
+}
+
+//----------------------------------------------------------------------------
+
+static const ConversionKernels*
+kernelsFor(AttributeConversionIsa isa)
+{
+  isa = std::min(isa, detectAttributeConversionIsa());
+
+  switch (isa) {
+#if PCC_ATTR_CONV_X86
+  case AttributeConversionIsa::kAvx2: return &avx2::kKernels;
+  case AttributeConversionIsa::kSse4: return &sse4::kKernels;
+#endif
+  default: return &scalar::kKernels;
+  }
+}
+
+//----------------------------------------------------------------------------
+
+static std::atomic<const ConversionKernels*>&
+activeKernels()
+{
+  static std::atomic<const ConversionKernels*> kernels{
+    kernelsFor(AttributeConversionIsa::kAvx2)};
+  return kernels;
+}
+
+//----------------------------------------------------------------------------
+
+AttributeConversionIsa
+attributeConversionIsa()
+{
+  return activeKernels().load()->isa;
+}
+
+//----------------------------------------------------------------------------
+
+void
+selectAttributeConversionIsa(AttributeConversionIsa isa)
+{
+  activeKernels().store(kernelsFor(isa));
+}
+
+//============================================================================
+
+void
+convertGbrToYCbCrBt709(Vec3<attr_t>* colours, size_t count)
+{
+  activeKernels().load()->gbrToYCbCrBt709(colours, count);
+}
+
+//----------------------------------------------------------------------------
+
+void
+convertYCbCrBt709ToGbr(Vec3<attr_t>* colours, size_t count)
+{
+  activeKernels().load()->yCbCrBt709ToGbr(colours, count);
+}
+
+//----------------------------------------------------------------------------
+
+void
+convertGbrToYCgCoR(int bitDepth, Vec3<attr_t>* colours, size_t count)
+{
+  activeKernels().load()->gbrToYCgCoR(bitDepth, colours, count);
+}
+
+//----------------------------------------------------------------------------
+
+void
+convertYCgCoRToGbr(int bitDepth, Vec3<attr_t>* colours, size_t count)
+{
+  activeKernels().load()->yCgCoRToGbr(bitDepth, colours, count);
+}
+
+//----------------------------------------------------------------------------
+
+void
+scaleAttributesFwd(
+  const AttributeParameters& params, attr_t* values, size_t count)
+{
+  activeKernels().load()->scaleFwd(params, values, count);
+}
+
+//----------------------------------------------------------------------------
+
+void
+scaleAttributesInv(
+  const AttributeParameters& params, attr_t* values, size_t count)
+{
+  activeKernels().load()->scaleInv(params, values, count);
+}
+
+//============================================================================
+
+}  // namespace pcc
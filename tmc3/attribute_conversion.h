@@ -0,0 +1,99 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+
+#include "PCCMath.h"
+#include "PCCPointSet.h"
+#include "hls.h"
+
+namespace pcc {
+
+//============================================================================
+// Batched conversions of contiguous attribute storage.
+//
+// Each kernel produces exactly the same result as the per-point reference
+// (colourspace.h, or the attribute scaling equations).  BT.709 uses
+// fixed-point arithmetic for 8-bit inputs, deferring to the floating-point
+// reference for the rare values that lie on a rounding tie; values
+// outside the 8-bit range always use the reference.
+//
+// The kernels are compiled for several instruction sets and selected at
+// runtime.  All variants share the same integer source, so only the
+// instruction selection differs between them.
+
+enum class AttributeConversionIsa
+{
+  kScalar = 0,
+  kSse4 = 1,
+  kAvx2 = 2,
+};
+
+// The best instruction set supported by both the build and the host.
+AttributeConversionIsa detectAttributeConversionIsa();
+
+// The instruction set used by subsequent conversions.
+AttributeConversionIsa attributeConversionIsa();
+
+// Restrict the instruction set used by subsequent conversions; requests
+// for unsupported variants select the best supported one.  Intended for
+// testing and benchmarking.
+void selectAttributeConversionIsa(AttributeConversionIsa isa);
+
+//----------------------------------------------------------------------------
+
+void convertGbrToYCbCrBt709(Vec3<attr_t>* colours, size_t count);
+void convertYCbCrBt709ToGbr(Vec3<attr_t>* colours, size_t count);
+
+void convertGbrToYCgCoR(int bitDepth, Vec3<attr_t>* colours, size_t count);
+void convertYCgCoRToGbr(int bitDepth, Vec3<attr_t>* colours, size_t count);
+
+//----------------------------------------------------------------------------
+// Attribute scaling according to the attribute scaling parameters:
+//   fwd: ((val - attr_offset) << attr_frac_bits) / (attr_scale_minus1 + 1)
+//   inv: ((val * (attr_scale_minus1 + 1)) >> attr_frac_bits) + attr_offset
+
+void scaleAttributesFwd(
+  const AttributeParameters& params, attr_t* values, size_t count);
+
+void scaleAttributesInv(
+  const AttributeParameters& params, attr_t* values, size_t count);
+
+//============================================================================
+
+}  // namespace pcc
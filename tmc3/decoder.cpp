@@ -48,6 +48,7 @@
 #include "io_hls.h"
 #include "io_tlv.h"
 #include "pcc_chrono.h"
+#include "pcc_trace.h"
 #include "osspecific.h"
 
 namespace pcc {
@@ -67,6 +68,7 @@ PCCTMC3Decoder3::init()
   _firstSliceInFrame = true;
   _outputInitialized = false;
   _suppressOutput = 1;
+  _skipSlice = false;
   _sps = nullptr;
   _gps = nullptr;
   _spss.clear();
@@ -150,7 +152,11 @@ PCCTMC3Decoder3::outputCurrentCloud(PCCTMC3Decoder3::Callbacks* callback)
   //     must be applied to a copy.
   scaleGeometry(_outCloud.cloud, _sps->globalScale, _outCloud.outputFpBits);
 
+  if (_params.roiClip)
+    clipToRoi(_outCloud.cloud);
+
   callback->onOutputCloud(_outCloud);
+  PCC_TRACE_PEAK_RSS();
 
   std::swap(_outCloud.cloud, _accumCloud);
   _accumCloud.clear();
@@ -263,8 +269,6 @@ PCCTMC3Decoder3::decompress(
     if (!_outputInitialized)
       startFrame();
 
-    // avoid accidents with stale attribute decoder on next slice
-    _attrDecoder.reset();
     // Avoid dropping an actual frame
     _suppressOutput = false;
 
@@ -272,18 +276,24 @@ PCCTMC3Decoder3::decompress(
     return decodeGeometryBrick(*buf, attrInterPredParams);
 
   case PayloadType::kAttributeBrick:
-    decodeAttributeBrick(*buf);
+    if (!_skipSlice)
+      decodeAttributeBrick(*buf);
     return 0;
 
   case PayloadType::kConstantAttribute:
-    decodeConstantAttribute(*buf);
+    if (!_skipSlice)
+      decodeConstantAttribute(*buf);
     return 0;
 
-  case PayloadType::kTileInventory:
-    // NB: the tile inventory is decoded in xyz order.  It may need
-    //     conversion if it is used (it currently isn't).
-    storeTileInventory(parseTileInventory(*buf));
+  case PayloadType::kTileInventory: {
+    // NB: the tile inventory is decoded in xyz order.
+    auto inventory = parseTileInventory(*buf);
+    auto it = _spss.find(inventory.ti_seq_parameter_set_id);
+    if (it != _spss.end())
+      convertXyzToStv(it->second, &inventory);
+    storeTileInventory(std::move(inventory));
     return 0;
+  }
 
   case PayloadType::kGeneralizedAttrParamInventory: {
     if (!_outputInitialized)
@@ -384,6 +394,7 @@ PCCTMC3Decoder3::decodeGeometryBrick(
   AttributeInterPredParams& attrInterPredParams)
 {
   assert(buf.type == PayloadType::kGeometryBrick);
+  PCC_TRACE_ZONE("geometry");
   std::cout << "positions bitstream size " << buf.size() << " B\n";
 
   // todo(df): replace with attribute mapping
@@ -448,6 +459,15 @@ PCCTMC3Decoder3::decodeGeometryBrick(
     throw std::runtime_error("slice origin must be aligned to grid"
       " when grid alignment is used");
 
+  // Slices outside of the region of interest are not decoded.
+  // NB: attribute data units for the slice are skipped too.
+  _skipSlice = !sliceIntersectsRoi();
+  if (_skipSlice) {
+    _firstSliceInFrame = false;
+    std::cout << "positions skipped (outside region of interest)\n\n";
+    return 0;
+  }
+
   // set default attribute values (in case an attribute data unit is lost)
   // NB: it is a requirement that geom_num_points_minus1 is correct
   _currentPointCloud.resize(_gbh.footer.geom_num_points_minus1 + 1);
@@ -501,16 +521,31 @@ PCCTMC3Decoder3::decodeGeometryBrick(
   aec.setBypassBinCodingWithoutProbUpdate(_sps->bypass_bin_coding_without_prob_update);
   aec.start();
 
+  // Partially decoded levels are only formed if someone is listening.
+  // They are presented as per the output cloud.
+  OctreeLevelFn onLevel;
+  if (_onGeometryLevel) {
+    onLevel = [&](int levelsRemaining, PCCPointSet3& cloud) {
+      for (auto i = 0; i < cloud.getPointCount(); i++)
+        cloud[i] += _sliceOrigin;
+      scaleGeometry(cloud, _sps->globalScale, _outCloud.outputFpBits);
+      if (_params.roiClip)
+        clipToRoi(cloud);
+      _onGeometryLevel(_sliceId, levelsRemaining, cloud);
+    };
+  }
+  const OctreeLevelFn* onLevelPtr = onLevel ? &onLevel : nullptr;
+
   if (!_gps->trisoup_enabled_flag) {
     if (!_params.minGeomNodeSizeLog2) {
       decodeGeometryOctree(
         *_gps, _gbh, _currentPointCloud, *_ctxtMemOctreeGeom, aec, _refFrame,
         _sps->seqBoundingBoxOrigin, attrInterPredParams.compensatedPointCloud,
-        attrInterPredParams.motionVectors);
+        attrInterPredParams.motionVectors, onLevelPtr);
     } else {
       decodeGeometryOctreeScalable(
         *_gps, _gbh, _params.minGeomNodeSizeLog2, _currentPointCloud,
-        *_ctxtMemOctreeGeom, aec, _refFrame);
+        *_ctxtMemOctreeGeom, aec, _refFrame, onLevelPtr);
     }
   } else {
     decodeGeometryTrisoup(
@@ -535,10 +570,112 @@ PCCTMC3Decoder3::decodeGeometryBrick(
 
 //--------------------------------------------------------------------------
 
+void
+PCCTMC3Decoder3::setGeometryLevelCallback(GeometryLevelFn fn)
+{
+  _onGeometryLevel = std::move(fn);
+}
+
+//--------------------------------------------------------------------------
+// Determine if the current slice may intersect the region of interest.
+
+bool
+PCCTMC3Decoder3::sliceIntersectsRoi() const
+{
+  if (_params.roiBoxes.empty())
+    return true;
+
+  // Later slices or frames may depend upon the state of this slice
+  if (
+    _sps->entropy_continuation_enabled_flag
+    || _sps->inter_frame_prediction_enabled_flag)
+    return true;
+
+  // The slice bounds from the root node size
+  int trisoupNodeSizeLog2 = _gbh.trisoupNodeSizeLog2(*_gps);
+  Vec3<int> rootNodeSizeLog2 = trisoupNodeSizeLog2;
+  for (auto split : _gbh.tree_lvl_coded_axis_list)
+    rootNodeSizeLog2 += Vec3<int>{!!(split & 4), !!(split & 2), !!(split & 1)};
+
+  Box3<int32_t> sliceBox;
+  for (int k = 0; k < 3; k++) {
+    sliceBox.min[k] = _sliceOrigin[k];
+    sliceBox.max[k] = _sliceOrigin[k] + (1 << rootNodeSizeLog2[k]) - 1;
+  }
+
+  // Trisoup surfaces are not strictly bounded by the tree, allow a margin
+  if (_gps->trisoup_enabled_flag) {
+    sliceBox.min -= 1 << trisoupNodeSizeLog2;
+    sliceBox.max += 1 << trisoupNodeSizeLog2;
+  }
+
+  auto fpBits = _outCloud.outputFpBits;
+  sliceBox.min = scalePosition(sliceBox.min, _sps->globalScale, fpBits);
+  sliceBox.max = scalePosition(sliceBox.max, _sps->globalScale, fpBits);
+
+  // The tile bounds (in the sequence coordinate system) are tighter, but
+  // only apply if the reconstructed positions are those of the source.
+  bool useTileBounds =
+    !_gps->trisoup_enabled_flag && !_gps->geom_scaling_enabled_flag;
+
+  if (useTileBounds) {
+    for (const auto& tile : _tileInventory.tiles) {
+      if (tile.tile_id != _gbh.slice_tag)
+        continue;
+
+      for (int k = 0; k < 3; k++) {
+        int32_t tileMin = tile.tileOrigin[k] << fpBits;
+        int32_t tileMax = (tile.tileOrigin[k] + tile.tileSize[k]) << fpBits;
+        sliceBox.min[k] = std::max(sliceBox.min[k], tileMin);
+        sliceBox.max[k] = std::min(sliceBox.max[k], tileMax - 1);
+      }
+      break;
+    }
+  }
+
+  for (const auto& box : _params.roiBoxes) {
+    if (sliceBox.intersects(box))
+      return true;
+  }
+
+  return false;
+}
+
+//--------------------------------------------------------------------------
+// Remove points that are outside of the region of interest.
+
+void
+PCCTMC3Decoder3::clipToRoi(PCCPointSet3& cloud) const
+{
+  if (_params.roiBoxes.empty())
+    return;
+
+  size_t numPoints = cloud.getPointCount();
+  size_t numKept = 0;
+  for (size_t i = 0; i < numPoints; i++) {
+    const auto& pos = cloud[i];
+    bool inside = std::any_of(
+      _params.roiBoxes.begin(), _params.roiBoxes.end(),
+      [&](const Box3<int32_t>& box) { return box.contains(pos); });
+
+    if (!inside)
+      continue;
+
+    if (i != numKept)
+      cloud.swapPoints(i, numKept);
+    numKept++;
+  }
+
+  cloud.resize(numKept);
+}
+
+//--------------------------------------------------------------------------
+
 void
 PCCTMC3Decoder3::decodeAttributeBrick(const PayloadBuffer& buf)
 {
   assert(buf.type == PayloadType::kAttributeBrick);
+  PCC_TRACE_ZONE("attribute");
   // todo(df): replace assertions with error handling
   assert(_sps);
   assert(_gps);
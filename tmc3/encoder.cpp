@@ -52,6 +52,7 @@
 #include "osspecific.h"
 #include "partitioning.h"
 #include "pcc_chrono.h"
+#include "pcc_trace.h"
 #include "ply.h"
 #include "TMC3.h"
 namespace pcc {
@@ -88,6 +89,7 @@ PCCTMC3Encoder3::compress(
 {
   // start of frame
   _frameCounter++;
+  PCC_TRACE_ZONE("encodeFrame", _frameCounter);
 
   if (_frameCounter == 0) {
     // Angular predictive geometry coding needs to determine spherical
@@ -154,6 +156,8 @@ PCCTMC3Encoder3::compress(
     // derive local motion parameters
     if (params->gps.interPredictionEnabledFlag)
          deriveMotionParams(params);
+    applyEncoderPreset(params);
+    predCoder.setModeSearch(params->attrModeSearch);
     params->gps.motion.motion_max_prefix_bits = deriveMotionMaxPrefixBits(params->gps.motion);
     params->gps.motion.motion_max_suffix_bits = deriveMotionMaxSuffixBits(params->gps.motion);
 
@@ -210,6 +214,7 @@ PCCTMC3Encoder3::compress(
 
   std::vector<std::vector<int32_t>> tileMaps;
   if (params->partition.tileSize) {
+    PCC_TRACE_ZONE("tilePartition");
     tileMaps = tilePartition(params->partition, quantizedInput.cloud);
 
     // To tag the slice with the tile id there must be sufficient bits.
@@ -297,6 +302,7 @@ PCCTMC3Encoder3::compress(
       params->trisoupNodeSizesLog2.end());
 
   do {
+    PCC_TRACE_ZONE("slicePartition");
     for (int t = 0; t < tileMaps.size(); t++) {
       const auto& tile = tileMaps[t];
       auto tile_id = partitions.tileInventory.tiles.empty()
@@ -409,6 +415,7 @@ PCCTMC3Encoder3::compress(
     scaleGeometry(
       reconCloud->cloud, _sps->globalScale, reconCloud->outputFpBits);
 
+  PCC_TRACE_PEAK_RSS();
   return 0;
 }
 
@@ -598,6 +605,66 @@ PCCTMC3Encoder3::deriveMotionParams(EncoderParams* params)
   }
 }
 
+//----------------------------------------------------------------------------
+// Restrict the encoder search effort according to the speed preset.
+// Only non-normative decisions are affected.
+
+void
+PCCTMC3Encoder3::applyEncoderPreset(EncoderParams* params)
+{
+  int level = int(params->preset);
+
+  params->attrModeSearch = attr::ModeSearch::kFull;
+  params->skipLosslessRecolour = level >= int(EncoderPreset::kSlow);
+
+  if (level >= int(EncoderPreset::kFast))
+    params->attrModeSearch = attr::ModeSearch::kReduced;
+  if (level >= int(EncoderPreset::kVeryFast))
+    params->attrModeSearch = attr::ModeSearch::kNone;
+
+  // maximum trisoup vertex search distance, indexed by preset
+  static const int kVertexSearchDist[] = {8, 8, 4, 2, 1, 1};
+  auto& trisoup = params->trisoup;
+  trisoup.maxVertexSearchDistance =
+    std::min(trisoup.maxVertexSearchDistance, kVertexSearchDist[level]);
+
+  // recolouring: fewer source neighbours are averaged, the colour
+  // refinement search is narrowed and, finally, the backward search for
+  // source points nearest to each target point is skipped
+  static const int kRecolourNeighboursFwd[] = {8, 6, 4, 2, 1, 1};
+  static const int kRecolourNeighboursBwd[] = {1, 1, 1, 1, 1, 0};
+  static const int kRecolourSearchRange[] = {1, 1, 1, 1, 0, 0};
+  auto& recolour = params->recolour;
+  recolour.numNeighboursFwd =
+    std::min(recolour.numNeighboursFwd, kRecolourNeighboursFwd[level]);
+  recolour.numNeighboursBwd =
+    std::min(recolour.numNeighboursBwd, kRecolourNeighboursBwd[level]);
+  recolour.searchRange =
+    std::min(recolour.searchRange, kRecolourSearchRange[level]);
+
+  if (!params->gps.interPredictionEnabledFlag)
+    return;
+
+  // motion search range reduction, mean shift iterations, search pattern
+  // size and split early termination threshold, indexed by preset
+  static const int kRangeShift[] = {0, 0, 1, 1, 2, 3};
+  static const int kMaxIterations[] = {
+    std::numeric_limits<int>::max(), std::numeric_limits<int>::max(),
+    4, 2, 1, 1};
+  static const int kDirections[] = {18, 18, 18, 6, 6, 6};
+  static const double kSplitThreshold[] = {0., 0., 0.25, 0.5, 1., 2.};
+
+  auto& motion = params->gps.motion;
+  motion.Amotion0 = std::max(1, motion.Amotion0 >> kRangeShift[level]);
+  motion.K = std::min(motion.K, kMaxIterations[level]);
+  params->geom.motion.searchDirections = kDirections[level];
+  params->geom.motion.splitEarlyTermination = kSplitThreshold[level];
+
+  // sparser sampling of the blocks when estimating motion
+  if (level >= int(EncoderPreset::kFaster))
+    motion.decimate = std::max(1, motion.decimate - 1);
+}
+
 //----------------------------------------------------------------------------
 
 void
@@ -612,6 +679,7 @@ PCCTMC3Encoder3::compressPartition(
   //  - prefilter/quantize geometry (non-normative)
   //  - encode geometry (single slice, id = 0)
   //  - recolour
+  PCC_TRACE_ZONE("slice", _sliceId);
 
   pointCloud.clear();
   pointCloud = inputPointCloud;
@@ -670,6 +738,7 @@ PCCTMC3Encoder3::compressPartition(
   attrInterPredParams.motionVectors.clear();
   if (1) {
     PayloadBuffer payload(PayloadType::kGeometryBrick);
+    PCC_TRACE_ZONE("geometry");
 
     pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock> clock_user;
     clock_user.start();
@@ -700,8 +769,19 @@ PCCTMC3Encoder3::compressPartition(
 
   // recolouring
   // NB: recolouring is required if points are added / removed
-  if (_gps->geom_unique_points_flag || _gps->trisoup_enabled_flag) {
+  bool needRecolour =
+    _gps->geom_unique_points_flag || _gps->trisoup_enabled_flag;
+
+  // When each source point is coded losslessly, the attributes carried
+  // through geometry coding are already correct.
+  if (params->skipLosslessRecolour && !_gps->trisoup_enabled_flag
+      && !_gps->geom_scaling_enabled_flag && _srcToCodingScale == 1.
+      && pointCloud.getPointCount() == originPartCloud.getPointCount())
+    needRecolour = false;
+
+  if (needRecolour) {
     for (const auto& attr_sps : _sps->attributeSets) {
+      PCC_TRACE_ZONE("recolour");
       recolour(
         attr_sps, params->recolour, originPartCloud, _srcToCodingScale,
         _originInCodingCoords + _sliceOrigin, &pointCloud);
@@ -713,7 +793,8 @@ PCCTMC3Encoder3::compressPartition(
   callback->onPostRecolour(pointCloud);
 
   // attributeCoding
-  auto attrEncoder = makeAttributeEncoder();
+  if (!_attrEncoder)
+    _attrEncoder = makeAttributeEncoder();
 
   // for each attribute
   for (const auto& it : params->attributeIdxMap) {
@@ -724,6 +805,7 @@ PCCTMC3Encoder3::compressPartition(
     const auto& label = attr_sps.attributeLabel;
 
     PayloadBuffer payload(PayloadType::kAttributeBrick);
+    PCC_TRACE_ZONE("attribute", attrIdx);
 
     pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock> clock_user;
     clock_user.start();
@@ -767,7 +849,7 @@ PCCTMC3Encoder3::compressPartition(
       mv.position += _sliceOrigin;
 
     auto& ctxtMemAttr = _ctxtMemAttrs.at(abh.attr_sps_attr_idx);
-    attrEncoder->encode(
+    _attrEncoder->encode(
       *_sps, attr_sps, attr_aps, abh, ctxtMemAttr, pointCloud, &payload, attrInterPredParams, predCoder);
 
     for (auto i = 0; i < pointCloud.getPointCount(); i++)
@@ -892,6 +974,9 @@ PCCTMC3Encoder3::encodeGeometryBrick(
     aec->setBypassBinCodingWithoutProbUpdate(_sps->bypass_bin_coding_without_prob_update);
     aec->start();
   }
+  PCC_TRACE_COUNTER(
+    "geomAecBufferBytes",
+    int64_t(maxAcBufLen) * (1 + gbh.geom_stream_cnt_minus1));
 
   // forget (reset) all saved context state at boundary
   if (!gbh.entropy_continuation_flag) {
@@ -928,6 +1013,7 @@ PCCTMC3Encoder3::encodeGeometryBrick(
 
   // assemble data unit
   //  - record the position of each aec buffer for chunk concatenation
+  PCC_TRACE_ZONE("geomAssemble");
   std::vector<std::pair<size_t, size_t>> aecStreams;
   write(*_sps, *_gps, gbh, buf);
   for (auto& arithmeticEncoder : arithmeticEncoders) {
@@ -979,6 +1065,8 @@ PCCTMC3Encoder3::appendSlice(PCCPointSet3& accumCloud)
 SrcMappedPointSet
 PCCTMC3Encoder3::quantization(const PCCPointSet3& src)
 {
+  PCC_TRACE_ZONE("quantization");
+
   // Currently the sequence bounding box size must be set
   assert(_sps->seqBoundingBoxSize != Vec3<int>{0});
 
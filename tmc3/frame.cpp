@@ -66,11 +66,14 @@ CloudFrame::setParametersFrom(
 
 //============================================================================
 
-void
-scaleGeometry(
-  PCCPointSet3& cloud,
+// Derive the fixed-point representation of the global scale factor
+// to be applied to positions: P_out = (P * num + (den >> 1)) >> denLog2
+
+static Rational
+fixedPointGlobalScale(
   const SequenceParameterSet::GlobalScale& globalScale,
-  int fixedPointFracBits)
+  int fixedPointFracBits,
+  int* denominatorLog2)
 {
   // Conversion to rational simplifies the globalScale expression.
   Rational gs = globalScale;
@@ -83,18 +86,53 @@ scaleGeometry(
   gsDenominatorLog2 = std::max(gsDenominatorLog2 - fixedPointFracBits, 0);
   gs.denominator = 1 << gsDenominatorLog2;
 
+  *denominatorLog2 = gsDenominatorLog2;
+  return gs;
+}
+
+//----------------------------------------------------------------------------
+
+void
+scaleGeometry(
+  PCCPointSet3& cloud,
+  const SequenceParameterSet::GlobalScale& globalScale,
+  int fixedPointFracBits)
+{
+  int gsDenominatorLog2;
+  Rational gs =
+    fixedPointGlobalScale(globalScale, fixedPointFracBits, &gsDenominatorLog2);
+
   // Nothing to do if scale factor is 1.
   if (gs.numerator == gs.denominator)
     return;
 
   // The scaling here is equivalent to the fixed-point conformance output
+  // NB: each component is scaled identically, permitting vectorisation
+  const int numerator = gs.numerator;
+  const int rounding = gs.denominator >> 1;
   size_t numPoints = cloud.getPointCount();
   for (size_t i = 0; i < numPoints; i++) {
     auto& pos = cloud[i];
-    pos = (pos * gs.numerator + (gs.denominator >> 1)) >> gsDenominatorLog2;
+    for (int k = 0; k < 3; k++)
+      pos[k] = (pos[k] * numerator + rounding) >> gsDenominatorLog2;
   }
 }
 
+//----------------------------------------------------------------------------
+
+point_t
+scalePosition(
+  const point_t& pos,
+  const SequenceParameterSet::GlobalScale& globalScale,
+  int fixedPointFracBits)
+{
+  int gsDenominatorLog2;
+  Rational gs =
+    fixedPointGlobalScale(globalScale, fixedPointFracBits, &gsDenominatorLog2);
+
+  return (pos * gs.numerator + (gs.denominator >> 1)) >> gsDenominatorLog2;
+}
+
 //============================================================================
 
 }  // namespace pcc
@@ -94,6 +94,12 @@ void scaleGeometry(
   const SequenceParameterSet::GlobalScale& globalScale,
   int fixedPointFracBits);
 
+// Scale a single position as per scaleGeometry
+point_t scalePosition(
+  const point_t& pos,
+  const SequenceParameterSet::GlobalScale& globalScale,
+  int fixedPointFracBits);
+
 //============================================================================
 
 }  // namespace pcc
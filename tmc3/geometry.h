@@ -35,6 +35,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -52,6 +53,17 @@ namespace pcc {
 struct GeometryOctreeContexts;
 struct CloudFrame;
 
+//============================================================================
+// Receives the partially decoded geometry of a slice after each octree
+// level: the number of levels remaining to be decoded and the points that
+// a partial decode skipping those levels would produce.
+//
+// Levels are only reported within the depth of the slice's own octree.
+// A partial decode skipping more levels than that produces the slice's
+// root node, so whole-frame results differ for multi-slice frames.
+
+typedef std::function<void(int, PCCPointSet3&)> OctreeLevelFn;
+
 //============================================================================
 
 void encodeGeometryOctree(
@@ -75,7 +87,8 @@ void decodeGeometryOctree(
   const CloudFrame* refFrame,
   const Vec3<int> minimum_position,
   PCCPointSet3& compensatedPointCloud,
-  std::vector<MotionVector>& motionVectors);
+  std::vector<MotionVector>& motionVectors,
+  const OctreeLevelFn* onLevel);
 
 void decodeGeometryOctreeScalable(
   const GeometryParameterSet& gps,
@@ -84,7 +97,8 @@ void decodeGeometryOctreeScalable(
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
   EntropyDecoder& arithmeticDecoder,
-  const CloudFrame* refFrame);
+  const CloudFrame* refFrame,
+  const OctreeLevelFn* onLevel);
 
 //----------------------------------------------------------------------------
 
@@ -41,6 +41,7 @@
 
 #include "PCCMisc.h"
 #include "geometry_params.h"
+#include "pcc_trace.h"
 #include "quantization.h"
 #include "tables.h"
 
@@ -338,6 +339,8 @@ GeometryOctreeContexts::clearMap()
     }
 
   std::cout << "Size used buffer OBUF LEAF = " << _OBUFleafNumber << "\n";
+  PCC_TRACE_COUNTER("obufLeaves", _OBUFleafNumber);
+  PCC_TRACE_COUNTER("obufLeavesTrisoup", _OBUFleafNumberTrisoup);
 
   for (int i = 0; i < 5; i++) {
     MapOBUFTriSoup[i][0].clear();
@@ -40,6 +40,7 @@
 #include "PCCMath.h"
 #include "PCCPointSet.h"
 #include "entropy.h"
+#include "geometry.h"
 #include "geometry_params.h"
 #include "hls.h"
 #include "quantization.h"
@@ -204,122 +205,111 @@ struct RasterScanContext {
     uint8_t neighPattern;
   };
 
-  // iterator will point nodes with lower or equal position to current+offset
-  std::vector<const PCCOctree3Node*> occupancyContextNodes;
-
   const std::vector<PCCOctree3Node>& buffer;
 
+  // index of the last node with lower or equal position to current+offset
+  std::vector<int> occupancyContextNodes;
+
+  // compact copy of the node positions of the current depth, such that
+  // the cursor walks do not have to touch the (large) node structures.
+  std::vector<Vec3<int32_t>> positions;
+
   RasterScanContext(const std::vector<PCCOctree3Node>& buffer)
   : buffer(buffer)
-  , occupancyContextNodes(contextSize, nullptr)
+  , occupancyContextNodes(contextSize, 0)
   {}
 
   void initializeNextDepth() {
     for (int i = 0; i < contextSize; ++i) {
-      occupancyContextNodes[i] = buffer.data();
+      occupancyContextNodes[i] = 0;
     }
+
+    positions.resize(buffer.size());
+    for (size_t i = 0; i < buffer.size(); ++i)
+      positions[i] = buffer[i].pos;
+  }
+
+  // raster scan order comparison of node positions
+  static bool isBefore(const Vec3<int32_t>& a, const Vec3<int32_t>& b)
+  {
+    return a[0] < b[0]
+      || (a[0] == b[0] && (a[1] < b[1] || (a[1] == b[1] && a[2] < b[2])));
   }
 
   void nextNode(const PCCOctree3Node* currNode, occupancy& occ) {
-    const PCCOctree3Node* buffer_end = buffer.data() + buffer.size();
+    const int currIdx = int(currNode - buffer.data());
+    const int bufferEnd = int(positions.size());
+    const Vec3<int32_t>* pos = positions.data();
     occ.reset();
 
-    // should never occur
-    //if(occupancyContextNodes[0] == buffer_end)
-    //  return;
-
     int i;
     int j;
-    const PCCOctree3Node* nextNodeContext;
+    int nextNodeContext;
     Vec3<int32_t> offsetPos;
     for (i = 0; i < childOccupancyContextSize; i += 3) {
-      // from here, iterator points at least on first node of the depth
+      // from here, cursor points at least on first node of the depth
       nextNodeContext = occupancyContextNodes[i] + 1;
       //
-      if (nextNodeContext >= currNode)
+      if (nextNodeContext >= currIdx)
         break;
-      offsetPos = currNode->pos + occupancyContextOffsets[i];
-      /**/
-      while (nextNodeContext < currNode
-        && ( nextNodeContext->pos[0] < offsetPos[0]
-          || nextNodeContext->pos[0] == offsetPos[0]
-          && ( nextNodeContext->pos[1] < offsetPos[1]
-            || nextNodeContext->pos[1] == offsetPos[1]
-            && nextNodeContext->pos[2] < offsetPos[2]
-          )
-        )
-      ) {
+      offsetPos = pos[currIdx] + occupancyContextOffsets[i];
+      while (nextNodeContext < currIdx
+        && isBefore(pos[nextNodeContext], offsetPos)) {
         ++occupancyContextNodes[i];
         ++nextNodeContext;
       }
-      if (
-        nextNodeContext < currNode
-        && nextNodeContext->pos == offsetPos
-      ) {
+      if (nextNodeContext < currIdx && pos[nextNodeContext] == offsetPos) {
         ++occupancyContextNodes[i];
-        occ.childOccupancyContext[i] = nextNodeContext->childOccupancy;
+        occ.childOccupancyContext[i] = buffer[nextNodeContext].childOccupancy;
         ++nextNodeContext;
       }
       int jend = i + 3 < childOccupancyContextSize ? i + 3 : childOccupancyContextSize;
       for (j = i + 1; j < jend; ++j) {
-        if (nextNodeContext >= currNode)
+        if (nextNodeContext >= currIdx)
           break;
         ++offsetPos[2];
-        if (nextNodeContext->pos == offsetPos) {
-          occ.childOccupancyContext[j] = nextNodeContext->childOccupancy;
+        if (pos[nextNodeContext] == offsetPos) {
+          occ.childOccupancyContext[j] = buffer[nextNodeContext].childOccupancy;
           ++nextNodeContext;
         }
       }
     }
-    nextNodeContext = currNode + 1;
-    if (nextNodeContext >= buffer_end) {
+    nextNodeContext = currIdx + 1;
+    if (nextNodeContext >= bufferEnd) {
       occ.neighPattern =
         ((occ.childOccupancyContext[4] != 0) << 1)
       | ((occ.childOccupancyContext[10] != 0) << 2)
       | ((occ.childOccupancyContext[12] != 0) << 4);
       return;
     }
-    //offsetPos = currNode->pos + occupancyContextOffsets[14];
-    offsetPos = currNode->pos;
+    offsetPos = pos[currIdx];
     ++offsetPos[2];
-    if (nextNodeContext->pos == offsetPos) {
+    if (pos[nextNodeContext] == offsetPos) {
       occ.depthOccupancyContext[0] = true;
     }
     for (i=15; i < contextSize; i += 3) {
-      // from here, iterator points at least on first node of the depth
-      auto nextNodeContext = occupancyContextNodes[i] + 1;
+      // from here, cursor points at least on first node of the depth
+      nextNodeContext = occupancyContextNodes[i] + 1;
       //
-      if (nextNodeContext >= buffer_end)
+      if (nextNodeContext >= bufferEnd)
         break;
-      auto offsetPos = currNode->pos + occupancyContextOffsets[i];
-      /**/
-      while (nextNodeContext < buffer_end
-        && ( nextNodeContext->pos[0] < offsetPos[0]
-          || nextNodeContext->pos[0] == offsetPos[0]
-          && ( nextNodeContext->pos[1] < offsetPos[1]
-            || nextNodeContext->pos[1] == offsetPos[1]
-            && nextNodeContext->pos[2] < offsetPos[2]
-          )
-        )
-      ) {
+      offsetPos = pos[currIdx] + occupancyContextOffsets[i];
+      while (nextNodeContext < bufferEnd
+        && isBefore(pos[nextNodeContext], offsetPos)) {
         ++occupancyContextNodes[i];
         ++nextNodeContext;
       }
-      if (
-        nextNodeContext < buffer_end
-        && nextNodeContext->pos == offsetPos
-      ) {
+      if (nextNodeContext < bufferEnd && pos[nextNodeContext] == offsetPos) {
         ++occupancyContextNodes[i];
         occ.depthOccupancyContext[i-14] = true;
         ++nextNodeContext;
       }
-      int j;
-      int jend = i + 3/* < contextSize ? i + 3 : contextSize*/;
+      int jend = i + 3;
       for (j = i + 1; j < jend; ++j) {
-        if (nextNodeContext >= buffer_end)
+        if (nextNodeContext >= bufferEnd)
           break;
         ++offsetPos[2];
-        if (nextNodeContext->pos == offsetPos) {
+        if (pos[nextNodeContext] == offsetPos) {
           occ.depthOccupancyContext[j-14] = true;
           ++nextNodeContext;
         }
@@ -852,6 +842,27 @@ GeometryOctreeContexts::reset()
   new (this) GeometryOctreeContexts;
 }
 
+//============================================================================
+// The octree encoder partitions a compact copy of the point positions,
+// each tagged with the index of the point in the input point cloud.
+// The point cloud itself is only reordered once coding is complete.
+
+struct OctreeEncPoint {
+  point_t pos;
+  int32_t idx;
+};
+
+//---------------------------------------------------------------------------
+// Sorts the points into the order produced by partitioning every level of
+// the tree, such that each node's children occupy contiguous runs.
+// Returns false, leaving the points untouched, if the combined sort key
+// does not fit in 64 bits.
+
+bool presortOctreePoints(
+  std::vector<OctreeEncPoint>& points,
+  const std::vector<Vec3<int>>& lvlNodeSizeLog2,
+  int maxDepth);
+
 //============================================================================
 // :: octree encoder exposing internal ringbuffer
 
@@ -879,7 +890,8 @@ void decodeGeometryOctree(
   const CloudFrame* refFrame,
   const Vec3<int> minimum_position,
   PCCPointSet3& compensatedPointCloud,
-  std::vector<MotionVector>& motionVectors);
+  std::vector<MotionVector>& motionVectors,
+  const OctreeLevelFn* onLevel = nullptr);
 
 //============================================================================
 
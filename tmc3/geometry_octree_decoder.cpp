@@ -42,6 +42,7 @@
 #include "tables.h"
 #include "quantization.h"
 #include "motionWip.h"
+#include "pcc_trace.h"
 #include <unordered_map>
 
 namespace pcc {
@@ -133,17 +134,6 @@ GeometryOctreeDecoder::decodePositionLeafNumPoints()
 // decode node occupancy bits
 //
 
-static void (*pointer2FunctionContext[8])(
-  OctreeNeighours&, int, int&, int&, bool&) = {
-  makeGeometryAdvancedNeighPattern0,
-  makeGeometryAdvancedNeighPattern1,
-  makeGeometryAdvancedNeighPattern2,
-  makeGeometryAdvancedNeighPattern3,
-  makeGeometryAdvancedNeighPattern4,
-  makeGeometryAdvancedNeighPattern5,
-  makeGeometryAdvancedNeighPattern6,
-  makeGeometryAdvancedNeighPattern7};
-
 static const int LUTinitCoded0[27][6] = {
   {0, 0, 0, 0, 0, 0}, {4, 0, 2, 2, 2, 2}, {0, 4, 2, 2, 2, 2},
   {2, 2, 4, 0, 2, 2}, {4, 2, 4, 2, 3, 3}, {2, 4, 4, 2, 3, 3},
@@ -232,8 +222,8 @@ GeometryOctreeDecoder::decodeOccupancyFullNeihbourgs(
     // OBUF contexts
     int ctx1, ctx2;
     bool Sparse;
-    (*pointer2FunctionContext[i])(
-      octreeNeighours, occupancy, ctx1, ctx2, Sparse);
+    makeGeometryAdvancedNeighPattern(
+      i, octreeNeighours, occupancy, ctx1, ctx2, Sparse);
 
     bool isInter2 = isInter && predOcc;
     if (isInter2) {
@@ -475,6 +465,38 @@ invQuantPosition(int qp, Vec3<uint32_t> quantMasks, const Vec3<int32_t>& pos)
 
 //-------------------------------------------------------------------------
 
+// Form the output of a partial decode: the points decoded so far, quantised
+// to the remaining node size, followed by the position of each remaining
+// node (at its centre when the node is larger than 2x2x2).
+
+static void
+formPartialCloud(
+  int minGeomNodeSizeLog2,
+  const std::vector<point_t>& nodePos,
+  PCCPointSet3& pointCloud)
+{
+  size_t size =
+    pointCloud.removeDuplicatePointInQuantizedPoint(minGeomNodeSizeLog2);
+
+  pointCloud.resize(size + nodePos.size());
+  size_t processedPointCount = size;
+
+  if (minGeomNodeSizeLog2 > 1) {
+    uint32_t mask = uint32_t(-1) << minGeomNodeSizeLog2;
+    for (auto pos : nodePos) {
+      for (int k = 0; k < 3; k++)
+        pos[k] &= mask;
+      pos += 1 << (minGeomNodeSizeLog2 - 1);
+      pointCloud[processedPointCount++] = pos;
+    }
+  } else {
+    for (const auto& pos : nodePos)
+      pointCloud[processedPointCount++] = pos;
+  }
+}
+
+//-------------------------------------------------------------------------
+
 void
 decodeGeometryOctree(
   const GeometryParameterSet& gps,
@@ -487,7 +509,8 @@ decodeGeometryOctree(
   const CloudFrame* refFrame,
   const Vec3<int> minimum_position,
   PCCPointSet3& compensatedPointCloud,
-  std::vector<MotionVector>& motionVectors)
+  std::vector<MotionVector>& motionVectors,
+  const OctreeLevelFn* onLevel)
 {
   const bool isInter = gbh.interPredictionEnabledFlag;
 
@@ -521,6 +544,10 @@ decodeGeometryOctree(
   size_t processedPointCount = 0;
   std::vector<uint32_t> values;
 
+  // partial decoding results reported after each level
+  PCCPointSet3 levelCloud;
+  std::vector<point_t> levelNodePos;
+
   //// rotating mask used to enable idcm
   //uint32_t idcmEnableMaskInit = /*mkIdcmEnableMask(gps)*/ 0; //NOTE[FT] : set to 0 by construction
 
@@ -599,6 +626,8 @@ decodeGeometryOctree(
   }
 
   for (int depth = 0; depth < maxDepth; depth++) {
+    PCC_TRACE_ZONE("octreeLevel", depth);
+
     // setup at the start of each level
     auto fifoCurrLvlEnd = fifo.end();
     int numNodesNextLvl = 0;
@@ -1014,6 +1043,27 @@ decodeGeometryOctree(
     // Check that one level hasn't produced too many nodes
     // todo(df): this check is too weak to spot overflowing the fifo
     assert(numNodesNextLvl <= ringBufferSize);
+
+    // report the partial decoding result at the end of the level
+    //  - fifo now holds the nodes of the next level
+    int levelsRemaining = int(lvlNodeSizeLog2.size()) - depth - 3;
+    if (onLevel && levelsRemaining > 0) {
+      auto nextNodeSizeLog2 = lvlNodeSizeLog2[depth + 1];
+      levelNodePos.clear();
+      for (const auto& node : fifo) {
+        auto pos = node.pos;
+        pos <<= nextNodeSizeLog2 - QuantizerGeom::qpShift(node.qp);
+        levelNodePos.push_back(
+          invQuantPosition(node.qp, posQuantBitMasks, pos));
+      }
+
+      levelCloud.resize(processedPointCount);
+      for (size_t i = 0; i < processedPointCount; i++)
+        levelCloud[i] = pointCloud[i];
+
+      formPartialCloud(levelsRemaining, levelNodePos, levelCloud);
+      (*onLevel)(levelsRemaining, levelCloud);
+    }
   }
   if (!(gps.interPredictionEnabledFlag
         && gps.gof_geom_entropy_continuation_enabled_flag)
@@ -1052,12 +1102,14 @@ decodeGeometryOctree(
   const CloudFrame* refFrame,
   const Vec3<int> minimum_position,
   PCCPointSet3& compensatedPointCloud,
-  std::vector<MotionVector>& motionVectors
+  std::vector<MotionVector>& motionVectors,
+  const OctreeLevelFn* onLevel
 )
 {
   decodeGeometryOctree(
     gps, gbh, 0, pointCloud, ctxtMem, arithmeticDecoder, nullptr,
-    refFrame, minimum_position, compensatedPointCloud, motionVectors);
+    refFrame, minimum_position, compensatedPointCloud, motionVectors,
+    onLevel);
 }
 
 //-------------------------------------------------------------------------
@@ -1070,7 +1122,8 @@ decodeGeometryOctreeScalable(
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
   EntropyDecoder& arithmeticDecoder,
-  const CloudFrame* refFrame
+  const CloudFrame* refFrame,
+  const OctreeLevelFn* onLevel
 )
 {
   std::vector<PCCOctree3Node> nodes;
@@ -1078,27 +1131,16 @@ decodeGeometryOctreeScalable(
   std::vector<MotionVector> motionVectors;
   decodeGeometryOctree(
     gps, gbh, minGeomNodeSizeLog2, pointCloud, ctxtMem, arithmeticDecoder,
-    &nodes, refFrame, { 0, 0, 0 }, compensatedPointCloud, motionVectors);
+    &nodes, refFrame, { 0, 0, 0 }, compensatedPointCloud, motionVectors,
+    onLevel);
 
   if (minGeomNodeSizeLog2 > 0) {
-    size_t size =
-      pointCloud.removeDuplicatePointInQuantizedPoint(minGeomNodeSizeLog2);
-
-    pointCloud.resize(size + nodes.size());
-    size_t processedPointCount = size;
-
-    if (minGeomNodeSizeLog2 > 1) {
-      uint32_t mask = uint32_t(-1) << minGeomNodeSizeLog2;
-      for (auto node0 : nodes) {
-        for (int k = 0; k < 3; k++)
-          node0.pos[k] &= mask;
-        node0.pos += 1 << (minGeomNodeSizeLog2 - 1);
-        pointCloud[processedPointCount++] = node0.pos;
-      }
-    } else {
-      for (const auto& node0 : nodes)
-        pointCloud[processedPointCount++] = node0.pos;
-    }
+    std::vector<point_t> nodePos;
+    nodePos.reserve(nodes.size());
+    for (const auto& node : nodes)
+      nodePos.push_back(node.pos);
+
+    formPartialCloud(minGeomNodeSizeLog2, nodePos, pointCloud);
   }
 }
 
@@ -43,6 +43,7 @@
 #include "quantization.h"
 #include "TMC3.h"
 #include "motionWip.h"
+#include "pcc_trace.h"
 #include <unordered_map>
 #include <set>
 #include <random>
@@ -152,17 +153,6 @@ GeometryOctreeEncoder::encodePositionLeafNumPoints(int count)
 // encode node occupancy bits
 //
 
-static void (*pointer2FunctionContext[8])(
-  OctreeNeighours&, int, int&, int&, bool&) = {
-  makeGeometryAdvancedNeighPattern0,
-  makeGeometryAdvancedNeighPattern1,
-  makeGeometryAdvancedNeighPattern2,
-  makeGeometryAdvancedNeighPattern3,
-  makeGeometryAdvancedNeighPattern4,
-  makeGeometryAdvancedNeighPattern5,
-  makeGeometryAdvancedNeighPattern6,
-  makeGeometryAdvancedNeighPattern7};
-
 static const int LUTinitCoded0[27][6] = {
   {0, 0, 0, 0, 0, 0}, {4, 0, 2, 2, 2, 2}, {0, 4, 2, 2, 2, 2},
   {2, 2, 4, 0, 2, 2}, {4, 2, 4, 2, 3, 3}, {2, 4, 4, 2, 3, 3},
@@ -242,7 +232,8 @@ GeometryOctreeEncoder::encodeOccupancyFullNeihbourgs(
     // OBUF contexts
     int ctx1, ctx2;
     bool Sparse;
-    (*pointer2FunctionContext[i])(octreeNeighours, occupancy, ctx1, ctx2, Sparse);
+    makeGeometryAdvancedNeighPattern(
+      i, octreeNeighours, occupancy, ctx1, ctx2, Sparse);
 
     bool isInter2 = isInter && predOcc;
     if (isInter2) {
@@ -499,9 +490,64 @@ calculateNodeQps(
 
 //-------------------------------------------------------------------------
 
+bool
+presortOctreePoints(
+  std::vector<OctreeEncPoint>& points,
+  const std::vector<Vec3<int>>& lvlNodeSizeLog2,
+  int maxDepth)
+{
+  std::vector<Vec3<int>> sortMasks;
+  int keyBits = 0;
+  for (int depth = 0; depth < maxDepth; depth++) {
+    auto mask = qtBtChildSize(lvlNodeSizeLog2[depth], lvlNodeSizeLog2[depth + 1]);
+    keyBits += !!mask[0] + !!mask[1] + !!mask[2];
+    sortMasks.push_back(mask);
+  }
+
+  if (keyBits > 64)
+    return false;
+
+  // the key of each point, formed from the child index at each level
+  std::vector<std::pair<uint64_t, int32_t>> keys(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    const auto& pos = points[i].pos;
+    uint64_t key = 0;
+    for (const auto& mask : sortMasks) {
+      for (int k = 0; k < 3; k++) {
+        if (mask[k])
+          key = (key << 1) | !!(pos[k] & mask[k]);
+      }
+    }
+    keys[i] = {key, int32_t(i)};
+  }
+
+  // lsb-first radix sort of the keys
+  std::vector<std::pair<uint64_t, int32_t>> tmp(points.size());
+  for (int shift = 0; shift < keyBits; shift += 8) {
+    std::array<int, 257> offsets = {};
+    for (const auto& entry : keys)
+      offsets[((entry.first >> shift) & 0xff) + 1]++;
+    for (int i = 1; i < 257; i++)
+      offsets[i] += offsets[i - 1];
+    for (const auto& entry : keys)
+      tmp[offsets[(entry.first >> shift) & 0xff]++] = entry;
+    std::swap(keys, tmp);
+  }
+
+  std::vector<OctreeEncPoint> sorted(points.size());
+  for (size_t i = 0; i < points.size(); i++)
+    sorted[i] = points[keys[i].second];
+  std::swap(points, sorted);
+  return true;
+}
+
+//-------------------------------------------------------------------------
+
 void
 geometryQuantization(
-  PCCPointSet3& pointCloud, PCCOctree3Node& node, Vec3<int> nodeSizeLog2)
+  std::vector<OctreeEncPoint>& points,
+  PCCOctree3Node& node,
+  Vec3<int> nodeSizeLog2)
 {
   QuantizerGeom quantizer = QuantizerGeom(node.qp);
   int qpShift = QuantizerGeom::qpShift(node.qp);
@@ -511,13 +557,13 @@ geometryQuantization(
     int32_t clipMax = quantBitsMask >> qpShift;
 
     for (int i = node.start; i < node.end; i++) {
-      int32_t pos = int32_t(pointCloud[i][k]);
+      int32_t pos = int32_t(points[i].pos[k]);
       int32_t quantPos = quantizer.quantize(pos & quantBitsMask);
       quantPos = PCCClip(quantPos, 0, clipMax);
 
       // NB: this representation is: |ppppppqqq00|, which, except for
       // the zero padding, is the same as the decoder.
-      pointCloud[i][k] = (pos & ~quantBitsMask) | (quantPos << qpShift);
+      points[i].pos[k] = (pos & ~quantBitsMask) | (quantPos << qpShift);
     }
   }
 }
@@ -526,7 +572,9 @@ geometryQuantization(
 
 void
 geometryScale(
-  PCCPointSet3& pointCloud, PCCOctree3Node& node, Vec3<int> quantNodeSizeLog2)
+  std::vector<OctreeEncPoint>& points,
+  PCCOctree3Node& node,
+  Vec3<int> quantNodeSizeLog2)
 {
   QuantizerGeom quantizer = QuantizerGeom(node.qp);
   int qpShift = QuantizerGeom::qpShift(node.qp);
@@ -534,11 +582,11 @@ geometryScale(
   for (int k = 0; k < 3; k++) {
     int quantBitsMask = (1 << quantNodeSizeLog2[k]) - 1;
     for (int i = node.start; i < node.end; i++) {
-      int pos = pointCloud[i][k];
+      int pos = points[i].pos[k];
       int lowPart = (pos & quantBitsMask) >> qpShift;
       int lowPartScaled = PCCClip(quantizer.scale(lowPart), 0, quantBitsMask);
       int highPartScaled = pos & ~quantBitsMask;
-      pointCloud[i][k] = highPartScaled | lowPartScaled;
+      points[i].pos[k] = highPartScaled | lowPartScaled;
     }
   }
 }
@@ -547,17 +595,17 @@ geometryScale(
 
 void
 checkDuplicatePoints(
-  PCCPointSet3& pointCloud,
+  std::vector<OctreeEncPoint>& points,
   PCCOctree3Node& node,
   std::vector<int>& pointIdxToDmIdx)
 {
-  auto first = PCCPointSet3::iterator(&pointCloud, node.start);
-  auto last = PCCPointSet3::iterator(&pointCloud, node.end);
+  auto first = std::next(points.begin(), node.start);
+  auto last = std::next(points.begin(), node.end);
 
   std::set<Vec3<int32_t>> uniquePointsSet;
   for (auto i = first; i != last;) {
-    if (uniquePointsSet.find(**i) == uniquePointsSet.end()) {
-      uniquePointsSet.insert(**i);
+    if (uniquePointsSet.find(i->pos) == uniquePointsSet.end()) {
+      uniquePointsSet.insert(i->pos);
       i++;
     } else {
       std::iter_swap(i, last - 1);
@@ -755,6 +803,11 @@ encodeGeometryOctree(
   if (gps.trisoup_enabled_flag && gbh.trisoupNodeSizeLog2(gps))
     reservedBufferSize = std::max(1000, reservedBufferSize >> 2 * gbh.trisoupNodeSizeLog2(gps) - 1);
 
+  // the points to be partitioned
+  std::vector<OctreeEncPoint> points(pointCloud.getPointCount());
+  for (size_t i = 0; i < points.size(); i++)
+    points[i] = {pointCloud[i], int32_t(i)};
+
   std::vector<PCCOctree3Node> fifo;
   std::vector<PCCOctree3Node> fifoNext;
   fifo.reserve(reservedBufferSize);
@@ -856,12 +909,25 @@ encodeGeometryOctree(
   if (gps.octree_point_count_list_present_flag)
     gbh.footer.octree_lvl_num_points_minus1.reserve(maxDepth);
 
+  // When the tree is coded to the leaves without modifying the positions,
+  // sort the points once rather than partitioning each node in turn.
+  // NB: the unique points constraint ensures the order does not depend
+  //     upon the sorting method.
+  bool pointsPresorted = false;
+  if (!nodesRemaining && !gps.geom_scaling_enabled_flag
+      && gps.geom_unique_points_flag) {
+    PCC_TRACE_ZONE("octreePresort");
+    pointsPresorted = presortOctreePoints(points, lvlNodeSizeLog2, maxDepth);
+  }
+
   if (!(isInter && gps.gof_geom_entropy_continuation_enabled_flag) && !gbh.entropy_continuation_flag) {
     encoder.clearMap();
     encoder.resetMap();
   }
 
   for (int depth = 0; depth < maxDepth; depth++) {
+    PCC_TRACE_ZONE("octreeLevel", depth);
+
     // The tree terminated early (eg, due to IDCM or quantisation)
     // Delete any unused arithmetic coders
     if (fifo.empty()) {
@@ -1022,9 +1088,9 @@ encodeGeometryOctree(
       }*/
 
       if (numLvlsUntilQuantization == 0 && !tubeIndex && !nodeSliceIndex) {
-        geometryQuantization(pointCloud, node0, quantNodeSizeLog2);
+        geometryQuantization(points, node0, quantNodeSizeLog2);
         if (gps.geom_unique_points_flag)
-          checkDuplicatePoints(pointCloud, node0, pointIdxToDmIdx);
+          checkDuplicatePoints(points, node0, pointIdxToDmIdx);
       }
 
       GeometryNeighPattern gnp{};
@@ -1038,9 +1104,10 @@ encodeGeometryOctree(
       if (!tubeIndex && !nodeSliceIndex) {
         //local motion : determine PU tree by motion search and RDO
         if (isInter && nodeSizeLog2[0] == log2MotionBlockSize) {
+          PCC_TRACE_ZONE("motionSearch");
           std::unique_ptr<PUtree> PU_tree(new PUtree);
 
-          node0.hasMotion = motionSearchForNode(mSOctreeCurr, mSOctree, &node0, gps.motion, nodeSizeLog2[0],
+          node0.hasMotion = motionSearchForNode(mSOctreeCurr, mSOctree, &node0, gps.motion, params.motion, nodeSizeLog2[0],
             encoder._arithmeticEncoder, PU_tree.get());
           node0.PU_tree = std::move(PU_tree);
         }
@@ -1056,16 +1123,24 @@ encodeGeometryOctree(
 
         // split the current node into 8 children
         //  - perform an 8-way counting sort of the current node's points
+        //    (or just count them if already sorted)
         //  - (later) map to child nodes
-        countingSort(
-          PCCPointSet3::iterator(&pointCloud, node0.start),
-          PCCPointSet3::iterator(&pointCloud, node0.end), node0.childCounts,
-          [=](const PCCPointSet3::Proxy& proxy) {
-            const auto& point = *proxy;
-            return !!(int(point[2]) & pointSortMask[2])
-              | (!!(int(point[1]) & pointSortMask[1]) << 1)
-              | (!!(int(point[0]) & pointSortMask[0]) << 2);
-          });
+        auto childIdxOf = [=](const OctreeEncPoint& p) {
+          const auto& point = p.pos;
+          return !!(int(point[2]) & pointSortMask[2])
+            | (!!(int(point[1]) & pointSortMask[1]) << 1)
+            | (!!(int(point[0]) & pointSortMask[0]) << 2);
+        };
+
+        if (pointsPresorted) {
+          for (auto i = node0.start; i < node0.end; i++)
+            node0.childCounts[childIdxOf(points[i])]++;
+        } else {
+          countingSort(
+            std::next(points.begin(), node0.start),
+            std::next(points.begin(), node0.end), node0.childCounts,
+            childIdxOf);
+        }
 
         /// sort and partition the predictor...
         node0.predCounts = {};
@@ -1222,7 +1297,7 @@ encodeGeometryOctree(
         int childStart = node0.start;
 
         // inverse quantise any quantised positions
-        geometryScale(pointCloud, node0, quantNodeSizeLog2);
+        geometryScale(points, node0, quantNodeSizeLog2);
 
         for (int i = 0; i < 8; i++) {
           if (!node0.childCounts[i]) {
@@ -1372,9 +1447,21 @@ encodeGeometryOctree(
     auto nodeSizeLog2 = lvlNodeSizeLog2[maxDepth];
     for (auto& node : fifo) {
       node.pos <<= nodeSizeLog2;
-      geometryScale(pointCloud, node, quantNodeSizeLog2);
+      geometryScale(points, node, quantNodeSizeLog2);
     }
     *nodesRemaining = std::move(fifo);
+
+    // reorder the point cloud to match the node ranges
+    std::vector<int32_t> indices;
+    indices.reserve(points.size());
+    for (const auto& p : points)
+      indices.push_back(p.idx);
+
+    PCCPointSet3 pointCloud2;
+    pointCloud2.appendPartition(pointCloud, indices);
+    for (size_t i = 0; i < points.size(); i++)
+      pointCloud2[i] = points[i].pos;
+    swap(pointCloud, pointCloud2);
     return;
   }
 
@@ -1397,11 +1484,12 @@ encodeGeometryOctree(
       continue;
     }
 
-    pointCloud2[dstIdx] = pointCloud[i];
+    int srcIdx = points[i].idx;
+    pointCloud2[dstIdx] = points[i].pos;
     if (pointCloud.hasColors())
-      pointCloud2.setColor(dstIdx, pointCloud.getColor(i));
+      pointCloud2.setColor(dstIdx, pointCloud.getColor(srcIdx));
     if (pointCloud.hasReflectances())
-      pointCloud2.setReflectance(dstIdx, pointCloud.getReflectance(i));
+      pointCloud2.setReflectance(dstIdx, pointCloud.getReflectance(srcIdx));
   }
   pointCloud2.resize(outIdx);
   swap(pointCloud, pointCloud2);
@@ -51,9 +51,23 @@ struct QtBtParameters {
 
 //----------------------------------------------------------------------------
 
+struct MotionSearchOpts {
+  // number of refinement search pattern directions (6, 18)
+  int searchDirections = 18;
+
+  // the PU split test is skipped when the mean per-point cost of the
+  // unsplit PU is below this threshold (0 => disabled)
+  double splitEarlyTermination = 0.;
+};
+
+//----------------------------------------------------------------------------
+
 struct OctreeEncOpts {
   QtBtParameters qtbt;
 
+  // Local motion search effort
+  MotionSearchOpts motion;
+
   // Method used to derive in-tree quantisation parameters
   enum class QpMethod
   {
@@ -76,6 +90,12 @@ struct TrisoupEncOpts {
 
   // force align slices to a grid of trisoup node size
   bool alignToNodeGrid;
+
+  // number of threads used to determine edge vertices
+  int numThreads;
+
+  // upper limit of the encoder vertex search distance
+  int maxVertexSearchDistance = 8;
 };
 
 //=============================================================================
@@ -43,6 +43,14 @@
 #include "geometry_octree.h"
 
 namespace pcc {
+//============================================================================
+// The number of fractional bits used in trisoup triangle voxelisation
+const int kTrisoupFpBits = 8;
+
+// The value 1 in fixed-point representation
+const int kTrisoupFpOne = 1 << (kTrisoupFpBits);
+const int kTrisoupFpHalf = 1 << (kTrisoupFpBits - 1);
+
 //============================================================================
   struct codeVertexCtxInfo {
     int ctxE;
@@ -244,7 +252,8 @@ void codeAndRenderTriSoupRasterScan(
   pcc::EntropyEncoder* arithmeticEncoder,
   pcc::EntropyDecoder& arithmeticDecoder,
   GeometryOctreeContexts& ctxtMemOctree,
-  int &nSegments);
+  int &nSegments,
+  int numThreads = 1);
 
 //============================================================================
 struct CentroidInfo{
@@ -325,6 +334,26 @@ int findDominantAxis(
     int haloTriangle,
     int thickness);
 
+// Voxelise the triangle (v0, v1, v2), with vertices in fixed-point block
+// co-ordinates, by ray tracing along its dominant direction.
+void rayTracingTriangle(
+  std::vector<int64_t>& renderedBlock,
+  int& nPointsInBlock,
+  int blockWidth,
+  Vec3<int32_t>& nodepos,
+  const Vec3<int32_t>& v0,
+  const Vec3<int32_t>& v1,
+  const Vec3<int32_t>& v2,
+  int haloTriangle,
+  int thickness);
+
+// Append the unique points of a rendered block to recPointCloud.
+void flush2PointCloud(
+  int& nRecPoints,
+  std::vector<int64_t>::iterator itBegingBlock,
+  int nPointsInBlock,
+  PCCPointSet3& recPointCloud);
+
 //============================================================================
 
 enum{
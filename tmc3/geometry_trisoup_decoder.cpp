@@ -35,12 +35,14 @@
 
 #include <cstdio>
 #include <queue>
+#include <thread>
 
 #include "geometry_trisoup.h"
 
 #include "pointset_processing.h"
 #include "geometry.h"
 #include "geometry_octree.h"
+#include "pcc_trace.h"
 
 #define PC_PREALLOCATION_SIZE 200000
 
@@ -50,12 +52,6 @@ static const int LUTdivtriCount[13] = { 32767, 1024, 512, 341, 256, 205, 171, 14
 namespace pcc {
 
 //============================================================================
-// The number of fractional bits used in trisoup triangle voxelisation
-const int kTrisoupFpBits = 8;
-
-// The value 1 in fixed-point representation
-const int kTrisoupFpOne = 1 << (kTrisoupFpBits);
-const int kTrisoupFpHalf = 1 << (kTrisoupFpBits - 1);
 const int truncateValue = kTrisoupFpHalf;
 
 //============================================================================
@@ -150,6 +146,24 @@ struct RasterScanTrisoupEdges {
   pcc::EntropyDecoder& arithmeticDecoder;
   GeometryOctreeContexts& ctxtMemOctree;
 
+  // Points close to each edge of each node (node * 12 + edge), analysed
+  // in advance of the raster scan.
+  struct EdgeStats {
+    // encoder: points on the edge, and (improved vertex determination)
+    // within distanceSearchEncoder of it.
+    int countNearPoints;
+    int distanceSum;
+    int countNearPoints2;
+    int distanceSum2;
+
+    // inter prediction: compensated points on the edge
+    int countNearPointsPred;
+    int distanceSumPred;
+  };
+
+  std::vector<EdgeStats> edgeStats;
+  const int numThreads;
+
   AdaptiveBitModel ctxFaces;
   std::vector<TrisoupNodeEdgeVertex> eVerts;
   std::vector<TrisoupCentroidVertex> cVerts;
@@ -159,7 +173,8 @@ struct RasterScanTrisoupEdges {
 
   RasterScanTrisoupEdges(const std::vector<PCCOctree3Node>& leaves, int blockWidth, PCCPointSet3& pointCloud, bool isEncoder,
     int bitDropped, int distanceSearchEncoder, bool isInter, const PCCPointSet3& compensatedPointCloud,
-    const GeometryParameterSet& gps, const GeometryBrickHeader& gbh, pcc::EntropyEncoder* arithmeticEncoder, pcc::EntropyDecoder& arithmeticDecoder, GeometryOctreeContexts& ctxtMemOctree)
+    const GeometryParameterSet& gps, const GeometryBrickHeader& gbh, pcc::EntropyEncoder* arithmeticEncoder, pcc::EntropyDecoder& arithmeticDecoder, GeometryOctreeContexts& ctxtMemOctree,
+    int numThreads)
   : leaves(leaves)
   , blockWidth(blockWidth)
   , pointCloud(pointCloud)
@@ -176,8 +191,126 @@ struct RasterScanTrisoupEdges {
   , ctxtMemOctree(ctxtMemOctree)
   , currWedgePos(leaves.empty() ? Vec3<int32_t>{0,0,0} : leaves[0].pos)
   , edgesNeighNodes {0,0,0,0,0,0,0,0}
+  , numThreads(numThreads)
   {}
 
+  //---------------------------------------------------------------------------
+  // Accumulate, for each of the 12 edges of a node, the points of the node
+  // that determine the edge vertex (encoder) and its inter predictor.
+  // This depends only on the node and its points, not on the coding state.
+  void analyseNodeEdges(int nodeIdx)
+  {
+    const auto& leaf = leaves[nodeIdx];
+    EdgeStats* stats = &edgeStats[nodeIdx * 12];
+    std::fill(stats, stats + 12, EdgeStats{0, 0, 0, 0, 0, 0});
+
+    // the voxel line of each edge within the node and its start position
+    struct {
+      int dir0, dir1, dir2;
+      int pos1, pos2, start;
+    } edges[12];
+
+    for (int j = 0; j < 12; j++) {
+      auto& edge = edges[j];
+      int corner = startCorner[j];
+      edge.dir0 = LUTsegmentDirection[j];
+      edge.dir1 = (edge.dir0 + 1) % 3;
+      edge.dir2 = (edge.dir0 + 2) % 3;
+      edge.pos1 = leaf.pos[edge.dir1]
+        + ((corner >> edge.dir1) & 1 ? blockWidth - 1 : 0);
+      edge.pos2 = leaf.pos[edge.dir2]
+        + ((corner >> edge.dir2) & 1 ? blockWidth - 1 : 0);
+      edge.start = leaf.pos[edge.dir0];
+    }
+
+    // a point can only be near an edge if it is near two faces
+    auto isNearEdges = [&](const Vec3<int>& voxel, int dist) {
+      int numFaces = 0;
+      for (int k = 0; k < 3; k++) {
+        int lo = voxel[k] - leaf.pos[k];
+        int hi = leaf.pos[k] + blockWidth - 1 - voxel[k];
+        numFaces += std::abs(lo) < dist || std::abs(hi) < dist;
+      }
+      return numFaces >= 2;
+    };
+
+    if (isEncoder) {
+      const int dist = std::max(1, distanceSearchEncoder);
+      for (int i = leaf.start; i < leaf.end; i++) {
+        Vec3<int> voxel = pointCloud[i];
+        if (!isNearEdges(voxel, dist))
+          continue;
+
+        for (int j = 0; j < 12; j++) {
+          const auto& edge = edges[j];
+          int d1 = voxel[edge.dir1] - edge.pos1;
+          int d2 = voxel[edge.dir2] - edge.pos2;
+          if (!d1 && !d2) {
+            stats[j].countNearPoints++;
+            stats[j].distanceSum += voxel[edge.dir0] - edge.start;
+          }
+          if (
+            distanceSearchEncoder > 1 && std::abs(d1) < distanceSearchEncoder
+            && std::abs(d2) < distanceSearchEncoder) {
+            stats[j].countNearPoints2++;
+            stats[j].distanceSum2 += voxel[edge.dir0] - edge.start;
+          }
+        }
+      }
+    }
+
+    if (isInter) {
+      const PCCPointSet3& PC = compensatedPointCloud;
+      for (int i = leaf.predStart; i < leaf.predEnd; i++) {
+        Vec3<int> voxel = PC[i];
+        if (!isNearEdges(voxel, 1))
+          continue;
+
+        for (int j = 0; j < 12; j++) {
+          const auto& edge = edges[j];
+          if (
+            voxel[edge.dir1] == edge.pos1 && voxel[edge.dir2] == edge.pos2) {
+            stats[j].countNearPointsPred++;
+            stats[j].distanceSumPred += voxel[edge.dir0] - edge.start;
+          }
+        }
+      }
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // Analyse the edges of all nodes, using blocks of consecutive nodes
+  // per thread.
+
+  void analyseEdges()
+  {
+    if (!isEncoder && !isInter)
+      return;
+
+    PCC_TRACE_ZONE("trisoupEdgeAnalysis");
+    const int numNodes = leaves.size();
+    edgeStats.resize(numNodes * 12);
+
+    // avoid starting threads for small slices
+    const int kMinNodesPerThread = 256;
+    int nThreads = std::min(numThreads, numNodes / kMinNodesPerThread);
+    nThreads = std::max(1, nThreads);
+
+    auto analyseBlock = [&](int t) {
+      int first = int64_t(numNodes) * t / nThreads;
+      int last = int64_t(numNodes) * (t + 1) / nThreads;
+      for (int i = first; i < last; i++)
+        analyseNodeEdges(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < nThreads; t++)
+      threads.emplace_back(analyseBlock, t);
+    analyseBlock(0);
+    for (auto& thread : threads)
+      thread.join();
+  }
+
   //---------------------------------------------------------------------------
   void  encodeOneTriSoupVertexRasterScan(
     int8_t vertex,
@@ -371,28 +504,6 @@ struct RasterScanTrisoupEdges {
     }
   }
 
-  //---------------------------------------------------------------------------
-  void flush2PointCloud(
-    int& nRecPoints,
-    std::vector<int64_t>::iterator itBegingBlock,
-    int nPointsInBlock,
-    PCCPointSet3& recPointCloud
-    )
-  {
-    std::sort(itBegingBlock, itBegingBlock + nPointsInBlock);
-    auto last = std::unique(itBegingBlock, itBegingBlock + nPointsInBlock);
-
-    // Move list of points to pointCloud
-    int nPointInCloud = recPointCloud.getPointCount();
-
-    int nPointInNode = last - itBegingBlock;
-    if (nPointInCloud <= nRecPoints + nPointInNode)
-      recPointCloud.resize(nRecPoints + nPointInNode + PC_PREALLOCATION_SIZE);
-
-    for (auto it = itBegingBlock; it != last; it++)
-      recPointCloud[nRecPoints++] = { int(*it >> 40), int(*it >> 20) & 0xFFFFF, int(*it) & 0xFFFFF };
-  }
-
   void generateCentroidsInNodeRasterScan(
     const PCCOctree3Node& leaf,
     const std::vector<int8_t>& TriSoupVertices,
@@ -858,63 +969,9 @@ struct RasterScanTrisoupEdges {
       Vec3<int32_t> v0 = v1;
       v1 = nodeVertices[j1].pos;
 
-
-      // choose ray direction
-      Vec3<int32_t> edge1 = v1 - v0;
-      Vec3<int32_t> edge2 = v2 - v0;
-      Vec3<int32_t> a = crossProduct(edge2, edge1) >> kTrisoupFpBits;
-      Vec3<int32_t> h = a.abs();
-      int directionOk = (h[0] > h[1] && h[0] > h[2]) ? 0 : h[1] > h[2] ? 1 : 2;
-
-      // check if ray tracing is valid; if not skip triangle which is too small
-      if (h[directionOk] <= kTrisoupFpOne) // < 2*kTrisoupFpOne should be ok
-        continue;
-
-      int64_t inva =
-        divApprox(int64_t(1) << precDivA, std::abs(a[directionOk]), 0);
-      inva = a[directionOk] > 0 ? inva : -inva;
-
-      // range
-      int minRange[3];
-      int maxRange[3];
-      for (int k = 0; k < 3; k++) {
-        minRange[k] =
-          std::max(
-            0,
-            std::min(std::min(v0[k], v1[k]), v2[k])
-            + truncateValue >> kTrisoupFpBits);
-        maxRange[k] =
-          std::min(
-            blockWidth - 1,
-            std::max(std::max(v0[k], v1[k]), v2[k])
-            + truncateValue >> kTrisoupFpBits);
-      }
-      Vec3<int32_t> s0 = {
-        (minRange[0] << kTrisoupFpBits) - v0[0],
-        (minRange[1] << kTrisoupFpBits) - v0[1],
-        (minRange[2] << kTrisoupFpBits) - v0[2]
-      };
-
-      // ensure there is enough space in the block buffer
-      if (renderedBlock.size() <= nPointsInBlock + blockWidth * blockWidth)
-        renderedBlock.resize(renderedBlock.size() + blockWidth * blockWidth);
-
-      // applying ray tracing along direction
-      if (directionOk == 0)
-        rayTracingAlongdirection_samp1_optimX(
-          renderedBlock, nPointsInBlock, blockWidth, nodepos, minRange,
-          maxRange, edge1, edge2, s0, inva, haloTriangle, thickness);
-
-      if (directionOk == 1)
-        rayTracingAlongdirection_samp1_optimY(
-          renderedBlock, nPointsInBlock, blockWidth, nodepos, minRange,
-          maxRange, edge1, edge2, s0, inva, haloTriangle, thickness);
-
-      if (directionOk == 2)
-        rayTracingAlongdirection_samp1_optimZ(
-          renderedBlock, nPointsInBlock, blockWidth, nodepos, minRange,
-          maxRange, edge1, edge2, s0, inva, haloTriangle, thickness);
-
+      rayTracingTriangle(
+        renderedBlock, nPointsInBlock, blockWidth, nodepos, v0, v1, v2,
+        haloTriangle, thickness);
     }  // end loop on triangles
 
     return nPointsInBlock;
@@ -1072,34 +1129,19 @@ struct RasterScanTrisoupEdges {
             }
 
             // determine TriSoup Vertex by the encoder
-            const int offset1 = leaves[neighbNodeIndex].pos[dir1] < currWedgePos[dir1];
-            const int offset2 = leaves[neighbNodeIndex].pos[dir2] < currWedgePos[dir2];
-            const int pos1 = currWedgePos[dir1] - offset1;
-            const int pos2 = currWedgePos[dir2] - offset2;
             if (isEncoder) {
-              for (int j = leaves[neighbNodeIndex].start; j < leaves[neighbNodeIndex].end; j++) {
-                Vec3<int> voxel = pointCloud[j];
-                if (voxel[dir1] ==  pos1 && voxel[dir2] == pos2) {
-                  countNearPoints++;
-                  distanceSum += voxel[dir0] - currWedgePos[dir0];
-                }
-                if (distanceSearchEncoder > 1 && std::abs(voxel[dir1] - pos1) < distanceSearchEncoder && std::abs(voxel[dir2] - pos2) < distanceSearchEncoder) {
-                  countNearPoints2++;
-                  distanceSum2 += voxel[dir0] - currWedgePos[dir0];
-                }
-              }
+              const auto& stats = edgeStats[idx];
+              countNearPoints += stats.countNearPoints;
+              distanceSum += stats.distanceSum;
+              countNearPoints2 += stats.countNearPoints2;
+              distanceSum2 += stats.distanceSum2;
             }
 
             // determine TriSoup Vertex inter prediction
             if (isInter) {
-              const PCCPointSet3& PC = compensatedPointCloud;
-              for (int j = leaves[neighbNodeIndex].predStart; j < leaves[neighbNodeIndex].predEnd; j++) {
-                Vec3<int> voxel = PC[j];
-                if (voxel[dir1] == pos1 && voxel[dir2] == pos2) {
-                  countNearPointsPred++;
-                  distanceSumPred += voxel[dir0] - currWedgePos[dir0];
-                }
-              }
+              const auto& stats = edgeStats[idx];
+              countNearPointsPred += stats.countNearPointsPred;
+              distanceSumPred += stats.distanceSumPred;
             }
           }
         } // end loop on 4 neighbouring nodes
@@ -1326,10 +1368,13 @@ void codeAndRenderTriSoupRasterScan(
   pcc::EntropyEncoder* arithmeticEncoder,
   pcc::EntropyDecoder& arithmeticDecoder,
   GeometryOctreeContexts& ctxtMemOctree,
-  int &nSegments) {
+  int &nSegments,
+  int numThreads) {
+  PCC_TRACE_ZONE("trisoupRender");
 
   const int32_t blockWidth = defaultBlockWidth; // Width of block. In future, may override with leaf blockWidth
-  RasterScanTrisoupEdges rste(leaves, blockWidth, pointCloud, isEncoder, bitDropped, distanceSearchEncoder, isInter, compensatedPointCloud, gps, gbh, arithmeticEncoder, arithmeticDecoder, ctxtMemOctree);
+  RasterScanTrisoupEdges rste(leaves, blockWidth, pointCloud, isEncoder, bitDropped, distanceSearchEncoder, isInter, compensatedPointCloud, gps, gbh, arithmeticEncoder, arithmeticDecoder, ctxtMemOctree, numThreads);
+  rste.analyseEdges();
   rste.buildSegments(nSegments);
 }
 
@@ -2069,6 +2114,98 @@ int findDominantAxis(
   return dominantAxis;
 }
 
+// --------------------------------------------------------
+void
+rayTracingTriangle(
+  std::vector<int64_t>& renderedBlock,
+  int& nPointsInBlock,
+  int blockWidth,
+  Vec3<int32_t>& nodepos,
+  const Vec3<int32_t>& v0,
+  const Vec3<int32_t>& v1,
+  const Vec3<int32_t>& v2,
+  int haloTriangle,
+  int thickness)
+{
+  // choose ray direction
+  Vec3<int32_t> edge1 = v1 - v0;
+  Vec3<int32_t> edge2 = v2 - v0;
+  Vec3<int32_t> a = crossProduct(edge2, edge1) >> kTrisoupFpBits;
+  Vec3<int32_t> h = a.abs();
+  int directionOk = (h[0] > h[1] && h[0] > h[2]) ? 0 : h[1] > h[2] ? 1 : 2;
+
+  // check if ray tracing is valid; if not skip triangle which is too small
+  if (h[directionOk] <= kTrisoupFpOne) // < 2*kTrisoupFpOne should be ok
+    return;
+
+  int64_t inva =
+    divApprox(int64_t(1) << precDivA, std::abs(a[directionOk]), 0);
+  inva = a[directionOk] > 0 ? inva : -inva;
+
+  // range
+  int minRange[3];
+  int maxRange[3];
+  for (int k = 0; k < 3; k++) {
+    minRange[k] =
+      std::max(
+        0,
+        std::min(std::min(v0[k], v1[k]), v2[k])
+        + truncateValue >> kTrisoupFpBits);
+    maxRange[k] =
+      std::min(
+        blockWidth - 1,
+        std::max(std::max(v0[k], v1[k]), v2[k])
+        + truncateValue >> kTrisoupFpBits);
+  }
+  Vec3<int32_t> s0 = {
+    (minRange[0] << kTrisoupFpBits) - v0[0],
+    (minRange[1] << kTrisoupFpBits) - v0[1],
+    (minRange[2] << kTrisoupFpBits) - v0[2]
+  };
+
+  // ensure there is enough space in the block buffer
+  if (renderedBlock.size() <= nPointsInBlock + blockWidth * blockWidth)
+    renderedBlock.resize(renderedBlock.size() + blockWidth * blockWidth);
+
+  // applying ray tracing along direction
+  if (directionOk == 0)
+    rayTracingAlongdirection_samp1_optimX(
+      renderedBlock, nPointsInBlock, blockWidth, nodepos, minRange,
+      maxRange, edge1, edge2, s0, inva, haloTriangle, thickness);
+
+  if (directionOk == 1)
+    rayTracingAlongdirection_samp1_optimY(
+      renderedBlock, nPointsInBlock, blockWidth, nodepos, minRange,
+      maxRange, edge1, edge2, s0, inva, haloTriangle, thickness);
+
+  if (directionOk == 2)
+    rayTracingAlongdirection_samp1_optimZ(
+      renderedBlock, nPointsInBlock, blockWidth, nodepos, minRange,
+      maxRange, edge1, edge2, s0, inva, haloTriangle, thickness);
+}
+
+// --------------------------------------------------------
+void
+flush2PointCloud(
+  int& nRecPoints,
+  std::vector<int64_t>::iterator itBegingBlock,
+  int nPointsInBlock,
+  PCCPointSet3& recPointCloud)
+{
+  std::sort(itBegingBlock, itBegingBlock + nPointsInBlock);
+  auto last = std::unique(itBegingBlock, itBegingBlock + nPointsInBlock);
+
+  // Move list of points to pointCloud
+  int nPointInCloud = recPointCloud.getPointCount();
+
+  int nPointInNode = last - itBegingBlock;
+  if (nPointInCloud <= nRecPoints + nPointInNode)
+    recPointCloud.resize(nRecPoints + nPointInNode + PC_PREALLOCATION_SIZE);
+
+  for (auto it = itBegingBlock; it != last; it++)
+    recPointCloud[nRecPoints++] = { int(*it >> 40), int(*it >> 20) & 0xFFFFF, int(*it) & 0xFFFFF };
+}
+
 // --------------------------------------------------------
 void rayTracingAlongdirection_samp1_optimX(
   std::vector<int64_t>& renderedBlock,
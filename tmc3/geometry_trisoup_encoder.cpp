@@ -88,7 +88,8 @@ encodeGeometryTrisoup(
 
     distanceSearchEncoder = (1 << std::max(0, bitDropped - 2)) - 1;
     distanceSearchEncoder += int(std::round(estimatedSampling + 0.1f));
-    distanceSearchEncoder = std::max(1, std::min(8, distanceSearchEncoder));
+    distanceSearchEncoder = std::max(
+      1, std::min(opt.maxVertexSearchDistance, distanceSearchEncoder));
     std::cout << "distanceSearchEncoder = " << distanceSearchEncoder << "\n";
   }
 
@@ -100,7 +101,8 @@ encodeGeometryTrisoup(
   EntropyDecoder foo;
   int nSegments = 0;
   codeAndRenderTriSoupRasterScan(nodes, blockWidth, pointCloud, true, bitDropped, distanceSearchEncoder,
-    isInter, compensatedPointCloud, gps, gbh, arithmeticEncoder, foo, ctxtMemOctree, nSegments);
+    isInter, compensatedPointCloud, gps, gbh, arithmeticEncoder, foo, ctxtMemOctree, nSegments,
+    opt.numThreads);
 
   std::cout << "TriSoup gives " << pointCloud.getPointCount() << " points \n";
 
@@ -37,6 +37,8 @@
 
 #include <cstdint>
 
+#include "pcc_trace.h"
+
 namespace pcc {
 
 //============================================================================
@@ -44,6 +46,7 @@ namespace pcc {
 std::ostream&
 writeTlv(const PayloadBuffer& buf, std::ostream& os)
 {
+  PCC_TRACE_ZONE("tlvWrite");
   uint32_t length = uint32_t(buf.size());
 
   os.put(char(buf.type));
@@ -62,17 +65,15 @@ std::istream&
 readTlv(std::istream& is, PayloadBuffer* buf)
 {
   buf->resize(0);
-  buf->type = PayloadType(static_cast<unsigned>(is.get()));
-
-  uint32_t length = 0;
-  length = (length << 8) | static_cast<unsigned>(is.get());
-  length = (length << 8) | static_cast<unsigned>(is.get());
-  length = (length << 8) | static_cast<unsigned>(is.get());
-  length = (length << 8) | static_cast<unsigned>(is.get());
 
-  if (!is)
+  unsigned char hdr[5];
+  if (!is.read(reinterpret_cast<char*>(hdr), sizeof(hdr)))
     return is;
 
+  buf->type = PayloadType(hdr[0]);
+  uint32_t length = uint32_t(hdr[1]) << 24 | uint32_t(hdr[2]) << 16
+    | uint32_t(hdr[3]) << 8 | uint32_t(hdr[4]);
+
   buf->resize(length);
   is.read(buf->data(), length);
   return is;
@@ -80,4 +81,24 @@ readTlv(std::istream& is, PayloadBuffer* buf)
 
 //============================================================================
 
+const char*
+parseTlv(const char* begin, const char* end, PayloadView* view)
+{
+  if (end - begin < 5)
+    return nullptr;
+
+  auto hdr = reinterpret_cast<const unsigned char*>(begin);
+  view->type = PayloadType(hdr[0]);
+  view->length = uint32_t(hdr[1]) << 24 | uint32_t(hdr[2]) << 16
+    | uint32_t(hdr[3]) << 8 | uint32_t(hdr[4]);
+  view->data = begin + 5;
+
+  if (uint64_t(end - view->data) < view->length)
+    return nullptr;
+
+  return view->data + view->length;
+}
+
+//============================================================================
+
 }  // namespace pcc
\ No newline at end of file
@@ -37,6 +37,7 @@
 
 #include "PayloadBuffer.h"
 
+#include <cstdint>
 #include <istream>
 #include <ostream>
 
@@ -48,6 +49,27 @@ std::ostream& writeTlv(const PayloadBuffer& buf, std::ostream& os);
 
 std::istream& readTlv(std::istream& is, PayloadBuffer* buf);
 
+//============================================================================
+// A TLV encapsulated payload that is held elsewhere in memory.
+
+struct PayloadView {
+  PayloadType type;
+  const char* data;
+  uint32_t length;
+
+  void copyTo(PayloadBuffer* buf) const
+  {
+    buf->type = type;
+    buf->assign(data, data + length);
+  }
+};
+
+//----------------------------------------------------------------------------
+// Parse the TLV encapsulated payload at the start of [begin, end).
+// Returns the start of the next payload, or nullptr if truncated.
+
+const char* parseTlv(const char* begin, const char* end, PayloadView* view);
+
 //============================================================================
 
 }  // namespace pcc
\ No newline at end of file
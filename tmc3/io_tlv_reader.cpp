@@ -0,0 +1,444 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "io_tlv_reader.h"
+
+#include "framectr.h"
+#include "hls.h"
+#include "io_hls.h"
+#include "pcc_trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#if _POSIX_C_SOURCE
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace pcc {
+
+//============================================================================
+
+bool
+MappedFile::open(const std::string& path, bool map)
+{
+  close();
+
+#if _POSIX_C_SOURCE
+  if (map) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+      ::close(fd);
+      return false;
+    }
+
+    _size = size_t(st.st_size);
+    if (_size) {
+      void* ptr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr != MAP_FAILED) {
+        madvise(ptr, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(ptr);
+        _mapped = true;
+      }
+    }
+    ::close(fd);
+
+    if (_mapped || !_size)
+      return true;
+  }
+#endif
+
+  // Fallback: read the whole file
+  std::ifstream fin(path, std::ios::binary | std::ios::ate);
+  if (!fin)
+    return false;
+
+  _buf.resize(size_t(fin.tellg()));
+  fin.seekg(0);
+  fin.read(_buf.data(), _buf.size());
+  if (!fin)
+    return false;
+
+  _data = _buf.data();
+  _size = _buf.size();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+void
+MappedFile::close()
+{
+#if _POSIX_C_SOURCE
+  if (_mapped)
+    munmap(const_cast<char*>(_data), _size);
+#endif
+
+  _buf.clear();
+  _data = nullptr;
+  _size = 0;
+  _mapped = false;
+}
+
+//============================================================================
+// Copy the parts of a geometry brick required to parse its header.
+// Since the footer is parsed along with the header, only the start and
+// end of large bricks are copied.
+
+static void
+copyGbhPayload(const PayloadView& view, PayloadBuffer* buf)
+{
+  const uint32_t kPartLen = 512;
+  if (view.length <= 2 * kPartLen) {
+    view.copyTo(buf);
+    return;
+  }
+
+  buf->type = view.type;
+  buf->assign(view.data, view.data + kPartLen);
+  const char* tail = view.data + view.length - kPartLen;
+  buf->insert(buf->end(), tail, tail + kPartLen);
+}
+
+//----------------------------------------------------------------------------
+
+bool
+TlvIndex::build(const char* data, size_t size)
+{
+  PCC_TRACE_ZONE("tlvIndex");
+  payloads.clear();
+  frames.clear();
+  bitstreamSize = size;
+
+  // As per the decoder, the first sps and gps (by id) are activated
+  std::map<int, SequenceParameterSet> spss;
+  std::map<int, GeometryParameterSet> gpss;
+
+  FrameCtr frameCtr;
+  PayloadBuffer buf;
+
+  frames.push_back({0, 0, true});
+  bool frameStarted = false;
+  bool frameHasGeom = false;
+
+  const char* end = data + size;
+  for (const char* ptr = data; ptr != end;) {
+    PayloadView view;
+    // NB: as per readTlv, a truncated payload ends the bitstream
+    const char* next = parseTlv(ptr, end, &view);
+    if (!next)
+      break;
+
+    uint32_t payloadIdx = uint32_t(payloads.size());
+    payloads.push_back({uint64_t(view.data - data), view.length, view.type});
+    ptr = next;
+
+    int frameCtrLsb = -1;
+    GeometryBrickHeader gbh{};
+    switch (view.type) {
+    case PayloadType::kSequenceParameterSet: {
+      view.copyTo(&buf);
+      auto sps = parseSps(buf);
+      spss[sps.sps_seq_parameter_set_id] = std::move(sps);
+      break;
+    }
+
+    case PayloadType::kGeometryParameterSet: {
+      view.copyTo(&buf);
+      auto gps = parseGps(buf);
+      gpss[gps.gps_geom_parameter_set_id] = std::move(gps);
+      break;
+    }
+
+    case PayloadType::kGeometryBrick:
+      if (spss.empty() || gpss.empty())
+        return false;
+      copyGbhPayload(view, &buf);
+      gbh = parseGbh(
+        spss.cbegin()->second, gpss.cbegin()->second, buf, nullptr,
+        nullptr);
+      frameCtrLsb = gbh.frame_ctr_lsb;
+      break;
+
+    case PayloadType::kFrameBoundaryMarker:
+      view.copyTo(&buf);
+      frameCtrLsb = parseFrameBoundaryMarker(buf).fbdu_frame_ctr_lsb;
+      break;
+
+    case PayloadType::kGeneralizedAttrParamInventory:
+      view.copyTo(&buf);
+      frameCtrLsb = parseAttrParamInventoryHdr(buf).attr_param_frame_ctr_lsb;
+      break;
+
+    // NB: the tile inventory precedes the first slice of the frame in
+    // which it comes into force, and so starts that frame.
+    case PayloadType::kTileInventory:
+      view.copyTo(&buf);
+      frameCtrLsb = parseTileInventory(buf).ti_frame_ctr;
+      break;
+
+    default: break;
+    }
+
+    if (frameCtrLsb >= 0) {
+      if (spss.empty())
+        return false;
+
+      int frameCtrBits = spss.cbegin()->second.frame_ctr_bits;
+      bool bdry = frameCtr.isDifferentFrame(frameCtrLsb, frameCtrBits);
+      frameCtr.update(frameCtrLsb, frameCtrBits);
+
+      // Any payloads prior to the first frame belong to the first frame
+      if (bdry && frameStarted) {
+        frames.back().isRandomAccessPoint &= frameHasGeom;
+        frames.push_back({payloadIdx, 0, true});
+        frameHasGeom = false;
+      }
+      frameStarted = true;
+    }
+
+    auto& frame = frames.back();
+    frame.numPayloads = payloadIdx + 1 - frame.firstPayload;
+
+    if (view.type == PayloadType::kGeometryBrick) {
+      // NB: the first slice of a random access frame cannot continue
+      // the entropy coding state of a previous frame.
+      bool dependent = gbh.interPredictionEnabledFlag
+        || (!frameHasGeom && gbh.entropy_continuation_flag);
+      frame.isRandomAccessPoint &= !dependent;
+      frameHasGeom = true;
+    }
+  }
+
+  frames.back().isRandomAccessPoint &= frameHasGeom;
+  if (!frameStarted)
+    frames.clear();
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+int
+TlvIndex::randomAccessFrameFor(int frameIdx) const
+{
+  for (int i = std::min(frameIdx, int(frames.size()) - 1); i >= 0; i--) {
+    if (frames[i].isRandomAccessPoint)
+      return i;
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+// The sidecar file format is a header followed by the payload and frame
+// tables, with all values little endian:
+//   "TLVI" u32:version u64:bitstreamSize u32:numPayloads u32:numFrames
+//   numPayloads * { u64:offset u32:length u8:type }
+//   numFrames * { u32:firstPayload u32:numPayloads u8:isRandomAccessPoint }
+
+static const char kIndexMagic[4] = {'T', 'L', 'V', 'I'};
+static const uint32_t kIndexVersion = 2;
+
+template<typename T>
+static void
+putLe(std::vector<char>& out, T val)
+{
+  for (size_t i = 0; i < sizeof(T); i++)
+    out.push_back(char(uint64_t(val) >> (8 * i)));
+}
+
+template<typename T>
+static bool
+getLe(const char*& ptr, const char* end, T* val)
+{
+  if (size_t(end - ptr) < sizeof(T))
+    return false;
+
+  uint64_t v = 0;
+  for (size_t i = 0; i < sizeof(T); i++)
+    v |= uint64_t(static_cast<unsigned char>(*ptr++)) << (8 * i);
+  *val = T(v);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool
+TlvIndex::save(const std::string& path) const
+{
+  std::vector<char> out(kIndexMagic, kIndexMagic + 4);
+  out.reserve(24 + payloads.size() * 13 + frames.size() * 9);
+  putLe(out, kIndexVersion);
+  putLe(out, bitstreamSize);
+  putLe(out, uint32_t(payloads.size()));
+  putLe(out, uint32_t(frames.size()));
+
+  for (const auto& entry : payloads) {
+    putLe(out, entry.offset);
+    putLe(out, entry.length);
+    putLe(out, uint8_t(entry.type));
+  }
+
+  for (const auto& frame : frames) {
+    putLe(out, frame.firstPayload);
+    putLe(out, frame.numPayloads);
+    putLe(out, uint8_t(frame.isRandomAccessPoint));
+  }
+
+  std::ofstream fout(path, std::ios::binary);
+  fout.write(out.data(), out.size());
+  return bool(fout);
+}
+
+//----------------------------------------------------------------------------
+
+bool
+TlvIndex::load(const std::string& path)
+{
+  MappedFile file;
+  if (!file.open(path) || file.size() < 4)
+    return false;
+
+  const char* ptr = file.data();
+  const char* end = ptr + file.size();
+  if (!std::equal(kIndexMagic, kIndexMagic + 4, ptr))
+    return false;
+  ptr += 4;
+
+  uint32_t version, numPayloads, numFrames;
+  if (
+    !getLe(ptr, end, &version) || version != kIndexVersion
+    || !getLe(ptr, end, &bitstreamSize) || !getLe(ptr, end, &numPayloads)
+    || !getLe(ptr, end, &numFrames))
+    return false;
+
+  if (uint64_t(end - ptr) != uint64_t(numPayloads) * 13 + numFrames * 9)
+    return false;
+
+  payloads.resize(numPayloads);
+  for (auto& entry : payloads) {
+    uint8_t type = 0;
+    getLe(ptr, end, &entry.offset);
+    getLe(ptr, end, &entry.length);
+    getLe(ptr, end, &type);
+    entry.type = PayloadType(type);
+  }
+
+  frames.resize(numFrames);
+  for (auto& frame : frames) {
+    uint8_t isRap = 0;
+    getLe(ptr, end, &frame.firstPayload);
+    getLe(ptr, end, &frame.numPayloads);
+    getLe(ptr, end, &isRap);
+    frame.isRandomAccessPoint = isRap;
+  }
+
+  return true;
+}
+
+//============================================================================
+
+bool
+TlvReader::open(const std::string& path, const std::string& indexPath)
+{
+  if (!_file.open(path))
+    return false;
+
+  // Use a sidecar index if it is consistent with the bitstream
+  if (!indexPath.empty() && _index.load(indexPath)) {
+    bool valid = _index.bitstreamSize == _file.size();
+    for (const auto& entry : _index.payloads)
+      valid &= entry.offset + entry.length <= _file.size();
+
+    if (valid)
+      return true;
+  }
+
+  if (!_index.build(_file.data(), _file.size()))
+    return false;
+
+  if (!indexPath.empty())
+    _index.save(indexPath);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool
+TlvReader::seek(int frameIdx, SeekPoint* point) const
+{
+  int rapIdx = _index.randomAccessFrameFor(frameIdx);
+  if (rapIdx < 0)
+    return false;
+
+  point->frameIdx = rapIdx;
+  point->firstPayload = _index.frames[rapIdx].firstPayload;
+  point->parameterSets.clear();
+
+  int64_t lastInventory = -1;
+  for (uint32_t i = 0; i < point->firstPayload; i++) {
+    switch (_index.payloads[i].type) {
+    case PayloadType::kSequenceParameterSet:
+    case PayloadType::kGeometryParameterSet:
+    case PayloadType::kAttributeParameterSet:
+      point->parameterSets.push_back(i);
+      break;
+
+    // only the last tile inventory remains in force
+    case PayloadType::kTileInventory: lastInventory = i; break;
+
+    default: break;
+    }
+  }
+
+  if (lastInventory >= 0)
+    point->parameterSets.push_back(uint32_t(lastInventory));
+
+  return true;
+}
+
+//============================================================================
+
+}  // namespace pcc
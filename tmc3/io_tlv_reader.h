@@ -0,0 +1,157 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include "io_tlv.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pcc {
+
+//============================================================================
+// A read-only view of an entire file.  The file is memory mapped where
+// supported, otherwise it is read into memory.
+
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { close(); }
+
+  // If map is false, the file is read into memory even where mapping
+  // is supported.
+  bool open(const std::string& path, bool map = true);
+  void close();
+
+  const char* data() const { return _data; }
+  size_t size() const { return _size; }
+
+private:
+  const char* _data = nullptr;
+  size_t _size = 0;
+
+  // storage used when the file is not mapped
+  std::vector<char> _buf;
+
+  bool _mapped = false;
+};
+
+//============================================================================
+// The location of each payload in a TLV bitstream and its grouping
+// into frames.
+
+struct TlvIndex {
+  struct Payload {
+    // Offset of the payload data (after the TLV header) in the bitstream
+    uint64_t offset;
+    uint32_t length;
+    PayloadType type;
+  };
+
+  struct Frame {
+    // The frame comprises payloads [firstPayload, firstPayload + numPayloads)
+    uint32_t firstPayload;
+    uint32_t numPayloads;
+
+    // The frame may be decoded without reference to any earlier frame
+    bool isRandomAccessPoint;
+  };
+
+  std::vector<Payload> payloads;
+  std::vector<Frame> frames;
+
+  // Length of the indexed bitstream
+  uint64_t bitstreamSize = 0;
+
+  // Index the bitstream held in [data, data + size).
+  // Frame boundaries are determined as per the decoder.
+  bool build(const char* data, size_t size);
+
+  // Read or write the index as a sidecar file.
+  bool load(const std::string& path);
+  bool save(const std::string& path) const;
+
+  // The last random access frame at or before frameIdx, or -1 if none.
+  int randomAccessFrameFor(int frameIdx) const;
+};
+
+//============================================================================
+// Zero-copy access to the payloads of a memory mapped TLV bitstream.
+
+class TlvReader {
+public:
+  // Where to start decoding in order to output a given frame: each
+  // parameter set and the last tile inventory that precede the random
+  // access point, followed by all payloads from firstPayload onwards.
+  struct SeekPoint {
+    int frameIdx;
+    uint32_t firstPayload;
+    std::vector<uint32_t> parameterSets;
+  };
+
+  // Map the bitstream at path and index it.  If indexPath is not empty,
+  // a valid index is loaded from it, otherwise the index is built and
+  // saved there.
+  bool open(const std::string& path, const std::string& indexPath = {});
+
+  const TlvIndex& index() const { return _index; }
+
+  size_t size() const { return _file.size(); }
+  int numFrames() const { return int(_index.frames.size()); }
+  size_t numPayloads() const { return _index.payloads.size(); }
+
+  PayloadView payload(size_t idx) const
+  {
+    const auto& entry = _index.payloads[idx];
+    return {entry.type, _file.data() + entry.offset, entry.length};
+  }
+
+  // Determine how to start decoding such that frameIdx is output.
+  bool seek(int frameIdx, SeekPoint* point) const;
+
+private:
+  MappedFile _file;
+  TlvIndex _index;
+};
+
+//============================================================================
+
+}  // namespace pcc
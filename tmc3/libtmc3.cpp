@@ -0,0 +1,465 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "libtmc3.h"
+
+#include "attribute_conversion.h"
+#include "pointset_processing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+namespace pcc {
+
+//============================================================================
+
+void
+copyToPointSet(const PointBufferView& src, PCCPointSet3* dst)
+{
+  const bool withColours = src.colour[0] && src.colour[1] && src.colour[2];
+  const bool withReflectances = src.reflectance;
+
+  dst->addRemoveAttributes(withColours, withReflectances);
+  dst->resize(src.numPoints);
+
+  const double scale = src.positionScale;
+  for (int k = 0; k < 3; k++) {
+    const double* srcPos = src.position[k];
+    for (size_t i = 0; i < src.numPoints; i++)
+      (*dst)[i][k] = srcPos[i] * scale;
+  }
+
+  if (withColours) {
+    for (size_t i = 0; i < src.numPoints; i++) {
+      dst->setColor(
+        i, {src.colour[0][i], src.colour[1][i], src.colour[2][i]});
+    }
+  }
+
+  if (withReflectances) {
+    for (size_t i = 0; i < src.numPoints; i++)
+      dst->setReflectance(i, src.reflectance[i]);
+  }
+}
+
+//============================================================================
+
+StreamEncoder::StreamEncoder(
+  const EncoderParams& params, OutputBufferFn onOutputBuffer)
+  : _params(params)
+  , _onOutputBuffer(std::move(onOutputBuffer))
+  , _frameCount(0)
+{}
+
+//----------------------------------------------------------------------------
+
+void
+StreamEncoder::setPostRecolourCallback(PostRecolourFn fn)
+{
+  _onPostRecolour = std::move(fn);
+}
+
+//----------------------------------------------------------------------------
+
+int
+StreamEncoder::encode(PCCPointSet3& cloud, CloudFrame* recon)
+{
+  if (!cloud.getPointCount())
+    return -1;
+
+  // Sanitise the input point cloud
+  // todo(df): remove the following with generic handling of properties
+  bool codeColour = _params.attributeIdxMap.count("color");
+  if (!codeColour)
+    cloud.removeColors();
+  assert(codeColour == cloud.hasColors());
+
+  bool codeReflectance = _params.attributeIdxMap.count("reflectance");
+  if (!codeReflectance)
+    cloud.removeReflectances();
+  assert(codeReflectance == cloud.hasReflectances());
+
+  // A reconstruction is required to predict subsequent frames
+  if (!recon && _params.sps.inter_frame_prediction_enabled_flag)
+    recon = &_recon;
+
+  // NB: the encoder appends each reconstructed slice to the frame
+  if (recon)
+    recon->cloud.clear();
+
+  _encoder.setInterForCurrPic(
+    _params.gps.interPredictionEnabledFlag
+    && (_frameCount % _params.randomAccessPeriod));
+
+  int ret = _encoder.compress(cloud, &_params, this, recon);
+  if (ret)
+    return ret;
+
+  _frameCount++;
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+
+int
+StreamEncoder::encode(const PointBufferView& points, CloudFrame* recon)
+{
+  copyToPointSet(points, &_inputCloud);
+  return encode(_inputCloud, recon);
+}
+
+//----------------------------------------------------------------------------
+
+void
+StreamEncoder::onOutputBuffer(const PayloadBuffer& buf)
+{
+  if (_onOutputBuffer)
+    _onOutputBuffer(buf);
+}
+
+//----------------------------------------------------------------------------
+
+void
+StreamEncoder::onPostRecolour(const PCCPointSet3& cloud)
+{
+  if (_onPostRecolour)
+    _onPostRecolour(cloud);
+}
+
+//============================================================================
+
+StreamDecoder::StreamDecoder(
+  const DecoderParams& params, OutputCloudFn onOutputCloud)
+  : _decoder(params), _onOutputCloud(std::move(onOutputCloud))
+{}
+
+//----------------------------------------------------------------------------
+
+void
+StreamDecoder::setGeometryLevelCallback(GeometryLevelFn fn)
+{
+  _decoder.setGeometryLevelCallback(std::move(fn));
+}
+
+//----------------------------------------------------------------------------
+
+int
+StreamDecoder::decode(const PayloadBuffer& buf)
+{
+  return _decoder.decompress(&buf, this);
+}
+
+//----------------------------------------------------------------------------
+
+int
+StreamDecoder::decode(const PayloadView& view)
+{
+  // NB: the decoder does not retain the payload
+  PayloadBuffer buf;
+  view.copyTo(&buf);
+  return _decoder.decompress(&buf, this);
+}
+
+//----------------------------------------------------------------------------
+
+int
+StreamDecoder::flush()
+{
+  return _decoder.decompress(nullptr, this);
+}
+
+//----------------------------------------------------------------------------
+
+void
+StreamDecoder::onOutputCloud(const CloudFrame& frame)
+{
+  if (_onOutputCloud)
+    _onOutputCloud(frame);
+}
+
+//============================================================================
+
+static const AttributeDescription*
+findColourAttrDesc(const std::vector<AttributeDescription>& attrDescs)
+{
+  // todo(df): don't assume that there is only one colour attribute in the sps
+  for (const auto& desc : attrDescs) {
+    if (desc.attributeLabel == KnownAttributeLabel::kColour)
+      return &desc;
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+
+void
+convertToGbr(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud)
+{
+  const AttributeDescription* attrDesc = findColourAttrDesc(attrDescs);
+  if (!attrDesc)
+    return;
+
+  switch (attrDesc->params.cicp_matrix_coefficients_idx) {
+  case ColourMatrix::kBt709: convertYCbCrBt709ToGbr(cloud); break;
+
+  case ColourMatrix::kYCgCo:
+    // todo(df): select YCgCoR vs YCgCo
+    // NB: bitdepth is the transformed bitdepth, not the source
+    convertYCgCoRToGbr(attrDesc->bitdepth - 1, cloud);
+    break;
+
+  default: break;
+  }
+}
+
+//----------------------------------------------------------------------------
+
+void
+convertFromGbr(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud)
+{
+  const AttributeDescription* attrDesc = findColourAttrDesc(attrDescs);
+  if (!attrDesc)
+    return;
+
+  switch (attrDesc->params.cicp_matrix_coefficients_idx) {
+  case ColourMatrix::kBt709: convertGbrToYCbCrBt709(cloud); break;
+
+  case ColourMatrix::kYCgCo:
+    // todo(df): select YCgCoR vs YCgCo
+    // NB: bitdepth is the transformed bitdepth, not the source
+    convertGbrToYCgCoR(attrDesc->bitdepth - 1, cloud);
+    break;
+
+  default: break;
+  }
+}
+
+//============================================================================
+
+static const AttributeDescription*
+findReflAttrDesc(const std::vector<AttributeDescription>& attrDescs)
+{
+  // todo(df): don't assume that there is only one in the sps
+  for (const auto& desc : attrDescs) {
+    if (desc.attributeLabel == KnownAttributeLabel::kReflectance)
+      return &desc;
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+
+// Determines if attribute scaling modifies values of @attrDesc.
+
+static bool
+hasAttributeScaling(const AttributeDescription* attrDesc)
+{
+  if (!attrDesc || !attrDesc->params.scalingParametersPresent)
+    return false;
+
+  auto& params = attrDesc->params;
+
+  // Parameters present, but nothing to do
+  bool unityScale = !params.attr_scale_minus1 && !params.attr_frac_bits;
+  return !unityScale || params.attr_offset;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename Op>
+static void
+scaleAttributes(
+  const std::vector<AttributeDescription>& attrDescs,
+  PCCPointSet3& cloud,
+  Op scaler)
+{
+  // todo(df): extend this to other attributes
+  const AttributeDescription* attrDesc = findReflAttrDesc(attrDescs);
+  if (!hasAttributeScaling(attrDesc))
+    return;
+
+  auto& params = attrDesc->params;
+  const auto pointCount = cloud.getPointCount();
+  if (pointCount)
+    scaler(params, &cloud.getReflectance(0), pointCount);
+}
+
+//----------------------------------------------------------------------------
+
+void
+scaleAttributesForInput(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud)
+{
+  scaleAttributes(attrDescs, cloud, scaleAttributesFwd);
+}
+
+//----------------------------------------------------------------------------
+
+void
+scaleAttributesForOutput(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud)
+{
+  scaleAttributes(attrDescs, cloud, scaleAttributesInv);
+}
+
+//============================================================================
+
+static void
+copyFromCloudFrame(
+  const CloudFrame& frame,
+  const PointOutputBufferView& dst,
+  size_t begin,
+  size_t end)
+{
+  const PCCPointSet3& cloud = frame.cloud;
+
+  // Source component of each output axis
+  const Vec3<int> axis = toXyz(frame.geometry_axis_order, Vec3<int>{0, 1, 2});
+
+  const AttributeDescription* colourDesc = findColourAttrDesc(frame.attrDesc);
+  auto colourMatrix = colourDesc
+    ? colourDesc->params.cicp_matrix_coefficients_idx
+    : ColourMatrix::kIdentity;
+
+  const AttributeDescription* reflDesc = findReflAttrDesc(frame.attrDesc);
+  const bool scaleReflectance = hasAttributeScaling(reflDesc);
+
+  // Points are processed in blocks that remain in cache between steps
+  const int kBlockSize = 256;
+  Vec3<attr_t> colours[kBlockSize];
+
+  for (size_t start = begin; start < end; start += kBlockSize) {
+    int len = int(std::min(end - start, size_t(kBlockSize)));
+    const point_t* pos = &cloud[start];
+
+    if (dst.positionXyz) {
+      float* out = dst.positionXyz + 3 * start;
+      for (int i = 0; i < len; i++) {
+        for (int k = 0; k < 3; k++) {
+          double val = pos[i][axis[k]] * dst.positionScale;
+          out[3 * i + k] = float(val + dst.positionOffset[k]);
+        }
+      }
+    }
+
+    for (int k = 0; k < 3; k++) {
+      if (!dst.position[k])
+        continue;
+      int32_t* out = dst.position[k] + start;
+      for (int i = 0; i < len; i++)
+        out[i] = pos[i][axis[k]];
+    }
+
+    if (dst.colourRgb8 && cloud.hasColors()) {
+      for (int i = 0; i < len; i++)
+        colours[i] = cloud.getColor(start + i);
+
+      switch (colourMatrix) {
+      case ColourMatrix::kBt709: convertYCbCrBt709ToGbr(colours, len); break;
+
+      case ColourMatrix::kYCgCo:
+        // NB: bitdepth is the transformed bitdepth, not the source
+        convertYCgCoRToGbr(colourDesc->bitdepth - 1, colours, len);
+        break;
+
+      default: break;
+      }
+
+      uint8_t* out = dst.colourRgb8 + 3 * start;
+      for (int i = 0; i < len; i++) {
+        out[3 * i + 0] = uint8_t(colours[i][2]);
+        out[3 * i + 1] = uint8_t(colours[i][0]);
+        out[3 * i + 2] = uint8_t(colours[i][1]);
+      }
+    }
+
+    if (dst.reflectance && cloud.hasReflectances()) {
+      attr_t* out = dst.reflectance + start;
+      for (int i = 0; i < len; i++)
+        out[i] = cloud.getReflectance(start + i);
+      if (scaleReflectance)
+        scaleAttributesInv(reflDesc->params, out, len);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+
+int
+copyFromCloudFrame(
+  const CloudFrame& frame, const PointOutputBufferView& dst, int numThreads)
+{
+  // Colour deeper than 8 bits cannot be represented in colourRgb8
+  const AttributeDescription* colourDesc = findColourAttrDesc(frame.attrDesc);
+  if (dst.colourRgb8 && frame.cloud.hasColors() && colourDesc) {
+    // NB: the YCgCoR bitdepth is the transformed bitdepth, not the source
+    int bitdepth = colourDesc->bitdepth;
+    auto colourMatrix = colourDesc->params.cicp_matrix_coefficients_idx;
+    if (colourMatrix == ColourMatrix::kYCgCo)
+      bitdepth--;
+    if (bitdepth > 8)
+      return 1;
+  }
+
+  // Avoid starting threads for small amounts of work
+  const size_t kMinPointsPerThread = 1 << 16;
+
+  size_t numPoints = frame.cloud.getPointCount();
+  int nThreads = int(std::min(
+    size_t(std::max(numThreads, 1)), numPoints / kMinPointsPerThread + 1));
+
+  auto copyRange = [&](int t) {
+    size_t first = numPoints * t / nThreads;
+    size_t last = numPoints * (t + 1) / nThreads;
+    copyFromCloudFrame(frame, dst, first, last);
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < nThreads; t++)
+    threads.emplace_back(copyRange, t);
+  copyRange(0);
+  for (auto& thread : threads)
+    thread.join();
+
+  return 0;
+}
+
+//============================================================================
+
+}  // namespace pcc
@@ -0,0 +1,235 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "PCCTMC3Decoder.h"
+#include "PCCTMC3Encoder.h"
+#include "PayloadBuffer.h"
+#include "PCCPointSet.h"
+#include "frame.h"
+#include "io_tlv.h"
+
+namespace pcc {
+
+//============================================================================
+// An in-memory interface to the codec.
+//
+// The encoder accepts one frame at a time and delivers the coded payloads
+// through a callback; the decoder accepts payloads and delivers the
+// reconstructed frames through a callback.  No file or stream I/O is
+// performed by either object.
+//
+// Attribute values are in the coded domain: any colourspace conversion or
+// attribute scaling is the responsibility of the caller (see the helper
+// functions below).
+
+//============================================================================
+// A non-owning description of a frame held as separate component arrays.
+
+struct PointBufferView {
+  size_t numPoints = 0;
+
+  // Point positions, one array per component in the order x, y, z.
+  // Each component is scaled by positionScale and truncated towards zero,
+  // as done for ply input.
+  const double* position[3] = {nullptr, nullptr, nullptr};
+  double positionScale = 1.;
+
+  // Optional colour components (nullptr if absent)
+  const attr_t* colour[3] = {nullptr, nullptr, nullptr};
+
+  // Optional reflectance (nullptr if absent)
+  const attr_t* reflectance = nullptr;
+};
+
+//----------------------------------------------------------------------------
+// Fill a point set from a PointBufferView.
+
+void copyToPointSet(const PointBufferView& src, PCCPointSet3* dst);
+
+//============================================================================
+// A non-owning description of caller storage for a decoded frame.
+// Each output is optional (nullptr if not required) and must have space
+// for every point in the frame.
+
+struct PointOutputBufferView {
+  // Interleaved x, y, z positions, rounded to float from:
+  //   pos * positionScale + positionOffset
+  // evaluated in double precision, as done for ply output.  Eg, for the
+  // external coordinate system, positionScale = frame.outputUnitLength /
+  // (outputUnitLength << frame.outputFpBits), and positionOffset is
+  // frame.outputOrigin (in xyz order) * frame.outputUnitLength /
+  // outputUnitLength.
+  float* positionXyz = nullptr;
+  double positionScale = 1.;
+  Vec3<double> positionOffset = 0.;
+
+  // Integer positions in the frame's coordinate system, one array per
+  // component in the order x, y, z.
+  int32_t* position[3] = {nullptr, nullptr, nullptr};
+
+  // Interleaved 8-bit red, green, blue colour.  Only available if the
+  // colour attribute has a bit depth of at most 8.
+  uint8_t* colourRgb8 = nullptr;
+
+  // Reflectance
+  attr_t* reflectance = nullptr;
+};
+
+//----------------------------------------------------------------------------
+// Fill the caller's storage from a decoded frame in a single pass.
+//
+// Attribute values are converted to the external representation, with the
+// same result as scaleAttributesForOutput() followed by convertToGbr().
+// Positions are not rescaled here: the decoder has already applied the
+// sequence's global scale to frame.cloud, in a separate pass.
+// Ranges of points are converted concurrently by up to @numThreads
+// threads.
+//
+// Returns zero on success.  Nothing is written if colourRgb8 is requested
+// for colour deeper than 8 bits.
+
+int copyFromCloudFrame(
+  const CloudFrame& frame,
+  const PointOutputBufferView& dst,
+  int numThreads = 1);
+
+//============================================================================
+
+class StreamEncoder : PCCTMC3Encoder3::Callbacks {
+public:
+  typedef std::function<void(const PayloadBuffer&)> OutputBufferFn;
+  typedef std::function<void(const PCCPointSet3&)> PostRecolourFn;
+
+  StreamEncoder(const EncoderParams& params, OutputBufferFn onOutputBuffer);
+  StreamEncoder(const StreamEncoder&) = delete;
+  StreamEncoder& operator=(const StreamEncoder&) = delete;
+
+  // Optionally observe the source cloud after attribute recolouring.
+  void setPostRecolourCallback(PostRecolourFn fn);
+
+  // The encoder parameters, including any values derived by the encoder.
+  const EncoderParams& params() const { return _params; }
+
+  // The number of frames encoded so far.
+  int frameCount() const { return _frameCount; }
+
+  // Encode the next frame of the sequence.
+  //  \param cloud  the source frame; attributes that are not configured
+  //                for coding are removed.
+  //  \param recon  if not null, receives the reconstructed frame.
+  // Returns zero on success.
+  int encode(PCCPointSet3& cloud, CloudFrame* recon = nullptr);
+
+  // Encode the next frame of the sequence from component arrays.
+  int encode(const PointBufferView& points, CloudFrame* recon = nullptr);
+
+private:
+  void onOutputBuffer(const PayloadBuffer& buf) override;
+  void onPostRecolour(const PCCPointSet3& cloud) override;
+
+  EncoderParams _params;
+  PCCTMC3Encoder3 _encoder;
+
+  OutputBufferFn _onOutputBuffer;
+  PostRecolourFn _onPostRecolour;
+
+  // Input conversion buffer, retained between frames.
+  PCCPointSet3 _inputCloud;
+
+  // Reconstruction used when inter prediction requires it and the caller
+  // does not request the reconstructed frame.
+  CloudFrame _recon;
+
+  int _frameCount;
+};
+
+//============================================================================
+
+class StreamDecoder : PCCTMC3Decoder3::Callbacks {
+public:
+  typedef std::function<void(const CloudFrame&)> OutputCloudFn;
+  typedef PCCTMC3Decoder3::GeometryLevelFn GeometryLevelFn;
+
+  StreamDecoder(const DecoderParams& params, OutputCloudFn onOutputCloud);
+  StreamDecoder(const StreamDecoder&) = delete;
+  StreamDecoder& operator=(const StreamDecoder&) = delete;
+
+  // Optionally observe the geometry of each slice as every octree level
+  // is decoded (see PCCTMC3Decoder3::setGeometryLevelCallback).
+  void setGeometryLevelCallback(GeometryLevelFn fn);
+
+  // Decode a single payload.  Completed frames are delivered through the
+  // output callback.  Returns zero on success.
+  int decode(const PayloadBuffer& buf);
+
+  // Decode a single payload held elsewhere in memory (eg, a TlvReader).
+  int decode(const PayloadView& view);
+
+  // Signal the end of the bitstream, outputting any pending frame.
+  int flush();
+
+private:
+  void onOutputCloud(const CloudFrame& frame) override;
+
+  PCCTMC3Decoder3 _decoder;
+  OutputCloudFn _onOutputCloud;
+};
+
+//============================================================================
+// Conversions between the external and coded attribute representations.
+
+void convertToGbr(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud);
+
+void convertFromGbr(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud);
+
+void scaleAttributesForInput(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud);
+
+void scaleAttributesForOutput(
+  const std::vector<AttributeDescription>& attrDescs, PCCPointSet3& cloud);
+
+//============================================================================
+
+}  // namespace pcc
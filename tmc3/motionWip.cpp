@@ -888,6 +888,7 @@ MSOctree::nearestNode(point_t node0Pos0, int32_t d_max, uint32_t node0SizeLog2)
 double
 MSOctree::find_motion(
   const GeometryParameterSet::Motion& param,
+  const MotionSearchOpts& searchOpts,
   const MotionEntropyEstimate& motionEntropy,
   const MSOctree& mSOctreeOrig,
   uint32_t mSOctreeOrigNodeIdx,
@@ -1058,7 +1059,7 @@ MSOctree::find_motion(
     // loop on searchPattern
     const int* pSearch = searchPattern;
     bool flagBetter = false;
-    for (int t = 0; t < 18; t++, pSearch += 3) {
+    for (int t = 0; t < searchOpts.searchDirections; t++, pSearch += 3) {
 
       point_t V = point_t(pSearch[0] * Amotion, pSearch[1] * Amotion, pSearch[2] * Amotion);
       V0 = Vs + V;
@@ -1141,7 +1142,13 @@ MSOctree::find_motion(
   double cost_Split = DBL_MAX;
   PUtree* Split_PU_tree = new PUtree;  // local split tree
 
-  if (local_size > param.motion_min_pu_size && Block0.size() >= 8) {
+  // early termination: a well predicted PU is not split
+  bool testSplit = local_size > param.motion_min_pu_size && Block0.size() >= 8;
+  if (testSplit && searchOpts.splitEarlyTermination > 0.)
+    testSplit =
+      cost_NoSplit >= searchOpts.splitEarlyTermination * Block0.size();
+
+  if (testSplit) {
     // condition on number of points for search acceleration
     int local_size1 = local_size >> 1;
 
@@ -1191,7 +1198,7 @@ MSOctree::find_motion(
 
       uint32_t childNodeIdx = mSOctreeOrig.nodes[mSOctreeOrigNodeIdx].child[t];
 
-      cost_Split += find_motion(param, motionEntropy, mSOctreeOrig, childNodeIdx, Block1, xyz1, local_size1, Split_PU_tree);
+      cost_Split += find_motion(param, searchOpts, motionEntropy, mSOctreeOrig, childNodeIdx, Block1, xyz1, local_size1, Split_PU_tree);
     }
   }
 
@@ -1238,6 +1245,7 @@ motionSearchForNode(
   const MSOctree& mSOctree,
   const PCCOctree3Node* node0,
   const GeometryParameterSet::Motion& param,
+  const MotionSearchOpts& searchOpts,
   int nodeSizeLog2,
   EntropyEncoder* arithmeticEncoder,
   PUtree* local_PU_tree)
@@ -1257,7 +1265,7 @@ motionSearchForNode(
 
   // MV search
   mSOctree.find_motion(
-    param, mcEstimate, mSOctreeOrig, mSOctreeOrigNodeIdx, Block0, pos, (1 << nodeSizeLog2), local_PU_tree);
+    param, searchOpts, mcEstimate, mSOctreeOrig, mSOctreeOrigNodeIdx, Block0, pos, (1 << nodeSizeLog2), local_PU_tree);
 
   return true;
 }
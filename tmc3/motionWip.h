@@ -156,6 +156,7 @@ struct MSOctree {
   double
   find_motion(
     const GeometryParameterSet::Motion& param,
+    const MotionSearchOpts& searchOpts,
     const MotionEntropyEstimate& motionEntropy,
     const MSOctree& mSOctreeOrig,
     uint32_t mSOctreeOrigNodeIdx,
@@ -185,6 +186,7 @@ motionSearchForNode(
   const MSOctree& mSOctree,
   const PCCOctree3Node* node0,
   const GeometryParameterSet::Motion& param,
+  const MotionSearchOpts& searchOpts,
   int nodeSizeLog2,
   EntropyEncoder* arithmeticEncoder,
   PUtree* local_PU_tree);
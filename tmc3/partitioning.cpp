@@ -37,6 +37,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <limits>
 #include <map>
 #include <stdint.h>
 
@@ -65,15 +66,15 @@ struct CM_Nodes {  //nodes == merged partition
 // Determine whether half of slices are smaller than maxPoints
 
 bool
-halfQualified(const std::vector<Partition> slices, int maxPoints)
+halfQualified(const std::vector<int>& sliceSizes, int maxPoints)
 {
   int Qualified = 0;
-  for (int i = 0; i < slices.size(); i++) {
-    if (slices[i].pointIndexes.size() < maxPoints)
+  for (int i = 0; i < sliceSizes.size(); i++) {
+    if (sliceSizes[i] < maxPoints)
       Qualified++;
   }
 
-  return ((double)Qualified / (double)slices.size()) > 0.5;
+  return ((double)Qualified / (double)sliceSizes.size()) > 0.5;
 }
 
 //============================================================================
@@ -197,38 +198,37 @@ partitionByUniformGeom(
     sliceSize = (1 + sliceSize / partitionBoundary) * partitionBoundary;
   }
 
+  // Slice p contains the points at or above p * sliceSize (relative to the
+  // bounding box) that are not in a subsequent slice.  The slice sizes for
+  // each candidate sliceNum are found from the cumulative histogram of
+  // point positions along the longest axis; points are assigned once the
+  // number of slices has been chosen.
+  int numPoints = cloud.getPointCount();
+  int axisMin = bbox.min[maxEdgeAxis];
+  std::vector<int> posCount(maxEdge + 2);
+  for (int n = 0; n < numPoints; n++)
+    posCount[cloud[n][maxEdgeAxis] - axisMin + 1]++;
+  for (int i = 1; i < posCount.size(); i++)
+    posCount[i] += posCount[i - 1];
+
+  std::vector<int> sliceSizes;
   while (1) {
-    slices.clear();
-    slices.resize(sliceNum);
-
-    for (int i = 0; i < sliceNum; i++) {
-      auto& slice = slices[i];
-      slice.sliceId = i;
-      slice.tileId = tileID;
-      slice.location[0] = i;
-      slice.location[1] = 0;
-      slice.location[2] = 0;
-      slice.origin = Vec3<int>{0};
+    sliceSizes.resize(sliceNum);
+    for (int p = 0; p < sliceNum; p++) {
+      int64_t start = int64_t(p) * sliceSize;
+      int64_t end = p == sliceNum - 1 ? maxEdge + 1 : start + sliceSize;
+      start = std::min<int64_t>(start, maxEdge + 1);
+      end = std::min<int64_t>(end, maxEdge + 1);
+      sliceSizes[p] = posCount[end] - posCount[start];
     }
 
-    for (int n = 0; n < cloud.getPointCount(); n++) {
-      for (int p = sliceNum - 1; p >= 0; p--) {
-        if (
-          cloud[n][maxEdgeAxis]
-          >= int(p * sliceSize + bbox.min[maxEdgeAxis])) {
-          auto& slice = slices[p];
-
-          slice.pointIndexes.push_back(n);
-          break;
-        }
-      }
+    // without any width, all points belong to the last slice
+    if (!sliceSize) {
+      std::fill(sliceSizes.begin(), sliceSizes.end(), 0);
+      sliceSizes.back() = numPoints;
     }
 
-    sliceArrNum[0] = sliceNum;
-    sliceArrNum[1] = 1;
-    sliceArrNum[2] = 1;
-
-    if (halfQualified(slices, params.sliceMaxPoints))
+    if (halfQualified(sliceSizes, params.sliceMaxPoints))
       break;
 
     sliceNum *= 2;
@@ -238,6 +238,29 @@ partitionByUniformGeom(
     }
   }
 
+  slices.resize(sliceNum);
+  for (int i = 0; i < sliceNum; i++) {
+    auto& slice = slices[i];
+    slice.sliceId = i;
+    slice.tileId = tileID;
+    slice.location[0] = i;
+    slice.location[1] = 0;
+    slice.location[2] = 0;
+    slice.origin = Vec3<int>{0};
+    slice.pointIndexes.reserve(sliceSizes[i]);
+  }
+
+  for (int n = 0; n < numPoints; n++) {
+    int p = sliceNum - 1;
+    if (sliceSize)
+      p = std::min(p, (cloud[n][maxEdgeAxis] - axisMin) / sliceSize);
+    slices[p].pointIndexes.push_back(n);
+  }
+
+  sliceArrNum[0] = sliceNum;
+  sliceArrNum[1] = 1;
+  sliceArrNum[2] = 1;
+
   // Delete the slice that with no points
   slices.erase(
     std::remove_if(
@@ -287,58 +310,45 @@ partitionByUniformSquare(
     sliceSize = (1 + sliceSize / partitionBoundary) * partitionBoundary;
   }
 
-  while (1) {
-    slices.clear();
-    slices.resize(sliceNum);
-
-    std::vector<Partition> slicesFirstAxis;
-    slicesFirstAxis.clear();
-    slicesFirstAxis.resize(firstSliceNum);
-
-    int count = 0;
-    for (int i = 0; i < firstSliceNum; i++) {
-      for (int j = 0; j < secondSliceNum; j++) {
-        auto& slice = slices[i * secondSliceNum + j];
-        slice.sliceId = count;
-        slice.location[0] = i;
-        slice.location[1] = j;
-        slice.location[2] = 0;
-        slice.tileId = tileID;
-        slice.origin = Vec3<int>{0};
-        count++;
-      }
-    }
-    int p = 0;
-    for (int n = 0; n < cloud.getPointCount(); n++) {
-      p = int(cloud[n][maxEdgeAxis]) / sliceSize;
-      auto& slice = slicesFirstAxis[p];
-      slice.pointIndexes.push_back(n);
-    }
-
-    int q = 0;
-    for (int s = 0; s < slicesFirstAxis.size(); s++) {
-      auto& sliceRough = slicesFirstAxis[s];
-      for (int n = 0; n < sliceRough.pointIndexes.size(); n++) {
-        q = int(cloud[sliceRough.pointIndexes[n]][midEdgeAxis]) / sliceSize;
-        auto& slice = slices[s * secondSliceNum + q];
-        slice.pointIndexes.push_back(sliceRough.pointIndexes[n]);
-      }
+  slices.resize(sliceNum);
+  int count = 0;
+  for (int i = 0; i < firstSliceNum; i++) {
+    for (int j = 0; j < secondSliceNum; j++) {
+      auto& slice = slices[i * secondSliceNum + j];
+      slice.sliceId = count;
+      slice.location[0] = i;
+      slice.location[1] = j;
+      slice.location[2] = 0;
+      slice.tileId = tileID;
+      slice.origin = Vec3<int>{0};
+      count++;
     }
-    slicesFirstAxis.clear();
+  }
 
-    break;
+  // determine the slice of each point, then distribute the points in order
+  int numPoints = cloud.getPointCount();
+  std::vector<int> pointToSliceId(numPoints);
+  std::vector<int> sliceSizes(sliceNum);
+  for (int n = 0; n < numPoints; n++) {
+    int p = int(cloud[n][maxEdgeAxis]) / sliceSize;
+    int q = int(cloud[n][midEdgeAxis]) / sliceSize;
+    int sliceIdx = p * secondSliceNum + q;
+    pointToSliceId[n] = sliceIdx;
+    sliceSizes[sliceIdx]++;
   }
 
+  for (int i = 0; i < sliceNum; i++)
+    slices[i].pointIndexes.reserve(sliceSizes[i]);
+
+  for (int n = 0; n < numPoints; n++)
+    slices[pointToSliceId[n]].pointIndexes.push_back(n);
+
   sliceArrNum[0] = firstSliceNum;
   sliceArrNum[1] = secondSliceNum;
   sliceArrNum[2] = 1;
 
-  int count = 0;
-  for (int i = 0; i < slices.size(); i++) {
-    auto& slice = slices[i];
-    slice.sliceId = count;
-    count++;
-  }
+  for (int i = 0; i < slices.size(); i++)
+    slices[i].sliceId = i;
 
   // refine slicesto meet max/min point constraints
   refineSlicesByAdjacentInfo(
@@ -370,17 +380,20 @@ partitionByOctreeDepth(
   int cloudSizeLog2 = ceillog2(maxBb + 1);
   int depOctree = splitByDepth ? params.octreeDepth : 1;
 
-  do {
-    slices.clear();
-    int posShift = cloudSizeLog2 - depOctree;
-    int posMask = (1 << depOctree) - 1;
+  // initially: number of points in each partition
+  // then: mapping of partId to sliceId
+  std::vector<int> partMap;
 
-    // initially: number of points in each partition
-    // then: mapping of partId to sliceId
-    std::vector<int> partMap(1 << (3 * depOctree));
+  // per-point indexes used for assigning to a partition
+  std::vector<int> pointToPartId(cloud.getPointCount());
 
-    // per-point indexes used for assigning to a partition
-    std::vector<int> pointToPartId(cloud.getPointCount());
+  // Find the depth at which half of the partitions are small enough
+  // using only the partition sizes.
+  std::vector<int> sliceSizes;
+  for (;; depOctree++) {
+    int posShift = cloudSizeLog2 - depOctree;
+    int posMask = (1 << depOctree) - 1;
+    partMap.assign(1 << (3 * depOctree), 0);
 
     // for each point, determine a partition based upon the position
     for (int i = 0, last = cloud.getPointCount(); i < last; i++) {
@@ -392,51 +405,58 @@ partitionByOctreeDepth(
       pointToPartId[i] = partId;
     }
 
-    // generate slice mapping
-    //  - allocate slice map storage and determine contiguous sliceIds
-    //    NB: the sliceIds replace partPointCount.
-    //  - map points to each slice.
-
-    int numSlices =
-      partMap.size() - std::count(partMap.begin(), partMap.end(), 0);
-    slices.resize(numSlices);
-
-    int sliceId = 0;
-    int count = 0;
-    for (auto& part : partMap) {
-      if (!part) {
-        count++;
-        continue;
-      }
-      auto& slice = slices[sliceId];
-      slice.sliceId = sliceId;
-      slice.tileId = tileID;
-      slice.origin = Vec3<int>{0};
-      int first = count / (1 << (2 * depOctree));
-      int second = count % (1 << (2 * depOctree)) / (1 << depOctree);
-      int third = count % (1 << (2 * depOctree)) % (1 << depOctree);
-      slice.location[0] = first;
-      slice.location[1] = second;
-      slice.location[2] = third;
-      slice.pointIndexes.reserve(part);
-      part = sliceId++;
-      count++;
-    }
+    if (splitByDepth)
+      break;
 
-    for (int i = 0, last = cloud.getPointCount(); i < last; i++) {
-      int partId = pointToPartId[i];
-      int sliceId = partMap[partId];
-      slices[sliceId].pointIndexes.push_back(i);
-    }
+    sliceSizes.clear();
+    for (auto part : partMap)
+      if (part)
+        sliceSizes.push_back(part);
 
-    sliceArrNum[0] = (1 << depOctree);
-    sliceArrNum[1] = (1 << depOctree);
-    sliceArrNum[2] = (1 << depOctree);
-    if (halfQualified(slices, params.sliceMaxPoints))
+    if (halfQualified(sliceSizes, params.sliceMaxPoints))
       break;
+  }
+
+  // generate slice mapping
+  //  - allocate slice map storage and determine contiguous sliceIds
+  //    NB: the sliceIds replace partPointCount.
+  //  - map points to each slice.
+
+  int numSlices =
+    partMap.size() - std::count(partMap.begin(), partMap.end(), 0);
+  slices.resize(numSlices);
+
+  int sliceId = 0;
+  int count = 0;
+  for (auto& part : partMap) {
+    if (!part) {
+      count++;
+      continue;
+    }
+    auto& slice = slices[sliceId];
+    slice.sliceId = sliceId;
+    slice.tileId = tileID;
+    slice.origin = Vec3<int>{0};
+    int first = count / (1 << (2 * depOctree));
+    int second = count % (1 << (2 * depOctree)) / (1 << depOctree);
+    int third = count % (1 << (2 * depOctree)) % (1 << depOctree);
+    slice.location[0] = first;
+    slice.location[1] = second;
+    slice.location[2] = third;
+    slice.pointIndexes.reserve(part);
+    part = sliceId++;
+    count++;
+  }
+
+  for (int i = 0, last = cloud.getPointCount(); i < last; i++) {
+    int partId = pointToPartId[i];
+    int sliceId = partMap[partId];
+    slices[sliceId].pointIndexes.push_back(i);
+  }
 
-    depOctree++;
-  } while (!splitByDepth);
+  sliceArrNum[0] = (1 << depOctree);
+  sliceArrNum[1] = (1 << depOctree);
+  sliceArrNum[2] = (1 << depOctree);
 
   // refine slicesto meet max/min point constraints
   refineSlicesByAdjacentInfo(params, cloud, sliceArrNum, slices);
@@ -538,6 +558,42 @@ maxEdgeAxis(const PCCPointSet3& cloud, std::vector<int32_t>& sliceIndexes)
   return maxAxis;
 }
 
+//----------------------------------------------------------------------------
+// Stable sort of point indexes by position along axis.  A counting sort is
+// used unless the extent is large compared to the number of points.
+
+static void
+sortByAxis(const PCCPointSet3& cloud, int axis, std::vector<int32_t>& indexes)
+{
+  int32_t minPos = std::numeric_limits<int32_t>::max();
+  int32_t maxPos = std::numeric_limits<int32_t>::min();
+  for (auto idx : indexes) {
+    minPos = std::min(minPos, cloud[idx][axis]);
+    maxPos = std::max(maxPos, cloud[idx][axis]);
+  }
+
+  int64_t range = int64_t(maxPos) - minPos + 1;
+  if (range > 4 * int64_t(indexes.size()) + 1024) {
+    std::stable_sort(
+      indexes.begin(), indexes.end(), [&](int32_t a, int32_t b) {
+        return cloud[a][axis] < cloud[b][axis];
+      });
+    return;
+  }
+
+  std::vector<int32_t> posCount(range + 1);
+  for (auto idx : indexes)
+    posCount[cloud[idx][axis] - minPos + 1]++;
+  for (int i = 1; i < posCount.size(); i++)
+    posCount[i] += posCount[i - 1];
+
+  std::vector<int32_t> sorted(indexes.size());
+  for (auto idx : indexes)
+    sorted[posCount[cloud[idx][axis] - minPos]++] = idx;
+
+  indexes.swap(sorted);
+}
+
 //============================================================================
 // When partitionBoundary <= 0,
 //   evenly split slice into several partitions no larger than maxPoints
@@ -556,10 +612,7 @@ splitSlice(
 
   // Split along the longest edge at the median point
   int splitAxis = maxEdgeAxis(cloud, aIndexes);
-  std::stable_sort(
-    aIndexes.begin(), aIndexes.end(), [&](int32_t a, int32_t b) {
-      return cloud[a][splitAxis] < cloud[b][splitAxis];
-    });
+  sortByAxis(cloud, splitAxis, aIndexes);
 
   int numSplit = std::ceil((double)aIndexes.size() / (double)maxPoints);
   int splitsize = aIndexes.size() / numSplit;
@@ -596,29 +649,19 @@ splitSlice(
     }
   }
 
-  std::vector<Partition> splitPartitions;
-  splitPartitions.resize(numSplit);
-
-  for (int i = 0; i < numSplit - 1; i++) {
-    auto& indexes = splitPartitions[i].pointIndexes;
-    indexes.insert(
-      indexes.begin(), aIndexes.begin() + splitIndices[i],
-      aIndexes.begin() + splitIndices[i + 1]);
-  }
-  auto& indexes = splitPartitions[numSplit - 1].pointIndexes;
-  indexes.insert(
-    indexes.begin(), aIndexes.begin() + splitIndices.back(), aIndexes.end());
-
+  newlist.clear();
   newlist.resize(numSplit);
   for (int i = 0; i < numSplit; i++) {
-    auto& Indexes = splitPartitions[i].pointIndexes;
+    auto first = aIndexes.begin() + splitIndices[i];
+    auto last =
+      i + 1 < numSplit ? aIndexes.begin() + splitIndices[i + 1] : aIndexes.end();
+
     newlist[i].xEvg = -1;
     newlist[i].yEvg = -1;
-    newlist[i].total = Indexes.size();
+    newlist[i].total = last - first;
     newlist[i].nodes.push_back(CM_Node());
-    newlist[i].nodes[0].pointCloudIndex.resize(Indexes.size());
-    newlist[i].nodes[0].pointCloudIndex = Indexes;
-    newlist[i].nodes[0].cnt = Indexes.size();
+    newlist[i].nodes[0].pointCloudIndex.assign(first, last);
+    newlist[i].nodes[0].cnt = last - first;
   }
 }
 
@@ -679,7 +722,7 @@ refineSlicesByAdjacentInfo(
     int second = slices[sliceCount].location[1];
     int third = slices[sliceCount].location[2];
 
-    slicePartition[first][second][third] = slices[sliceCount];
+    slicePartition[first][second][third] = std::move(slices[sliceCount]);
     list[i].nodes.resize(1);
     list[i].xEvg = first;
     list[i].yEvg = second;
@@ -694,15 +737,12 @@ refineSlicesByAdjacentInfo(
     sliceCount++;
   }
 
+  // only slices that are to be split require a copy of their points
   for (int i = 0; i < list.size(); i++) {
-    for (int n = 0; n < list[i].nodes.size(); n++) {
-      list[i].nodes[n].pointCloudIndex.resize(list[i].total);
-      for (int idx = 0; idx < list[i].total; idx++) {
-        list[i].nodes[n].pointCloudIndex[idx] =
-          slicePartition[list[i].xEvg][list[i].yEvg][list[i].zEvg]
-            .pointIndexes[idx];
-      }
-    }
+    if (list[i].total <= maxPoints)
+      continue;
+    list[i].nodes[0].pointCloudIndex =
+      slicePartition[list[i].xEvg][list[i].yEvg][list[i].zEvg].pointIndexes;
   }
 
   //list erase
@@ -727,25 +767,20 @@ refineSlicesByAdjacentInfo(
 
   std::vector<CM_Nodes> newlist;
   std::vector<CM_Nodes> newSlice;
-  std::vector<CM_Nodes> tmplist = list;
-  int listNum = list.size();
-  for (int i = 0; i < listNum; i++) {
-    if (tmplist[i].total > maxPoints) {
+  for (int i = 0; i < list.size(); i++) {
+    if (list[i].total > maxPoints) {
       splitSlice(list[i], newlist, cloud, maxPoints, partitionBoundary);
       for (int j = 0; j < newlist.size(); j++) {
-        newSlice.push_back(newlist[j]);
+        newSlice.push_back(std::move(newlist[j]));
       }
     }
   }
 
-  tmplist.erase(
+  list.erase(
     std::remove_if(
-      tmplist.begin(), tmplist.end(),
+      list.begin(), list.end(),
       [=](const CM_Nodes& p) { return p.total > maxPoints; }),
-    tmplist.end());
-
-  list = tmplist;
-  tmplist.clear();
+    list.end());
 
   for (int i = 0; i < list.size(); i++) {
     for (int n = 0; n < list[i].nodes.size(); n++) {
@@ -879,13 +914,10 @@ refineSlicesByAdjacentInfo(
   }
 
   for (int i = list.size(); i < list.size() + newSlice.size(); i++) {
-    refinedSlice[i].pointIndexes.resize(0);
-    refinedSlice[i].pointIndexes.insert(
-      refinedSlice[i].pointIndexes.end(),
-      newSlice[i - list.size()].nodes[0].pointCloudIndex.begin(),
-      newSlice[i - list.size()].nodes[0].pointCloudIndex.end());
+    refinedSlice[i].pointIndexes =
+      std::move(newSlice[i - list.size()].nodes[0].pointCloudIndex);
   }
-  slices = refinedSlice;
+  slices = std::move(refinedSlice);
   for (int i = 0; i < slices.size(); i++) {
     auto& slice = slices[i];
     slice.sliceId = i;
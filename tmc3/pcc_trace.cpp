@@ -0,0 +1,300 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "pcc_trace.h"
+
+#if ENABLE_TRACING
+#  include <algorithm>
+#  include <atomic>
+#  include <chrono>
+#  include <fstream>
+#  include <iomanip>
+#  include <map>
+#  include <mutex>
+#  include <vector>
+
+#  if HAVE_GETRUSAGE
+#    include <sys/time.h>
+#    include <sys/resource.h>
+#  endif
+#endif
+
+namespace pcc {
+namespace trace {
+
+#if ENABLE_TRACING
+
+  //=========================================================================
+
+  bool g_enabled = false;
+
+  namespace {
+    // A completed zone or a counter sample
+    struct Record {
+      const char* name;
+
+      // zone identifier (eg, frame or slice number), or -1
+      int64_t id;
+
+      int64_t startNs;
+
+      // zone duration, or -1 for a counter sample
+      int64_t durNs;
+
+      // zone duration excluding nested zones
+      int64_t selfNs;
+
+      // counter value
+      int64_t value;
+
+      int tid;
+    };
+
+    std::mutex g_mutex;
+    std::vector<Record> g_records;
+
+    const auto g_epoch = std::chrono::steady_clock::now();
+
+    thread_local Zone* t_currentZone = nullptr;
+
+    int64_t
+    nowNs()
+    {
+      auto delta = std::chrono::steady_clock::now() - g_epoch;
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(delta)
+        .count();
+    }
+
+    // A small sequential identifier for the calling thread
+    int
+    threadIdx()
+    {
+      static std::atomic<int> next{0};
+      thread_local int idx = next++;
+      return idx;
+    }
+
+    void
+    addRecord(const Record& rec)
+    {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_records.push_back(rec);
+    }
+  }  // namespace
+
+  //-------------------------------------------------------------------------
+
+  void
+  Zone::begin(const char* name, int64_t id)
+  {
+    _name = name;
+    _id = id;
+    _childNs = 0;
+    _parent = t_currentZone;
+    t_currentZone = this;
+    _startNs = nowNs();
+  }
+
+  //-------------------------------------------------------------------------
+
+  void
+  Zone::end()
+  {
+    int64_t durNs = nowNs() - _startNs;
+
+    t_currentZone = _parent;
+    if (_parent)
+      _parent->_childNs += durNs;
+
+    addRecord({_name, _id, _startNs, durNs, durNs - _childNs, 0, threadIdx()});
+  }
+
+  //-------------------------------------------------------------------------
+
+  void
+  counter(const char* name, int64_t value)
+  {
+    if (g_enabled)
+      addRecord({name, -1, nowNs(), -1, 0, value, threadIdx()});
+  }
+
+  //-------------------------------------------------------------------------
+
+  void
+  samplePeakRss()
+  {
+#  if HAVE_GETRUSAGE
+    // NB: ru_maxrss is in KiB except under macOS (bytes)
+    struct rusage usage;
+    if (g_enabled && !getrusage(RUSAGE_SELF, &usage))
+      counter("peakRssKiB", usage.ru_maxrss);
+#  endif
+  }
+
+  //-------------------------------------------------------------------------
+
+  bool
+  setEnabled(bool enabled)
+  {
+    g_enabled = enabled;
+    return true;
+  }
+
+  //-------------------------------------------------------------------------
+
+  bool
+  writeChromeTrace(const std::string& path)
+  {
+    std::ofstream fout(path);
+    if (!fout)
+      return false;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    // timestamps are in microseconds
+    fout << std::fixed << std::setprecision(3);
+    fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    const char* sep = "\n";
+    for (const auto& rec : g_records) {
+      fout << sep << "{\"name\":\"" << rec.name << "\",\"pid\":0"
+           << ",\"tid\":" << rec.tid << ",\"ts\":" << rec.startNs / 1e3;
+
+      if (rec.durNs < 0)
+        fout << ",\"ph\":\"C\",\"args\":{\"value\":" << rec.value << "}}";
+      else {
+        fout << ",\"ph\":\"X\",\"dur\":" << rec.durNs / 1e3;
+        if (rec.id >= 0)
+          fout << ",\"args\":{\"id\":" << rec.id << "}";
+        fout << "}";
+      }
+      sep = ",\n";
+    }
+
+    fout << "\n]}\n";
+    return bool(fout);
+  }
+
+  //-------------------------------------------------------------------------
+
+  bool
+  writeSummaryCsv(const std::string& path)
+  {
+    std::ofstream fout(path);
+    if (!fout)
+      return false;
+
+    struct Summary {
+      const char* name;
+      bool isCounter;
+      int64_t count;
+      int64_t totalNs;
+      int64_t selfNs;
+      int64_t max;
+      int64_t last;
+    };
+
+    std::vector<Summary> summaries;
+    std::map<std::string, int> summaryIdx;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    // aggregate by name, in order of first appearance
+    for (const auto& rec : g_records) {
+      bool isCounter = rec.durNs < 0;
+      std::string key = (isCounter ? "C" : "Z") + std::string(rec.name);
+      auto it = summaryIdx.find(key);
+      if (it == summaryIdx.end()) {
+        it = summaryIdx.emplace(key, int(summaries.size())).first;
+        summaries.push_back({rec.name, isCounter, 0, 0, 0, 0, 0});
+      }
+
+      auto& summary = summaries[it->second];
+      int64_t val = isCounter ? rec.value : rec.durNs;
+      summary.max = summary.count ? std::max(summary.max, val) : val;
+      summary.last = val;
+      summary.count++;
+      if (!isCounter) {
+        summary.totalNs += rec.durNs;
+        summary.selfNs += rec.selfNs;
+      }
+    }
+
+    fout << std::fixed << std::setprecision(3);
+    fout << "kind,name,count,total_ms,self_ms,mean_ms,max_ms,last,max\n";
+    for (const auto& s : summaries) {
+      if (s.isCounter) {
+        fout << "counter," << s.name << ',' << s.count << ",,,,,"
+             << s.last << ',' << s.max << '\n';
+        continue;
+      }
+
+      fout << "zone," << s.name << ',' << s.count << ',' << s.totalNs / 1e6
+           << ',' << s.selfNs / 1e6 << ',' << s.totalNs / 1e6 / s.count
+           << ',' << s.max / 1e6 << ",,\n";
+    }
+
+    return bool(fout);
+  }
+
+#else
+
+  //=========================================================================
+
+  bool
+  setEnabled(bool)
+  {
+    return false;
+  }
+
+  bool
+  writeChromeTrace(const std::string&)
+  {
+    return false;
+  }
+
+  bool
+  writeSummaryCsv(const std::string&)
+  {
+    return false;
+  }
+
+#endif
+
+  //=========================================================================
+
+}  // namespace trace
+}  // namespace pcc
@@ -0,0 +1,132 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "TMC3Config.h"
+
+//===========================================================================
+// Per-stage tracing.
+//
+// Scoped zones record the wall-clock interval of a processing stage and
+// counters record sampled values (eg, allocation sizes).  The records may
+// be written as a Chrome trace (chrome://tracing, Perfetto) and as a flat
+// summary in CSV form.
+//
+// When built without ENABLE_TRACING the macros expand to nothing.  When
+// built with it, nothing is recorded until recording is enabled.
+
+#if ENABLE_TRACING
+#  define PCC_TRACE_CAT_(a, b) a##b
+#  define PCC_TRACE_CAT(a, b) PCC_TRACE_CAT_(a, b)
+
+// Declare a zone spanning the rest of the enclosing scope.
+//  - PCC_TRACE_ZONE(name) or PCC_TRACE_ZONE(name, id)
+#  define PCC_TRACE_ZONE(...) \
+    ::pcc::trace::Zone PCC_TRACE_CAT(pccTraceZone, __LINE__)(__VA_ARGS__)
+
+// Record a sample of a named counter.
+#  define PCC_TRACE_COUNTER(name, value) ::pcc::trace::counter(name, value)
+
+// Record the peak resident set size of the process (as peakRssKiB).
+#  define PCC_TRACE_PEAK_RSS() ::pcc::trace::samplePeakRss()
+#else
+#  define PCC_TRACE_ZONE(...) ((void)0)
+#  define PCC_TRACE_COUNTER(name, value) ((void)0)
+#  define PCC_TRACE_PEAK_RSS() ((void)0)
+#endif
+
+//===========================================================================
+
+namespace pcc {
+namespace trace {
+  // Start or stop recording.  Returns false if tracing is not built in.
+  bool setEnabled(bool enabled);
+
+  // Write all records as Chrome trace event JSON.
+  bool writeChromeTrace(const std::string& path);
+
+  // Write a per-name summary of all records as CSV.
+  bool writeSummaryCsv(const std::string& path);
+
+  //-------------------------------------------------------------------------
+
+#if ENABLE_TRACING
+  extern bool g_enabled;
+
+  class Zone {
+  public:
+    // NB: name must have static storage duration
+    explicit Zone(const char* name, int64_t id = -1)
+    {
+      if (g_enabled)
+        begin(name, id);
+    }
+
+    ~Zone()
+    {
+      if (_name)
+        end();
+    }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+  private:
+    void begin(const char* name, int64_t id);
+    void end();
+
+    const char* _name = nullptr;
+    int64_t _id;
+    int64_t _startNs;
+
+    // Time spent in nested zones
+    int64_t _childNs;
+
+    // The enclosing zone on the same thread
+    Zone* _parent;
+  };
+
+  // NB: name must have static storage duration
+  void counter(const char* name, int64_t value);
+
+  void samplePeakRss();
+#endif
+}  // namespace trace
+}  // namespace pcc
@@ -38,6 +38,10 @@
 #include "PCCMisc.h"
 #include "PCCPointSet.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -83,6 +87,141 @@ getTokens(
   return !tokens.empty();
 }
 
+//----------------------------------------------------------------------------
+// Find the start of each token in the line [str, end).  Tokens are not
+// terminated: the numeric conversions stop at the following separator.
+
+static void
+getTokens(
+  const char* str, const char* end, std::vector<const char*>& tokens)
+{
+  tokens.clear();
+  bool inToken = false;
+  for (; str < end; str++) {
+    bool isSep = *str == ' ' || *str == '\t' || *str == '\r';
+    if (!isSep && !inToken)
+      tokens.push_back(str);
+    inToken = !isSep;
+  }
+}
+
+//----------------------------------------------------------------------------
+// Equivalent to atof(str), with a fast path for integral values that are
+// written with an optional all-zero fraction (eg, "-123.00000").
+
+static double
+parseDouble(const char* str)
+{
+  const char* p = str;
+  bool negative = *p == '-';
+  p += negative || *p == '+';
+
+  int64_t val = 0;
+  const char* digits = p;
+  for (; *p >= '0' && *p <= '9' && p - digits < 15; p++)
+    val = val * 10 + (*p - '0');
+
+  if (p == digits)
+    return atof(str);
+
+  if (*p == '.')
+    while (*++p == '0')
+      ;
+
+  if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || !*p)
+    return negative ? -double(val) : double(val);
+
+  return atof(str);
+}
+
+//----------------------------------------------------------------------------
+// Equivalent to atoi(str), with a fast path for short decimal values.
+
+static int
+parseInt(const char* str)
+{
+  const char* p = str;
+  bool negative = *p == '-';
+  p += negative || *p == '+';
+
+  int val = 0;
+  const char* digits = p;
+  for (; *p >= '0' && *p <= '9' && p - digits < 9; p++)
+    val = val * 10 + (*p - '0');
+
+  if (p == digits || (*p >= '0' && *p <= '9'))
+    return atoi(str);
+
+  return negative ? -val : val;
+}
+
+//============================================================================
+
+static const size_t kReadBufferSize = 1 << 22;
+static const size_t kWriteBufferSize = 1 << 20;
+
+//----------------------------------------------------------------------------
+
+template<typename T>
+static char*
+pack(char* dst, const T& val)
+{
+  memcpy(dst, &val, sizeof(T));
+  return dst + sizeof(T);
+}
+
+//----------------------------------------------------------------------------
+
+template<typename T>
+static T
+unpack(const char* src)
+{
+  T val;
+  memcpy(&val, src, sizeof(T));
+  return val;
+}
+
+//----------------------------------------------------------------------------
+// Append the decimal representation of val, preceded by sep (if not 0).
+
+static void
+appendInt(std::vector<char>& buf, char sep, int64_t val)
+{
+  char tmp[24];
+  char* p = tmp + sizeof(tmp);
+  uint64_t mag = val < 0 ? -uint64_t(val) : uint64_t(val);
+  do {
+    *--p = '0' + mag % 10;
+    mag /= 10;
+  } while (mag);
+  if (val < 0)
+    *--p = '-';
+  if (sep)
+    *--p = sep;
+  buf.insert(buf.end(), p, tmp + sizeof(tmp));
+}
+
+//----------------------------------------------------------------------------
+// Append val formatted as by printf("%.5f").  Integral values, which are
+// the common case, are formatted directly.
+
+static void
+appendFixed5(std::vector<char>& buf, double val)
+{
+  if (
+    val == std::trunc(val) && std::abs(val) < 1e15
+    && !(val == 0 && std::signbit(val))) {
+    static const char kFraction[] = ".00000";
+    appendInt(buf, 0, int64_t(val));
+    buf.insert(buf.end(), kFraction, kFraction + 6);
+    return;
+  }
+
+  char tmp[512];
+  int len = snprintf(tmp, sizeof(tmp), "%.5f", val);
+  buf.insert(buf.end(), tmp, tmp + std::min(len, int(sizeof(tmp)) - 1));
+}
+
 //============================================================================
 
 bool
@@ -134,51 +273,74 @@ ply::write(
   if (cloud.hasFrameIndex()) {
     fout << "property uint8 frameindex" << std::endl;
   }
+  if (cloud.hasLaserAngles()) {
+    fout << "property int32 laserangle" << std::endl;
+  }
   fout << "element face 0" << std::endl;
   fout << "property list uint8 int32 vertex_index" << std::endl;
   fout << "end_header" << std::endl;
   if (asAscii) {
-    //      fout << std::setprecision(std::numeric_limits<double>::max_digits10);
-    fout << std::fixed << std::setprecision(5);
+    // NB: output is equivalent to std::fixed << std::setprecision(5)
+    std::vector<char> buf;
+    buf.reserve(kWriteBufferSize + 1024);
     for (size_t i = 0; i < pointCount; ++i) {
       Vec3<double> position = cloud[i] * positionScale + positionOffset;
-      fout << position.x() << " " << position.y() << " " << position.z();
+      appendFixed5(buf, position.x());
+      buf.push_back(' ');
+      appendFixed5(buf, position.y());
+      buf.push_back(' ');
+      appendFixed5(buf, position.z());
       if (cloud.hasColors()) {
         const Vec3<attr_t>& color = cloud.getColor(i);
-        fout << " " << static_cast<int>(color[0]) << " "
-             << static_cast<int>(color[1]) << " "
-             << static_cast<int>(color[2]);
+        appendInt(buf, ' ', color[0]);
+        appendInt(buf, ' ', color[1]);
+        appendInt(buf, ' ', color[2]);
       }
-      if (cloud.hasReflectances()) {
-        fout << " " << static_cast<int>(cloud.getReflectance(i));
-      }
-      if (cloud.hasFrameIndex()) {
-        fout << " " << static_cast<int>(cloud.getFrameIndex(i));
+      if (cloud.hasReflectances())
+        appendInt(buf, ' ', cloud.getReflectance(i));
+      if (cloud.hasFrameIndex())
+        appendInt(buf, ' ', cloud.getFrameIndex(i));
+      if (cloud.hasLaserAngles())
+        appendInt(buf, ' ', cloud.getLaserAngle(i));
+      buf.push_back('\n');
+
+      if (buf.size() >= kWriteBufferSize) {
+        fout.write(buf.data(), buf.size());
+        buf.clear();
       }
-      fout << std::endl;
     }
+    fout.write(buf.data(), buf.size());
   } else {
     fout.clear();
     fout.close();
     fout.open(fileName, std::ofstream::binary | std::ofstream::app);
-    for (size_t i = 0; i < pointCount; ++i) {
-      Vec3<double> position = cloud[i] * positionScale + positionOffset;
-      fout.write(
-        reinterpret_cast<const char* const>(&position), sizeof(double) * 3);
-      if (cloud.hasColors()) {
-        const Vec3<attr_t>& c = cloud.getColor(i);
-        Vec3<uint8_t> val8b{uint8_t(c[0]), uint8_t(c[1]), uint8_t(c[2])};
-        fout.write(reinterpret_cast<const char*>(&val8b), sizeof(uint8_t) * 3);
-      }
-      if (cloud.hasReflectances()) {
-        const attr_t& reflectance = cloud.getReflectance(i);
-        fout.write(
-          reinterpret_cast<const char*>(&reflectance), sizeof(uint16_t));
-      }
-      if (cloud.hasFrameIndex()) {
-        const uint16_t& findex = cloud.getFrameIndex(i);
-        fout.write(reinterpret_cast<const char*>(&findex), sizeof(uint16_t));
+
+    // Records are packed into a large buffer and written in blocks
+    const size_t recordSize = 3 * sizeof(double)
+      + (cloud.hasColors() ? 3 : 0) + (cloud.hasReflectances() ? 2 : 0)
+      + (cloud.hasFrameIndex() ? 1 : 0) + (cloud.hasLaserAngles() ? 4 : 0);
+    const size_t pointsPerBlock = kWriteBufferSize / recordSize;
+
+    std::vector<char> buf(pointsPerBlock * recordSize);
+    for (size_t start = 0; start < pointCount; start += pointsPerBlock) {
+      size_t end = std::min(pointCount, start + pointsPerBlock);
+      char* p = buf.data();
+      for (size_t i = start; i < end; ++i) {
+        Vec3<double> position = cloud[i] * positionScale + positionOffset;
+        p = pack(p, position);
+        if (cloud.hasColors()) {
+          const Vec3<attr_t>& c = cloud.getColor(i);
+          Vec3<uint8_t> val8b{uint8_t(c[0]), uint8_t(c[1]), uint8_t(c[2])};
+          p = pack(p, val8b);
+        }
+        if (cloud.hasReflectances())
+          p = pack(p, uint16_t(cloud.getReflectance(i)));
+        if (cloud.hasFrameIndex())
+          p = pack(p, uint8_t(cloud.getFrameIndex(i)));
+        if (cloud.hasLaserAngles())
+          p = pack(p, int32_t(cloud.getLaserAngle(i)));
       }
+      fout.write(buf.data(), p - buf.data());
     }
   }
   fout.close();
@@ -272,7 +434,7 @@ ply::read(
       attributesInfo.resize(attributeIndex + 1);
       AttributeInfo& attributeInfo = attributesInfo[attributeIndex];
       attributeInfo.name = propertyName;
-      if (propertyType == "float64") {
+      if (propertyType == "float64" || propertyType == "double") {
         attributeInfo.type = ATTRIBUTE_TYPE_FLOAT64;
         attributeInfo.byteCount = 8;
       } else if (propertyType == "float" || propertyType == "float32") {
@@ -281,10 +443,10 @@ ply::read(
       } else if (propertyType == "uint64") {
         attributeInfo.type = ATTRIBUTE_TYPE_UINT64;
         attributeInfo.byteCount = 8;
-      } else if (propertyType == "uint32") {
+      } else if (propertyType == "uint32" || propertyType == "uint") {
         attributeInfo.type = ATTRIBUTE_TYPE_UINT32;
         attributeInfo.byteCount = 4;
-      } else if (propertyType == "uint16") {
+      } else if (propertyType == "uint16" || propertyType == "ushort") {
         attributeInfo.type = ATTRIBUTE_TYPE_UINT16;
         attributeInfo.byteCount = 2;
       } else if (propertyType == "uchar" || propertyType == "uint8") {
@@ -293,10 +455,10 @@ ply::read(
       } else if (propertyType == "int64") {
         attributeInfo.type = ATTRIBUTE_TYPE_INT64;
         attributeInfo.byteCount = 8;
-      } else if (propertyType == "int32") {
+      } else if (propertyType == "int32" || propertyType == "int") {
         attributeInfo.type = ATTRIBUTE_TYPE_INT32;
         attributeInfo.byteCount = 4;
-      } else if (propertyType == "int16") {
+      } else if (propertyType == "int16" || propertyType == "short") {
         attributeInfo.type = ATTRIBUTE_TYPE_INT16;
         attributeInfo.byteCount = 2;
       } else if (propertyType == "char" || propertyType == "int8") {
@@ -393,111 +555,148 @@ ply::read(
 
   cloud.resize(pointCount);
   if (isAscii) {
+    // The body is parsed in blocks of whole lines; any partial line at the
+    // end of a block is carried over to the start of the next.
+    std::vector<char> buf(kReadBufferSize + 1);
+    std::vector<const char*> tokens;
     size_t pointCounter = 0;
-    while (!ifs.eof() && pointCounter < pointCount) {
-      ifs.getline(tmp, MAX_BUFFER_SIZE);
-      getTokens(tmp, sep, tokens);
-      if (tokens.empty()) {
-        continue;
+    size_t carry = 0;
+    while (pointCounter < pointCount) {
+      ifs.read(buf.data() + carry, buf.size() - 1 - carry);
+      size_t len = carry + ifs.gcount();
+      bool lastBlock = !ifs;
+      if (len == 0)
+        break;
+
+      // the final line of the file need not be terminated
+      buf[len] = '\n';
+      const char* line = buf.data();
+      const char* bufEnd = buf.data() + len + lastBlock;
+      while (pointCounter < pointCount) {
+        const char* eol =
+          static_cast<const char*>(memchr(line, '\n', bufEnd - line));
+        if (!eol)
+          break;
+
+        getTokens(line, eol, tokens);
+        line = eol + 1;
+        if (tokens.empty())
+          continue;
+        if (tokens.size() < attributeCount)
+          return false;
+
+        auto& position = cloud[pointCounter];
+        position[0] = parseDouble(tokens[indexX]) * positionScale;
+        position[1] = parseDouble(tokens[indexY]) * positionScale;
+        position[2] = parseDouble(tokens[indexZ]) * positionScale;
+        if (cloud.hasColors()) {
+          auto& color = cloud.getColor(pointCounter);
+          color[0] = parseInt(tokens[indexG]);
+          color[1] = parseInt(tokens[indexB]);
+          color[2] = parseInt(tokens[indexR]);
+        }
+        if (cloud.hasReflectances()) {
+          cloud.getReflectance(pointCounter) =
+            uint16_t(parseInt(tokens[indexReflectance]));
+        }
+        if (cloud.hasFrameIndex()) {
+          cloud.getFrameIndex(pointCounter) =
+            uint8_t(parseInt(tokens[indexFrame]));
+        }
+        if (cloud.hasLaserAngles()) {
+          cloud.getLaserAngle(pointCounter) =
+            std::round(atof(tokens[indexLaserAngle]));
+        }
+        ++pointCounter;
       }
-      if (tokens.size() < attributeCount) {
+
+      if (lastBlock)
+        break;
+
+      carry = buf.data() + len - line;
+      if (carry == buf.size() - 1) {
+        std::cout << "Error: line too long!" << std::endl;
         return false;
       }
-      auto& position = cloud[pointCounter];
-      position[0] = atof(tokens[indexX].c_str()) * positionScale;
-      position[1] = atof(tokens[indexY].c_str()) * positionScale;
-      position[2] = atof(tokens[indexZ].c_str()) * positionScale;
-      if (cloud.hasColors()) {
-        auto& color = cloud.getColor(pointCounter);
-        color[0] = atoi(tokens[indexG].c_str());
-        color[1] = atoi(tokens[indexB].c_str());
-        color[2] = atoi(tokens[indexR].c_str());
-      }
-      if (cloud.hasReflectances()) {
-        cloud.getReflectance(pointCounter) =
-          uint16_t(atoi(tokens[indexReflectance].c_str()));
+      memmove(buf.data(), line, carry);
+    }
+  } else {
+    // Byte offset of each property within a vertex record
+    std::vector<size_t> offsets(attributeCount);
+    size_t recordSize = 0;
+    for (size_t a = 0; a < attributeCount; ++a) {
+      offsets[a] = recordSize;
+      recordSize += attributesInfo[a].byteCount;
+    }
+    if (!recordSize)
+      return true;
+
+    // Records are read in blocks, each property being decoded over the
+    // whole block in turn.  Decoding stops at the last complete record.
+    const size_t pointsPerBlock =
+      std::max(size_t(1), kReadBufferSize / recordSize);
+    std::vector<char> buf(pointsPerBlock * recordSize);
+    for (size_t start = 0; start < pointCount;) {
+      size_t count = std::min(pointsPerBlock, pointCount - start);
+      ifs.read(buf.data(), count * recordSize);
+      count = ifs.gcount() / recordSize;
+
+      const char* rec = buf.data();
+      for (int k = 0; k < 3; k++) {
+        const size_t idx = k == 0 ? indexX : k == 1 ? indexY : indexZ;
+        const char* src = rec + offsets[idx];
+        if (attributesInfo[idx].byteCount == 4) {
+          for (size_t i = 0; i < count; i++, src += recordSize)
+            cloud[start + i][k] = unpack<float>(src) * positionScale;
+        } else {
+          for (size_t i = 0; i < count; i++, src += recordSize)
+            cloud[start + i][k] = unpack<double>(src) * positionScale;
+        }
       }
-      if (cloud.hasFrameIndex()) {
-        cloud.getFrameIndex(pointCounter) =
-          uint8_t(atoi(tokens[indexFrame].c_str()));
+
+      if (withColors) {
+        // NB: the internal representation is GBR
+        const size_t idx[3] = {indexG, indexB, indexR};
+        for (int k = 0; k < 3; k++) {
+          const char* src = rec + offsets[idx[k]];
+          for (size_t i = 0; i < count; i++, src += recordSize)
+            cloud.getColor(start + i)[k] = unpack<uint8_t>(src);
+        }
       }
-      if (cloud.hasLaserAngles()) {
-        cloud.getLaserAngle(pointCounter) =
-          std::round(atof(tokens[indexLaserAngle].c_str()));
+
+      if (withReflectances) {
+        const char* src = rec + offsets[indexReflectance];
+        if (attributesInfo[indexReflectance].byteCount == 1) {
+          for (size_t i = 0; i < count; i++, src += recordSize)
+            cloud.getReflectance(start + i) = unpack<uint8_t>(src);
+        } else {
+          for (size_t i = 0; i < count; i++, src += recordSize)
+            cloud.getReflectance(start + i) = unpack<uint16_t>(src);
+        }
       }
-      ++pointCounter;
-    }
-  } else {
-    for (size_t pointCounter = 0; pointCounter < pointCount && !ifs.eof();
-         ++pointCounter) {
-      auto& position = cloud[pointCounter];
-      for (size_t a = 0; a < attributeCount && !ifs.eof(); ++a) {
-        const auto& attributeInfo = attributesInfo[a];
-        if (a == indexX) {
-          if (attributeInfo.byteCount == 4) {
-            float x;
-            ifs.read(reinterpret_cast<char*>(&x), sizeof(float));
-            position[0] = x * positionScale;
-          } else {
-            double x;
-            ifs.read(reinterpret_cast<char*>(&x), sizeof(double));
-            position[0] = x * positionScale;
-          }
-        } else if (a == indexY) {
-          if (attributeInfo.byteCount == 4) {
-            float y;
-            ifs.read(reinterpret_cast<char*>(&y), sizeof(float));
-            position[1] = y * positionScale;
-          } else {
-            double y;
-            ifs.read(reinterpret_cast<char*>(&y), sizeof(double));
-            position[1] = y * positionScale;
-          }
-        } else if (a == indexZ) {
-          if (attributeInfo.byteCount == 4) {
-            float z;
-            ifs.read(reinterpret_cast<char*>(&z), sizeof(float));
-            position[2] = z * positionScale;
-          } else {
-            double z;
-            ifs.read(reinterpret_cast<char*>(&z), sizeof(double));
-            position[2] = z * positionScale;
-          }
-        } else if (a == indexR && attributeInfo.byteCount == 1) {
-          uint8_t val8b;
-          ifs.read(reinterpret_cast<char*>(&val8b), sizeof(uint8_t));
-          cloud.getColor(pointCounter)[2] = val8b;
-        } else if (a == indexG && attributeInfo.byteCount == 1) {
-          uint8_t val8b;
-          ifs.read(reinterpret_cast<char*>(&val8b), sizeof(uint8_t));
-          cloud.getColor(pointCounter)[0] = val8b;
-        } else if (a == indexB && attributeInfo.byteCount == 1) {
-          uint8_t val8b;
-          ifs.read(reinterpret_cast<char*>(&val8b), sizeof(uint8_t));
-          cloud.getColor(pointCounter)[1] = val8b;
-        } else if (a == indexReflectance && attributeInfo.byteCount <= 2) {
-          if (attributeInfo.byteCount == 1) {
-            uint8_t reflectance;
-            ifs.read(reinterpret_cast<char*>(&reflectance), sizeof(uint8_t));
-            cloud.getReflectance(pointCounter) = reflectance;
-          } else {
-            auto& reflectance = cloud.getReflectance(pointCounter);
-            ifs.read(reinterpret_cast<char*>(&reflectance), sizeof(uint16_t));
-          }
-        } else if (a == indexFrame && attributeInfo.byteCount <= 2) {
-          if (attributeInfo.byteCount == 1) {
-            auto& findex = cloud.getFrameIndex(pointCounter);
-            ifs.read(reinterpret_cast<char*>(&findex), sizeof(uint8_t));
-          } else {
-            uint16_t findex;
-            ifs.read(reinterpret_cast<char*>(&findex), sizeof(uint16_t));
-            cloud.getFrameIndex(pointCounter) = uint8_t(findex);
-          }
+
+      if (withFrameIndex) {
+        const char* src = rec + offsets[indexFrame];
+        if (attributesInfo[indexFrame].byteCount == 1) {
+          for (size_t i = 0; i < count; i++, src += recordSize)
+            cloud.getFrameIndex(start + i) = unpack<uint8_t>(src);
         } else {
-          char buffer[128];
-          ifs.read(buffer, attributeInfo.byteCount);
+          for (size_t i = 0; i < count; i++, src += recordSize)
+            cloud.getFrameIndex(start + i) = uint8_t(unpack<uint16_t>(src));
         }
       }
+
+      if (
+        withLaserAngles
+        && attributesInfo[indexLaserAngle].type == ATTRIBUTE_TYPE_INT32) {
+        const char* src = rec + offsets[indexLaserAngle];
+        for (size_t i = 0; i < count; i++, src += recordSize)
+          cloud.getLaserAngle(start + i) = unpack<int32_t>(src);
+      }
+
+      if (!count)
+        break;
+      start += count;
     }
   }
   return true;
@@ -35,12 +35,17 @@
 
 #include "pointset_processing.h"
 
+#include "attribute_conversion.h"
 #include "colourspace.h"
 #include "hls.h"
 #include "KDTreeVectorOfVectorsAdaptor.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstddef>
+#include <cstring>
+#include <limits>
 #include <set>
 #include <vector>
 #include <utility>
@@ -50,56 +55,191 @@ namespace pcc {
 
 //============================================================================
 
-template<typename UniqueFn, typename QFn>
+// Quantise @count positions from @src into @dst (which may alias @src).
+// Each component is translated by -@offset after quantisation by a
+// multiplicative @scaleFactor with rounding, then clamped to @clamp:
+//   PCCClip(int32_t(std::round(pos * scaleFactor) - offset), min, max)
+//
+// The rounding is performed using integer conversions that permit
+// vectorisation.  Blocks containing values for which these conversions
+// could overflow are evaluated using the floating-point definition.
+
+static void
+quantizePositionArray(
+  const float scaleFactor,
+  const Vec3<int> offset,
+  const Box3<int> clamp,
+  const point_t* src,
+  point_t* dst,
+  size_t count)
+{
+  const int kBlockSize = 64;
+  const int kBlockLen = 3 * kBlockSize;
+  const double kMaxMagnitude = double(1 << 30);
+
+  bool offsetInRange = true;
+  for (int k = 0; k < 3; k++)
+    offsetInRange &= std::abs(offset[k]) < 1 << 30;
+
+  // Per-component parameters, repeated to match an interleaved block
+  int32_t offsets[kBlockLen], clampMin[kBlockLen], clampMax[kBlockLen];
+  for (int j = 0; j < kBlockLen; j++) {
+    offsets[j] = offset[j % 3];
+    clampMin[j] = clamp.min[j % 3];
+    clampMax[j] = clamp.max[j % 3];
+  }
+
+  static_assert(sizeof(point_t) == 3 * sizeof(int32_t), "packed point_t");
+  int32_t in[kBlockLen], out[kBlockLen];
+
+  for (size_t start = 0; start < count; start += kBlockSize) {
+    int numPoints = int(std::min(count - start, size_t(kBlockSize)));
+    int len = 3 * numPoints;
+    std::memcpy(in, src + start, len * sizeof(int32_t));
+
+    int32_t minPos = 0;
+    int32_t maxPos = 0;
+    for (int j = 0; j < len; j++) {
+      minPos = std::min(minPos, in[j]);
+      maxPos = std::max(maxPos, in[j]);
+    }
+
+    double maxMagnitude =
+      std::max(-double(minPos), double(maxPos)) * std::abs(scaleFactor);
+
+    if (offsetInRange && maxMagnitude < kMaxMagnitude) {
+      // NB: std::round(x) == t + (x - t >= 0.5) - (x - t <= -0.5),
+      // where t = trunc(x), and x - t is exact.
+      for (int j = 0; j < len; j++) {
+        float x = in[j] * scaleFactor;
+        int32_t t = int32_t(x);
+        float frac = x - float(t);
+        int32_t rounded = t + (frac >= 0.5f) - (frac <= -0.5f);
+        int32_t pos = int32_t(float(rounded) - offsets[j]);
+        out[j] = PCCClip(pos, clampMin[j], clampMax[j]);
+      }
+    } else {
+      for (int j = 0; j < len; j++) {
+        double pos = std::round(in[j] * scaleFactor) - offsets[j];
+        out[j] = PCCClip(int32_t(pos), clampMin[j], clampMax[j]);
+      }
+    }
+
+    std::memcpy(dst + start, out, len * sizeof(int32_t));
+  }
+}
+
+//============================================================================
+// Link the indexes of points with identical @keys into the chains of
+// @dst.srcIdxDupList.  The head of each chain (the first occurrence of
+// each key) is marked by setting the sign bit.
+//
+// Returns the number of unique keys.
+
+static int
+linkDuplicatePoints(const std::vector<point_t>& keys, SrcMappedPointSet& dst)
+{
+  int numPoints = keys.size();
+  dst.srcIdxDupList.resize(numPoints);
+  if (!numPoints)
+    return 0;
+
+  // Group identical keys, preserving the source order within each group.
+  // @isGroupStart[i] indicates that order[i] differs from its predecessor.
+  std::vector<int32_t> order(numPoints);
+  std::vector<uint8_t> isGroupStart(numPoints);
+
+  // The keys are packed together with the source index into a single
+  // integer when possible.
+  Box3<int32_t> bbox(
+    std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min());
+  for (const auto& key : keys) {
+    for (int k = 0; k < 3; k++) {
+      bbox.min[k] = std::min(bbox.min[k], key[k]);
+      bbox.max[k] = std::max(bbox.max[k], key[k]);
+    }
+  }
+
+  int idxBits = numBits(numPoints - 1);
+  Vec3<int> keyBits;
+  for (int k = 0; k < 3; k++)
+    keyBits[k] = numBits(bbox.max[k] - bbox.min[k]);
+
+  if (idxBits + keyBits[0] + keyBits[1] + keyBits[2] <= 64) {
+    std::vector<uint64_t> packed(numPoints);
+    for (int i = 0; i < numPoints; i++) {
+      uint64_t val = 0;
+      for (int k = 0; k < 3; k++)
+        val = (val << keyBits[k]) | uint32_t(keys[i][k] - bbox.min[k]);
+      packed[i] = (val << idxBits) | i;
+    }
+    std::sort(packed.begin(), packed.end());
+
+    const uint64_t idxMask = (uint64_t(1) << idxBits) - 1;
+    for (int i = 0; i < numPoints; i++) {
+      order[i] = int32_t(packed[i] & idxMask);
+      isGroupStart[i] =
+        !i || (packed[i] >> idxBits) != (packed[i - 1] >> idxBits);
+    }
+  } else {
+    for (int i = 0; i < numPoints; i++)
+      order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int32_t a, int32_t b) {
+      return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+    });
+
+    for (int i = 0; i < numPoints; i++)
+      isGroupStart[i] = !i || !(keys[order[i]] == keys[order[i - 1]]);
+  }
+
+  // Each chain runs from its lowest index to its highest, which refers
+  // to itself
+  int numUnique = 0;
+  for (int i = 0; i < numPoints; i++) {
+    bool isGroupEnd = i + 1 == numPoints || isGroupStart[i + 1];
+    int32_t next = isGroupEnd ? order[i] : order[i + 1];
+
+    if (isGroupStart[i]) {
+      dst.srcIdxDupList[order[i]] = next | 0x80000000;
+      numUnique++;
+    } else
+      dst.srcIdxDupList[order[i]] = next;
+  }
+
+  return numUnique;
+}
+
+//----------------------------------------------------------------------------
+// Generate the unique points identified by @keys, taking the attributes
+// of the first source point of each.  Output positions are given by
+// @posFn(srcIdx).
+
+template<typename PosFn>
 SrcMappedPointSet
-reducePointSet(const PCCPointSet3& src, UniqueFn uniqueFn, QFn qFn)
+reducePointSet(
+  const PCCPointSet3& src, const std::vector<point_t>& keys, PosFn posFn)
 {
   SrcMappedPointSet dst;
   int numSrcPoints = src.getPointCount();
 
   // Build a map of duplicate points
-  int numDstPoints = 0;
-  if (1) {
-    std::map<Vec3<int32_t>, int> qPosToSrcIdx;
-    dst.srcIdxDupList.resize(numSrcPoints);
-    for (int i = numSrcPoints - 1; i >= 0; i--) {
-      // Attempt to insert quantised position
-      auto res = qPosToSrcIdx.insert({uniqueFn(src[i]), i});
-
-      // Append to linked list of same positions.
-      // Index of the src point (i) or the index of the previous point with
-      // the same quantised position
-      dst.srcIdxDupList[res.first->second] ^= 0x80000000;
-      dst.srcIdxDupList[i] = res.first->second | 0x80000000;
-      res.first->second = i;
-    }
-
-    numDstPoints = qPosToSrcIdx.size();
-  }
+  int numDstPoints = linkDuplicatePoints(keys, dst);
 
-  // Number of quantised points is now known
-  dst.cloud.resize(numDstPoints);
-  // Add attribute storage to match src
-  dst.cloud.addRemoveAttributes(src);
+  // Find head of each linked list
   dst.idxToSrcIdx.resize(numDstPoints);
-
-  // Generate dst outputs
   for (int i = 0, dstIdx = 0; i < numSrcPoints; ++i) {
-    // Find head of each linked list
     if (dst.srcIdxDupList[i] >= 0)
       continue;
 
     dst.srcIdxDupList[i] ^= 0x80000000;
-    dst.idxToSrcIdx[dstIdx] = i;
-    if (src.hasLaserAngles() == true)
-      dst.cloud.setLaserAngle(dstIdx, src.getLaserAngle(i));
-    if (src.hasColors() == true)
-      dst.cloud.setColor(dstIdx, src.getColor(i));
-    if (src.hasReflectances() == true)
-      dst.cloud.setReflectance(dstIdx, src.getReflectance(i));
-    dst.cloud[dstIdx++] = qFn(src[i]);
+    dst.idxToSrcIdx[dstIdx++] = i;
   }
 
+  // Generate dst outputs
+  dst.cloud.appendPartition(src, dst.idxToSrcIdx);
+  for (int i = 0; i < numDstPoints; i++)
+    dst.cloud[i] = posFn(dst.idxToSrcIdx[i]);
+
   return dst;
 }
 
@@ -121,18 +261,21 @@ samplePositionsUniq(
 {
   auto diffScale = sampleScale / quantScale;
 
-  return reducePointSet(
-    src,
-    [=](Vec3<int> point) {
-      for (int k = 0; k < 3; k++)
-        point[k] = std::round(std::round(point[k] * quantScale) * diffScale);
-      return point;
-    },
-    [=](Vec3<int> point) {
-      for (int k = 0; k < 3; k++)
-        point[k] = std::round(point[k] * quantScale);
-      return point - offset;
-    });
+  int numSrcPoints = src.getPointCount();
+  std::vector<point_t> keys(numSrcPoints);
+  for (int i = 0; i < numSrcPoints; i++) {
+    Vec3<int> point = src[i];
+    for (int k = 0; k < 3; k++)
+      point[k] = std::round(std::round(point[k] * quantScale) * diffScale);
+    keys[i] = point;
+  }
+
+  return reducePointSet(src, keys, [&](int srcIdx) {
+    Vec3<int> point = src[srcIdx];
+    for (int k = 0; k < 3; k++)
+      point[k] = std::round(point[k] * quantScale);
+    return point - offset;
+  });
 }
 
 //============================================================================
@@ -150,15 +293,14 @@ quantizePositionsUniq(
   const Box3<int> clamp,
   const PCCPointSet3& src)
 {
-  auto qFn = [=](Vec3<int> point) {
-    for (int k = 0; k < 3; k++) {
-      double posk = std::round(point[k] * scaleFactor) - offset[k];
-      point[k] = PCCClip(int32_t(posk), clamp.min[k], clamp.max[k]);
-    }
-    return point;
-  };
+  int numSrcPoints = src.getPointCount();
+  std::vector<point_t> qPos(numSrcPoints);
+  if (numSrcPoints)
+    quantizePositionArray(
+      scaleFactor, offset, clamp, &src[0], qPos.data(), numSrcPoints);
 
-  return reducePointSet(src, qFn, qFn);
+  return reducePointSet(
+    src, qPos, [&](int srcIdx) { return qPos[srcIdx]; });
 }
 
 //============================================================================
@@ -181,39 +323,15 @@ quantizePositions(
   int numSrcPoints = src.getPointCount();
 
   // In case dst and src point clouds are the same, don't destroy src.
+  // Otherwise, copy all attributes in bulk.
   if (&src != dst) {
     dst->clear();
-    dst->addRemoveAttributes(src);
-    dst->resize(numSrcPoints);
-  }
-
-  for (int i = 0; i < numSrcPoints; ++i) {
-    const auto point = src[i];
-    auto& dstPoint = (*dst)[i];
-    for (int k = 0; k < 3; ++k) {
-      double k_pos = std::round(point[k] * scaleFactor) - offset[k];
-      dstPoint[k] = PCCClip(int32_t(k_pos), clamp.min[k], clamp.max[k]);
-    }
-  }
-
-  // don't copy attributes if dst already has them
-  if (&src == dst)
-    return;
-
-  if (src.hasColors()) {
-    for (int i = 0; i < numSrcPoints; ++i)
-      dst->setColor(i, src.getColor(i));
-  }
-
-  if (src.hasReflectances()) {
-    for (int i = 0; i < numSrcPoints; ++i)
-      dst->setReflectance(i, src.getReflectance(i));
+    dst->append(src);
   }
 
-  if (src.hasLaserAngles()) {
-    for (int i = 0; i < numSrcPoints; ++i)
-      dst->setLaserAngle(i, src.getLaserAngle(i));
-  }
+  if (numSrcPoints)
+    quantizePositionArray(
+      scaleFactor, offset, clamp, &src[0], &(*dst)[0], numSrcPoints);
 }
 
 //============================================================================
@@ -237,7 +355,8 @@ clampVolume(Box3<double> bbox, PCCPointSet3* cloud)
 //  - Find the N_1 (1 < N_1) nearest neighbours in source to p_t and create
 //    a set of points denoted by Ψ_1.
 //  - Find the set of source points that p_t belongs to their set of N_2
-//    nearest neighbours. Denote this set of points by Ψ_2.
+//    nearest neighbours. Denote this set of points by Ψ_2.  If N_2 is 0,
+//    Ψ_2 is empty and the search is skipped.
 //  - Compute the distance-weighted average of points in Ψ_1 and Ψ_2 by:
 //        \bar{Ψ}_k = ∑_{q∈Ψ_k} c(q)/Δ(q,p_t)
 //                    ----------------------- ,
@@ -269,8 +388,6 @@ recolourColour(
     return false;
   }
 
-  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeTarget(
-    3, target, 10);
   KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeSource(
     3, source, 10);
 
@@ -398,20 +515,25 @@ recolourColour(
   std::vector<std::vector<DistColor>> refinedColorsDists2;
   refinedColorsDists2.resize(pointCountTarget);
 
-  for (size_t index = 0; index < pointCountSource; ++index) {
-    const Vec3<attr_t> color = source.getColor(index);
-    resultSetBwd.init(&indicesBwd[0], &sqrDistBwd[0]);
+  if (num_resultsBwd) {
+    KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeTarget(
+      3, target, 10);
+
+    for (size_t index = 0; index < pointCountSource; ++index) {
+      const Vec3<attr_t> color = source.getColor(index);
+      resultSetBwd.init(&indicesBwd[0], &sqrDistBwd[0]);
 
-    Vec3<double> posInTgt =
-      source[index] * sourceToTargetScaleFactor - targetToSourceOffset;
+      Vec3<double> posInTgt =
+        source[index] * sourceToTargetScaleFactor - targetToSourceOffset;
 
-    kdtreeTarget.index->findNeighbors(
-      resultSetBwd, &posInTgt[0], nanoflann::SearchParams(10));
+      kdtreeTarget.index->findNeighbors(
+        resultSetBwd, &posInTgt[0], nanoflann::SearchParams(10));
 
-    for (int i = 0; i < num_resultsBwd; ++i) {
-      if (sqrDistBwd[i] <= maxGeometryDist2Bwd) {
-        refinedColorsDists2[indicesBwd[i]].push_back(
-          DistColor{sqrDistBwd[i], color});
+      for (int i = 0; i < num_resultsBwd; ++i) {
+        if (sqrDistBwd[i] <= maxGeometryDist2Bwd) {
+          refinedColorsDists2[indicesBwd[i]].push_back(
+            DistColor{sqrDistBwd[i], color});
+        }
       }
     }
   }
@@ -602,7 +724,8 @@ recolourColour(
 //  - Find the N_1 (1 < N_1) nearest neighbours in source to p_t and create
 //    a set of points denoted by Ψ_1.
 //  - Find the set of source points that p_t belongs to their set of N_2
-//    nearest neighbours. Denote this set of points by Ψ_2.
+//    nearest neighbours. Denote this set of points by Ψ_2.  If N_2 is 0,
+//    Ψ_2 is empty and the search is skipped.
 //  - Compute the distance-weighted average of points in Ψ_1 and Ψ_2 by:
 //        \bar{Ψ}_k = ∑_{q∈Ψ_k} c(q)/Δ(q,p_t)
 //                    ----------------------- ,
@@ -633,8 +756,6 @@ recolourReflectance(
   if (!pointCountSource || !pointCountTarget || !source.hasReflectances()) {
     return false;
   }
-  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeTarget(
-    3, target, 10);
   KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeSource(
     3, source, 10);
   target.addReflectances();
@@ -752,20 +873,25 @@ recolourReflectance(
   std::vector<std::vector<DistReflectance>> refinedReflectancesDists2;
   refinedReflectancesDists2.resize(pointCountTarget);
 
-  for (size_t index = 0; index < pointCountSource; ++index) {
-    const attr_t reflectance = source.getReflectance(index);
-    resultSetBwd.init(&indicesBwd[0], &sqrDistBwd[0]);
+  if (num_resultsBwd) {
+    KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeTarget(
+      3, target, 10);
 
-    Vec3<double> posInTgt =
-      source[index] * sourceToTargetScaleFactor - targetToSourceOffset;
+    for (size_t index = 0; index < pointCountSource; ++index) {
+      const attr_t reflectance = source.getReflectance(index);
+      resultSetBwd.init(&indicesBwd[0], &sqrDistBwd[0]);
 
-    kdtreeTarget.index->findNeighbors(
-      resultSetBwd, &posInTgt[0], nanoflann::SearchParams(10));
+      Vec3<double> posInTgt =
+        source[index] * sourceToTargetScaleFactor - targetToSourceOffset;
 
-    for (int i = 0; i < num_resultsBwd; ++i) {
-      if (sqrDistBwd[i] <= maxGeometryDist2Bwd) {
-        refinedReflectancesDists2[indicesBwd[i]].push_back(
-          DistReflectance{sqrDistBwd[i], reflectance});
+      kdtreeTarget.index->findNeighbors(
+        resultSetBwd, &posInTgt[0], nanoflann::SearchParams(10));
+
+      for (int i = 0; i < num_resultsBwd; ++i) {
+        if (sqrDistBwd[i] <= maxGeometryDist2Bwd) {
+          refinedReflectancesDists2[indicesBwd[i]].push_back(
+            DistReflectance{sqrDistBwd[i], reflectance});
+        }
       }
     }
   }
@@ -964,10 +1090,8 @@ recolour(
 void
 convertGbrToYCgCoR(int bitDepth, PCCPointSet3& cloud)
 {
-  for (int i = 0; i < cloud.getPointCount(); i++) {
-    auto& val = cloud.getColor(i);
-    val = transformGbrToYCgCoR(bitDepth, val);
-  }
+  if (cloud.getPointCount())
+    convertGbrToYCgCoR(bitDepth, &cloud.getColor(0), cloud.getPointCount());
 }
 
 //============================================================================
@@ -975,10 +1099,8 @@ convertGbrToYCgCoR(int bitDepth, PCCPointSet3& cloud)
 void
 convertYCgCoRToGbr(int bitDepth, PCCPointSet3& cloud)
 {
-  for (int i = 0; i < cloud.getPointCount(); i++) {
-    auto& val = cloud.getColor(i);
-    val = transformYCgCoRToGbr(bitDepth, val);
-  }
+  if (cloud.getPointCount())
+    convertYCgCoRToGbr(bitDepth, &cloud.getColor(0), cloud.getPointCount());
 }
 
 //============================================================================
@@ -986,10 +1108,8 @@ convertYCgCoRToGbr(int bitDepth, PCCPointSet3& cloud)
 void
 convertGbrToYCbCrBt709(PCCPointSet3& cloud)
 {
-  for (int i = 0; i < cloud.getPointCount(); i++) {
-    auto& val = cloud.getColor(i);
-    val = transformGbrToYCbCrBt709(val);
-  }
+  if (cloud.getPointCount())
+    convertGbrToYCbCrBt709(&cloud.getColor(0), cloud.getPointCount());
 }
 
 //============================================================================
@@ -997,10 +1117,8 @@ convertGbrToYCbCrBt709(PCCPointSet3& cloud)
 void
 convertYCbCrBt709ToGbr(PCCPointSet3& cloud)
 {
-  for (int i = 0; i < cloud.getPointCount(); i++) {
-    auto& val = cloud.getColor(i);
-    val = transformYCbCrBt709ToGbr(val);
-  }
+  if (cloud.getPointCount())
+    convertYCbCrBt709ToGbr(&cloud.getColor(0), cloud.getPointCount());
 }
 
 //============================================================================
@@ -35,6 +35,10 @@
 
 #include "quantization.h"
 
+#include <algorithm>
+#include <cstdint>
+
+#include "PCCPointSet.h"
 #include "constants.h"
 #include "hls.h"
 #include "tables.h"
@@ -128,11 +132,15 @@ deriveQpSet(
   QpSet qpset;
   qpset.layers = deriveLayerQps(attr_aps, abh);
   qpset.regions = deriveQpRegions(attr_aps, abh);
+  qpset.regionIndex = QpRegionIndex(qpset.regions);
 
   // The mimimum Qp = 4 is always lossless; the maximum varies according to
   // bitdepth.
   qpset.maxQp = 51 + 6 * (attrDesc.bitdepth - 8);
 
+  for (int qp = 4; qp <= qpset.maxQp; qp++)
+    qpset.quantizerByQp.emplace_back(qp);
+
   return qpset;
 }
 
@@ -144,6 +152,9 @@ QpSet::quantizers(int qpLayer, Qps qpOffset) const
   int qp0 = PCCClip(layers[qpLayer][0] + qpOffset[0], 4, maxQp);
   int qp1 = PCCClip(layers[qpLayer][1] + qpOffset[1] + qp0, 4, maxQp);
 
+  if (!quantizerByQp.empty())
+    return {quantizerByQp[qp0 - 4], quantizerByQp[qp1 - 4]};
+
   return {Quantizer(qp0), Quantizer(qp1)};
 }
 
@@ -152,12 +163,7 @@ QpSet::quantizers(int qpLayer, Qps qpOffset) const
 Quantizers
 QpSet::quantizers(const Vec3<int32_t>& point, int qpLayer) const
 {
-  for (const auto& region : regions) {
-    if (region.region.contains(point))
-      return quantizers(qpLayer, region.qpOffset);
-  }
-
-  return quantizers(qpLayer, {0, 0});
+  return quantizers(qpLayer, regionQpOffset(point));
 }
 
 //============================================================================
@@ -165,12 +171,107 @@ QpSet::quantizers(const Vec3<int32_t>& point, int qpLayer) const
 Qps
 QpSet::regionQpOffset(const Vec3<int32_t>& point) const
 {
-  for (const auto& region : regions) {
-    if (region.region.contains(point))
-      return region.qpOffset;
+  int regionIdx = regionIndex.find(point);
+  if (regionIdx < 0)
+    return {0, 0};
+
+  return regions[regionIdx].qpOffset;
+}
+
+//============================================================================
+
+void
+QpSet::regionQpOffsets(
+  const PCCPointSet3& cloud,
+  const std::vector<int>& order,
+  std::vector<Qps>& qpOffsets) const
+{
+  qpOffsets.resize(order.size());
+  if (regions.empty()) {
+    std::fill(qpOffsets.begin(), qpOffsets.end(), Qps{0, 0});
+    return;
   }
 
-  return {0, 0};
+  for (int i = 0; i < int(order.size()); i++) {
+    int regionIdx = regionIndex.find(cloud[order[i]]);
+    qpOffsets[i] = regionIdx < 0 ? Qps{0, 0} : regions[regionIdx].qpOffset;
+  }
+}
+
+//============================================================================
+
+QpRegionIndex::QpRegionIndex(const QpRegionList& regions)
+{
+  for (const auto& region : regions)
+    _boxes.push_back(region.region);
+
+  if (regions.size() < kMinGridRegions)
+    return;
+
+  // Each region [min, max] starts intervals at min and max + 1
+  int64_t numCells = 1;
+  for (int k = 0; k < 3; k++) {
+    auto& cuts = _axes[k].cuts;
+    for (const auto& region : regions) {
+      cuts.push_back(region.region.min[k]);
+      cuts.push_back(int64_t(region.region.max[k]) + 1);
+    }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+    numCells *= cuts.size() + 1;
+  }
+
+  if (numCells > kMaxCells || regions.size() > INT16_MAX)
+    return;
+
+  // Buckets covering [cuts[0], cuts.back()] locate the interval of any
+  // coordinate in a few steps
+  for (auto& axis : _axes) {
+    int64_t span = axis.cuts.back() - axis.cuts[0];
+    axis.shift = 0;
+    while ((span >> axis.shift) >= kMaxBuckets)
+      axis.shift++;
+
+    int numBuckets = (span >> axis.shift) + 1;
+    axis.bucketInterval.resize(numBuckets);
+    for (int b = 0; b < numBuckets; b++) {
+      int64_t start = axis.cuts[0] + (int64_t(b) << axis.shift);
+      axis.bucketInterval[b] =
+        std::upper_bound(axis.cuts.begin(), axis.cuts.end(), start)
+        - axis.cuts.begin();
+    }
+  }
+
+  // Resolve the first region containing each cell, using the lower bound
+  // of the cell as a representative.  NB: the first interval along each
+  // axis is outside all regions.
+  _cells.resize(numCells);
+  const int nx = _axes[0].cuts.size() + 1;
+  const int ny = _axes[1].cuts.size() + 1;
+  const int nz = _axes[2].cuts.size() + 1;
+  auto cell = _cells.begin();
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      for (int k = 0; k < nz; k++, cell++) {
+        *cell = -1;
+        if (!i || !j || !k)
+          continue;
+
+        Vec3<int64_t> pt{
+          _axes[0].cuts[i - 1], _axes[1].cuts[j - 1], _axes[2].cuts[k - 1]};
+        for (int r = 0; r < int(regions.size()); r++) {
+          const auto& box = regions[r].region;
+          if (
+            pt[0] >= box.min[0] && pt[0] <= box.max[0] && pt[1] >= box.min[1]
+            && pt[1] <= box.max[1] && pt[2] >= box.min[2]
+            && pt[2] <= box.max[2]) {
+            *cell = r;
+            break;
+          }
+        }
+      }
+    }
+  }
 }
 
 //============================================================================
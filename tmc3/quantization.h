@@ -36,6 +36,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <vector>
 
 #include "constants.h"
@@ -46,6 +47,7 @@ namespace pcc {
 struct AttributeDescription;
 struct AttributeParameterSet;
 struct AttributeBrickHeader;
+class PCCPointSet3;
 
 //============================================================================
 // Quantisation methods
@@ -117,6 +119,91 @@ struct QpRegionOffset {
 
 typedef std::vector<QpRegionOffset> QpRegionList;
 
+//============================================================================
+// Finds the first region of a QpRegionList that contains a point.
+//
+// The region boundaries divide each axis into intervals, and so the space
+// into a grid of cells in which region membership is constant.  The first
+// region containing each cell is determined in advance.  A lookup then
+// maps each coordinate to an interval using a table of coarse buckets.
+
+class QpRegionIndex {
+public:
+  QpRegionIndex() = default;
+  explicit QpRegionIndex(const QpRegionList& regions);
+
+  // The index of the first region that contains point, or -1 if none
+  int find(const Vec3<int32_t>& point) const;
+
+private:
+  // Fewer regions than this are searched in turn, which is faster
+  static const int kMinGridRegions = 6;
+
+  // Limit on the number of cells, beyond which regions are searched in turn
+  static const int kMaxCells = 1 << 20;
+
+  // Maximum number of buckets used to locate the intervals of an axis
+  static const int kMaxBuckets = 1024;
+
+  struct Axis {
+    // The lower bound of each interval (except the first)
+    std::vector<int64_t> cuts;
+
+    // The interval containing the start of each bucket of 2^shift
+    // coordinates from cuts[0]
+    std::vector<int> bucketInterval;
+    int shift;
+
+    int interval(int32_t x) const;
+  };
+
+  // The regions searched directly when no grid is used
+  std::vector<Box3<int32_t>> _boxes;
+
+  std::array<Axis, 3> _axes;
+
+  // The first region containing each cell, or -1
+  std::vector<int16_t> _cells;
+};
+
+//----------------------------------------------------------------------------
+
+inline int
+QpRegionIndex::Axis::interval(int32_t x) const
+{
+  int64_t offset = int64_t(x) - cuts[0];
+  if (offset < 0)
+    return 0;
+
+  uint64_t bucket = uint64_t(offset) >> shift;
+  if (bucket >= bucketInterval.size())
+    return cuts.size();
+
+  int i = bucketInterval[bucket];
+  const int numCuts = int(cuts.size());
+  while (i < numCuts && cuts[i] <= x)
+    i++;
+  return i;
+}
+
+//----------------------------------------------------------------------------
+
+inline int
+QpRegionIndex::find(const Vec3<int32_t>& point) const
+{
+  if (_cells.empty()) {
+    for (int r = 0; r < int(_boxes.size()); r++)
+      if (_boxes[r].contains(point))
+        return r;
+    return -1;
+  }
+
+  int idx = _axes[0].interval(point[0]);
+  idx = idx * (_axes[1].cuts.size() + 1) + _axes[1].interval(point[1]);
+  idx = idx * (_axes[2].cuts.size() + 1) + _axes[2].interval(point[2]);
+  return _cells[idx];
+}
+
 //============================================================================
 
 struct QpSet {
@@ -124,6 +211,13 @@ struct QpSet {
   QpRegionList regions;
   int maxQp;
 
+  // Lookup structure for regions, derived by deriveQpSet()
+  QpRegionIndex regionIndex;
+
+  // The quantizer for each qp in the range [4, maxQp], derived by
+  // deriveQpSet()
+  std::vector<Quantizer> quantizerByQp;
+
   // Derive the quantizers at a given layer after applying qpOffset
   Quantizers quantizers(int qpLayer, Qps qpOffset) const;
 
@@ -131,6 +225,12 @@ struct QpSet {
   Quantizers quantizers(const Vec3<int32_t>& point, int qpLayer) const;
 
   Qps regionQpOffset(const Vec3<int32_t>& point) const;
+
+  // The region qp offset of each point cloud[order[i]]
+  void regionQpOffsets(
+    const PCCPointSet3& cloud,
+    const std::vector<int>& order,
+    std::vector<Qps>& qpOffsets) const;
 };
 
 //============================================================================
@@ -0,0 +1,758 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "synthetic.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pcc {
+
+//============================================================================
+// Pseudo random numbers (splitmix64).  Used in preference to the standard
+// library distributions, whose output is implementation defined.
+
+namespace {
+  struct Rng {
+    uint64_t state;
+
+    explicit Rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+      uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+    }
+
+    // uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1. / 9007199254740992.); }
+
+    double uniform(double a, double b) { return a + (b - a) * uniform(); }
+
+    int uniformInt(int a, int b) { return a + int(next() % (b - a + 1)); }
+  };
+
+  //--------------------------------------------------------------------------
+  // Stateless hash of two values to [0, 1), used for per-sample noise that
+  // is independent of the generation order.
+
+  double
+  hashUniform(uint64_t a, uint64_t b)
+  {
+    Rng rng(a * 0xd1b54a32d192ed03ull + b);
+    rng.next();
+    return rng.uniform();
+  }
+
+  //--------------------------------------------------------------------------
+  // A point prior to duplicate removal.
+
+  struct Sample {
+    // position packed as x:y:z
+    uint64_t key;
+
+    // colour (GBR), reflectance, laser index
+    uint16_t attr[5];
+  };
+
+  //--------------------------------------------------------------------------
+  // Collects samples, producing a voxelised point cloud.  Where several
+  // samples occupy the same voxel, the first to be generated is retained.
+
+  class SampleSink {
+  public:
+    SampleSink(int precisionBits)
+      : _bits(precisionBits), _maxPos((1 << precisionBits) - 1), _lastKey(-1)
+    {}
+
+    // Add a sample at pos (in grid units).  Returns false if outside.
+    bool add(
+      const Vec3<double>& pos,
+      Vec3<int> gbr = 0,
+      int reflectance = 0,
+      int laser = 0)
+    {
+      int64_t key = 0;
+      for (int k = 0; k < 3; k++) {
+        double v = std::floor(pos[k]);
+        if (!(v >= 0 && v <= _maxPos))
+          return false;
+        key = (key << _bits) | int64_t(v);
+      }
+
+      // successive samples frequently occupy the same voxel
+      if (key == _lastKey)
+        return true;
+      _lastKey = key;
+
+      Sample s;
+      s.key = uint64_t(key);
+      for (int k = 0; k < 3; k++)
+        s.attr[k] = uint16_t(std::max(0, std::min(255, gbr[k])));
+      s.attr[3] = uint16_t(std::max(0, std::min(65535, reflectance)));
+      s.attr[4] = uint16_t(laser);
+      _samples.push_back(s);
+      return true;
+    }
+
+    void reserve(size_t n) { _samples.reserve(n); }
+
+    // Remove duplicate positions and output in raster order.
+    void emit(bool withColour, bool withRefl, bool withLaser, PCCPointSet3* cloud)
+    {
+      sortByKey();
+      auto end = std::unique(
+        _samples.begin(), _samples.end(),
+        [](const Sample& a, const Sample& b) { return a.key == b.key; });
+      _samples.erase(end, _samples.end());
+
+      cloud->clear();
+      cloud->addRemoveAttributes(withColour, withRefl);
+      if (withLaser)
+        cloud->addLaserAngles();
+      cloud->resize(_samples.size());
+
+      const uint64_t mask = (uint64_t(1) << _bits) - 1;
+      for (size_t i = 0; i < _samples.size(); i++) {
+        const auto& s = _samples[i];
+        (*cloud)[i] = point_t(
+          int32_t(s.key >> (2 * _bits)), int32_t((s.key >> _bits) & mask),
+          int32_t(s.key & mask));
+
+        if (withColour)
+          cloud->setColor(i, Vec3<attr_t>(s.attr[0], s.attr[1], s.attr[2]));
+        if (withRefl)
+          cloud->setReflectance(i, s.attr[3]);
+        if (withLaser)
+          cloud->setLaserAngle(i, s.attr[4]);
+      }
+
+      _samples.clear();
+      _samples.shrink_to_fit();
+    }
+
+  private:
+    // Stable (LSD radix) sort, preserving the generation order of samples
+    // at each position.
+    void sortByKey()
+    {
+      const int kDigitBits = 11;
+      const uint64_t kDigitMask = (1 << kDigitBits) - 1;
+
+      std::vector<Sample> buf(_samples.size());
+      std::vector<size_t> bucket(size_t(1) << kDigitBits);
+      for (int shift = 0; shift < 3 * _bits; shift += kDigitBits) {
+        std::fill(bucket.begin(), bucket.end(), 0);
+        for (const auto& s : _samples)
+          bucket[(s.key >> shift) & kDigitMask]++;
+
+        size_t offset = 0;
+        for (auto& count : bucket) {
+          size_t next = offset + count;
+          count = offset;
+          offset = next;
+        }
+
+        for (const auto& s : _samples)
+          buf[bucket[(s.key >> shift) & kDigitMask]++] = s;
+        std::swap(buf, _samples);
+      }
+    }
+
+    int _bits;
+    int _maxPos;
+    int64_t _lastKey;
+    std::vector<Sample> _samples;
+  };
+
+  //--------------------------------------------------------------------------
+  // Rotation about the vertical (z) axis
+
+  struct RotationZ {
+    double c, s;
+
+    explicit RotationZ(double angle) : c(std::cos(angle)), s(std::sin(angle))
+    {}
+
+    Vec3<double> operator()(const Vec3<double>& p) const
+    {
+      return {c * p[0] - s * p[1], s * p[0] + c * p[1], p[2]};
+    }
+  };
+
+  //--------------------------------------------------------------------------
+
+  const double kPi = 3.14159265358979323846;
+  const double kDegToRad = kPi / 180.;
+
+  // Samples per voxel spacing when sampling surfaces
+  const double kSurfaceStep = 0.6;
+
+  // Surface voxels per unit of object radius squared (see the dense
+  // object generator).
+  const double kDenseVoxelsPerRadiusSq = 19.;
+
+  // The largest dense object radius relative to the grid size (the ring
+  // extends to 1.27 radii).
+  const double kDenseMaxRadius = 0.42 / 1.27;
+
+  // LiDAR maximum range (metres) and sensor height
+  const double kLidarRange = 120.;
+  const double kLidarHeight = 1.8;
+}  // namespace
+
+//============================================================================
+
+SyntheticParams
+defaultSyntheticParams(SyntheticProfile profile)
+{
+  SyntheticParams params;
+  params.profile = profile;
+  params.seed = 1;
+  params.numPoints = 1000000;
+  params.precisionBits = 10;
+  params.rotationPerFrame = 0.;
+  params.translationPerFrame = 0.;
+  params.deformation = 0.;
+  params.numLasers = 64;
+
+  switch (profile) {
+  case SyntheticProfile::kDenseObject: break;
+
+  case SyntheticProfile::kLidarSweep: {
+    params.precisionBits = 18;
+    // sensor moving at 1m/frame, other vehicles at 1m/frame
+    double gridUnitsPerMetre = (1 << 18) / (2. * kLidarRange);
+    params.translationPerFrame = {gridUnitsPerMetre, 0., 0.};
+    params.deformation = 1.;
+    break;
+  }
+
+  case SyntheticProfile::kSparseScene:
+    params.numPoints = 500000;
+    params.precisionBits = 16;
+    break;
+  }
+
+  return params;
+}
+
+//----------------------------------------------------------------------------
+
+int
+minSyntheticPrecisionBits(SyntheticProfile profile, int64_t numPoints)
+{
+  if (profile != SyntheticProfile::kDenseObject)
+    return 4;
+
+  double radius = std::sqrt(numPoints / kDenseVoxelsPerRadiusSq);
+  double gridSize = radius / kDenseMaxRadius;
+  return std::max(4, int(std::ceil(std::log2(gridSize))));
+}
+
+//============================================================================
+
+SyntheticCloudGenerator::SyntheticCloudGenerator(
+  const SyntheticParams& params)
+  : _params(params), _radius(0)
+{
+  _params.precisionBits = std::max(4, std::min(21, _params.precisionBits));
+  _params.numPoints = std::max<int64_t>(1, _params.numPoints);
+  _params.numLasers = std::max(1, _params.numLasers);
+
+  Rng rng(_params.seed);
+  const double gridSize = double(1 << _params.precisionBits);
+
+  switch (_params.profile) {
+  case SyntheticProfile::kDenseObject: {
+    // four surface harmonics: amplitude, polar freq, azimuth freq, phase
+    for (int i = 0; i < 4; i++) {
+      _harmonics.push_back(rng.uniform(0.01, 0.04));
+      _harmonics.push_back(rng.uniformInt(1, 5));
+      _harmonics.push_back(rng.uniformInt(1, 5));
+      _harmonics.push_back(rng.uniform(0, 2 * kPi));
+    }
+    // torus tilt, body and ring colours
+    for (int i = 0; i < 6; i++)
+      _harmonics.push_back(rng.uniform());
+
+    // choose the object size to produce approximately numPoints voxels,
+    // limited by the grid size.
+    _radius = std::sqrt(_params.numPoints / kDenseVoxelsPerRadiusSq);
+    _radius = std::min(_radius, kDenseMaxRadius * gridSize);
+    break;
+  }
+
+  case SyntheticProfile::kLidarSweep: {
+    // buildings lining both sides of a street along the x axis
+    for (int side = -1; side <= 1; side += 2) {
+      double x = -150.;
+      while (x < 150.) {
+        double len = rng.uniform(10., 30.);
+        double setback = rng.uniform(8., 12.);
+        Box box;
+        box.min = {x, side > 0 ? setback : -setback - rng.uniform(10, 20), 0};
+        box.max = {x + len, side > 0 ? setback + rng.uniform(10, 20) : -setback,
+                   rng.uniform(6., 25.)};
+        box.velocity = 0.;
+        box.material = rng.uniformInt(35, 60);
+        _boxes.push_back(box);
+        x += len + rng.uniform(1., 6.);
+      }
+    }
+
+    // vehicles in four lanes
+    for (int i = 0; i < 12; i++) {
+      int lane = i % 4;
+      double y = -5.25 + lane * 3.5;
+      double x = rng.uniform(-100., 100.);
+      double dir = lane < 2 ? -1. : 1.;
+      Box car;
+      car.min = {x, y - 0.9, 0.2};
+      car.max = {x + 4.5, y + 0.9, 1.6};
+      car.velocity = {dir * _params.deformation * rng.uniform(0.5, 1.5), 0, 0};
+      car.material = rng.uniformInt(50, 90);
+      _boxes.push_back(car);
+    }
+
+    // street furniture
+    for (double x = -150.; x < 150.; x += rng.uniform(10., 20.)) {
+      for (int side = -1; side <= 1; side += 2) {
+        Cylinder pole;
+        pole.base = {x + rng.uniform(-2., 2.), side * 7.5, 0.};
+        pole.radius = rng.uniform(0.1, 0.25);
+        pole.height = rng.uniform(3., 9.);
+        pole.material = 80;
+        _poles.push_back(pole);
+      }
+    }
+    break;
+  }
+
+  case SyntheticProfile::kSparseScene: {
+    // terrain: amplitude, x/y frequency, phase
+    for (int i = 0; i < 4; i++) {
+      _terrain.push_back(rng.uniform(0.2, 1.) / (i + 1));
+      _terrain.push_back(rng.uniform(0.5, 3.) * (i + 1));
+      _terrain.push_back(rng.uniform(0.5, 3.) * (i + 1));
+      _terrain.push_back(rng.uniform(0, 2 * kPi));
+    }
+
+    // vegetation clusters
+    for (int i = 0; i < 40; i++) {
+      Blob blob;
+      blob.centre = {rng.uniform(0.05, 0.95) * gridSize,
+                     rng.uniform(0.05, 0.95) * gridSize, 0.};
+      blob.radius = rng.uniform(0.005, 0.02) * gridSize;
+      _blobs.push_back(blob);
+    }
+
+    // buildings
+    for (int i = 0; i < 10; i++) {
+      Box box;
+      Vec3<double> size{rng.uniform(0.02, 0.06) * gridSize,
+                        rng.uniform(0.02, 0.06) * gridSize,
+                        rng.uniform(0.02, 0.08) * gridSize};
+      box.min = {rng.uniform(0.05, 0.9) * gridSize,
+                 rng.uniform(0.05, 0.9) * gridSize, 0.};
+      box.max = box.min + size;
+      box.velocity = 0.;
+      box.material = rng.uniformInt(0, 255);
+      _boxes.push_back(box);
+    }
+    break;
+  }
+  }
+}
+
+//----------------------------------------------------------------------------
+
+void
+SyntheticCloudGenerator::generate(int frameIdx, PCCPointSet3* cloud) const
+{
+  switch (_params.profile) {
+  case SyntheticProfile::kDenseObject:
+    generateDenseObject(frameIdx, cloud);
+    break;
+
+  case SyntheticProfile::kLidarSweep:
+    generateLidarSweep(frameIdx, cloud);
+    break;
+
+  case SyntheticProfile::kSparseScene:
+    generateSparseScene(frameIdx, cloud);
+    break;
+  }
+}
+
+//============================================================================
+// A bumpy sphere (a sum of surface harmonics) encircled by a tilted torus.
+// Each surface is sampled on a regular parametric grid at sub-voxel
+// spacing, so the voxelised surface is closed.  The samples are fixed in
+// object space; motion transforms them.
+//
+// NB: the voxel count is approximately kDenseVoxelsPerRadiusSq * r^2.
+
+void
+SyntheticCloudGenerator::generateDenseObject(
+  int frameIdx, PCCPointSet3* cloud) const
+{
+  const double gridSize = double(1 << _params.precisionBits);
+  const double R = _radius;
+  const double t = frameIdx;
+  const auto& h = _harmonics;
+
+  // rigid motion
+  const RotationZ rotate(t * _params.rotationPerFrame * kDegToRad);
+  const Vec3<double> centre =
+    Vec3<double>(gridSize / 2.) + _params.translationPerFrame * t;
+
+  // object space to grid, including non-rigid motion
+  auto transform = [&](Vec3<double> p) {
+    if (_params.deformation != 0.) {
+      double a = _params.deformation * R;
+      Vec3<double> q = p * (kPi / R);
+      p[0] += a * std::sin(q[1] + 0.5 * t);
+      p[1] += a * std::sin(q[2] + 0.4 * t + 1.);
+      p[2] += a * std::sin(q[0] + 0.3 * t + 2.);
+    }
+    return rotate(p) + centre;
+  };
+
+  auto colour = [](double r, double g, double b) {
+    return Vec3<int>(int(g), int(b), int(r));
+  };
+
+  SampleSink sink(_params.precisionBits);
+  sink.reserve(size_t(3.5 * kDenseVoxelsPerRadiusSq * R * R));
+
+  // body
+  double ampl = 0, slope = 1;
+  for (int i = 0; i < 4; i++) {
+    ampl += h[4 * i];
+    slope += h[4 * i] * std::max(h[4 * i + 1], h[4 * i + 2]);
+  }
+
+  const double rMax = R * (1. + ampl) * slope;
+  const int numRings = int(std::ceil(kPi * rMax / kSurfaceStep));
+  for (int j = 0; j <= numRings; j++) {
+    double theta = kPi * j / numRings;
+    double sinTheta = std::sin(theta), cosTheta = std::cos(theta);
+    int numSamples =
+      std::max(1, int(std::ceil(2 * kPi * rMax * sinTheta / kSurfaceStep)));
+
+    // the polar part of each harmonic is constant along a ring
+    double polar[4];
+    for (int k = 0; k < 4; k++)
+      polar[k] = h[4 * k] * std::sin(h[4 * k + 1] * theta + h[4 * k + 3]);
+
+    for (int i = 0; i < numSamples; i++) {
+      double phi = 2 * kPi * i / numSamples;
+      double cosPhi = std::cos(phi), sinPhi = std::sin(phi);
+
+      // cos(m phi) by the Chebyshev recurrence, m <= 5
+      double cosMPhi[6] = {1., cosPhi};
+      for (int m = 2; m < 6; m++)
+        cosMPhi[m] = 2 * cosPhi * cosMPhi[m - 1] - cosMPhi[m - 2];
+
+      double r = 1.;
+      for (int k = 0; k < 4; k++)
+        r += polar[k] * cosMPhi[int(h[4 * k + 2])];
+      r *= R;
+
+      Vec3<double> p{r * sinTheta * cosPhi, r * sinTheta * sinPhi,
+                     r * cosTheta};
+
+      // a base colour with latitude bands and fine texture
+      double band =
+        0.5 + 0.5 * std::sin(6 * theta + 6 * sinPhi * cosPhi);
+      double noise = 16 * (hashUniform(j, i) - 0.5);
+      auto c = colour(
+        60 + 150 * h[17] + 40 * band + noise,
+        60 + 150 * h[18] * band + noise, 60 + 120 * h[19] + noise);
+      sink.add(transform(p), c);
+    }
+  }
+
+  // ring
+  const double tilt = (h[16] - 0.5) * kPi / 3;
+  const double majorR = 1.15 * R, minorR = 0.12 * R;
+  const int numU = int(std::ceil(2 * kPi * (majorR + minorR) / kSurfaceStep));
+  const int numV = int(std::ceil(2 * kPi * minorR / kSurfaceStep));
+  for (int iu = 0; iu < numU; iu++) {
+    double u = 2 * kPi * iu / numU;
+    for (int iv = 0; iv < numV; iv++) {
+      double v = 2 * kPi * iv / numV;
+      double d = majorR + minorR * std::cos(v);
+      Vec3<double> p{d * std::cos(u), d * std::sin(u), minorR * std::sin(v)};
+
+      // tilt about the x axis
+      p = {p[0], std::cos(tilt) * p[1] - std::sin(tilt) * p[2],
+           std::sin(tilt) * p[1] + std::cos(tilt) * p[2]};
+
+      bool check = ((iu * 16 / numU) + (iv * 4 / numV)) & 1;
+      double noise = 12 * (hashUniform(iu + (1ull << 32), iv) - 0.5);
+      auto c = check
+        ? colour(200 * h[20] + 40 + noise, 200 * h[21] + 40 + noise, 60 + noise)
+        : colour(230 + noise, 230 + noise, 220 + noise);
+      sink.add(transform(p), c);
+    }
+  }
+
+  sink.emit(true, false, false, cloud);
+}
+
+//============================================================================
+// A spinning multi-laser sensor driving along a street.  Each laser is cast
+// against the ground, buildings, vehicles and poles.
+
+void
+SyntheticCloudGenerator::generateLidarSweep(
+  int frameIdx, PCCPointSet3* cloud) const
+{
+  const double gridSize = double(1 << _params.precisionBits);
+  const double scale = gridSize / (2. * kLidarRange);
+  const double t = frameIdx;
+
+  // sensor pose
+  const Vec3<double> sensor =
+    _params.translationPerFrame * (t / scale) + Vec3<double>{0, 0, kLidarHeight};
+  const double yaw = t * _params.rotationPerFrame * kDegToRad;
+
+  // the scene at time t (vehicles move)
+  std::vector<Box> boxes = _boxes;
+  for (auto& box : boxes) {
+    box.min += box.velocity * t;
+    box.max += box.velocity * t;
+  }
+
+  const int numLasers = _params.numLasers;
+  const int numAzimuths = int(std::max<int64_t>(1, _params.numPoints / numLasers));
+  const uint64_t frameSeed = _params.seed * 1000003 + frameIdx;
+
+  SampleSink sink(_params.precisionBits);
+  sink.reserve(size_t(numLasers) * numAzimuths);
+
+  for (int l = 0; l < numLasers; l++) {
+    double elev = numLasers == 1 ? 0.
+                                 : (-24.9 + 26.9 * l / (numLasers - 1)) * kDegToRad;
+    double cosE = std::cos(elev), sinE = std::sin(elev);
+
+    for (int a = 0; a < numAzimuths; a++) {
+      uint64_t rayIdx = uint64_t(l) * numAzimuths + a;
+      if (hashUniform(frameSeed, rayIdx) < 0.02)
+        continue;
+
+      double az = 2 * kPi * a / numAzimuths + yaw;
+      Vec3<double> dir{cosE * std::cos(az), cosE * std::sin(az), sinE};
+
+      // nearest intersection
+      double tHit = kLidarRange;
+      Vec3<double> normal{0, 0, 1};
+      int material = -1;
+
+      if (dir[2] < 0) {
+        double tg = -sensor[2] / dir[2];
+        if (tg < tHit)
+          tHit = tg, material = 15;
+      }
+
+      for (const auto& box : boxes) {
+        double t0 = 0, t1 = tHit;
+        int axis = -1;
+        for (int k = 0; k < 3 && t0 <= t1; k++) {
+          double inv = 1. / dir[k];
+          double ta = (box.min[k] - sensor[k]) * inv;
+          double tb = (box.max[k] - sensor[k]) * inv;
+          if (ta > tb)
+            std::swap(ta, tb);
+          if (ta > t0)
+            t0 = ta, axis = k;
+          t1 = std::min(t1, tb);
+        }
+        if (t0 <= t1 && axis >= 0 && t0 < tHit) {
+          tHit = t0;
+          normal = 0.;
+          normal[axis] = dir[axis] > 0 ? -1. : 1.;
+          material = box.material;
+        }
+      }
+
+      for (const auto& pole : _poles) {
+        // circle intersection in the horizontal plane
+        double ox = sensor[0] - pole.base[0], oy = sensor[1] - pole.base[1];
+        double qa = dir[0] * dir[0] + dir[1] * dir[1];
+        double qb = ox * dir[0] + oy * dir[1];
+        double qc = ox * ox + oy * oy - pole.radius * pole.radius;
+        double disc = qb * qb - qa * qc;
+        if (disc < 0 || qa == 0)
+          continue;
+        double tp = (-qb - std::sqrt(disc)) / qa;
+        double z = sensor[2] + tp * dir[2];
+        if (tp > 0 && tp < tHit && z >= 0 && z <= pole.height) {
+          tHit = tp;
+          normal = {ox + tp * dir[0], oy + tp * dir[1], 0.};
+          normal /= pole.radius;
+          material = pole.material;
+        }
+      }
+
+      if (material < 0)
+        continue;
+
+      // range noise (±2cm)
+      double range = tHit + 0.04 * (hashUniform(frameSeed + 1, rayIdx) - 0.5);
+      Vec3<double> pos = sensor + dir * range;
+
+      double cosI = std::abs(normal * dir);
+      double falloff = 1. / (1. + (range / 50.) * (range / 50.));
+      double refl = 2.55 * material * (0.3 + 0.7 * cosI) * falloff;
+      refl += 8 * (hashUniform(frameSeed + 2, rayIdx) - 0.5);
+
+      sink.add(pos * scale + Vec3<double>(gridSize / 2.), 0, int(refl), l);
+    }
+  }
+
+  sink.emit(false, true, true, cloud);
+}
+
+//============================================================================
+// Terrain, vegetation and buildings sampled sparsely.  Samples are fixed
+// in object space (a function of the seed and sample index only).
+
+void
+SyntheticCloudGenerator::generateSparseScene(
+  int frameIdx, PCCPointSet3* cloud) const
+{
+  const double gridSize = double(1 << _params.precisionBits);
+  const double t = frameIdx;
+  const RotationZ rotate(t * _params.rotationPerFrame * kDegToRad);
+  const Vec3<double> centre{gridSize / 2., gridSize / 2., 0.};
+
+  auto terrainHeight = [&](double x, double y) {
+    double z = 0.;
+    for (int i = 0; i < 4; i++) {
+      const double* c = &_terrain[4 * i];
+      z += c[0] * std::sin(2 * kPi * (c[1] * x + c[2] * y) / gridSize + c[3]);
+    }
+    return gridSize * (0.2 + 0.04 * z);
+  };
+
+  auto transform = [&](const Vec3<double>& p) {
+    return rotate(p - centre) + centre + _params.translationPerFrame * t;
+  };
+
+  auto colour = [](double r, double g, double b) {
+    return Vec3<int>(int(g), int(b), int(r));
+  };
+
+  const int64_t numPoints = _params.numPoints;
+  const int64_t numTerrain = numPoints * 55 / 100;
+  const int64_t numVegetation = numPoints * 30 / 100;
+
+  SampleSink sink(_params.precisionBits);
+  sink.reserve(numPoints);
+
+  for (int64_t i = 0; i < numPoints; i++) {
+    Rng rng(_params.seed * 0x9e3779b97f4a7c15ull + i);
+    double noise = rng.uniform() - 0.5;
+
+    if (i < numTerrain) {
+      double x = rng.uniform() * gridSize, y = rng.uniform() * gridSize;
+      double z = terrainHeight(x, y);
+      double shade = (z / gridSize - 0.16) * 1000;
+      sink.add(
+        transform({x, y, z + 2 * noise}),
+        colour(110 + shade + 20 * noise, 100 + shade / 2, 70),
+        int(60 + 30 * noise));
+    } else if (i < numTerrain + numVegetation) {
+      const auto& blob = _blobs[rng.next() % _blobs.size()];
+
+      // roughly gaussian offset within the blob
+      Vec3<double> d;
+      for (int k = 0; k < 3; k++)
+        d[k] = (rng.uniform() + rng.uniform() + rng.uniform() - 1.5) / 1.5;
+
+      Vec3<double> p = blob.centre + d * blob.radius;
+      double ground = terrainHeight(blob.centre[0], blob.centre[1]);
+      p[2] = ground + blob.radius * (1.5 + d[2]);
+
+      // sway in proportion to the height above the ground
+      if (_params.deformation != 0.) {
+        double sway = _params.deformation * (p[2] - ground)
+          * std::sin(0.7 * t + blob.centre[0]);
+        p[0] += sway;
+      }
+
+      sink.add(
+        transform(p), colour(40 + 30 * noise, 120 + 60 * d[2], 40),
+        int(120 + 40 * noise));
+    } else {
+      const auto& box = _boxes[rng.next() % _boxes.size()];
+      Vec3<double> size = box.max - box.min;
+      double ground = terrainHeight(box.min[0], box.min[1]);
+
+      // a wall or the roof, weighted by area
+      double wallX = size[0] * size[2], wallY = size[1] * size[2];
+      double roof = size[0] * size[1];
+      double sel = rng.uniform() * (2 * wallX + 2 * wallY + roof);
+      double u = rng.uniform(), v = rng.uniform();
+      Vec3<double> p;
+      if (sel < 2 * wallX)
+        p = {u * size[0], sel < wallX ? 0. : size[1], v * size[2]};
+      else if (sel < 2 * wallX + 2 * wallY)
+        p = {sel < 2 * wallX + wallY ? 0. : size[0], u * size[1], v * size[2]};
+      else
+        p = {u * size[0], v * size[1], size[2]};
+
+      p += box.min;
+      p[2] += ground;
+
+      double tone = 0.4 + 0.6 * (box.material / 255.);
+      sink.add(
+        transform(p), colour(200 * tone, 180 * tone, 170 * tone + 20 * noise),
+        int(200 + 40 * noise));
+    }
+  }
+
+  sink.emit(true, true, false, cloud);
+}
+
+//============================================================================
+
+}  // namespace pcc
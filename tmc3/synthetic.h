@@ -0,0 +1,160 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PCCMath.h"
+#include "PCCPointSet.h"
+
+namespace pcc {
+
+//============================================================================
+// Deterministic synthetic point clouds for benchmarking and testing.
+//
+// A sequence is defined entirely by its parameters (including the seed).
+// Each frame is generated independently of any other, so frames may be
+// produced in any order.  No library random number distributions are
+// used: the output depends only on IEEE double arithmetic and the
+// platform's libm.
+
+enum class SyntheticProfile
+{
+  // Closed object surfaces with colour, voxelised at the grid precision
+  kDenseObject = 0,
+
+  // Spinning LiDAR sweeps of a street scene with reflectance and laser
+  // index, following a moving sensor
+  kLidarSweep = 1,
+
+  // Sparse outdoor scene: terrain, vegetation and building facades with
+  // colour and reflectance
+  kSparseScene = 2,
+};
+
+//============================================================================
+
+struct SyntheticParams {
+  SyntheticProfile profile;
+
+  uint64_t seed;
+
+  // Approximate number of points per frame.
+  int64_t numPoints;
+
+  // Geometry precision: output positions lie in [0, 2^precisionBits).
+  int precisionBits;
+
+  // Rigid motion per frame: rotation (degrees) about the vertical axis
+  // through the centre of the grid, followed by a translation (in grid
+  // units).  For LiDAR sweeps, this is the motion of the sensor.
+  double rotationPerFrame;
+  Vec3<double> translationPerFrame;
+
+  // Amplitude of non-rigid motion, relative to the object size.
+  // For LiDAR sweeps, the speed of other vehicles (in metres per frame).
+  double deformation;
+
+  // LiDAR sweeps: the number of lasers.
+  int numLasers;
+};
+
+//----------------------------------------------------------------------------
+// Defaults for a given profile.
+
+SyntheticParams defaultSyntheticParams(SyntheticProfile profile);
+
+//----------------------------------------------------------------------------
+// The least geometry precision at which a profile produces approximately
+// @numPoints points.  Only the size of dense objects is limited by the grid.
+
+int minSyntheticPrecisionBits(SyntheticProfile profile, int64_t numPoints);
+
+//============================================================================
+
+class SyntheticCloudGenerator {
+public:
+  SyntheticCloudGenerator(const SyntheticParams& params);
+
+  const SyntheticParams& params() const { return _params; }
+
+  // Generate the frameIdx-th frame of the sequence.
+  //  - colours are stored as per ply::read (ie, GBR order).
+  void generate(int frameIdx, PCCPointSet3* cloud) const;
+
+  //--------------------------------------------------------------------------
+  // Scene description (derived from the seed)
+
+  struct Box {
+    Vec3<double> min, max;
+    Vec3<double> velocity;
+    int material;
+  };
+
+  struct Cylinder {
+    Vec3<double> base;
+    double radius, height;
+    int material;
+  };
+
+  struct Blob {
+    Vec3<double> centre;
+    double radius;
+  };
+
+private:
+  void generateDenseObject(int frameIdx, PCCPointSet3* cloud) const;
+  void generateLidarSweep(int frameIdx, PCCPointSet3* cloud) const;
+  void generateSparseScene(int frameIdx, PCCPointSet3* cloud) const;
+
+  SyntheticParams _params;
+
+  // Dense objects: surface harmonic coefficients, object scale
+  std::vector<double> _harmonics;
+  double _radius;
+
+  // LiDAR and sparse scenes
+  std::vector<Box> _boxes;
+  std::vector<Cylinder> _poles;
+  std::vector<Blob> _blobs;
+  std::vector<double> _terrain;
+};
+
+//============================================================================
+
+}  // namespace pcc
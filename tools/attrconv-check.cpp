@@ -0,0 +1,320 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PCCMath.h"
+#include "PCCPointSet.h"
+#include "attribute_conversion.h"
+#include "colourspace.h"
+#include "hls.h"
+#include "program_options_lite.h"
+#include "version.h"
+
+using namespace std;
+using namespace pcc;
+
+//============================================================================
+// An exhaustive check of the batched attribute conversions.
+//
+// Every instruction set variant of each kernel in attribute_conversion.h
+// is compared with the per-point reference (the colourspace.h templates,
+// or the attribute scaling equations) over every input of the given bit
+// depths.  Inputs are converted in runs of consecutive values so that
+// blocks mixing in-range and out-of-range values are also exercised.
+
+struct Options {
+  // the bit depths of the input space to check
+  std::vector<int> bitDepths;
+};
+
+bool parseParameters(int argc, char* argv[], Options& opts);
+
+//============================================================================
+
+static const char*
+isaName(AttributeConversionIsa isa)
+{
+  switch (isa) {
+  case AttributeConversionIsa::kScalar: return "scalar";
+  case AttributeConversionIsa::kSse4: return "sse4";
+  case AttributeConversionIsa::kAvx2: return "avx2";
+  }
+  return "?";
+}
+
+//----------------------------------------------------------------------------
+// The variants supported by both the build and the host
+
+static std::vector<AttributeConversionIsa>
+supportedIsas()
+{
+  std::vector<AttributeConversionIsa> isas;
+  for (auto isa : {AttributeConversionIsa::kScalar,
+                   AttributeConversionIsa::kSse4,
+                   AttributeConversionIsa::kAvx2}) {
+    selectAttributeConversionIsa(isa);
+    if (attributeConversionIsa() == isa)
+      isas.push_back(isa);
+  }
+  return isas;
+}
+
+//============================================================================
+// Compares every variant of @kernel with @ref over the @count inputs
+// produced by @gen.  Returns the number of mismatching variants.
+
+template<typename T, typename Gen, typename Ref, typename Kernel>
+static int
+check(
+  const std::string& name, int64_t count, Gen gen, Ref ref, Kernel kernel)
+{
+  const size_t kRunLength = 1 << 16;
+  std::vector<T> in(kRunLength), expected(kRunLength), out(kRunLength);
+
+  static const auto isas = supportedIsas();
+  std::vector<int64_t> mismatches(isas.size());
+
+  for (int64_t start = 0; start < count; start += kRunLength) {
+    size_t len = size_t(std::min<int64_t>(kRunLength, count - start));
+    for (size_t i = 0; i < len; i++) {
+      in[i] = gen(start + i);
+      expected[i] = ref(in[i]);
+    }
+
+    for (int j = 0; j < isas.size(); j++) {
+      selectAttributeConversionIsa(isas[j]);
+      std::copy_n(in.begin(), len, out.begin());
+      kernel(out.data(), len);
+
+      for (size_t i = 0; i < len; i++) {
+        if (out[i] == expected[i])
+          continue;
+        if (!mismatches[j]++)
+          cerr << "Error: " << name << " (" << isaName(isas[j])
+               << ") differs from the reference for input " << in[i]
+               << ": " << out[i] << " != " << expected[i] << endl;
+      }
+    }
+  }
+
+  int numFailed = 0;
+  cout << name << ": " << count << " inputs,";
+  for (int j = 0; j < isas.size(); j++) {
+    cout << ' ' << isaName(isas[j]) << ' ';
+    if (mismatches[j])
+      cout << mismatches[j] << " mismatches";
+    else
+      cout << "ok";
+    numFailed += !!mismatches[j];
+  }
+  cout << endl;
+
+  return numFailed;
+}
+
+//----------------------------------------------------------------------------
+// Colour triples whose components have the given number of bits, in order
+// of increasing index.
+
+struct TripleGen {
+  int bits0, bits12;
+
+  int64_t count() const { return int64_t(1) << (bits0 + 2 * bits12); }
+
+  Vec3<attr_t> operator()(int64_t idx) const
+  {
+    int mask12 = (1 << bits12) - 1;
+    return {attr_t(idx >> 2 * bits12), attr_t(idx >> bits12 & mask12),
+            attr_t(idx & mask12)};
+  }
+};
+
+//============================================================================
+
+static int
+checkColourConversions(int bitDepth)
+{
+  using V = Vec3<attr_t>;
+  const std::string suffix = " " + std::to_string(bitDepth) + "-bit";
+  const TripleGen triples = {bitDepth, bitDepth};
+
+  // NB: YCgCoR chroma has an extra bit
+  const TripleGen ycgcor = {bitDepth, bitDepth + 1};
+
+  int numFailed = 0;
+
+  numFailed += check<V>(
+    "gbr->ycbcr709" + suffix, triples.count(), triples,
+    [](V val) { return transformGbrToYCbCrBt709(val); },
+    [](V* vals, size_t n) { convertGbrToYCbCrBt709(vals, n); });
+
+  numFailed += check<V>(
+    "ycbcr709->gbr" + suffix, triples.count(), triples,
+    [](V val) { return transformYCbCrBt709ToGbr(val); },
+    [](V* vals, size_t n) { convertYCbCrBt709ToGbr(vals, n); });
+
+  numFailed += check<V>(
+    "gbr->ycgcor" + suffix, triples.count(), triples,
+    [=](V val) { return transformGbrToYCgCoR(bitDepth, val); },
+    [=](V* vals, size_t n) { convertGbrToYCgCoR(bitDepth, vals, n); });
+
+  numFailed += check<V>(
+    "ycgcor->gbr" + suffix, ycgcor.count(), ycgcor,
+    [=](V val) { return transformYCgCoRToGbr(bitDepth, val); },
+    [=](V* vals, size_t n) { convertYCgCoRToGbr(bitDepth, vals, n); });
+
+  return numFailed;
+}
+
+//----------------------------------------------------------------------------
+// Attribute scaling of every 16-bit value under a range of parameters
+
+static int
+checkAttributeScaling()
+{
+  const auto gen = [](int64_t idx) { return attr_t(idx); };
+  const int64_t count = 1 << 16;
+
+  int numFailed = 0;
+  for (int scaleMinus1 : {0, 1, 2, 9, 99, 255, 1023})
+    for (int fracBits : {0, 1, 4, 8})
+      for (int offset : {0, 1, 128, 1000}) {
+        AttributeParameters params;
+        params.attr_scale_minus1 = scaleMinus1;
+        params.attr_frac_bits = fracBits;
+        params.attr_offset = offset;
+
+        const int scale = scaleMinus1 + 1;
+        const std::string suffix = " scale=" + std::to_string(scale)
+          + " fracBits=" + std::to_string(fracBits)
+          + " offset=" + std::to_string(offset);
+
+        numFailed += check<attr_t>(
+          "attrScale.fwd" + suffix, count, gen,
+          [=](int val) { return attr_t(((val - offset) << fracBits) / scale); },
+          [&](attr_t* vals, size_t n) { scaleAttributesFwd(params, vals, n); });
+
+        numFailed += check<attr_t>(
+          "attrScale.inv" + suffix, count, gen,
+          [=](int val) { return attr_t(((val * scale) >> fracBits) + offset); },
+          [&](attr_t* vals, size_t n) { scaleAttributesInv(params, vals, n); });
+      }
+
+  return numFailed;
+}
+
+//============================================================================
+
+int
+main(int argc, char* argv[])
+{
+  cout << "MPEG PCC attribute conversion check from Test Model C13" << endl;
+
+  Options opts;
+  if (!parseParameters(argc, argv, opts))
+    return 1;
+
+  cout << "detected:";
+  for (auto isa : supportedIsas())
+    cout << ' ' << isaName(isa);
+  cout << endl;
+
+  int numFailed = 0;
+  for (int bitDepth : opts.bitDepths)
+    numFailed += checkColourConversions(bitDepth);
+  numFailed += checkAttributeScaling();
+
+  if (numFailed) {
+    cerr << "Error: " << numFailed << " checks failed" << endl;
+    return 1;
+  }
+
+  cout << "all checks passed" << endl;
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+// :: Command line / config parsing
+
+bool
+parseParameters(int argc, char* argv[], Options& params)
+{
+  namespace po = df::program_options_lite;
+  bool print_help = false;
+
+  /* clang-format off */
+  // The definition of the program/config options, along with default values.
+  //
+  // NB: when updating the following tables:
+  //      (a) please keep to 80-columns for easier reading at a glance,
+  //      (b) do not vertically align values -- it breaks quickly
+  //
+  po::Options opts;
+  opts.addOptions()
+  ("help", print_help, false, "this help text")
+
+  ("bitDepths",
+    params.bitDepths, {8, 10},
+    "Bit depths of the colour input space to check")
+  ;
+  /* clang-format on */
+
+  po::setDefaults(opts);
+  po::ErrorReporter err;
+  const list<const char*>& argv_unhandled =
+    po::scanArgv(opts, argc, (const char**)argv, err);
+
+  for (const auto arg : argv_unhandled) {
+    err.warn() << "Unhandled argument ignored: " << arg << "\n";
+  }
+
+  if (print_help) {
+    po::doHelp(std::cout, opts, 78);
+    return false;
+  }
+
+  for (int bitDepth : params.bitDepths)
+    if (bitDepth < 1 || bitDepth > 10)
+      err.error() << "bitDepths must be between 1 and 10\n";
+
+  po::dumpCfg(cout, opts, 4);
+
+  return !err.is_errored;
+}
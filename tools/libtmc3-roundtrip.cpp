@@ -0,0 +1,642 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "TMC3Options.h"
+#include "libtmc3.h"
+#include "program_options_lite.h"
+#include "synthetic.h"
+#include "version.h"
+
+using namespace std;
+using namespace pcc;
+
+//============================================================================
+// An in-memory round trip through the codec library.
+//
+// Synthetic frames are passed to a StreamEncoder as component arrays.  The
+// coded payloads are TLV encapsulated in memory and decoded by a
+// StreamDecoder from views of that memory.  Each decoded frame must be
+// identical to the encoder's reconstruction.  Each decoded frame is then
+// copied to caller storage by copyFromCloudFrame(), which must agree with
+// scaleAttributesForOutput() followed by convertToGbr().
+//
+// Optionally, the geometry reported after each decoded octree level is
+// checked against a fresh decode that skips the same number of levels.
+//
+// The encoder is configured by the tmc3 options following "--".
+
+struct Options {
+  SyntheticProfile profile;
+  uint64_t seed;
+  int64_t numPoints;
+  int frameCount;
+
+  // check each reported octree level against a fresh partial decode
+  bool checkLevels;
+
+  // the tmc3 options used to configure the codec
+  std::vector<std::string> codecArgs;
+};
+
+bool parseParameters(int argc, char* argv[], Options& opts);
+
+// The number of threads used to copy each decoded frame to caller storage
+static const int kOutputThreads = 4;
+
+//============================================================================
+
+namespace pcc {
+
+static std::istream&
+operator>>(std::istream& in, SyntheticProfile& val)
+{
+  std::string word;
+  in >> word;
+  if (word == "dense")
+    val = SyntheticProfile::kDenseObject;
+  else if (word == "lidar")
+    val = SyntheticProfile::kLidarSweep;
+  else if (word == "sparse")
+    val = SyntheticProfile::kSparseScene;
+  else
+    throw std::exception();
+  return in;
+}
+
+//----------------------------------------------------------------------------
+
+static std::ostream&
+operator<<(std::ostream& out, const SyntheticProfile& val)
+{
+  switch (val) {
+  case SyntheticProfile::kDenseObject: out << "dense"; break;
+  case SyntheticProfile::kLidarSweep: out << "lidar"; break;
+  case SyntheticProfile::kSparseScene: out << "sparse"; break;
+  }
+  return out;
+}
+
+}  // namespace pcc
+
+//============================================================================
+// The caller's representation of a frame: separate component arrays
+
+struct ComponentArrays {
+  std::vector<double> position[3];
+  std::vector<attr_t> colour[3];
+  std::vector<attr_t> reflectance;
+
+  ComponentArrays(const PCCPointSet3& cloud, bool withColours, bool withRefl);
+
+  PointBufferView view(double positionScale) const;
+};
+
+//----------------------------------------------------------------------------
+
+ComponentArrays::ComponentArrays(
+  const PCCPointSet3& cloud, bool withColours, bool withReflectances)
+{
+  const size_t numPoints = cloud.getPointCount();
+  for (int k = 0; k < 3; k++) {
+    position[k].resize(numPoints);
+    for (size_t i = 0; i < numPoints; i++)
+      position[k][i] = cloud[i][k];
+  }
+
+  if (withColours) {
+    for (int k = 0; k < 3; k++) {
+      colour[k].resize(numPoints);
+      for (size_t i = 0; i < numPoints; i++)
+        colour[k][i] = cloud.getColor(i)[k];
+    }
+  }
+
+  if (withReflectances) {
+    reflectance.resize(numPoints);
+    for (size_t i = 0; i < numPoints; i++)
+      reflectance[i] = cloud.getReflectance(i);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+PointBufferView
+ComponentArrays::view(double positionScale) const
+{
+  PointBufferView view;
+  view.numPoints = position[0].size();
+  view.positionScale = positionScale;
+  for (int k = 0; k < 3; k++) {
+    view.position[k] = position[k].data();
+    view.colour[k] = colour[k].empty() ? nullptr : colour[k].data();
+  }
+  view.reflectance = reflectance.empty() ? nullptr : reflectance.data();
+  return view;
+}
+
+//============================================================================
+
+static bool
+samePoints(const PCCPointSet3& a, const PCCPointSet3& b)
+{
+  if (a.getPointCount() != b.getPointCount())
+    return false;
+  if (a.hasColors() != b.hasColors())
+    return false;
+  if (a.hasReflectances() != b.hasReflectances())
+    return false;
+
+  for (size_t i = 0; i < a.getPointCount(); i++) {
+    if (a[i] != b[i])
+      return false;
+    if (a.hasColors() && a.getColor(i) != b.getColor(i))
+      return false;
+    if (a.hasReflectances() && a.getReflectance(i) != b.getReflectance(i))
+      return false;
+  }
+
+  return true;
+}
+
+//============================================================================
+// The caller's storage for a decoded frame
+
+struct OutputArrays {
+  std::vector<float> positionXyz;
+  std::vector<int32_t> position[3];
+  std::vector<uint8_t> colourRgb8;
+  std::vector<attr_t> reflectance;
+
+  PointOutputBufferView view(const CloudFrame& frame, bool withColours);
+};
+
+//----------------------------------------------------------------------------
+
+PointOutputBufferView
+OutputArrays::view(const CloudFrame& frame, bool withColours)
+{
+  const size_t numPoints = frame.cloud.getPointCount();
+  PointOutputBufferView view;
+
+  positionXyz.resize(3 * numPoints);
+  view.positionXyz = positionXyz.data();
+  view.positionScale = 1. / (1 << frame.outputFpBits);
+
+  for (int k = 0; k < 3; k++) {
+    position[k].resize(numPoints);
+    view.position[k] = position[k].data();
+  }
+
+  if (withColours && frame.cloud.hasColors()) {
+    colourRgb8.resize(3 * numPoints);
+    view.colourRgb8 = colourRgb8.data();
+  }
+
+  if (frame.cloud.hasReflectances()) {
+    reflectance.resize(numPoints);
+    view.reflectance = reflectance.data();
+  }
+
+  return view;
+}
+
+//----------------------------------------------------------------------------
+// The bit depth of the frame's colour in the external representation
+
+static int
+colourBitdepth(const CloudFrame& frame)
+{
+  for (const auto& desc : frame.attrDesc) {
+    if (!(desc.attributeLabel == KnownAttributeLabel::kColour))
+      continue;
+
+    // NB: the YCgCoR bitdepth is the transformed bitdepth
+    auto colourMatrix = desc.params.cicp_matrix_coefficients_idx;
+    return desc.bitdepth - (colourMatrix == ColourMatrix::kYCgCo);
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+// Checks the output of copyFromCloudFrame() against the frame converted by
+// scaleAttributesForOutput() followed by convertToGbr().
+
+static bool
+sameOutput(
+  const CloudFrame& frame,
+  const PointOutputBufferView& view,
+  const OutputArrays& out)
+{
+  PCCPointSet3 cloud = frame.cloud;
+  scaleAttributesForOutput(frame.attrDesc, cloud);
+  convertToGbr(frame.attrDesc, cloud);
+
+  for (size_t i = 0; i < cloud.getPointCount(); i++) {
+    auto pos = toXyz(frame.geometry_axis_order, cloud[i]);
+    for (int k = 0; k < 3; k++) {
+      if (out.position[k][i] != pos[k])
+        return false;
+      if (out.positionXyz[3 * i + k] != float(pos[k] * view.positionScale))
+        return false;
+    }
+
+    if (view.colourRgb8) {
+      const auto& gbr = cloud.getColor(i);
+      const uint8_t* rgb = &out.colourRgb8[3 * i];
+      if (rgb[0] != gbr[2] || rgb[1] != gbr[0] || rgb[2] != gbr[1])
+        return false;
+    }
+
+    if (view.reflectance && out.reflectance[i] != cloud.getReflectance(i))
+      return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// The geometry reported for one octree level of a frame, merged over slices
+
+struct LevelPositions {
+  int numSlices = 0;
+  std::vector<point_t> positions;
+};
+
+//----------------------------------------------------------------------------
+// Decode @stream afresh, skipping the last @levelsRemaining octree levels,
+// and return the sorted positions of the final frame.
+
+static bool
+decodeLevel(
+  DecoderParams params,
+  int levelsRemaining,
+  const std::string& stream,
+  std::vector<point_t>* positions)
+{
+  params.minGeomNodeSizeLog2 = levelsRemaining;
+
+  StreamDecoder decoder(params, [&](const CloudFrame& frame) {
+    positions->resize(frame.cloud.getPointCount());
+    for (size_t i = 0; i < frame.cloud.getPointCount(); i++)
+      (*positions)[i] = frame.cloud[i];
+  });
+
+  const char* end = stream.data() + stream.size();
+  PayloadView payload;
+  for (const char* p = stream.data(); p && p < end;) {
+    p = parseTlv(p, end, &payload);
+    if (!p || decoder.decode(payload))
+      return false;
+  }
+  if (decoder.flush())
+    return false;
+
+  std::sort(positions->begin(), positions->end());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+static double
+msSince(std::chrono::steady_clock::time_point t0)
+{
+  std::chrono::duration<double, std::milli> elapsed =
+    std::chrono::steady_clock::now() - t0;
+  return elapsed.count();
+}
+
+//============================================================================
+
+int
+main(int argc, char* argv[])
+{
+  cout << "MPEG PCC libtmc3 in-memory round trip from Test Model C13" << endl;
+
+  Options opts;
+  if (!parseParameters(argc, argv, opts))
+    return 1;
+
+  // NB: the file paths required by tmc3 are not used
+  std::vector<std::string> codecArgs = {
+    argv[0], "--mode=0", "--uncompressedDataPath=-",
+    "--compressedStreamPath=-"};
+  codecArgs.insert(
+    codecArgs.end(), opts.codecArgs.begin(), opts.codecArgs.end());
+
+  std::vector<char*> codecArgv;
+  for (auto& arg : codecArgs)
+    codecArgv.push_back(&arg[0]);
+
+  Parameters params;
+  try {
+    if (!ParseParameters(int(codecArgv.size()), codecArgv.data(), params))
+      return 1;
+  }
+  catch (df::program_options_lite::ParseFailure& e) {
+    cerr << "Error parsing option \"" << e.arg << "\" with argument \""
+         << e.val << "\"." << endl;
+    return 1;
+  }
+
+  SyntheticParams synthParams = defaultSyntheticParams(opts.profile);
+  synthParams.seed = opts.seed;
+  if (opts.numPoints > 0)
+    synthParams.numPoints = opts.numPoints;
+  synthParams.precisionBits = std::max(
+    synthParams.precisionBits,
+    minSyntheticPrecisionBits(opts.profile, synthParams.numPoints));
+  SyntheticCloudGenerator generator(synthParams);
+
+  const bool withColours = params.encoder.attributeIdxMap.count("color");
+  const bool withReflectances =
+    params.encoder.attributeIdxMap.count("reflectance");
+
+  // Each payload is encapsulated as it would be for transmission
+  std::string tlvBytes;
+  StreamEncoder encoder(params.encoder, [&](const PayloadBuffer& buf) {
+    std::ostringstream os;
+    writeTlv(buf, os);
+    tlvBytes += os.str();
+  });
+
+  // The encoder reconstructions awaiting comparison with decoded frames
+  std::deque<PCCPointSet3> pending;
+  int numDecoded = 0;
+  int numMismatches = 0;
+
+  // Each decoded frame is also copied to caller storage
+  OutputArrays outArrays;
+  double outputMs = 0.;
+
+  StreamDecoder decoder(params.decoder, [&](const CloudFrame& frame) {
+    numDecoded++;
+    if (pending.empty() || !samePoints(frame.cloud, pending.front())) {
+      cerr << "Error: decoded frame " << numDecoded - 1
+           << " differs from the encoder reconstruction" << endl;
+      numMismatches++;
+    }
+    if (!pending.empty())
+      pending.pop_front();
+
+    // 8-bit colour output is not available for deeper colour
+    auto view = outArrays.view(frame, colourBitdepth(frame) <= 8);
+
+    auto t0 = std::chrono::steady_clock::now();
+    int err = copyFromCloudFrame(frame, view, kOutputThreads);
+    outputMs += msSince(t0);
+
+    if (err || !sameOutput(frame, view, outArrays)) {
+      cerr << "Error: the output copy of frame " << numDecoded - 1
+           << " differs from scaleAttributesForOutput + convertToGbr"
+           << endl;
+      numMismatches++;
+    }
+  });
+
+  // The geometry reported after each octree level of the current frame
+  std::map<int, LevelPositions> levels;
+  if (opts.checkLevels) {
+    decoder.setGeometryLevelCallback(
+      [&](int, int levelsRemaining, const PCCPointSet3& cloud) {
+        auto& level = levels[levelsRemaining];
+        level.numSlices++;
+        for (size_t i = 0; i < cloud.getPointCount(); i++)
+          level.positions.push_back(cloud[i]);
+      });
+  }
+
+  // The complete stream so far, for the fresh decodes of each level
+  std::string streamBytes;
+  int numLevelsChecked = 0;
+  int numLevelsSkipped = 0;
+
+  double totalCodec = 0., totalOverhead = 0.;
+  PCCPointSet3 scratch;
+
+  for (int frameIdx = 0; frameIdx < opts.frameCount; frameIdx++) {
+    PCCPointSet3 cloud;
+    generator.generate(frameIdx, &cloud);
+
+    if (withColours && !cloud.hasColors()) {
+      cerr << "Error: the " << opts.profile << " profile has no colour\n";
+      return 1;
+    }
+    if (withReflectances && !cloud.hasReflectances()) {
+      cerr << "Error: the " << opts.profile << " profile has no reflectance\n";
+      return 1;
+    }
+
+    // Attribute conversion as for ply input, then handed over as arrays
+    const auto& attrDescs = encoder.params().sps.attributeSets;
+    if (params.convertColourspace)
+      convertFromGbr(attrDescs, cloud);
+    scaleAttributesForInput(attrDescs, cloud);
+
+    ComponentArrays arrays(cloud, withColours, withReflectances);
+    PointBufferView view = arrays.view(params.inputScale);
+
+    // The cost of the conversion performed by encode(PointBufferView)
+    auto t0 = std::chrono::steady_clock::now();
+    copyToPointSet(view, &scratch);
+    double inputMs = msSince(t0);
+
+    CloudFrame recon;
+    tlvBytes.clear();
+    t0 = std::chrono::steady_clock::now();
+    if (encoder.encode(view, &recon)) {
+      cerr << "Error: can't compress frame " << frameIdx << endl;
+      return 1;
+    }
+    double encodeMs = msSince(t0);
+    pending.push_back(recon.cloud);
+
+    // Decode from views of the encapsulated payloads
+    const char* end = tlvBytes.data() + tlvBytes.size();
+    PayloadView payload;
+    int numSlices = 0;
+    levels.clear();
+    outputMs = 0.;
+    t0 = std::chrono::steady_clock::now();
+    for (const char* p = tlvBytes.data(); p && p < end;) {
+      p = parseTlv(p, end, &payload);
+      if (!p || decoder.decode(payload)) {
+        cerr << "Error: can't decompress frame " << frameIdx << endl;
+        return 1;
+      }
+      numSlices += payload.type == PayloadType::kGeometryBrick;
+    }
+    double decodeMs = msSince(t0) - outputMs;
+    double overheadMs = inputMs + outputMs;
+
+    // Each reported level must match a decode that stops at that level.
+    // A level deeper than the octree of some slice is not reported for
+    // that slice (see GeometryLevelFn), and is not comparable.
+    streamBytes += tlvBytes;
+    for (auto& entry : levels) {
+      auto& level = entry.second;
+      if (level.numSlices != numSlices) {
+        numLevelsSkipped++;
+        continue;
+      }
+
+      std::vector<point_t> expected;
+      if (!decodeLevel(params.decoder, entry.first, streamBytes, &expected)) {
+        cerr << "Error: can't decompress frame " << frameIdx
+             << " with minGeomNodeSizeLog2=" << entry.first << endl;
+        return 1;
+      }
+
+      std::sort(level.positions.begin(), level.positions.end());
+      if (level.positions != expected) {
+        cerr << "Error: frame " << frameIdx << " level "
+             << entry.first << " differs from a decode with "
+             << "minGeomNodeSizeLog2=" << entry.first << endl;
+        numMismatches++;
+      }
+      numLevelsChecked++;
+    }
+
+    totalCodec += encodeMs + decodeMs;
+    totalOverhead += overheadMs;
+
+    cout << "frame " << frameIdx << ": " << cloud.getPointCount()
+         << " points, " << tlvBytes.size() << " B, encode " << fixed
+         << setprecision(2) << encodeMs << " ms, decode " << decodeMs
+         << " ms, api overhead " << overheadMs << " ms ("
+         << 100. * overheadMs / (encodeMs + decodeMs) << "%)" << defaultfloat
+         << endl;
+  }
+
+  outputMs = 0.;
+  if (decoder.flush()) {
+    cerr << "Error: can't flush decoder" << endl;
+    return 1;
+  }
+  totalOverhead += outputMs;
+
+  if (numDecoded != opts.frameCount) {
+    cerr << "Error: decoded " << numDecoded << " of " << opts.frameCount
+         << " frames" << endl;
+    return 1;
+  }
+
+  cout << "round trip of " << opts.frameCount << " frames: "
+       << (numMismatches ? "MISMATCH" : "identical") << ", mean api overhead "
+       << fixed << setprecision(2) << totalOverhead / opts.frameCount
+       << " ms per frame (" << 100. * totalOverhead / totalCodec << "%)"
+       << defaultfloat << endl;
+
+  if (opts.checkLevels)
+    cout << "octree levels: " << numLevelsChecked << " checked, "
+         << numLevelsSkipped << " not comparable" << endl;
+
+  return numMismatches ? 1 : 0;
+}
+
+//---------------------------------------------------------------------------
+// :: Command line / config parsing
+
+bool
+parseParameters(int argc, char* argv[], Options& params)
+{
+  namespace po = df::program_options_lite;
+  bool print_help = false;
+
+  /* clang-format off */
+  // The definition of the program/config options, along with default values.
+  //
+  // NB: when updating the following tables:
+  //      (a) please keep to 80-columns for easier reading at a glance,
+  //      (b) do not vertically align values -- it breaks quickly
+  //
+  po::Options opts;
+  opts.addOptions()
+  ("help", print_help, false,
+    "this help text.  Options following \"--\" configure the codec as\n"
+    "per tmc3 (eg, -- --attribute=color)")
+
+  ("profile", params.profile, SyntheticProfile::kDenseObject,
+    "The type of content to generate: dense, lidar or sparse")
+
+  ("seed",
+    params.seed, uint64_t(1),
+    "Seed from which the sequence is derived")
+
+  ("numPoints",
+    params.numPoints, int64_t(100000),
+    "Approximate number of points per frame (0 = profile default)")
+
+  ("frameCount",
+    params.frameCount, 4,
+    "Number of frames to encode and decode")
+
+  ("checkLevels",
+    params.checkLevels, false,
+    "Check the geometry reported after each octree level against a fresh\n"
+    "decode with minGeomNodeSizeLog2 set to that level")
+  ;
+  /* clang-format on */
+
+  po::setDefaults(opts);
+  po::ErrorReporter err;
+  const list<const char*>& argv_unhandled =
+    po::scanArgv(opts, argc, (const char**)argv, err);
+
+  // everything after "--" is passed to the tmc3 option parser
+  params.codecArgs.assign(argv_unhandled.begin(), argv_unhandled.end());
+
+  if (print_help) {
+    po::doHelp(std::cout, opts, 78);
+    return false;
+  }
+
+  if (params.frameCount < 1)
+    err.error() << "frameCount must be at least 1\n";
+
+  po::dumpCfg(cout, opts, 4);
+
+  return !err.is_errored;
+}
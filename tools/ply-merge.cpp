@@ -33,8 +33,11 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <climits>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <exception>
+#include <thread>
 
 #include "PCCMisc.h"
 #include "PCCPointSet.h"
@@ -82,6 +85,9 @@ struct Options {
 
   // number of src frames per merged output frame
   int groupSize;
+
+  // maximum number of frames to read or write concurrently
+  int numThreads;
 };
 
 //============================================================================
@@ -190,6 +196,11 @@ parseParameters(int argc, char* argv[], Options& params)
   ("groupSize",
     params.groupSize, 8,
     "Number of source ply files per combined output (merge mode only)")
+
+  ("numThreads",
+    params.numThreads, 0,
+    "Number of frames to read (merge) or write (split) concurrently.\n"
+    "  0: use the number of hardware threads")
   ;
   /* clang-format on */
 
@@ -207,88 +218,169 @@ parseParameters(int argc, char* argv[], Options& params)
     return false;
   }
 
+  if (params.numThreads <= 0)
+    params.numThreads = std::max(1u, std::thread::hardware_concurrency());
+
   po::dumpCfg(cout, opts, 4);
 
   return !err.is_errored;
 }
 
+//---------------------------------------------------------------------------
+// Run fn(i) for each i in [0, count), with up to numThreads workers taking
+// items in order.  Any exception raised by fn is rethrown by the caller.
+
+template<typename Fn>
+static void
+parallelFor(int numThreads, int count, Fn fn)
+{
+  std::atomic<int> nextItem{0};
+  std::vector<std::exception_ptr> errors(count);
+
+  auto worker = [&]() {
+    for (int i; (i = nextItem++) < count;) {
+      try {
+        fn(i);
+      }
+      catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < std::min(numThreads, count); t++)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads)
+    thread.join();
+
+  for (const auto& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+}
+
+//---------------------------------------------------------------------------
+
+static void
+readFrame(const string& srcName, PCCPointSet3& cloud)
+{
+  ply::PropertyNameMap propNames;
+  propNames.position = {"x", "y", "z"};
+
+  if (!ply::read(srcName, propNames, 1.0, cloud) || cloud.getPointCount() == 0)
+    throw runtime_error("failed to read input file: " + srcName);
+}
+
+//---------------------------------------------------------------------------
+
+static void
+writeFrame(
+  const Options& opts, const string& outName, const PCCPointSet3& cloud)
+{
+  ply::PropertyNameMap propNames;
+  propNames.position = {"x", "y", "z"};
+
+  if (!ply::write(cloud, propNames, 1, 0, outName, !opts.outputBinaryPly))
+    throw runtime_error("failed to write output file: " + outName);
+}
+
 //---------------------------------------------------------------------------
 // Read a series of frames, write a single merged frame.
 //
+// The source frames of each group are read concurrently.  Writing of each
+// merged frame overlaps with reading the next group.
 
 void
 runMerge(const Options& opts)
 {
-  ply::PropertyNameMap propNames;
-  propNames.position = {"x", "y", "z"};
+  // the merged frame being written, and any error arising from doing so
+  PCCPointSet3 pendingCloud;
+  std::exception_ptr writeError;
+  std::thread writer;
+  string pendingName;
+
+  auto finishWrite = [&]() {
+    if (!writer.joinable())
+      return;
+    writer.join();
+    if (writeError)
+      std::rethrow_exception(writeError);
+    cout << pendingName << endl;
+  };
 
   // iterate over all input frames in groups
   int outFrameNum = opts.firstOutputFrameNum;
-  for (int i = 0; i < opts.frameCount; outFrameNum++) {
-    vector<PCCPointSet3> srcClouds;
-    srcClouds.reserve(opts.groupSize);
-
-    // read source frames
-    for (int j = 0; j < opts.groupSize && i < opts.frameCount; j++, i++) {
-      int frameNum = opts.firstFrameNum + i;
-      string srcName{expandNum(opts.srcPath, frameNum)};
-
-      srcClouds.emplace_back();
-      auto& srcCloud = srcClouds.back();
-      if (
-        !ply::read(srcName, propNames, 1.0, srcCloud)
-        || srcCloud.getPointCount() == 0) {
-        throw runtime_error("failed to read input file: " + srcName);
-      }
-    }
+  try {
+    for (int i = 0; i < opts.frameCount; outFrameNum++) {
+      int groupSize = std::min(opts.groupSize, opts.frameCount - i);
+      vector<PCCPointSet3> srcClouds(groupSize);
+
+      // read source frames
+      parallelFor(opts.numThreads, groupSize, [&](int j) {
+        int frameNum = opts.firstFrameNum + i + j;
+        readFrame(expandNum(opts.srcPath, frameNum), srcClouds[j]);
+      });
+      i += groupSize;
+
+      size_t totalPoints = 0;
+      for (const auto& cloud : srcClouds)
+        totalPoints += cloud.getPointCount();
+
+      // merge sources, setting the frameIndex of each point in the merged
+      // cloud to the group index of the corresponding source frame.
+      PCCPointSet3 outCloud;
+      outCloud.addFrameIndex();
+      if (srcClouds[0].hasColors())
+        outCloud.addColors();
+      if (srcClouds[0].hasReflectances())
+        outCloud.addReflectances();
+      outCloud.reserve(totalPoints);
+
+      for (int j = 0; j < srcClouds.size(); j++) {
+        size_t frameStart = outCloud.getPointCount();
+        outCloud.append(srcClouds[j], false);
 
-    int totalPoints = 0;
-    for (const auto& cloud : srcClouds)
-      totalPoints += cloud.getPointCount();
-
-    // merge sources, setting the frameIndex of each point in the merged
-    // cloud to the group index of the corresponding source frame.
-    PCCPointSet3 outCloud;
-    outCloud.addFrameIndex();
-    if (srcClouds[0].hasColors())
-      outCloud.addColors();
-    if (srcClouds[0].hasReflectances())
-      outCloud.addReflectances();
-    outCloud.resize(totalPoints);
-
-    int outPtIdx = 0;
-    for (int j = 0; j < srcClouds.size(); j++) {
-      const auto& cloud = srcClouds[j];
-
-      for (int ptIdx = 0; ptIdx < cloud.getPointCount(); ptIdx++, outPtIdx++) {
-        outCloud[outPtIdx] = cloud[ptIdx];
-        outCloud.setFrameIndex(outPtIdx, j);
-
-        if (cloud.hasColors())
-          outCloud.setColor(outPtIdx, cloud.getColor(ptIdx));
-
-        if (cloud.hasReflectances())
-          outCloud.setReflectance(outPtIdx, cloud.getReflectance(ptIdx));
+        size_t frameEnd = outCloud.getPointCount();
+        for (size_t outPtIdx = frameStart; outPtIdx < frameEnd; outPtIdx++)
+          outCloud.setFrameIndex(outPtIdx, j);
+
+        // release each source as soon as it is no longer required
+        PCCPointSet3().swap(srcClouds[j]);
       }
-    }
 
-    string outName{expandNum(opts.outPath, outFrameNum)};
-    if (!ply::write(outCloud, propNames, 1, 0, outName, !opts.outputBinaryPly))
-      throw runtime_error("failed to write output file: " + outName);
-    cout << outName << endl;
+      finishWrite();
+      pendingCloud.swap(outCloud);
+      pendingName = expandNum(opts.outPath, outFrameNum);
+      writer = std::thread([&]() {
+        try {
+          writeFrame(opts, pendingName, pendingCloud);
+        }
+        catch (...) {
+          writeError = std::current_exception();
+        }
+      });
+    }
   }
+  catch (...) {
+    // the writer must not outlive the frame being written
+    if (writer.joinable())
+      writer.join();
+    throw;
+  }
+
+  finishWrite();
 }
 
 //---------------------------------------------------------------------------
 // Read a merged frame, write out each component frame.
 //
+// The points of each merged frame are bucketed by frame index in a single
+// pass, and the component frames are then written concurrently.
 
 void
 runSplit(const Options& opts)
 {
-  ply::PropertyNameMap propNames;
-  propNames.position = {"x", "y", "z"};
-
   int outFrameNum = opts.firstOutputFrameNum;
   int srcFrameNum = opts.firstFrameNum;
 
@@ -296,59 +388,49 @@ runSplit(const Options& opts)
     string srcName{expandNum(opts.srcPath, srcFrameNum)};
 
     PCCPointSet3 srcCloud;
-    if (
-      !ply::read(srcName, propNames, 1.0, srcCloud)
-      || srcCloud.getPointCount() == 0) {
-      throw runtime_error("failed to read input file: " + srcName);
-    }
+    readFrame(srcName, srcCloud);
 
     int numSrcPoints = srcCloud.getPointCount();
 
     if (!srcCloud.hasFrameIndex())
       throw runtime_error("missing frameindex property: " + srcName);
 
-    // Extract each frame based on the frame index (assumed to start at 0)
-    int frameIdx = 0;
-    do {
-      PCCPointSet3 outCloud;
-      if (srcCloud.hasColors())
-        outCloud.addColors();
-      if (srcCloud.hasReflectances())
-        outCloud.addReflectances();
-      outCloud.resize(srcCloud.getPointCount());
+    // Bucket the points of each frame by frame index, preserving order
+    std::array<int, 256> frameSizes{};
+    for (int ptIdx = 0; ptIdx < numSrcPoints; ptIdx++)
+      frameSizes[srcCloud.getFrameIndex(ptIdx)]++;
+
+    std::array<vector<int32_t>, 256> framePoints;
+    for (int frameIdx = 0; frameIdx < 256; frameIdx++)
+      framePoints[frameIdx].reserve(frameSizes[frameIdx]);
 
-      int nextFrameIdx = INT_MAX;
-      int outPtIdx = 0;
-      for (int ptIdx = 0; ptIdx < numSrcPoints; ptIdx++) {
-        int ptFrameIdx = srcCloud.getFrameIndex(ptIdx);
-        if (ptFrameIdx > frameIdx)
-          nextFrameIdx = min(ptFrameIdx, nextFrameIdx);
+    for (int ptIdx = 0; ptIdx < numSrcPoints; ptIdx++)
+      framePoints[srcCloud.getFrameIndex(ptIdx)].push_back(ptIdx);
 
-        if (ptFrameIdx != frameIdx)
-          continue;
+    // Each frame index is extracted (assumed to start at 0), frame zero
+    // being reported even if empty.
+    vector<int> frameIdxs;
+    for (int frameIdx = 0; frameIdx < 256; frameIdx++)
+      if (!frameIdx || frameSizes[frameIdx])
+        frameIdxs.push_back(frameIdx);
 
-        outCloud[outPtIdx] = srcCloud[ptIdx];
+    parallelFor(opts.numThreads, frameIdxs.size(), [&](int j) {
+      int frameIdx = frameIdxs[j];
+      if (!frameSizes[frameIdx])
+        return;
 
-        if (srcCloud.hasColors())
-          outCloud.setColor(outPtIdx, srcCloud.getColor(ptIdx));
+      PCCPointSet3 outCloud;
+      outCloud.addRemoveAttributes(
+        srcCloud.hasColors(), srcCloud.hasReflectances());
+      outCloud.appendPartition(srcCloud, framePoints[frameIdx], false);
 
-        if (srcCloud.hasReflectances())
-          outCloud.setReflectance(outPtIdx, srcCloud.getReflectance(ptIdx));
+      string outName{expandNum(opts.outPath, outFrameNum + frameIdx)};
+      writeFrame(opts, outName, outCloud);
+    });
 
-        outPtIdx++;
-      }
-      outCloud.resize(outPtIdx);
-
-      string outName{expandNum(opts.outPath, outFrameNum)};
-      if (outCloud.getPointCount() > 0)
-        if (!ply::write(
-              outCloud, propNames, 1, 0, outName, !opts.outputBinaryPly))
-          throw runtime_error("failed to write output file: " + outName);
-      cout << outName << endl;
-
-      if (nextFrameIdx != INT_MAX)
-        outFrameNum += nextFrameIdx - frameIdx;
-      frameIdx = nextFrameIdx;
-    } while (frameIdx != INT_MAX);
+    for (int frameIdx : frameIdxs)
+      cout << expandNum(opts.outPath, outFrameNum + frameIdx) << endl;
+
+    outFrameNum += frameIdxs.back();
   }
 }
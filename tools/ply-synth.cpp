@@ -0,0 +1,285 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <vector>
+
+#include "PCCMisc.h"
+#include "PCCPointSet.h"
+#include "ply.h"
+#include "program_options_lite.h"
+#include "synthetic.h"
+#include "version.h"
+
+using namespace std;
+using namespace pcc;
+
+//============================================================================
+
+struct Options {
+  // generator parameters, values of zero (or empty) select the profile
+  // default.  A negative deformation selects the profile default.
+  SyntheticProfile profile;
+  uint64_t seed;
+  int64_t numPoints;
+  int precisionBits;
+  double rotationPerFrame;
+  std::vector<double> translationPerFrame;
+  double deformation;
+  int numLasers;
+
+  // output mode for ply writing (binary or ascii)
+  bool outputBinaryPly;
+
+  // path (using %d to indicate frame number) of output files.
+  // If empty, frames are generated but not written.
+  std::string outPath;
+
+  // number of frames to generate
+  int frameCount;
+
+  // first frame number in the sequence
+  int firstFrameNum;
+};
+
+bool parseParameters(int argc, char* argv[], Options& opts);
+
+//============================================================================
+
+namespace pcc {
+
+static std::istream&
+operator>>(std::istream& in, SyntheticProfile& val)
+{
+  std::string word;
+  in >> word;
+  if (word == "dense")
+    val = SyntheticProfile::kDenseObject;
+  else if (word == "lidar")
+    val = SyntheticProfile::kLidarSweep;
+  else if (word == "sparse")
+    val = SyntheticProfile::kSparseScene;
+  else
+    throw std::exception();
+  return in;
+}
+
+//----------------------------------------------------------------------------
+
+static std::ostream&
+operator<<(std::ostream& out, const SyntheticProfile& val)
+{
+  switch (val) {
+  case SyntheticProfile::kDenseObject: out << "dense"; break;
+  case SyntheticProfile::kLidarSweep: out << "lidar"; break;
+  case SyntheticProfile::kSparseScene: out << "sparse"; break;
+  }
+  return out;
+}
+
+}  // namespace pcc
+
+//============================================================================
+
+int
+main(int argc, char* argv[])
+{
+  cout << "MPEG PCC synthetic point cloud generator from Test Model C13"
+       << endl;
+
+  Options opts;
+  if (!parseParameters(argc, argv, opts)) {
+    return 1;
+  }
+
+  SyntheticParams params = defaultSyntheticParams(opts.profile);
+  params.seed = opts.seed;
+  params.rotationPerFrame = opts.rotationPerFrame;
+  if (opts.numPoints > 0)
+    params.numPoints = opts.numPoints;
+
+  // The default precision is raised if too small for numPoints
+  const int minPrecisionBits =
+    minSyntheticPrecisionBits(params.profile, params.numPoints);
+  if (opts.precisionBits > 0)
+    params.precisionBits = opts.precisionBits;
+  else
+    params.precisionBits = std::max(params.precisionBits, minPrecisionBits);
+
+  if (opts.translationPerFrame.size() == 3)
+    params.translationPerFrame = {opts.translationPerFrame[0],
+                                  opts.translationPerFrame[1],
+                                  opts.translationPerFrame[2]};
+  if (opts.deformation >= 0)
+    params.deformation = opts.deformation;
+  if (opts.numLasers > 0)
+    params.numLasers = opts.numLasers;
+
+  try {
+    ply::PropertyNameMap propNames;
+    propNames.position = {"x", "y", "z"};
+
+    SyntheticCloudGenerator generator(params);
+    PCCPointSet3 cloud;
+
+    if (generator.params().precisionBits < minPrecisionBits)
+      cerr << "Warning: fewer than " << params.numPoints
+           << " points fit at precisionBits="
+           << generator.params().precisionBits << " (at least "
+           << minPrecisionBits << " are required)" << endl;
+
+    for (int i = 0; i < opts.frameCount; i++) {
+      int frameNum = opts.firstFrameNum + i;
+
+      auto start = std::chrono::steady_clock::now();
+      generator.generate(frameNum, &cloud);
+      auto end = std::chrono::steady_clock::now();
+      std::chrono::duration<double> elapsed = end - start;
+
+      cout << "frame " << frameNum << ": " << cloud.getPointCount()
+           << " points, " << elapsed.count() << " s";
+
+      if (!opts.outPath.empty()) {
+        string outName{expandNum(opts.outPath, frameNum)};
+        if (!ply::write(cloud, propNames, 1, 0, outName, !opts.outputBinaryPly))
+          throw runtime_error("failed to write output file: " + outName);
+        cout << ", " << outName;
+      }
+      cout << endl;
+    }
+  }
+  catch (const exception& e) {
+    cerr << "Error:" << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+// :: Command line / config parsing
+
+bool
+parseParameters(int argc, char* argv[], Options& params)
+{
+  namespace po = df::program_options_lite;
+  bool print_help = false;
+
+  /* clang-format off */
+  // The definition of the program/config options, along with default values.
+  //
+  // NB: when updating the following tables:
+  //      (a) please keep to 80-columns for easier reading at a glance,
+  //      (b) do not vertically align values -- it breaks quickly
+  //
+  po::Options opts;
+  opts.addOptions()
+  ("help", print_help, false, "this help text")
+  ("config,c", po::parseConfigFile, "configuration file name")
+
+  ("profile", params.profile, SyntheticProfile::kDenseObject,
+    "The type of content to generate:\n"
+    "  dense:  coloured object surfaces\n"
+    "  lidar:  spinning lidar sweeps with reflectance and laser index\n"
+    "  sparse: sparse outdoor scene with colour and reflectance")
+
+  ("seed",
+    params.seed, uint64_t(1),
+    "Seed from which the sequence is derived")
+
+  ("numPoints",
+    params.numPoints, int64_t(0),
+    "Approximate number of points per frame (0 = profile default)")
+
+  ("precisionBits",
+    params.precisionBits, 0,
+    "Geometry bit depth of generated frames (0 = profile default)")
+
+  ("rotationPerFrame",
+    params.rotationPerFrame, 0.,
+    "Rigid rotation about the vertical axis per frame (degrees)")
+
+  ("translationPerFrame",
+    params.translationPerFrame, {},
+    "Rigid translation per frame (grid units), as x y z")
+
+  ("deformation",
+    params.deformation, -1.,
+    "Non-rigid motion amplitude (relative to the object size), or lidar\n"
+    "vehicle speed (metres per frame).  Negative = profile default")
+
+  ("numLasers",
+    params.numLasers, 0,
+    "Number of lasers (lidar only, 0 = profile default)")
+
+  ("outPath",
+    params.outPath, {},
+    "Output pointcloud file path (using %d to indicate frame number)")
+
+  ("outputBinaryPly",
+    params.outputBinaryPly, false,
+    "Output ply files using binary (or otherwise ascii) format")
+
+  ("firstFrameNum",
+    params.firstFrameNum, 0,
+    "Number of first frame of the sequence (used in %d interpolation)")
+
+  ("frameCount",
+    params.frameCount, 1,
+    "Number of frames to generate")
+  ;
+  /* clang-format on */
+
+  po::setDefaults(opts);
+  po::ErrorReporter err;
+  const list<const char*>& argv_unhandled =
+    po::scanArgv(opts, argc, (const char**)argv, err);
+
+  for (const auto arg : argv_unhandled) {
+    err.warn() << "Unhandled argument ignored: " << arg << "\n";
+  }
+
+  if (argc == 1 || print_help) {
+    po::doHelp(std::cout, opts, 78);
+    return false;
+  }
+
+  po::dumpCfg(cout, opts, 4);
+
+  return !err.is_errored;
+}
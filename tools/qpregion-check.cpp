@@ -0,0 +1,306 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "PCCMath.h"
+#include "program_options_lite.h"
+#include "quantization.h"
+
+using namespace std;
+using namespace pcc;
+
+//============================================================================
+// A randomised check of QpRegionIndex.
+//
+// Each trial builds a random list of regions, then compares
+// QpRegionIndex::find() with a linear search of the list for points on
+// and either side of every region boundary, and for random points.  The
+// layouts include overlapping regions, empty regions (min > max) and
+// boundaries at the extremes of the int32 range.  The number of regions
+// is varied to exercise both the direct search and the grid.
+
+struct Options {
+  // the number of random layouts to check
+  int trials;
+
+  // the maximum number of regions in a layout
+  int maxRegions;
+
+  uint64_t seed;
+};
+
+bool parseParameters(int argc, char* argv[], Options& opts);
+
+//============================================================================
+// Deterministic pseudo-random numbers (splitmix64)
+
+class Rng {
+public:
+  Rng(uint64_t seed) : _state(seed) {}
+
+  uint64_t next()
+  {
+    uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  // a value in [0, n)
+  int uniform(int n) { return int(next() % uint64_t(n)); }
+
+private:
+  uint64_t _state;
+};
+
+//============================================================================
+
+static const int32_t kMin = std::numeric_limits<int32_t>::min();
+static const int32_t kMax = std::numeric_limits<int32_t>::max();
+
+//----------------------------------------------------------------------------
+// A random coordinate: mostly small values so that regions overlap, with
+// some at or near the extremes of the int32 range.
+
+static int32_t
+randomCoord(Rng& rng)
+{
+  static const int32_t kExtremes[] = {kMin, kMin + 1, kMax - 1, kMax};
+
+  switch (rng.uniform(8)) {
+  case 0: return kExtremes[rng.uniform(4)];
+  case 1: return int32_t(rng.next());
+  default: return rng.uniform(129) - 64;
+  }
+}
+
+//----------------------------------------------------------------------------
+
+static QpRegionList
+randomRegions(Rng& rng, int numRegions)
+{
+  QpRegionList regions(numRegions);
+  for (auto& region : regions) {
+    region.qpOffset = {rng.uniform(25) - 12, rng.uniform(25) - 12};
+    for (int k = 0; k < 3; k++) {
+      int32_t a = randomCoord(rng);
+      int32_t b = randomCoord(rng);
+      region.region.min[k] = std::min(a, b);
+      region.region.max[k] = std::max(a, b);
+    }
+
+    // an empty region along one axis
+    if (!rng.uniform(8)) {
+      int k = rng.uniform(3);
+      std::swap(region.region.min[k], region.region.max[k]);
+      if (region.region.min[k] == region.region.max[k])
+        region.region.max[k] = region.region.min[k] == kMin
+          ? kMax
+          : region.region.min[k] - 1;
+    }
+  }
+  return regions;
+}
+
+//----------------------------------------------------------------------------
+// The reference: the first region that contains the point
+
+static int
+linearFind(const QpRegionList& regions, const Vec3<int32_t>& point)
+{
+  for (int r = 0; r < int(regions.size()); r++)
+    if (regions[r].region.contains(point))
+      return r;
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+// Coordinates on and either side of each region boundary along an axis
+
+static std::vector<int32_t>
+boundaryCoords(const QpRegionList& regions, int k)
+{
+  std::vector<int32_t> coords = {kMin, kMin + 1, 0, kMax - 1, kMax};
+  for (const auto& region : regions) {
+    for (int64_t x : {region.region.min[k], region.region.max[k]})
+      for (int64_t dx = -1; dx <= 1; dx++)
+        if (x + dx >= kMin && x + dx <= kMax)
+          coords.push_back(int32_t(x + dx));
+  }
+  std::sort(coords.begin(), coords.end());
+  coords.erase(std::unique(coords.begin(), coords.end()), coords.end());
+  return coords;
+}
+
+//============================================================================
+
+int
+main(int argc, char* argv[])
+{
+  cout << "MPEG PCC qp region index check from Test Model C13" << endl;
+
+  Options opts;
+  if (!parseParameters(argc, argv, opts))
+    return 1;
+
+  // Points on boundaries are sampled when there are too many to test all
+  const int64_t kMaxBoundaryPoints = 1 << 18;
+  const int kRandomPoints = 1 << 12;
+
+  Rng rng(opts.seed);
+  int64_t numPoints = 0;
+  int numFailed = 0;
+
+  for (int trial = 0; trial < opts.trials; trial++) {
+    int numRegions = rng.uniform(opts.maxRegions + 1);
+    QpRegionList regions = randomRegions(rng, numRegions);
+    QpRegionIndex index(regions);
+
+    std::vector<Vec3<int32_t>> points;
+    std::vector<int32_t> coords[3];
+    int64_t numBoundaryPoints = 1;
+    for (int k = 0; k < 3; k++) {
+      coords[k] = boundaryCoords(regions, k);
+      numBoundaryPoints *= coords[k].size();
+    }
+
+    if (numBoundaryPoints <= kMaxBoundaryPoints) {
+      for (auto x : coords[0])
+        for (auto y : coords[1])
+          for (auto z : coords[2])
+            points.push_back({x, y, z});
+    } else {
+      for (int64_t i = 0; i < kMaxBoundaryPoints; i++) {
+        Vec3<int32_t> pt;
+        for (int k = 0; k < 3; k++)
+          pt[k] = coords[k][rng.uniform(int(coords[k].size()))];
+        points.push_back(pt);
+      }
+    }
+
+    for (int i = 0; i < kRandomPoints; i++)
+      points.push_back(
+        {randomCoord(rng), randomCoord(rng), randomCoord(rng)});
+
+    int mismatches = 0;
+    for (const auto& pt : points) {
+      int expected = linearFind(regions, pt);
+      int actual = index.find(pt);
+      if (actual == expected)
+        continue;
+      if (!mismatches++)
+        cerr << "Error: trial " << trial << " (" << numRegions
+             << " regions): find(" << pt << ") = " << actual
+             << ", expected " << expected << endl;
+    }
+
+    numPoints += points.size();
+    numFailed += !!mismatches;
+  }
+
+  cout << opts.trials << " layouts, " << numPoints << " points: ";
+  if (numFailed) {
+    cout << numFailed << " layouts differ from the linear search" << endl;
+    return 1;
+  }
+
+  cout << "all match the linear search" << endl;
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+// :: Command line / config parsing
+
+bool
+parseParameters(int argc, char* argv[], Options& params)
+{
+  namespace po = df::program_options_lite;
+  bool print_help = false;
+
+  /* clang-format off */
+  // The definition of the program/config options, along with default values.
+  //
+  // NB: when updating the following tables:
+  //      (a) please keep to 80-columns for easier reading at a glance,
+  //      (b) do not vertically align values -- it breaks quickly
+  //
+  po::Options opts;
+  opts.addOptions()
+  ("help", print_help, false, "this help text")
+
+  ("trials",
+    params.trials, 500,
+    "Number of random region layouts to check")
+
+  ("maxRegions",
+    params.maxRegions, 40,
+    "Maximum number of regions in a layout")
+
+  ("seed",
+    params.seed, uint64_t(1),
+    "Seed from which the layouts are derived")
+  ;
+  /* clang-format on */
+
+  po::setDefaults(opts);
+  po::ErrorReporter err;
+  const list<const char*>& argv_unhandled =
+    po::scanArgv(opts, argc, (const char**)argv, err);
+
+  for (const auto arg : argv_unhandled) {
+    err.warn() << "Unhandled argument ignored: " << arg << "\n";
+  }
+
+  if (print_help) {
+    po::doHelp(std::cout, opts, 78);
+    return false;
+  }
+
+  if (params.trials < 1)
+    err.error() << "trials must be at least 1\n";
+
+  if (params.maxRegions < 0)
+    err.error() << "maxRegions must not be negative\n";
+
+  po::dumpCfg(cout, opts, 4);
+
+  return !err.is_errored;
+}
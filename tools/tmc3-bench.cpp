@@ -0,0 +1,2608 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2017-2018, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AttributeCommon.h"
+#include "AttributeResiduals.h"
+#include "ModeCoder.h"
+#include "OctreeNeighMap.h"
+#include "PCCMisc.h"
+#include "PCCPointSet.h"
+#include "RAHT.h"
+#include "TMC3Options.h"
+#include "attribute_conversion.h"
+#include "colourspace.h"
+#include "entropy.h"
+#include "geometry_octree.h"
+#include "geometry_trisoup.h"
+#include "io_tlv.h"
+#include "io_tlv_reader.h"
+#include "libtmc3.h"
+#include "motionWip.h"
+#include "partitioning.h"
+#include "ply.h"
+#include "program_options_lite.h"
+#include "quantization.h"
+#include "synthetic.h"
+#include "version.h"
+
+using namespace std;
+using namespace pcc;
+
+//============================================================================
+// Microbenchmarks of the codec kernels.
+//
+// Each benchmark prepares its inputs from a deterministic synthetic point
+// cloud, then times a fixed number of iterations of a single kernel after
+// a fixed number of warmup iterations.  Only the kernel is timed: the
+// restoration of inputs that a kernel modifies is excluded.
+
+struct Options {
+  // comma separated list of name substrings selecting the benchmarks
+  std::string filter;
+
+  // list the benchmarks without running them
+  bool list;
+
+  // number of untimed and timed iterations of each benchmark
+  int warmup;
+  int iterations;
+
+  // synthetic source parameters
+  int64_t numPoints;
+  uint64_t seed;
+
+  // the maximum number of motion search blocks per iteration
+  int motionBlocks;
+
+  // scratch file used by the ply benchmarks
+  std::string tmpPath;
+
+  // a bitstream to use in place of the synthetic tlv stream
+  std::string bitstreamPath;
+};
+
+bool parseParameters(int argc, char* argv[], Options& opts);
+
+//============================================================================
+// Accumulates the time of the measured part of an iteration
+
+class BenchTimer {
+public:
+  void start() { _t0 = clock::now(); }
+  void stop() { _elapsed += clock::now() - _t0; }
+
+  void reset() { _elapsed = clock::duration::zero(); }
+
+  double ns() const
+  {
+    return std::chrono::duration<double, std::nano>(_elapsed).count();
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+  clock::time_point _t0;
+  clock::duration _elapsed = clock::duration::zero();
+};
+
+//----------------------------------------------------------------------------
+// A single iteration of a benchmark, returning the number of items processed
+
+using Kernel = std::function<int64_t(BenchTimer&)>;
+
+struct Fixtures;
+
+struct Benchmark {
+  std::string name;
+  const char* unit;
+
+  // Prepares the inputs (untimed) and returns the kernel
+  std::function<Kernel(Fixtures&)> setup;
+};
+
+// Results are accumulated here so that kernel outputs are not optimised away
+static volatile int64_t g_sink;
+
+//============================================================================
+// Deterministic pseudo-random numbers (splitmix64)
+
+class Rng {
+public:
+  Rng(uint64_t seed) : _state(seed) {}
+
+  uint64_t next()
+  {
+    uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  // a value in [0, n)
+  int uniform(int n) { return int(next() % uint64_t(n)); }
+
+private:
+  uint64_t _state;
+};
+
+//============================================================================
+// An octree level in raster scan order with the child occupancy of each
+// node, along with the occupancy contexts as used in the occupancy coder.
+
+struct OctreeLevel {
+  std::vector<PCCOctree3Node> nodes;
+  std::vector<RasterScanContext::occupancy> occ;
+
+  // the (bit, ctx1, ctx2, sparse, bitIdx) of each coded occupancy bit
+  struct Bin {
+    uint8_t bit;
+    uint8_t bitIdx;
+    bool sparse;
+    int ctx1;
+    int ctx2;
+  };
+  std::vector<Bin> bins;
+};
+
+//----------------------------------------------------------------------------
+// A triangle soup: the fan of triangles around each node centroid
+
+struct TriangleSoup {
+  int blockWidth;
+  std::vector<Vec3<int32_t>> nodepos;
+
+  // per node, the centroid and the start of its vertex list
+  std::vector<Vec3<int32_t>> centroids;
+  std::vector<int> vertexStart;
+  std::vector<Vec3<int32_t>> vertices;
+};
+
+//----------------------------------------------------------------------------
+// The partitioning of a frame by each level of an octree, as performed by
+// the octree encoder: the order of the points entering each level and the
+// point range of each node of the level.
+
+struct OctreeSplit {
+  std::vector<Vec3<int>> lvlNodeSizeLog2;
+  std::vector<std::vector<int32_t>> order;
+  std::vector<std::vector<std::pair<int, int>>> nodes;
+
+  // the points sorted once by their position in the tree
+  std::vector<OctreeEncPoint> presorted;
+
+  // the child index bit of each axis when splitting a node at depth
+  Vec3<int> childMask(int depth) const
+  {
+    return qtBtChildSize(lvlNodeSizeLog2[depth], lvlNodeSizeLog2[depth + 1]);
+  }
+};
+
+//----------------------------------------------------------------------------
+// Discards anything written to std::cout (eg, codec logging) while in scope
+
+class QuietStdout {
+public:
+  QuietStdout() : _buf(std::cout.rdbuf(nullptr)) {}
+  ~QuietStdout() { std::cout.rdbuf(_buf); }
+
+private:
+  std::streambuf* _buf;
+};
+
+//----------------------------------------------------------------------------
+// A multi-frame bitstream of dense frames coded with inter prediction,
+// written to a file.  Every kTlvStreamRapPeriod'th frame is a random
+// access point.
+
+const int kTlvStreamFrames = 32;
+const int kTlvStreamRapPeriod = 8;
+
+struct TlvStream {
+  std::string path;
+  int numFrames;
+
+  // the file is removed once done with
+  bool temporary;
+
+  // the parameters with which to decode the bitstream
+  DecoderParams decoder;
+};
+
+//----------------------------------------------------------------------------
+
+static int
+octreeChildIdx(const Vec3<int>& mask, const point_t& pos)
+{
+  return (!!(pos[0] & mask[0]) << 2) | (!!(pos[1] & mask[1]) << 1)
+    | !!(pos[2] & mask[2]);
+}
+
+//----------------------------------------------------------------------------
+// Shared benchmark inputs, each built on first use
+
+struct Fixtures {
+  Options opts;
+
+  Fixtures(const Options& opts) : opts(opts) {}
+  ~Fixtures()
+  {
+    std::remove(opts.tmpPath.c_str());
+    if (_tlvStream && _tlvStream->temporary)
+      std::remove(_tlvStream->path.c_str());
+  }
+
+  // A voxelised dense frame with colour, and the following frame
+  const PCCPointSet3& dense(int frameIdx);
+
+  // A voxelised lidar sweep with reflectance
+  const PCCPointSet3& lidar();
+
+  // A voxelised lidar sweep of approximately numPoints, moved to the
+  // origin as done before slice partitioning.  Only the most recently
+  // requested size is retained.
+  const PCCPointSet3& lidarSweep(int64_t numPoints);
+
+  // The level above the leaves of dense(0), or if sparse, of lidar()
+  const OctreeLevel& octreeLevel(bool sparse = false);
+
+  // The partitioning of dense(0) by every level of a cubic octree
+  const OctreeSplit& octreeSplit();
+
+  // A bitstream of kTlvStreamFrames dense frames of a quarter the size,
+  // or that given by opts.bitstreamPath
+  const TlvStream& tlvStream();
+  const TriangleSoup& triangleSoup();
+
+private:
+  std::unique_ptr<PCCPointSet3> _dense[2];
+  std::unique_ptr<PCCPointSet3> _lidar;
+  std::unique_ptr<PCCPointSet3> _lidarSweep;
+  int64_t _lidarSweepPoints = 0;
+  std::unique_ptr<OctreeLevel> _octreeLevel[2];
+  std::unique_ptr<OctreeSplit> _octreeSplit;
+  std::unique_ptr<TlvStream> _tlvStream;
+  std::unique_ptr<TriangleSoup> _triangleSoup;
+};
+
+//----------------------------------------------------------------------------
+// Generates a frame with duplicate points removed, in raster scan order
+
+std::unique_ptr<PCCPointSet3>
+voxelisedFrame(const SyntheticParams& params, int frameIdx)
+{
+  PCCPointSet3 src;
+  SyntheticCloudGenerator(params).generate(frameIdx, &src);
+
+  std::vector<std::pair<int64_t, int32_t>> keys(src.getPointCount());
+  for (int i = 0; i < keys.size(); i++) {
+    const auto& pt = src[i];
+    keys[i] = {(int64_t(pt[0]) << 42) | (int64_t(pt[1]) << 21) | pt[2], i};
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<int32_t> indexes;
+  for (int i = 0; i < keys.size(); i++)
+    if (!i || keys[i].first != keys[i - 1].first)
+      indexes.push_back(keys[i].second);
+
+  std::unique_ptr<PCCPointSet3> cloud(new PCCPointSet3);
+  cloud->appendPartition(src, indexes);
+  return cloud;
+}
+
+//----------------------------------------------------------------------------
+
+const PCCPointSet3&
+Fixtures::dense(int frameIdx)
+{
+  auto& cloud = _dense[frameIdx];
+  if (cloud)
+    return *cloud;
+
+  SyntheticParams params =
+    defaultSyntheticParams(SyntheticProfile::kDenseObject);
+  params.seed = opts.seed;
+  params.numPoints = opts.numPoints;
+  params.rotationPerFrame = 2.;
+
+  cloud = voxelisedFrame(params, frameIdx);
+  return *cloud;
+}
+
+//----------------------------------------------------------------------------
+
+const PCCPointSet3&
+Fixtures::lidar()
+{
+  if (_lidar)
+    return *_lidar;
+
+  SyntheticParams params =
+    defaultSyntheticParams(SyntheticProfile::kLidarSweep);
+  params.seed = opts.seed;
+  params.numPoints = opts.numPoints;
+
+  _lidar = voxelisedFrame(params, 0);
+  return *_lidar;
+}
+
+//----------------------------------------------------------------------------
+
+const PCCPointSet3&
+Fixtures::lidarSweep(int64_t numPoints)
+{
+  if (_lidarSweep && _lidarSweepPoints == numPoints)
+    return *_lidarSweep;
+
+  // release the previous sweep before generating the next
+  _lidarSweep.reset();
+
+  SyntheticParams params =
+    defaultSyntheticParams(SyntheticProfile::kLidarSweep);
+  params.seed = opts.seed;
+  params.numPoints = numPoints;
+
+  _lidarSweep = voxelisedFrame(params, 0);
+  _lidarSweepPoints = numPoints;
+
+  auto& cloud = *_lidarSweep;
+  Box3<int32_t> bbox = cloud.computeBoundingBox();
+  for (int i = 0; i < cloud.getPointCount(); i++)
+    cloud[i] -= bbox.min;
+
+  return cloud;
+}
+
+//----------------------------------------------------------------------------
+
+const OctreeLevel&
+Fixtures::octreeLevel(bool sparse)
+{
+  auto& levelPtr = _octreeLevel[sparse];
+  if (levelPtr)
+    return *levelPtr;
+
+  // the level above the leaves, in raster scan order
+  const auto& cloud = sparse ? lidar() : dense(0);
+  std::vector<std::pair<int64_t, int>> keys(cloud.getPointCount());
+  for (int i = 0; i < keys.size(); i++) {
+    const auto& pt = cloud[i];
+    auto pos = pt >> 1;
+    keys[i].first = (int64_t(pos[0]) << 42) | (int64_t(pos[1]) << 21) | pos[2];
+    keys[i].second = (pt[0] & 1) << 2 | (pt[1] & 1) << 1 | (pt[2] & 1);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<std::pair<int64_t, int>> occupancy;
+  for (const auto& key : keys) {
+    if (occupancy.empty() || occupancy.back().first != key.first)
+      occupancy.emplace_back(key.first, 0);
+    occupancy.back().second |= 1 << key.second;
+  }
+
+  // NB: childOccupancy is not copied by PCCOctree3Node's copy constructor,
+  //     it is set once the node vector is complete
+  levelPtr.reset(new OctreeLevel);
+  auto& level = *levelPtr;
+  auto& nodes = level.nodes;
+  nodes.resize(occupancy.size());
+  const int64_t mask = (1 << 21) - 1;
+  for (int i = 0; i < nodes.size(); i++) {
+    int64_t key = occupancy[i].first;
+    nodes[i].pos = {int(key >> 42), int((key >> 21) & mask), int(key & mask)};
+    nodes[i].childOccupancy = occupancy[i].second;
+  }
+
+  RasterScanContext rsc(nodes);
+  rsc.initializeNextDepth();
+  level.occ.resize(nodes.size());
+  for (int i = 0; i < nodes.size(); i++)
+    rsc.nextNode(&nodes[i], level.occ[i]);
+
+  for (int i = 0; i < nodes.size(); i++) {
+    OctreeNeighours neigh;
+    prepareGeometryAdvancedNeighPattern(level.occ[i], neigh);
+    int occupancy = nodes[i].childOccupancy;
+    for (int j = 0; j < 8; j++) {
+      OctreeLevel::Bin bin;
+      makeGeometryAdvancedNeighPattern(
+        j, neigh, occupancy, bin.ctx1, bin.ctx2, bin.sparse);
+      bin.bit = (occupancy >> j) & 1;
+      bin.bitIdx = j;
+      level.bins.push_back(bin);
+    }
+  }
+
+  return level;
+}
+
+//----------------------------------------------------------------------------
+// The depth of the octree of dense(), whose positions have the precision
+// of the synthetic dense profile.
+
+static int
+denseOctreeDepth()
+{
+  return defaultSyntheticParams(SyntheticProfile::kDenseObject).precisionBits;
+}
+
+//----------------------------------------------------------------------------
+
+const OctreeSplit&
+Fixtures::octreeSplit()
+{
+  if (_octreeSplit)
+    return *_octreeSplit;
+
+  const auto& cloud = dense(0);
+  const int depth = denseOctreeDepth();
+  _octreeSplit.reset(new OctreeSplit);
+  auto& split = *_octreeSplit;
+  for (int d = 0; d <= depth; d++)
+    split.lvlNodeSizeLog2.push_back(depth - d);
+
+  std::vector<OctreeEncPoint> points(cloud.getPointCount());
+  for (size_t i = 0; i < points.size(); i++)
+    points[i] = {cloud[i], int32_t(i)};
+
+  std::vector<std::pair<int, int>> nodes = {{0, int(points.size())}};
+  for (int d = 0; d < depth; d++) {
+    split.order.emplace_back();
+    for (const auto& p : points)
+      split.order.back().push_back(p.idx);
+    split.nodes.push_back(nodes);
+
+    const auto mask = split.childMask(d);
+    std::vector<std::pair<int, int>> children;
+    for (const auto& node : nodes) {
+      std::array<int, 8> counts = {};
+      countingSort(
+        std::next(points.begin(), node.first),
+        std::next(points.begin(), node.second), counts,
+        [=](const OctreeEncPoint& p) { return octreeChildIdx(mask, p.pos); });
+
+      int start = node.first;
+      for (int count : counts) {
+        if (count)
+          children.emplace_back(start, start + count);
+        start += count;
+      }
+    }
+    nodes = std::move(children);
+  }
+
+  // the presorted points must occupy the same node ranges
+  for (size_t i = 0; i < points.size(); i++)
+    points[i] = {cloud[i], int32_t(i)};
+  if (!presortOctreePoints(points, split.lvlNodeSizeLog2, depth))
+    throw std::runtime_error("octree presort failed");
+
+  for (int d = 0; d < depth; d++) {
+    for (const auto& node : split.nodes[d]) {
+      auto pos = points[node.first].pos >> split.lvlNodeSizeLog2[d];
+      for (int i = node.first; i < node.second; i++)
+        if (points[i].pos >> split.lvlNodeSizeLog2[d] != pos)
+          throw std::runtime_error("octree presort mismatch");
+    }
+  }
+  split.presorted = std::move(points);
+
+  return split;
+}
+
+//----------------------------------------------------------------------------
+
+const TlvStream&
+Fixtures::tlvStream()
+{
+  if (_tlvStream)
+    return *_tlvStream;
+
+  // NB: the file paths required by tmc3 are not used
+  std::vector<std::string> args = {
+    "tmc3-bench", "--mode=0", "--uncompressedDataPath=-",
+    "--compressedStreamPath=-", "--qtbtEnabled=0",
+    "--inferredDirectCodingMode=0", "--neighbourAvailBoundaryLog2=8",
+    "--interPredictionEnabled=1", "--motionParamPreset=2",
+    "--randomAccessPeriod=" + std::to_string(kTlvStreamRapPeriod),
+    "--convertPlyColourspace=1", "--transformType=0", "--qp=28",
+    "--bitdepth=8", "--attribute=color"};
+
+  std::vector<char*> argv;
+  for (auto& arg : args)
+    argv.push_back(&arg[0]);
+
+  Parameters params;
+  bool parsed;
+  {
+    QuietStdout quiet;
+    parsed = ParseParameters(int(argv.size()), argv.data(), params);
+  }
+  if (!parsed)
+    throw std::runtime_error("bad codec parameters for the tlv stream");
+
+  _tlvStream.reset(new TlvStream);
+  auto& stream = *_tlvStream;
+  stream.decoder = params.decoder;
+
+  if (!opts.bitstreamPath.empty()) {
+    TlvReader reader;
+    if (!reader.open(opts.bitstreamPath) || !reader.numFrames())
+      throw std::runtime_error("failed to index " + opts.bitstreamPath);
+    stream.path = opts.bitstreamPath;
+    stream.numFrames = reader.numFrames();
+    stream.temporary = false;
+    return stream;
+  }
+
+  stream.path = opts.tmpPath + ".bin";
+  stream.numFrames = kTlvStreamFrames;
+  stream.temporary = true;
+
+  SyntheticParams synthParams =
+    defaultSyntheticParams(SyntheticProfile::kDenseObject);
+  synthParams.seed = opts.seed;
+  synthParams.numPoints = opts.numPoints / 4;
+  synthParams.rotationPerFrame = 2.;
+  SyntheticCloudGenerator generator(synthParams);
+
+  QuietStdout quiet;
+  std::ofstream fout(stream.path, std::ios::binary);
+  StreamEncoder encoder(params.encoder, [&](const PayloadBuffer& buf) {
+    writeTlv(buf, fout);
+  });
+
+  for (int frameIdx = 0; frameIdx < kTlvStreamFrames; frameIdx++) {
+    PCCPointSet3 cloud;
+    generator.generate(frameIdx, &cloud);
+
+    const auto& attrDescs = encoder.params().sps.attributeSets;
+    if (params.convertColourspace)
+      convertFromGbr(attrDescs, cloud);
+    scaleAttributesForInput(attrDescs, cloud);
+
+    if (encoder.encode(cloud))
+      throw std::runtime_error("failed to encode the tlv stream");
+  }
+
+  fout.close();
+  if (!fout)
+    throw std::runtime_error("failed to write " + stream.path);
+
+  return stream;
+}
+
+//----------------------------------------------------------------------------
+
+const TriangleSoup&
+Fixtures::triangleSoup()
+{
+  if (_triangleSoup)
+    return *_triangleSoup;
+
+  // Each 8x8x8 node is approximated by a fan of up to six triangles around
+  // the centroid of its points, with vertices chosen among the points in
+  // order of angle about the axis of least extent.
+  const int kBlockLog2 = 3;
+  const auto& cloud = dense(0);
+  _triangleSoup.reset(new TriangleSoup);
+  auto& soup = *_triangleSoup;
+  soup.blockWidth = 1 << kBlockLog2;
+
+  std::vector<std::pair<int64_t, int32_t>> keys(cloud.getPointCount());
+  for (int i = 0; i < keys.size(); i++) {
+    auto pos = cloud[i] >> kBlockLog2;
+    keys[i] = {(int64_t(pos[0]) << 42) | (int64_t(pos[1]) << 21) | pos[2], i};
+  }
+  std::sort(keys.begin(), keys.end());
+
+  for (int i = 0, j; i < keys.size(); i = j) {
+    for (j = i; j < keys.size() && keys[j].first == keys[i].first; j++)
+      ;
+    if (j - i < 3)
+      continue;
+
+    Vec3<int32_t> nodepos = (cloud[keys[i].second] >> kBlockLog2)
+      << kBlockLog2;
+
+    // fixed-point positions relative to the node
+    std::vector<Vec3<int32_t>> pts;
+    Vec3<int32_t> lo = soup.blockWidth, hi = -1, sum = 0;
+    for (int k = i; k < j; k++) {
+      Vec3<int32_t> pt = cloud[keys[k].second] - nodepos;
+      for (int d = 0; d < 3; d++) {
+        lo[d] = std::min(lo[d], pt[d]);
+        hi[d] = std::max(hi[d], pt[d]);
+      }
+      pts.push_back((pt << kTrisoupFpBits) + kTrisoupFpHalf);
+      sum += pts.back();
+    }
+    Vec3<int32_t> centroid = sum / int(pts.size());
+
+    int axis = 0;
+    for (int d = 1; d < 3; d++)
+      if (hi[d] - lo[d] < hi[axis] - lo[axis])
+        axis = d;
+    int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+
+    std::vector<std::pair<double, int>> angles;
+    for (int k = 0; k < pts.size(); k++) {
+      Vec3<int32_t> d = pts[k] - centroid;
+      angles.push_back({std::atan2(double(d[a2]), double(d[a1])), k});
+    }
+    std::sort(angles.begin(), angles.end());
+
+    int numVertices = std::min(6, int(pts.size()));
+    soup.nodepos.push_back(nodepos);
+    soup.centroids.push_back(centroid);
+    soup.vertexStart.push_back(soup.vertices.size());
+    for (int k = 0; k < numVertices; k++)
+      soup.vertices.push_back(
+        pts[angles[k * angles.size() / numVertices].second]);
+  }
+  soup.vertexStart.push_back(soup.vertices.size());
+
+  return soup;
+}
+
+//============================================================================
+// Entropy coding
+
+// Bins coded with one of 64 contexts, each with a different probability
+struct ContextBins {
+  std::vector<uint8_t> bits;
+  std::vector<uint8_t> ctxIdx;
+
+  ContextBins(int count, uint64_t seed) : bits(count), ctxIdx(count)
+  {
+    Rng rng(seed);
+    for (int i = 0; i < count; i++) {
+      ctxIdx[i] = rng.uniform(64);
+      bits[i] = rng.uniform(66) <= ctxIdx[i];
+    }
+  }
+};
+
+const int kNumBins = 1 << 20;
+
+//----------------------------------------------------------------------------
+
+size_t
+encodeContextBins(
+  const ContextBins& bins, std::vector<uint8_t>& buf, BenchTimer& timer)
+{
+  EntropyEncoder enc;
+  enc.setBuffer(buf.size(), buf.data());
+  AdaptiveBitModel ctx[64];
+
+  timer.start();
+  enc.start();
+  for (int i = 0; i < bins.bits.size(); i++)
+    enc.encode(bins.bits[i], ctx[bins.ctxIdx[i]]);
+  size_t len = enc.stop();
+  timer.stop();
+  return len;
+}
+
+//----------------------------------------------------------------------------
+
+int64_t
+decodeContextBins(
+  const ContextBins& bins, const std::vector<uint8_t>& buf, size_t len,
+  BenchTimer& timer)
+{
+  EntropyDecoder dec;
+  dec.setBuffer(len, reinterpret_cast<const char*>(buf.data()));
+  AdaptiveBitModel ctx[64];
+
+  int64_t mismatches = 0;
+  timer.start();
+  dec.start();
+  for (int i = 0; i < bins.bits.size(); i++)
+    mismatches += dec.decode(ctx[bins.ctxIdx[i]]) != bins.bits[i];
+  dec.stop();
+  timer.stop();
+  return mismatches;
+}
+
+//----------------------------------------------------------------------------
+
+size_t
+encodeBypassBins(
+  const ContextBins& bins, std::vector<uint8_t>& buf, BenchTimer& timer)
+{
+  EntropyEncoder enc;
+  enc.setBuffer(buf.size(), buf.data());
+  enc.setBypassBinCodingWithoutProbUpdate(true);
+  AdaptiveBitModel ctx;
+
+  // NB: the bypass coding of a bin requires the state established by at
+  //     least one preceding context coded bin, as is always the case in
+  //     the codec
+  timer.start();
+  enc.start();
+  enc.encode(1, ctx);
+  for (int i = 0; i < bins.bits.size(); i++)
+    enc.encode(bins.bits[i]);
+  size_t len = enc.stop();
+  timer.stop();
+  return len;
+}
+
+//----------------------------------------------------------------------------
+
+int64_t
+decodeBypassBins(
+  const ContextBins& bins, const std::vector<uint8_t>& buf, size_t len,
+  BenchTimer& timer)
+{
+  EntropyDecoder dec;
+  dec.setBuffer(len, reinterpret_cast<const char*>(buf.data()));
+  dec.setBypassBinCodingWithoutProbUpdate(true);
+  AdaptiveBitModel ctx;
+
+  int64_t mismatches = 0;
+  timer.start();
+  dec.start();
+  mismatches += dec.decode(ctx) != 1;
+  for (int i = 0; i < bins.bits.size(); i++)
+    mismatches += dec.decode() != bins.bits[i];
+  dec.stop();
+  timer.stop();
+  return mismatches;
+}
+
+//----------------------------------------------------------------------------
+// The dynamic OBUF context maps of intra occupancy coding
+
+struct ObufState {
+  CtxMapDynamicOBUF maps[2][8];
+  CtxModelDynamicOBUF models[2];
+  std::vector<uint8_t> leaves;
+  int leafNumber;
+
+  ObufState()
+    : leaves(
+        CtxMapDynamicOBUF::kLeafBufferSize
+        * (1 << CtxMapDynamicOBUF::kLeafDepth))
+    , leafNumber(0)
+  {
+    // NB: as per GeometryOctreeContexts::resetMap()
+    const int n2 = 6, n3 = 5;
+    const int sparseBitsS2[8] = {9, 12, 12, 11, 9, 12, 12, 11};
+    for (int i = 0; i < 8; i++) {
+      maps[0][i].reset(6 + n3 + 1, sparseBitsS2[i] - n3);
+      maps[1][i].reset((i == 3 || i == 7 ? 4 : 6) + n2 + 1, 18 - 6 - n2);
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+
+size_t
+encodeObufBins(
+  const std::vector<OctreeLevel::Bin>& bins, std::vector<uint8_t>& buf,
+  BenchTimer& timer)
+{
+  std::unique_ptr<ObufState> state(new ObufState);
+  EntropyEncoder enc;
+  enc.setBuffer(buf.size(), buf.data());
+
+  timer.start();
+  enc.start();
+  for (const auto& bin : bins) {
+    int dense = !bin.sparse;
+    auto& model = state->models[dense];
+    auto obufIdx = state->maps[dense][bin.bitIdx].getEvolve(
+      bin.bit, bin.ctx2, bin.ctx1, &state->leafNumber, state->leaves.data());
+    enc.encode(bin.bit, obufIdx >> 3, model[obufIdx], model.obufSingleBound);
+  }
+  size_t len = enc.stop();
+  timer.stop();
+  return len;
+}
+
+//----------------------------------------------------------------------------
+
+int64_t
+decodeObufBins(
+  const std::vector<OctreeLevel::Bin>& bins, const std::vector<uint8_t>& buf,
+  size_t len, BenchTimer& timer)
+{
+  std::unique_ptr<ObufState> state(new ObufState);
+  EntropyDecoder dec;
+  dec.setBuffer(len, reinterpret_cast<const char*>(buf.data()));
+
+  int64_t mismatches = 0;
+  timer.start();
+  dec.start();
+  for (const auto& bin : bins) {
+    int dense = !bin.sparse;
+    int bit = state->maps[dense][bin.bitIdx].decodeEvolve(
+      &dec, state->models[dense], bin.ctx2, bin.ctx1, &state->leafNumber,
+      state->leaves.data());
+    mismatches += bit != bin.bit;
+  }
+  dec.stop();
+  timer.stop();
+  return mismatches;
+}
+
+//============================================================================
+// Chunked entropy streams: bins coded with a separate bypass stream
+
+const int kNumChunkStreams = 64;
+
+struct ChunkStreams {
+  // the concatenated streams prior to splicing
+  std::vector<uint8_t> buf;
+  std::vector<std::pair<size_t, size_t>> streams;
+};
+
+//----------------------------------------------------------------------------
+// Each of the numStreams streams codes an equal part of bins, alternating
+// between context coded and bypass bins.
+
+void
+encodeChunkStreams(
+  const ContextBins& bins,
+  int numStreams,
+  ChunkStreams& out,
+  std::vector<uint8_t>& scratch,
+  BenchTimer& timer)
+{
+  out.buf.clear();
+  out.streams.clear();
+  AdaptiveBitModel ctx[64];
+
+  int binsPerStream = bins.bits.size() / numStreams;
+  for (int s = 0; s < numStreams; s++) {
+    EntropyEncoder enc;
+    enc.enableBypassStream(true);
+    enc.setBuffer(scratch.size(), scratch.data());
+
+    timer.start();
+    enc.start();
+    for (int i = s * binsPerStream; i < (s + 1) * binsPerStream; i++) {
+      if (i & 1)
+        enc.encode(bins.bits[i]);
+      else
+        enc.encode(bins.bits[i], ctx[bins.ctxIdx[i]]);
+    }
+    size_t len = enc.stop();
+    timer.stop();
+
+    out.streams.emplace_back(out.buf.size(), len);
+    out.buf.insert(out.buf.end(), scratch.data(), scratch.data() + len);
+  }
+}
+
+//----------------------------------------------------------------------------
+// As per the encoder's assembly of geometry data units
+
+void
+spliceChunkStreams(ChunkStreams& in)
+{
+  uint8_t* ptr = in.buf.data();
+  uint8_t* end = ptr + in.buf.size();
+  for (int i = int(in.streams.size()) - 2; i >= 0; i--) {
+    const auto& stream = in.streams[i];
+    auto* chunkA = ptr + stream.first + (stream.second & ~0xff);
+    auto* chunkB = ptr + stream.first + stream.second;
+    ChunkStreamBuilder::spliceChunkStreams(chunkA, chunkB, end);
+  }
+}
+
+//----------------------------------------------------------------------------
+// NB: the spliced streams in buf are modified by the decoder
+
+int64_t
+decodeChunkStreams(
+  const ContextBins& bins,
+  int numStreams,
+  std::vector<uint8_t>& buf,
+  BenchTimer& timer)
+{
+  EntropyDecoder dec;
+  dec.enableBypassStream(true);
+  dec.setBuffer(buf.size(), reinterpret_cast<const char*>(buf.data()));
+  AdaptiveBitModel ctx[64];
+
+  int64_t mismatches = 0;
+  int binsPerStream = bins.bits.size() / numStreams;
+  timer.start();
+  dec.start();
+  for (int s = 0; s < numStreams; s++) {
+    if (s)
+      dec.flushAndRestart();
+    for (int i = s * binsPerStream; i < (s + 1) * binsPerStream; i++) {
+      int bit = i & 1 ? dec.decode() : dec.decode(ctx[bins.ctxIdx[i]]);
+      mismatches += bit != bins.bits[i];
+    }
+  }
+  dec.stop();
+  timer.stop();
+  return mismatches;
+}
+
+//============================================================================
+// Attribute coding
+
+RahtPredictionParams
+defaultRahtPredictionParams()
+{
+  // NB: as per the tmc3 defaults
+  RahtPredictionParams params;
+  params.intra_mode_level = 4;
+  params.enable_inter_prediction = false;
+  params.mode_level = 2;
+  params.upper_mode_level = 4;
+  params.integer_haar_enable_flag = false;
+  params.prediction_enabled_flag = true;
+  params.prediction_threshold0 = 2;
+  params.prediction_threshold1 = 6;
+  params.prediction_skip1_flag = true;
+  params.subnode_prediction_enabled_flag = true;
+  params.prediction_weights = {9, 3, 1, 5, 2};
+  params.setPredictionWeights();
+  return params;
+}
+
+//----------------------------------------------------------------------------
+
+QpSet
+deriveQpSet(int qp)
+{
+  AttributeDescription desc;
+  desc.attr_num_dimensions_minus1 = 2;
+  desc.bitdepth = 8;
+
+  AttributeParameterSet aps;
+  aps.init_qp_minus4 = qp - 4;
+  aps.aps_chroma_qp_offset = 0;
+  aps.aps_slice_qp_deltas_present_flag = false;
+
+  AttributeBrickHeader abh;
+  return deriveQpSet(desc, aps, abh);
+}
+
+//----------------------------------------------------------------------------
+// The inputs and outputs of a colour transform with the uraht
+
+struct RahtData {
+  RahtPredictionParams params;
+  QpSet qpSet;
+  std::vector<Qps> qpOffsets;
+  std::vector<int64_t> mortonCode;
+  std::vector<int> attributes;
+
+  // forward transform outputs: reconstruction, coefficients and modes
+  std::vector<int> reconstruction;
+  std::vector<int> coefficients;
+  std::vector<uint8_t> modeBuf;
+  size_t modeLen;
+
+  RahtWorkspace workspace;
+
+  RahtData(const PCCPointSet3& cloud, int qp = 28)
+    : params(defaultRahtPredictionParams()), qpSet(deriveQpSet(qp))
+  {
+    auto order = sortedPointCloud(3, cloud, mortonCode, attributes);
+    qpSet.regionQpOffsets(cloud, order, qpOffsets);
+    coefficients.resize(attributes.size());
+    modeBuf.resize(attributes.size() + 4096);
+  }
+
+  int voxelCount() const { return int(mortonCode.size()); }
+};
+
+//----------------------------------------------------------------------------
+
+void
+rahtForward(RahtData& d, BenchTimer& timer)
+{
+  std::vector<int64_t> mortonCode(d.mortonCode);
+  d.reconstruction = d.attributes;
+
+  EntropyEncoder enc;
+  enc.setBuffer(d.modeBuf.size(), d.modeBuf.data());
+  enc.start();
+  attr::ModeEncoder modeEncoder;
+  modeEncoder.set(&enc);
+
+  timer.start();
+  regionAdaptiveHierarchicalTransform(
+    d.params, d.qpSet, d.qpOffsets.data(), 3, d.voxelCount(),
+    mortonCode.data(), d.reconstruction.data(), 0, nullptr, nullptr,
+    d.coefficients.data(), modeEncoder, d.workspace);
+  timer.stop();
+
+  modeEncoder.flush();
+  d.modeLen = enc.stop();
+}
+
+//----------------------------------------------------------------------------
+
+int64_t
+rahtInverse(RahtData& d, std::vector<int>& out, BenchTimer& timer)
+{
+  std::vector<int64_t> mortonCode(d.mortonCode);
+  std::vector<int> coefficients(d.coefficients);
+  out.assign(d.attributes.size(), 0);
+
+  EntropyDecoder dec;
+  dec.setBuffer(d.modeLen, reinterpret_cast<const char*>(d.modeBuf.data()));
+  dec.start();
+  attr::ModeDecoder modeDecoder;
+  modeDecoder.set(&dec);
+
+  timer.start();
+  regionAdaptiveHierarchicalInverseTransform(
+    d.params, d.qpSet, d.qpOffsets.data(), 3, d.voxelCount(),
+    mortonCode.data(), out.data(), 0, nullptr, nullptr, coefficients.data(),
+    modeDecoder, d.workspace);
+  timer.stop();
+
+  dec.stop();
+  return out != d.reconstruction;
+}
+
+//----------------------------------------------------------------------------
+// A RahtKernel using the sign tested rounding that preceded the branchless
+// FixedPoint::round(), against which the butterflies are checked and timed.
+
+class BranchingRahtKernel {
+public:
+  BranchingRahtKernel(int64_t w0, int64_t w1, bool) : _a(w0), _b(w1) {}
+
+  static int64_t fix(int64_t val)
+  {
+    if (val < 0)
+      return -((FixedPoint::kOneHalf - val) >> FixedPoint::kFracBits);
+    return (FixedPoint::kOneHalf + val) >> FixedPoint::kFracBits;
+  }
+
+  void fwdTransform(FixedPoint& lf, FixedPoint& hf)
+  {
+    auto tmp = lf.val * _b;
+    lf.val = fix(lf.val * _a + hf.val * _b);
+    hf.val = fix(hf.val * _a - tmp);
+  }
+
+  void invTransform(FixedPoint& left, FixedPoint& right)
+  {
+    auto tmp = right.val * _b;
+    right.val = fix(right.val * _a + left.val * _b);
+    left.val = fix(left.val * _a - tmp);
+  }
+
+private:
+  int64_t _a, _b;
+};
+
+//----------------------------------------------------------------------------
+// Fully occupied 2x2x2 blocks of three channel coefficients, each with
+// random butterfly weights
+
+struct RahtBlock {
+  int64_t weights[8 + 8 + 8 + 8 + 24];
+  FixedPoint buf[3][8];
+};
+
+std::vector<RahtBlock>
+makeRahtBlocks(int numBlocks, uint64_t seed)
+{
+  std::vector<RahtBlock> blocks(numBlocks);
+  Rng rng(seed);
+  for (auto& block : blocks) {
+    for (int i = 0; i < 24; i += 2) {
+      RahtKernel kernel(1 + rng.uniform(64), 1 + rng.uniform(64));
+      block.weights[32 + i] = kernel.getW0();
+      block.weights[33 + i] = kernel.getW1();
+    }
+    for (auto& channel : block.buf)
+      for (auto& coeff : channel)
+        coeff.val = int64_t(rng.uniform(1 << 24)) - (1 << 23);
+  }
+  return blocks;
+}
+
+//----------------------------------------------------------------------------
+
+template<class Kernel>
+void
+rahtButterflies(std::vector<RahtBlock>& blocks, bool inverse, BenchTimer& timer)
+{
+  timer.start();
+  for (auto& block : blocks) {
+    if (inverse)
+      invTransformBlock222<Kernel>(3, block.buf, block.weights);
+    else
+      fwdTransformBlock222<Kernel>(3, block.buf, block.weights);
+  }
+  timer.stop();
+}
+
+//----------------------------------------------------------------------------
+
+bool
+operator==(const RahtBlock& a, const RahtBlock& b)
+{
+  for (int k = 0; k < 3; k++)
+    for (int i = 0; i < 8; i++)
+      if (a.buf[k][i].val != b.buf[k][i].val)
+        return false;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Coefficient coding: the bins used by each binarisation of
+// PCCResidualsEncoder
+
+static int64_t
+expGolombBins(unsigned symbol, int k)
+{
+  int64_t bins = 1;
+  for (; symbol >= (1u << k); k++, bins++)
+    symbol -= 1u << k;
+  return bins + k;
+}
+
+static int64_t
+runLengthBins(int runLength)
+{
+  if (runLength < 3)
+    return runLength + 1;
+  runLength -= 3;
+  if (runLength < 8)
+    return 3 + (runLength >> 1) + 2;
+  return 3 + 4 + expGolombBins(runLength - 8, 2);
+}
+
+static int64_t
+symbolBins(int mag)
+{
+  return mag < 2 ? 1 + mag : 2 + expGolombBins(mag - 2, 1);
+}
+
+// The number of bins used to code the planar coefficients of count
+// colour triplets
+static int64_t
+rahtCoeffBins(const std::vector<int>& coeffs, int count)
+{
+  int64_t bins = 0;
+  int zeroRun = 0;
+  for (int n = 0; n < count; n++) {
+    int mag0 = std::abs(coeffs[n]);
+    int mag1 = std::abs(coeffs[count + n]);
+    int mag2 = std::abs(coeffs[2 * count + n]);
+    if (!mag0 && !mag1 && !mag2) {
+      zeroRun++;
+      continue;
+    }
+
+    bins += runLengthBins(zeroRun);
+    bins += symbolBins(mag1) + symbolBins(mag2);
+    bins += symbolBins(!mag1 && !mag2 ? mag0 - 1 : mag0);
+    bins += !!mag0 + !!mag1 + !!mag2;
+    zeroRun = 0;
+  }
+  if (zeroRun)
+    bins += runLengthBins(zeroRun);
+  return bins;
+}
+
+//----------------------------------------------------------------------------
+// The per-position coding of the planar coefficients that preceded
+// encode/decodeRahtCoefficients
+
+static void
+encodeRahtCoefficientsRef(
+  PCCResidualsEncoder& encoder, const int* coeffs, int count)
+{
+  int zeroRun = 0;
+  int values[3];
+  for (int n = 0; n < count; ++n) {
+    for (int d = 0; d < 3; ++d)
+      values[d] = coeffs[count * d + n];
+    if (!values[0] && !values[1] && !values[2])
+      ++zeroRun;
+    else {
+      encoder.encodeRunLength(zeroRun);
+      encoder.encode(values[0], values[1], values[2]);
+      zeroRun = 0;
+    }
+  }
+  if (zeroRun)
+    encoder.encodeRunLength(zeroRun);
+}
+
+static void
+decodeRahtCoefficientsRef(PCCResidualsDecoder& decoder, int* coeffs, int count)
+{
+  std::fill_n(coeffs, 3 * count, 0);
+  int32_t values[3];
+  for (int n = 0; n < count; n++) {
+    int zeroRun = decoder.decodeRunLength();
+    if (zeroRun) {
+      n += zeroRun;
+      if (n >= count)
+        break;
+    }
+
+    decoder.decode(values);
+    for (int d = 0; d < 3; d++)
+      coeffs[n + count * d] = values[d];
+  }
+}
+
+//----------------------------------------------------------------------------
+
+size_t
+encodeRahtCoeffs(
+  const RahtData& d, bool ref, std::vector<uint8_t>& buf, BenchTimer& timer)
+{
+  SequenceParameterSet sps;
+  sps.cabac_bypass_stream_enabled_flag = false;
+  sps.bypass_bin_coding_without_prob_update = false;
+  AttributeParameterSet aps;
+  AttributeBrickHeader abh;
+  PCCResidualsEncoder enc(aps, abh, AttributeContexts());
+  enc.start(sps, d.voxelCount());
+
+  timer.start();
+  if (ref)
+    encodeRahtCoefficientsRef(enc, d.coefficients.data(), d.voxelCount());
+  else
+    encodeRahtCoefficients(enc, 3, d.coefficients.data(), d.voxelCount());
+  size_t len = enc.stop();
+  timer.stop();
+
+  buf.assign(enc.arithmeticEncoder.buffer(),
+    enc.arithmeticEncoder.buffer() + len);
+  return len;
+}
+
+//----------------------------------------------------------------------------
+
+int64_t
+decodeRahtCoeffs(
+  const RahtData& d, bool ref, const std::vector<uint8_t>& buf,
+  BenchTimer& timer)
+{
+  SequenceParameterSet sps;
+  sps.cabac_bypass_stream_enabled_flag = false;
+  sps.bypass_bin_coding_without_prob_update = false;
+  AttributeBrickHeader abh;
+  PCCResidualsDecoder dec(abh, AttributeContexts());
+  std::vector<int> coeffs(d.coefficients.size());
+
+  timer.start();
+  dec.start(sps, reinterpret_cast<const char*>(buf.data()), int(buf.size()));
+  if (ref)
+    decodeRahtCoefficientsRef(dec, coeffs.data(), d.voxelCount());
+  else
+    decodeRahtCoefficients(dec, 3, coeffs.data(), d.voxelCount());
+  dec.stop();
+  timer.stop();
+
+  return coeffs != d.coefficients;
+}
+
+//============================================================================
+// Attribute conversion
+
+// A batched conversion and its per-point reference, both in place
+template<typename T>
+struct ConversionBench {
+  std::string name;
+  std::function<std::vector<T>(Fixtures&)> input;
+  std::function<void(T*, size_t)> reference;
+  std::function<void(T*, size_t)> kernel;
+};
+
+//----------------------------------------------------------------------------
+// Adds a benchmark of the reference (.ref) and of each variant of the
+// batched kernel supported by the host.  Each is checked against the
+// reference.
+
+template<typename T>
+void
+addConversionBenchmarks(
+  std::vector<Benchmark>& list, const ConversionBench<T>& cb)
+{
+  static const std::pair<const char*, AttributeConversionIsa> variants[] = {
+    {"scalar", AttributeConversionIsa::kScalar},
+    {"sse4", AttributeConversionIsa::kSse4},
+    {"avx2", AttributeConversionIsa::kAvx2},
+    {"ref", AttributeConversionIsa::kScalar}};
+
+  for (const auto& variant : variants) {
+    const bool isRef = variant.first == std::string("ref");
+    const auto isa = variant.second;
+    if (isa > detectAttributeConversionIsa())
+      continue;
+
+    list.push_back({cb.name + "." + variant.first, "point",
+                    [=](Fixtures& fx) -> Kernel {
+      auto in = std::make_shared<std::vector<T>>(cb.input(fx));
+      auto ref = std::make_shared<std::vector<T>>(*in);
+      cb.reference(ref->data(), ref->size());
+
+      auto work = std::make_shared<std::vector<T>>();
+      return [=](BenchTimer& timer) {
+        *work = *in;
+        selectAttributeConversionIsa(isa);
+        timer.start();
+        if (isRef)
+          cb.reference(work->data(), work->size());
+        else
+          cb.kernel(work->data(), work->size());
+        timer.stop();
+        if (*work != *ref)
+          throw std::runtime_error(cb.name + " mismatch");
+        return int64_t(work->size());
+      };
+    }});
+  }
+}
+
+//----------------------------------------------------------------------------
+// The colours of dense(0), optionally converted by the reference
+
+std::vector<Vec3<attr_t>>
+denseColours(
+  Fixtures& fx, std::function<void(Vec3<attr_t>*, size_t)> convert = {})
+{
+  const auto& cloud = fx.dense(0);
+  std::vector<Vec3<attr_t>> colours(cloud.getPointCount());
+  for (int i = 0; i < colours.size(); i++)
+    colours[i] = cloud.getColor(i);
+  if (convert)
+    convert(colours.data(), colours.size());
+  return colours;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename Fn>
+std::function<void(Vec3<attr_t>*, size_t)>
+perPoint(Fn fn)
+{
+  return [=](Vec3<attr_t>* colours, size_t count) {
+    for (size_t i = 0; i < count; i++)
+      colours[i] = fn(colours[i]);
+  };
+}
+
+//============================================================================
+// Motion search
+
+GeometryParameterSet::Motion
+denseMotionParams()
+{
+  // NB: as per motionParamPreset=2 at unit scale
+  GeometryParameterSet::Motion motion;
+  motion.motion_block_size = 128;
+  motion.motion_window_size = 8;
+  motion.motion_min_pu_size = 64;
+  motion.Amotion0 = 1;
+  motion.lambda = 1.0;
+  motion.decimate = 7;
+  motion.dgeom_color_factor = 0.015;
+  motion.K = 10;
+  motion.motion_max_prefix_bits = deriveMotionMaxPrefixBits(motion);
+  motion.motion_max_suffix_bits = deriveMotionMaxSuffixBits(motion);
+  return motion;
+}
+
+//----------------------------------------------------------------------------
+// The motion search octrees of a reference and a current frame.
+
+struct MotionData {
+  GeometryParameterSet::Motion param;
+  PCCPointSet3 ref, curr;
+  MSOctree refOctree, currOctree;
+
+  // the motion blocks (by node index in currOctree) to be searched
+  std::vector<uint32_t> blocks;
+
+  MotionData(const PCCPointSet3& refCloud, const PCCPointSet3& currCloud)
+    : param(denseMotionParams()), ref(refCloud), curr(currCloud)
+  {
+    // NB: the octrees reorder their point clouds
+    refOctree = MSOctree(&ref, {}, 2);
+    currOctree = MSOctree(&curr, {}, 0);
+  }
+};
+
+//============================================================================
+// Bitstream access
+
+// Decodes stream until frameIdx is output, starting either at the first
+// frame or, if seeking, at the preceding random access point.  The time to
+// output the frame, including opening and indexing the bitstream, is
+// accumulated in timer.  Returns the number of points decoded.
+
+int64_t
+decodeFrame(
+  const TlvStream& stream,
+  int frameIdx,
+  bool seek,
+  BenchTimer& timer,
+  PCCPointSet3* frame)
+{
+  QuietStdout quiet;
+  bool done = false;
+  timer.start();
+
+  TlvReader reader;
+  if (!reader.open(stream.path))
+    throw std::runtime_error("failed to open " + stream.path);
+
+  TlvReader::SeekPoint start{0, 0, {}};
+  if (seek && !reader.seek(frameIdx, &start))
+    throw std::runtime_error("failed to seek " + stream.path);
+
+  int outputIdx = start.frameIdx;
+  int64_t numPoints = 0;
+  StreamDecoder decoder(stream.decoder, [&](const CloudFrame& out) {
+    numPoints += out.cloud.getPointCount();
+    if (outputIdx++ != frameIdx)
+      return;
+    timer.stop();
+    done = true;
+    *frame = out.cloud;
+  });
+
+  int ret = 0;
+  for (auto idx : start.parameterSets)
+    ret |= decoder.decode(reader.payload(idx));
+
+  for (size_t idx = start.firstPayload; idx < reader.numPayloads(); idx++) {
+    if (ret || done)
+      break;
+    ret = decoder.decode(reader.payload(idx));
+  }
+
+  if (!ret && !done)
+    ret = decoder.flush();
+
+  if (ret || !done)
+    throw std::runtime_error("failed to decode " + stream.path);
+
+  return numPoints;
+}
+
+//----------------------------------------------------------------------------
+
+bool
+samePoints(const PCCPointSet3& a, const PCCPointSet3& b)
+{
+  if (a.getPointCount() != b.getPointCount())
+    return false;
+
+  if (a.hasColors() != b.hasColors())
+    return false;
+  if (a.hasReflectances() != b.hasReflectances())
+    return false;
+
+  for (int i = 0; i < a.getPointCount(); i++) {
+    if (a[i] != b[i])
+      return false;
+    if (a.hasColors() && a.getColor(i) != b.getColor(i))
+      return false;
+    if (a.hasReflectances() && a.getReflectance(i) != b.getReflectance(i))
+      return false;
+  }
+  return true;
+}
+
+//============================================================================
+// The benchmarks
+
+std::vector<Benchmark>
+benchmarks()
+{
+  std::vector<Benchmark> list;
+
+  //--------------------------------------------------------------------------
+  // Entropy coding
+
+  list.push_back({"aec.ctx.encode", "bin", [](Fixtures& fx) -> Kernel {
+    auto bins = std::make_shared<ContextBins>(kNumBins, fx.opts.seed);
+    auto buf = std::make_shared<std::vector<uint8_t>>(kNumBins);
+    return [=](BenchTimer& timer) {
+      g_sink += encodeContextBins(*bins, *buf, timer);
+      return int64_t(kNumBins);
+    };
+  }});
+
+  list.push_back({"aec.ctx.decode", "bin", [](Fixtures& fx) -> Kernel {
+    auto bins = std::make_shared<ContextBins>(kNumBins, fx.opts.seed);
+    auto buf = std::make_shared<std::vector<uint8_t>>(kNumBins);
+    BenchTimer unused;
+    size_t len = encodeContextBins(*bins, *buf, unused);
+    return [=](BenchTimer& timer) {
+      if (decodeContextBins(*bins, *buf, len, timer))
+        throw std::runtime_error("decoder mismatch");
+      return int64_t(kNumBins);
+    };
+  }});
+
+  list.push_back({"aec.bypass.encode", "bin", [](Fixtures& fx) -> Kernel {
+    auto bins = std::make_shared<ContextBins>(kNumBins, fx.opts.seed);
+    auto buf = std::make_shared<std::vector<uint8_t>>(kNumBins);
+    return [=](BenchTimer& timer) {
+      g_sink += encodeBypassBins(*bins, *buf, timer);
+      return int64_t(kNumBins);
+    };
+  }});
+
+  list.push_back({"aec.bypass.decode", "bin", [](Fixtures& fx) -> Kernel {
+    auto bins = std::make_shared<ContextBins>(kNumBins, fx.opts.seed);
+    auto buf = std::make_shared<std::vector<uint8_t>>(kNumBins);
+    BenchTimer unused;
+    size_t len = encodeBypassBins(*bins, *buf, unused);
+    return [=](BenchTimer& timer) {
+      if (decodeBypassBins(*bins, *buf, len, timer))
+        throw std::runtime_error("decoder mismatch");
+      return int64_t(kNumBins);
+    };
+  }});
+
+  list.push_back({"aec.obuf.encode", "bin", [](Fixtures& fx) -> Kernel {
+    const auto& bins = fx.octreeLevel().bins;
+    auto buf = std::make_shared<std::vector<uint8_t>>(bins.size());
+    return [=, &bins](BenchTimer& timer) {
+      g_sink += encodeObufBins(bins, *buf, timer);
+      return int64_t(bins.size());
+    };
+  }});
+
+  list.push_back({"aec.obuf.decode", "bin", [](Fixtures& fx) -> Kernel {
+    const auto& bins = fx.octreeLevel().bins;
+    auto buf = std::make_shared<std::vector<uint8_t>>(bins.size());
+    BenchTimer unused;
+    size_t len = encodeObufBins(bins, *buf, unused);
+    return [=, &bins](BenchTimer& timer) {
+      if (decodeObufBins(bins, *buf, len, timer))
+        throw std::runtime_error("decoder mismatch");
+      return int64_t(bins.size());
+    };
+  }});
+
+  list.push_back({"chunk.encode", "bin", [](Fixtures& fx) -> Kernel {
+    auto bins = std::make_shared<ContextBins>(kNumBins, fx.opts.seed);
+    auto out = std::make_shared<ChunkStreams>();
+    auto scratch = std::make_shared<std::vector<uint8_t>>(kNumBins);
+    return [=](BenchTimer& timer) {
+      encodeChunkStreams(*bins, kNumChunkStreams, *out, *scratch, timer);
+      return int64_t(kNumBins);
+    };
+  }});
+
+  list.push_back({"chunk.splice", "stream", [](Fixtures& fx) -> Kernel {
+    ContextBins bins(kNumBins, fx.opts.seed);
+    auto in = std::make_shared<ChunkStreams>();
+    auto work = std::make_shared<ChunkStreams>();
+    std::vector<uint8_t> scratch(kNumBins);
+    BenchTimer unused;
+    encodeChunkStreams(bins, kNumChunkStreams, *in, scratch, unused);
+    return [=](BenchTimer& timer) {
+      *work = *in;
+      timer.start();
+      spliceChunkStreams(*work);
+      timer.stop();
+      return int64_t(work->streams.size() - 1);
+    };
+  }});
+
+  list.push_back({"chunk.decode", "bin", [](Fixtures& fx) -> Kernel {
+    auto bins = std::make_shared<ContextBins>(kNumBins, fx.opts.seed);
+    auto streams = std::make_shared<ChunkStreams>();
+    std::vector<uint8_t> scratch(kNumBins);
+    BenchTimer unused;
+    encodeChunkStreams(*bins, kNumChunkStreams, *streams, scratch, unused);
+    spliceChunkStreams(*streams);
+
+    // NB: the decoder realigns the spliced streams in place
+    auto work = std::make_shared<std::vector<uint8_t>>();
+    return [=](BenchTimer& timer) {
+      *work = streams->buf;
+      if (decodeChunkStreams(*bins, kNumChunkStreams, *work, timer))
+        throw std::runtime_error("decoder mismatch");
+      return int64_t(kNumBins);
+    };
+  }});
+
+  //--------------------------------------------------------------------------
+  // Occupancy contexts
+
+  // The context cursors are walked over both a dense and a sparse level
+  for (bool sparse : {false, true}) {
+    const char* name = sparse ? "octree.nextNode.sparse" : "octree.nextNode";
+    list.push_back({name, "node", [=](Fixtures& fx) -> Kernel {
+      const auto& level = fx.octreeLevel(sparse);
+      return [&level](BenchTimer& timer) {
+        const auto& nodes = level.nodes;
+        RasterScanContext rsc(nodes);
+        RasterScanContext::occupancy occ;
+        int64_t sum = 0;
+        timer.start();
+        rsc.initializeNextDepth();
+        for (const auto& node : nodes) {
+          rsc.nextNode(&node, occ);
+          sum += occ.neighPattern;
+        }
+        timer.stop();
+        g_sink += sum;
+        return int64_t(nodes.size());
+      };
+    }});
+  }
+
+  list.push_back({"octree.neighPattern", "bin", [](Fixtures& fx) -> Kernel {
+    const auto& level = fx.octreeLevel();
+    return [&level](BenchTimer& timer) {
+      int64_t sum = 0;
+      timer.start();
+      for (int i = 0; i < level.nodes.size(); i++) {
+        OctreeNeighours neigh;
+        prepareGeometryAdvancedNeighPattern(level.occ[i], neigh);
+        int occupancy = level.nodes[i].childOccupancy;
+        for (int j = 0; j < 8; j++) {
+          int ctx1, ctx2;
+          bool sparse;
+          makeGeometryAdvancedNeighPattern(
+            j, neigh, occupancy, ctx1, ctx2, sparse);
+          sum += ctx1 + ctx2 + sparse;
+        }
+      }
+      timer.stop();
+      g_sink += sum;
+      return int64_t(level.nodes.size() * 8);
+    };
+  }});
+
+  //--------------------------------------------------------------------------
+  // Sorting
+
+  list.push_back({"sort.countingSort", "point", [](Fixtures& fx) -> Kernel {
+    const auto& cloud = fx.dense(1);
+    auto work = std::make_shared<PCCPointSet3>();
+    return [=, &cloud](BenchTimer& timer) {
+      *work = cloud;
+      std::array<int, 8> counts = {};
+      timer.start();
+      countingSort(
+        work->begin(), work->end(), counts,
+        [](const PCCPointSet3::Proxy& proxy) {
+          const auto& pt = *proxy;
+          return (pt[0] >> 7 & 1) << 2 | (pt[1] >> 7 & 1) << 1 | pt[2] >> 7 & 1;
+        });
+      timer.stop();
+      g_sink += counts[0];
+      return int64_t(cloud.getPointCount());
+    };
+  }});
+
+  list.push_back({"sort.sortedPointCloud", "point", [](Fixtures& fx) -> Kernel {
+    const auto& cloud = fx.dense(1);
+    return [&cloud](BenchTimer& timer) {
+      std::vector<int64_t> mortonCode;
+      std::vector<int> attributes;
+      timer.start();
+      auto order = sortedPointCloud(3, cloud, mortonCode, attributes);
+      timer.stop();
+      g_sink += order[0];
+      return int64_t(cloud.getPointCount());
+    };
+  }});
+
+  // Partitioning of the points of each octree level as per the octree
+  // encoder: an in-place counting sort of each node of the point cloud
+  // (pset), as done prior to the compact point array (compact), or when
+  // presorted, counting the points of each child (presort).  The presort
+  // itself is timed separately.
+
+  list.push_back({"octree.presort", "point", [](Fixtures& fx) -> Kernel {
+    const auto& cloud = fx.dense(0);
+    const auto& split = fx.octreeSplit();
+    auto input = std::make_shared<std::vector<OctreeEncPoint>>();
+    for (int i = 0; i < cloud.getPointCount(); i++)
+      input->push_back({cloud[i], i});
+    auto work = std::make_shared<std::vector<OctreeEncPoint>>();
+
+    return [=, &split](BenchTimer& timer) {
+      *work = *input;
+      timer.start();
+      bool sorted = presortOctreePoints(
+        *work, split.lvlNodeSizeLog2, int(split.nodes.size()));
+      timer.stop();
+      g_sink += sorted + work->front().idx;
+      return int64_t(input->size());
+    };
+  }});
+
+  for (int d = 0; d < denseOctreeDepth(); d++) {
+    std::string level = ".L" + std::to_string(d);
+
+    list.push_back({"octree.split.pset" + level, "point", [=](Fixtures& fx)
+                    -> Kernel {
+      const auto& cloud = fx.dense(0);
+      const auto& split = fx.octreeSplit();
+      const auto mask = split.childMask(d);
+      auto input = std::make_shared<PCCPointSet3>();
+      input->appendPartition(cloud, split.order[d]);
+      auto work = std::make_shared<PCCPointSet3>();
+
+      return [=, &split](BenchTimer& timer) {
+        *work = *input;
+        int64_t sum = 0;
+        timer.start();
+        for (const auto& node : split.nodes[d]) {
+          std::array<int, 8> counts = {};
+          countingSort(
+            PCCPointSet3::iterator(work.get(), node.first),
+            PCCPointSet3::iterator(work.get(), node.second), counts,
+            [=](const PCCPointSet3::Proxy& proxy) {
+              return octreeChildIdx(mask, *proxy);
+            });
+          sum += counts[0];
+        }
+        timer.stop();
+        g_sink += sum;
+        return int64_t(input->getPointCount());
+      };
+    }});
+
+    list.push_back({"octree.split.compact" + level, "point", [=](Fixtures& fx)
+                    -> Kernel {
+      const auto& cloud = fx.dense(0);
+      const auto& split = fx.octreeSplit();
+      const auto mask = split.childMask(d);
+      auto input = std::make_shared<std::vector<OctreeEncPoint>>();
+      for (int32_t idx : split.order[d])
+        input->push_back({cloud[idx], idx});
+      auto work = std::make_shared<std::vector<OctreeEncPoint>>();
+
+      return [=, &split](BenchTimer& timer) {
+        *work = *input;
+        int64_t sum = 0;
+        timer.start();
+        for (const auto& node : split.nodes[d]) {
+          std::array<int, 8> counts = {};
+          countingSort(
+            std::next(work->begin(), node.first),
+            std::next(work->begin(), node.second), counts,
+            [=](const OctreeEncPoint& p) {
+              return octreeChildIdx(mask, p.pos);
+            });
+          sum += counts[0];
+        }
+        timer.stop();
+        g_sink += sum;
+        return int64_t(input->size());
+      };
+    }});
+
+    list.push_back({"octree.split.presort" + level, "point", [=](Fixtures& fx)
+                    -> Kernel {
+      const auto& split = fx.octreeSplit();
+      const auto mask = split.childMask(d);
+
+      return [=, &split](BenchTimer& timer) {
+        const auto& points = split.presorted;
+        int64_t sum = 0;
+        timer.start();
+        for (const auto& node : split.nodes[d]) {
+          std::array<int, 8> counts = {};
+          for (int i = node.first; i < node.second; i++)
+            counts[octreeChildIdx(mask, points[i].pos)]++;
+          sum += counts[0];
+        }
+        timer.stop();
+        g_sink += sum;
+        return int64_t(points.size());
+      };
+    }});
+  }
+
+  //--------------------------------------------------------------------------
+  // Attribute transform
+
+  list.push_back({"raht.forward", "point", [](Fixtures& fx) -> Kernel {
+    auto data = std::make_shared<RahtData>(fx.dense(0));
+    return [=](BenchTimer& timer) {
+      rahtForward(*data, timer);
+      return int64_t(data->voxelCount());
+    };
+  }});
+
+  list.push_back({"raht.inverse", "point", [](Fixtures& fx) -> Kernel {
+    auto data = std::make_shared<RahtData>(fx.dense(0));
+    auto out = std::make_shared<std::vector<int>>();
+    BenchTimer unused;
+    rahtForward(*data, unused);
+    return [=](BenchTimer& timer) {
+      if (rahtInverse(*data, *out, timer))
+        throw std::runtime_error("inverse transform mismatch");
+      return int64_t(data->voxelCount());
+    };
+  }});
+
+  // Coefficient coding at a low and a high qp.  The .ref variants code
+  // the planar coefficients one position at a time.
+  for (int qp : {28, 46}) {
+    for (bool ref : {false, true}) {
+      std::string suffix = ".qp" + std::to_string(qp) + (ref ? ".ref" : "");
+
+      list.push_back({"attr.code.encode" + suffix, "bin", [=](Fixtures& fx)
+                      -> Kernel {
+        auto data = std::make_shared<RahtData>(fx.dense(0), qp);
+        auto buf = std::make_shared<std::vector<uint8_t>>();
+        BenchTimer unused;
+        rahtForward(*data, unused);
+        int64_t bins = rahtCoeffBins(data->coefficients, data->voxelCount());
+        return [=](BenchTimer& timer) {
+          g_sink += encodeRahtCoeffs(*data, ref, *buf, timer);
+          return bins;
+        };
+      }});
+
+      list.push_back({"attr.code.decode" + suffix, "bin", [=](Fixtures& fx)
+                      -> Kernel {
+        auto data = std::make_shared<RahtData>(fx.dense(0), qp);
+        auto buf = std::make_shared<std::vector<uint8_t>>();
+        BenchTimer unused;
+        rahtForward(*data, unused);
+        encodeRahtCoeffs(*data, ref, *buf, unused);
+        int64_t bins = rahtCoeffBins(data->coefficients, data->voxelCount());
+        return [=](BenchTimer& timer) {
+          if (decodeRahtCoeffs(*data, ref, *buf, timer))
+            throw std::runtime_error("decoder mismatch");
+          return bins;
+        };
+      }});
+    }
+  }
+
+  // Each butterfly variant is checked against the branching reference
+  for (bool inverse : {false, true}) {
+    for (bool branching : {false, true}) {
+      static const char* names[2][2] = {
+        {"raht.butterfly.fwd", "raht.butterfly.fwd.ref"},
+        {"raht.butterfly.inv", "raht.butterfly.inv.ref"}};
+
+      list.push_back({names[inverse][branching], "bfly", [=](Fixtures& fx)
+                      -> Kernel {
+        int numBlocks = std::max(int64_t(1), fx.opts.numPoints / 8);
+        auto in = std::make_shared<std::vector<RahtBlock>>(
+          makeRahtBlocks(numBlocks, fx.opts.seed));
+
+        auto ref = std::make_shared<std::vector<RahtBlock>>(*in);
+        BenchTimer unused;
+        rahtButterflies<BranchingRahtKernel>(*ref, inverse, unused);
+
+        auto work = std::make_shared<std::vector<RahtBlock>>();
+        return [=](BenchTimer& timer) {
+          *work = *in;
+          if (branching)
+            rahtButterflies<BranchingRahtKernel>(*work, inverse, timer);
+          else
+            rahtButterflies<RahtKernel>(*work, inverse, timer);
+          if (*work != *ref)
+            throw std::runtime_error("butterfly mismatch");
+          return int64_t(work->size()) * 12 * 3;
+        };
+      }});
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  // Attribute conversion
+
+  auto bt709Fwd = perPoint(
+    [](Vec3<attr_t> val) { return transformGbrToYCbCrBt709(val); });
+  auto bt709Inv = perPoint(
+    [](Vec3<attr_t> val) { return transformYCbCrBt709ToGbr(val); });
+  auto ycgcorFwd = perPoint(
+    [](Vec3<attr_t> val) { return transformGbrToYCgCoR(8, val); });
+  auto ycgcorInv = perPoint(
+    [](Vec3<attr_t> val) { return transformYCgCoRToGbr(8, val); });
+
+  addConversionBenchmarks<Vec3<attr_t>>(
+    list,
+    {"colour.bt709.fwd", [](Fixtures& fx) { return denseColours(fx); },
+     bt709Fwd, [](Vec3<attr_t>* colours, size_t count) {
+       convertGbrToYCbCrBt709(colours, count);
+     }});
+
+  addConversionBenchmarks<Vec3<attr_t>>(
+    list,
+    {"colour.bt709.inv",
+     [=](Fixtures& fx) { return denseColours(fx, bt709Fwd); }, bt709Inv,
+     [](Vec3<attr_t>* colours, size_t count) {
+       convertYCbCrBt709ToGbr(colours, count);
+     }});
+
+  addConversionBenchmarks<Vec3<attr_t>>(
+    list,
+    {"colour.ycgcor.fwd", [](Fixtures& fx) { return denseColours(fx); },
+     ycgcorFwd, [](Vec3<attr_t>* colours, size_t count) {
+       convertGbrToYCgCoR(8, colours, count);
+     }});
+
+  addConversionBenchmarks<Vec3<attr_t>>(
+    list,
+    {"colour.ycgcor.inv",
+     [=](Fixtures& fx) { return denseColours(fx, ycgcorFwd); }, ycgcorInv,
+     [](Vec3<attr_t>* colours, size_t count) {
+       convertYCgCoRToGbr(8, colours, count);
+     }});
+
+  // Reflectance scaling by 3 (a division by a non power of two), with
+  // per-point references as per the attribute scaling equations
+  AttributeParameters scaleParams;
+  scaleParams.attr_scale_minus1 = 2;
+  scaleParams.attr_frac_bits = 0;
+  scaleParams.attr_offset = 0;
+
+  auto lidarReflectances = [](Fixtures& fx) {
+    const auto& cloud = fx.lidar();
+    std::vector<attr_t> values(cloud.getPointCount());
+    for (int i = 0; i < values.size(); i++)
+      values[i] = cloud.getReflectance(i);
+    return values;
+  };
+
+  addConversionBenchmarks<attr_t>(
+    list,
+    {"attrScale.fwd", lidarReflectances,
+     [=](attr_t* values, size_t count) {
+       const auto& p = scaleParams;
+       int scale = p.attr_scale_minus1 + 1;
+       for (size_t i = 0; i < count; i++)
+         values[i] =
+           attr_t(((values[i] - p.attr_offset) << p.attr_frac_bits) / scale);
+     },
+     [=](attr_t* values, size_t count) {
+       scaleAttributesFwd(scaleParams, values, count);
+     }});
+
+  addConversionBenchmarks<attr_t>(
+    list,
+    {"attrScale.inv", lidarReflectances,
+     [=](attr_t* values, size_t count) {
+       const auto& p = scaleParams;
+       int scale = p.attr_scale_minus1 + 1;
+       for (size_t i = 0; i < count; i++)
+         values[i] =
+           attr_t(((values[i] * scale) >> p.attr_frac_bits) + p.attr_offset);
+     },
+     [=](attr_t* values, size_t count) {
+       scaleAttributesInv(scaleParams, values, count);
+     }});
+
+  //--------------------------------------------------------------------------
+  // Qp region lookup of each point of dense(0), with random regions within
+  // its bounding box.  NB: fewer than six regions are searched directly,
+  // without the grid.
+
+  for (int numRegions : {1, 4, 16}) {
+    std::string name = "qp.regionLookup." + std::to_string(numRegions);
+    list.push_back({name, "point", [=](Fixtures& fx) -> Kernel {
+      const auto& cloud = fx.dense(0);
+      const auto bbox = cloud.computeBoundingBox();
+
+      Rng rng(numRegions);
+      QpRegionList regions(numRegions);
+      for (auto& region : regions) {
+        region.qpOffset = {rng.uniform(9) - 4, rng.uniform(9) - 4};
+        for (int k = 0; k < 3; k++) {
+          int extent = bbox.max[k] - bbox.min[k] + 1;
+          int a = bbox.min[k] + rng.uniform(extent);
+          int b = bbox.min[k] + rng.uniform(extent);
+          region.region.min[k] = std::min(a, b);
+          region.region.max[k] = std::max(a, b);
+        }
+      }
+
+      auto index = std::make_shared<QpRegionIndex>(regions);
+      for (int i = 0; i < cloud.getPointCount(); i++) {
+        int expected = -1;
+        for (int r = 0; r < numRegions && expected < 0; r++)
+          if (regions[r].region.contains(cloud[i]))
+            expected = r;
+        if (index->find(cloud[i]) != expected)
+          throw std::runtime_error(name + " mismatch");
+      }
+
+      return [=, &cloud](BenchTimer& timer) {
+        int64_t sum = 0;
+        timer.start();
+        for (int i = 0; i < cloud.getPointCount(); i++)
+          sum += index->find(cloud[i]);
+        timer.stop();
+        g_sink += sum;
+        return int64_t(cloud.getPointCount());
+      };
+    }});
+  }
+
+  //--------------------------------------------------------------------------
+  // Motion search
+
+  list.push_back({"motion.buildOctree", "point", [](Fixtures& fx) -> Kernel {
+    const auto& cloud = fx.dense(0);
+    auto work = std::make_shared<PCCPointSet3>();
+    return [=, &cloud](BenchTimer& timer) {
+      *work = cloud;
+      timer.start();
+      MSOctree octree(work.get(), {}, 2);
+      timer.stop();
+      g_sink += octree.nodes.size();
+      return int64_t(cloud.getPointCount());
+    };
+  }});
+
+  list.push_back({"motion.nearestNeighbour", "query", [](Fixtures& fx)
+                  -> Kernel {
+    auto data = std::make_shared<MotionData>(fx.dense(0), fx.dense(1));
+    auto queries = std::make_shared<std::vector<point_t>>();
+    Rng rng(fx.opts.seed);
+    for (int i = 0; i < data->curr.getPointCount(); i += 4) {
+      point_t pos = data->curr[i];
+      for (int d = 0; d < 3; d++)
+        pos[d] = std::max(0, pos[d] + rng.uniform(9) - 4);
+      queries->push_back(pos);
+    }
+    return [=](BenchTimer& timer) {
+      int64_t sum = 0;
+      timer.start();
+      for (const auto& pos : *queries)
+        sum += std::get<0>(data->refOctree.nearestNeighbour(pos, 16));
+      timer.stop();
+      g_sink += sum;
+      return int64_t(queries->size());
+    };
+  }});
+
+  list.push_back({"motion.findMotion", "point", [](Fixtures& fx) -> Kernel {
+    auto data = std::make_shared<MotionData>(fx.dense(0), fx.dense(1));
+    const int blockLog2 = ilog2(uint32_t(data->param.motion_block_size));
+    const auto& nodes = data->currOctree.nodes;
+    int64_t numPoints = 0;
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+      if (nodes[i].sizeMinus1 != (1 << blockLog2) - 1)
+        continue;
+      if (data->blocks.size() == fx.opts.motionBlocks)
+        break;
+      data->blocks.push_back(i);
+      numPoints += nodes[i].numPoints();
+    }
+
+    auto buf = std::make_shared<std::vector<uint8_t>>(1 << 20);
+    return [=](BenchTimer& timer) {
+      EntropyEncoder enc;
+      enc.setBuffer(buf->size(), buf->data());
+      enc.start();
+      for (auto idx : data->blocks) {
+        const auto& msoNode = data->currOctree.nodes[idx];
+        PCCOctree3Node node0;
+        node0.start = msoNode.start;
+        node0.end = msoNode.end;
+        node0.pos = msoNode.pos0 >> blockLog2;
+        node0.mSOctreeNodeIdx = idx;
+
+        PUtree puTree;
+        timer.start();
+        motionSearchForNode(
+          data->currOctree, data->refOctree, &node0, data->param,
+          MotionSearchOpts(), blockLog2, &enc, &puTree);
+        timer.stop();
+        g_sink += puTree.MVs.size();
+      }
+      enc.stop();
+      return numPoints;
+    };
+  }});
+
+  //--------------------------------------------------------------------------
+  // Trisoup rendering
+
+  list.push_back({"trisoup.rayTracing", "point", [](Fixtures& fx) -> Kernel {
+    const auto& soup = fx.triangleSoup();
+    auto rendered = std::make_shared<std::vector<int64_t>>();
+    return [=, &soup](BenchTimer& timer) {
+      int bw = soup.blockWidth;
+      rendered->assign(bw * bw * 16, 0);
+      int64_t numPoints = 0;
+      timer.start();
+      for (int i = 0; i < soup.nodepos.size(); i++) {
+        Vec3<int32_t> nodepos = soup.nodepos[i];
+        int nPointsInBlock = 0;
+        int start = soup.vertexStart[i], end = soup.vertexStart[i + 1];
+        for (int j = start; j < end; j++) {
+          const auto& v1 = soup.vertices[j];
+          const auto& v2 = soup.vertices[j + 1 < end ? j + 1 : start];
+          rayTracingTriangle(
+            *rendered, nPointsInBlock, bw, nodepos, v1, v2,
+            soup.centroids[i], 0, 36);
+        }
+        numPoints += nPointsInBlock;
+      }
+      timer.stop();
+      return numPoints;
+    };
+  }});
+
+  list.push_back({"trisoup.flush2PointCloud", "point", [](Fixtures& fx)
+                  -> Kernel {
+    // render each node once, retaining the (unsorted) rendered points
+    const auto& soup = fx.triangleSoup();
+    auto blocks = std::make_shared<std::vector<int64_t>>();
+    auto blockStart = std::make_shared<std::vector<int>>(1, 0);
+    std::vector<int64_t> rendered(soup.blockWidth * soup.blockWidth * 16);
+    for (int i = 0; i < soup.nodepos.size(); i++) {
+      Vec3<int32_t> nodepos = soup.nodepos[i];
+      int nPointsInBlock = 0;
+      int start = soup.vertexStart[i], end = soup.vertexStart[i + 1];
+      for (int j = start; j < end; j++)
+        rayTracingTriangle(
+          rendered, nPointsInBlock, soup.blockWidth, nodepos,
+          soup.vertices[j], soup.vertices[j + 1 < end ? j + 1 : start],
+          soup.centroids[i], 0, 36);
+      blocks->insert(
+        blocks->end(), rendered.begin(), rendered.begin() + nPointsInBlock);
+      blockStart->push_back(blocks->size());
+    }
+
+    auto work = std::make_shared<std::vector<int64_t>>();
+    auto recCloud = std::make_shared<PCCPointSet3>();
+    return [=](BenchTimer& timer) {
+      *work = *blocks;
+      recCloud->resize(0);
+      int nRecPoints = 0;
+      timer.start();
+      for (int i = 0; i + 1 < blockStart->size(); i++) {
+        int start = (*blockStart)[i];
+        flush2PointCloud(
+          nRecPoints, work->begin() + start, (*blockStart)[i + 1] - start,
+          *recCloud);
+      }
+      timer.stop();
+      g_sink += nRecPoints;
+      return int64_t(blocks->size());
+    };
+  }});
+
+  //--------------------------------------------------------------------------
+  // Slice partitioning of lidar sweeps
+
+  struct PartitionBench {
+    const char* name;
+    int64_t numPoints;
+    PartitionMethod method;
+  };
+
+  const PartitionBench partitionBenches[] = {
+    {"partition.geom.1M", 1000000, PartitionMethod::kUniformGeom},
+    {"partition.square.1M", 1000000, PartitionMethod::kUniformSquare},
+    {"partition.octree.1M", 1000000, PartitionMethod::kOctreeUniform},
+    {"partition.geom.10M", 10000000, PartitionMethod::kUniformGeom},
+    {"partition.square.10M", 10000000, PartitionMethod::kUniformSquare},
+    {"partition.octree.10M", 10000000, PartitionMethod::kOctreeUniform},
+    {"partition.geom.50M", 50000000, PartitionMethod::kUniformGeom},
+    {"partition.square.50M", 50000000, PartitionMethod::kUniformSquare},
+    {"partition.octree.50M", 50000000, PartitionMethod::kOctreeUniform}};
+
+  for (const auto& pb : partitionBenches) {
+    list.push_back({pb.name, "point", [=](Fixtures& fx) -> Kernel {
+      const auto& cloud = fx.lidarSweep(pb.numPoints);
+
+      PartitionParams params;
+      params.method = pb.method;
+      params.octreeDepth = 1;
+      params.sliceMaxPointsTrisoup = 5000000;
+      params.sliceMaxPoints = 30000;
+      params.sliceMinPoints = 15000;
+      params.tileSize = 0;
+      params.safeTrisoupPartionning = false;
+
+      return [=, &cloud](BenchTimer& timer) {
+        std::vector<Partition> slices;
+        timer.start();
+        switch (params.method) {
+        case PartitionMethod::kUniformGeom:
+          slices = partitionByUniformGeom(params, cloud, 0, 0);
+          break;
+        case PartitionMethod::kUniformSquare:
+          slices = partitionByUniformSquare(params, cloud, 0, 0);
+          break;
+        default: slices = partitionByOctreeDepth(params, cloud, 0); break;
+        }
+        timer.stop();
+        g_sink += slices.size();
+        return int64_t(cloud.getPointCount());
+      };
+    }});
+  }
+
+  //--------------------------------------------------------------------------
+  // File and bitstream io
+
+  for (bool ascii : {false, true}) {
+    const char* writeName = ascii ? "ply.write.ascii" : "ply.write.binary";
+    list.push_back({writeName, "point", [=](Fixtures& fx) -> Kernel {
+      const auto& cloud = fx.dense(0);
+      auto path = fx.opts.tmpPath;
+      return [=, &cloud](BenchTimer& timer) {
+        ply::PropertyNameMap names;
+        names.position = {"x", "y", "z"};
+        timer.start();
+        if (!ply::write(cloud, names, 1., 0., path, ascii))
+          throw std::runtime_error("failed to write " + path);
+        timer.stop();
+        return int64_t(cloud.getPointCount());
+      };
+    }});
+
+    const char* readName = ascii ? "ply.read.ascii" : "ply.read.binary";
+    list.push_back({readName, "point", [=](Fixtures& fx) -> Kernel {
+      const auto& cloud = fx.dense(0);
+      auto path = fx.opts.tmpPath;
+      ply::PropertyNameMap names;
+      names.position = {"x", "y", "z"};
+      if (!ply::write(cloud, names, 1., 0., path, ascii))
+        throw std::runtime_error("failed to write " + path);
+      return [=](BenchTimer& timer) {
+        PCCPointSet3 in;
+        timer.start();
+        if (!ply::read(path, names, 1., in))
+          throw std::runtime_error("failed to read " + path);
+        timer.stop();
+        return int64_t(in.getPointCount());
+      };
+    }});
+  }
+
+  auto makePayloads = [](uint64_t seed) {
+    // 4096 payloads of between 16 bytes and 8 KiB
+    auto payloads = std::make_shared<std::vector<PayloadBuffer>>();
+    Rng rng(seed);
+    for (int i = 0; i < 4096; i++) {
+      payloads->emplace_back(PayloadType::kGeometryBrick);
+      payloads->back().resize(16 << rng.uniform(10));
+      for (auto& byte : payloads->back())
+        byte = char(rng.next());
+    }
+    return payloads;
+  };
+
+  auto serialise = [](const std::vector<PayloadBuffer>& payloads) {
+    std::ostringstream os;
+    for (const auto& payload : payloads)
+      writeTlv(payload, os);
+    return std::make_shared<std::string>(os.str());
+  };
+
+  list.push_back({"tlv.write", "byte", [=](Fixtures& fx) -> Kernel {
+    auto payloads = makePayloads(fx.opts.seed);
+    int64_t bytes = serialise(*payloads)->size();
+    return [=](BenchTimer& timer) {
+      std::ostringstream os;
+      timer.start();
+      for (const auto& payload : *payloads)
+        writeTlv(payload, os);
+      timer.stop();
+      return bytes;
+    };
+  }});
+
+  list.push_back({"tlv.read", "byte", [=](Fixtures& fx) -> Kernel {
+    auto data = serialise(*makePayloads(fx.opts.seed));
+    return [=](BenchTimer& timer) {
+      std::istringstream is(*data);
+      PayloadBuffer buf;
+      int64_t count = 0;
+      timer.start();
+      while (readTlv(is, &buf))
+        count++;
+      timer.stop();
+      g_sink += count;
+      return int64_t(data->size());
+    };
+  }});
+
+  list.push_back({"tlv.parse", "byte", [=](Fixtures& fx) -> Kernel {
+    auto data = serialise(*makePayloads(fx.opts.seed));
+    return [=](BenchTimer& timer) {
+      const char* end = data->data() + data->size();
+      PayloadView view;
+      int64_t count = 0;
+      timer.start();
+      for (const char* p = data->data(); p && p < end; count++)
+        p = parseTlv(p, end, &view);
+      timer.stop();
+      g_sink += count;
+      return int64_t(data->size());
+    };
+  }});
+
+
+  // Indexing a coded multi-frame bitstream, either memory mapped, or
+  // read into memory
+
+  for (bool map : {true, false}) {
+    const char* name = map ? "tlv.index.mmap" : "tlv.index.read";
+    list.push_back({name, "byte", [=](Fixtures& fx) -> Kernel {
+      const auto& stream = fx.tlvStream();
+      return [=, &stream](BenchTimer& timer) {
+        MappedFile file;
+        TlvIndex index;
+        timer.start();
+        if (!file.open(stream.path, map)
+            || !index.build(file.data(), file.size()))
+          throw std::runtime_error("failed to index " + stream.path);
+        timer.stop();
+
+        if (index.frames.size() != stream.numFrames)
+          throw std::runtime_error(std::string(name) + " frame mismatch");
+        g_sink += index.payloads.size();
+        return int64_t(file.size());
+      };
+    }});
+  }
+
+  // The time to output the last frame of a bitstream, decoding from the
+  // first frame (linear) or seeking to the preceding random access point
+  // (seek).  Each is checked against a linear decode.  The items are the
+  // points decoded to reach the frame.
+
+  for (bool seek : {false, true}) {
+    const char* name = seek ? "tlv.decode.seek" : "tlv.decode.linear";
+    list.push_back({name, "point", [=](Fixtures& fx) -> Kernel {
+      const auto& stream = fx.tlvStream();
+      const int frameIdx = stream.numFrames - 1;
+
+      BenchTimer unused;
+      auto expected = std::make_shared<PCCPointSet3>();
+      decodeFrame(stream, frameIdx, false, unused, expected.get());
+
+      return [=, &stream](BenchTimer& timer) {
+        PCCPointSet3 frame;
+        int64_t numPoints = decodeFrame(stream, frameIdx, seek, timer, &frame);
+        if (!samePoints(frame, *expected))
+          throw std::runtime_error(std::string(name) + " mismatch");
+        return numPoints;
+      };
+    }});
+  }
+
+  return list;
+}
+
+//============================================================================
+
+bool
+selected(const Options& opts, const std::string& name)
+{
+  if (opts.filter.empty())
+    return true;
+
+  std::istringstream patterns(opts.filter);
+  std::string pattern;
+  while (std::getline(patterns, pattern, ','))
+    if (!pattern.empty() && name.find(pattern) != std::string::npos)
+      return true;
+
+  return false;
+}
+
+//----------------------------------------------------------------------------
+
+void
+runBenchmark(const Benchmark& bench, Fixtures& fx)
+{
+  const auto& opts = fx.opts;
+  Kernel kernel = bench.setup(fx);
+
+  BenchTimer timer;
+  for (int i = 0; i < opts.warmup; i++)
+    kernel(timer);
+
+  // the time of each iteration
+  std::vector<double> ns;
+  int64_t items = 0;
+  for (int i = 0; i < opts.iterations; i++) {
+    timer.reset();
+    items = kernel(timer);
+    ns.push_back(timer.ns());
+  }
+
+  std::sort(ns.begin(), ns.end());
+  double median = ns[ns.size() / 2];
+  if (!(ns.size() & 1))
+    median = (median + ns[ns.size() / 2 - 1]) / 2;
+
+  double spread = median > 0 ? 100. * (ns.back() - ns.front()) / median : 0;
+  double nsPerItem = items ? median / items : 0.;
+  double itemsPerSec = median > 0 ? items * 1e9 / median : 0.;
+
+  cout << std::left << setw(26) << bench.name << std::right << setw(6)
+       << bench.unit << setw(10) << items << fixed << setprecision(3)
+       << setw(11) << median * 1e-6 << setprecision(2) << setw(10)
+       << nsPerItem << setw(11) << itemsPerSec * 1e-6 << setprecision(1)
+       << setw(7) << spread << "%" << defaultfloat << endl;
+}
+
+//============================================================================
+
+int
+main(int argc, char* argv[])
+{
+  cout << "MPEG PCC codec kernel benchmarks from Test Model C13" << endl;
+
+  Options opts;
+  if (!parseParameters(argc, argv, opts))
+    return 1;
+
+  auto list = benchmarks();
+
+  if (opts.list) {
+    for (const auto& bench : list)
+      if (selected(opts, bench.name))
+        cout << bench.name << endl;
+    return 0;
+  }
+
+  cout << std::left << setw(26) << "benchmark" << std::right << setw(6)
+       << "unit" << setw(10) << "items" << setw(11) << "ms/iter"
+       << setw(10) << "ns/item" << setw(11) << "Mitems/s" << setw(8)
+       << "spread" << endl;
+
+  try {
+    Fixtures fx(opts);
+    for (const auto& bench : list)
+      if (selected(opts, bench.name))
+        runBenchmark(bench, fx);
+  }
+  catch (const exception& e) {
+    cerr << "Error: " << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+// :: Command line / config parsing
+
+bool
+parseParameters(int argc, char* argv[], Options& params)
+{
+  namespace po = df::program_options_lite;
+  bool print_help = false;
+
+  /* clang-format off */
+  // The definition of the program/config options, along with default values.
+  //
+  // NB: when updating the following tables:
+  //      (a) please keep to 80-columns for easier reading at a glance,
+  //      (b) do not vertically align values -- it breaks quickly
+  //
+  po::Options opts;
+  opts.addOptions()
+  ("help", print_help, false, "this help text")
+  ("config,c", po::parseConfigFile, "configuration file name")
+
+  ("filter",
+    params.filter, {},
+    "Comma separated list of substrings of the benchmarks to run\n"
+    "(empty = all)")
+
+  ("list",
+    params.list, false,
+    "List the selected benchmarks without running them")
+
+  ("warmup",
+    params.warmup, 2,
+    "Number of untimed iterations of each benchmark")
+
+  ("iterations",
+    params.iterations, 10,
+    "Number of timed iterations of each benchmark")
+
+  ("numPoints",
+    params.numPoints, int64_t(200000),
+    "Approximate number of points in the synthetic source")
+
+  ("seed",
+    params.seed, uint64_t(1),
+    "Seed from which the inputs are derived")
+
+  ("motionBlocks",
+    params.motionBlocks, 32,
+    "Maximum number of blocks searched per motion search iteration")
+
+  ("bitstreamPath",
+    params.bitstreamPath, std::string(),
+    "Coded bitstream used by the tlv.index and tlv.decode benchmarks\n"
+    "(empty = a synthetic inter coded stream)")
+
+  ("tmpPath",
+    params.tmpPath, std::string("tmc3-bench.tmp.ply"),
+    "Scratch file used by the ply benchmarks")
+  ;
+  /* clang-format on */
+
+  po::setDefaults(opts);
+  po::ErrorReporter err;
+  const list<const char*>& argv_unhandled =
+    po::scanArgv(opts, argc, (const char**)argv, err);
+
+  for (const auto arg : argv_unhandled) {
+    err.warn() << "Unhandled argument ignored: " << arg << "\n";
+  }
+
+  if (print_help) {
+    po::doHelp(std::cout, opts, 78);
+    return false;
+  }
+
+  if (params.iterations < 1) {
+    err.error() << "iterations must be at least 1\n";
+  }
+
+  if (!params.list)
+    po::dumpCfg(cout, opts, 4);
+
+  return !err.is_errored;
+}